@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ *
+ * @file       WorldMagModelCache.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Precomputed World Magnetic Model grid around the vehicle.
+ *
+ *             The full model takes a spherical harmonic expansion and a
+ *             few hundred bytes of heap per call. The field changes by a
+ *             few nT per kilometre, so a small lat/lon/alt grid evaluated
+ *             once and interpolated trilinearly gives the same answer in a
+ *             fixed, short time.
+ *
+ *             The grid is refreshed in the background one model evaluation
+ *             per WMM_CacheUpdate() call, into a second buffer that is
+ *             switched in when complete. Lookups never wait on a refresh.
+ *
+ *             Within a few tenths of a degree of the poles north turns
+ *             around inside the grid and interpolation gets poor, the
+ *             error bound reports that.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "WorldMagModel.h"
+#include "WorldMagModelCache.h"
+
+#define HALF_SPAN  ((WMM_CACHE_NODES - 1) / 2)
+#define NODE_COUNT (WMM_CACHE_NODES * WMM_CACHE_NODES * WMM_CACHE_NODES)
+#define CELL_COUNT ((WMM_CACHE_NODES - 1) * (WMM_CACHE_NODES - 1) * (WMM_CACHE_NODES - 1))
+
+struct WMMCacheGrid {
+    float    lat; // centre node
+    float    lon;
+    float    alt;
+    uint16_t month;
+    uint16_t day;
+    uint16_t year;
+    bool     valid;
+    float    errorBound; // largest interpolation error found at the cell centres
+    float    B[WMM_CACHE_NODES][WMM_CACHE_NODES][WMM_CACHE_NODES][3];
+};
+
+static struct WMMCacheGrid grids[2];
+static volatile uint8_t active;
+
+// Refresh request, written by lookups from any task and taken by WMM_CacheUpdate()
+static volatile bool requested;
+static volatile float requestLat;
+static volatile float requestLon;
+static volatile float requestAlt;
+
+// Refresh progress, 0 when idle, otherwise the next node or cell centre + 1
+static uint16_t step;
+
+/**************************************************************************************
+*   Example use
+*
+*	// lookup from any task, fast and deterministic
+*	if (WMM_CacheGetMagVector(Lat, Lon, Alt, B) < 0) {
+*	    // not covered (yet), a refresh has been requested
+*	}
+*
+*	// from the task that owns the WMM, e.g. on every GPS update
+*	WMM_CacheRequest(Lat, Lon, Alt); // keep the grid around the vehicle
+*	WMM_CacheUpdate(Month, Day, Year); // one full model evaluation at most
+**************************************************************************************/
+
+static float wrapLongitude(float lon)
+{
+    if (lon > 180.0f) {
+        lon -= 360.0f;
+    } else if (lon < -180.0f) {
+        lon += 360.0f;
+    }
+    return lon;
+}
+
+/* Keep the whole grid inside the valid latitude range */
+static float centreLatitude(float lat)
+{
+    const float limit = 90.0f - HALF_SPAN * WMM_CACHE_LAT_SPACING;
+
+    if (lat > limit) {
+        return limit;
+    }
+    if (lat < -limit) {
+        return -limit;
+    }
+    return lat;
+}
+
+/* Trilinear interpolation, x y z in nodes from the south west bottom corner */
+static void interpolate(const struct WMMCacheGrid *grid, float x, float y, float z, float B[3])
+{
+    int i = (int)x;
+    int j = (int)y;
+    int k = (int)z;
+
+    if (i > WMM_CACHE_NODES - 2) {
+        i = WMM_CACHE_NODES - 2;
+    }
+    if (j > WMM_CACHE_NODES - 2) {
+        j = WMM_CACHE_NODES - 2;
+    }
+    if (k > WMM_CACHE_NODES - 2) {
+        k = WMM_CACHE_NODES - 2;
+    }
+    const float fx = x - i;
+    const float fy = y - j;
+    const float fz = z - k;
+
+    for (int n = 0; n < 3; n++) {
+        const float c00 = grid->B[i][j][k][n] + fx * (grid->B[i + 1][j][k][n] - grid->B[i][j][k][n]);
+        const float c01 = grid->B[i][j][k + 1][n] + fx * (grid->B[i + 1][j][k + 1][n] - grid->B[i][j][k + 1][n]);
+        const float c10 = grid->B[i][j + 1][k][n] + fx * (grid->B[i + 1][j + 1][k][n] - grid->B[i][j + 1][k][n]);
+        const float c11 = grid->B[i][j + 1][k + 1][n] + fx * (grid->B[i + 1][j + 1][k + 1][n] - grid->B[i][j + 1][k + 1][n]);
+        const float c0  = c00 + fy * (c10 - c00);
+        const float c1  = c01 + fy * (c11 - c01);
+        B[n] = c0 + fz * (c1 - c0);
+    }
+}
+
+/**
+ * Magnetic field from the cached grid
+ * \param[in] Lat latitude in degrees
+ * \param[in] Lon longitude in degrees
+ * \param[in] AltEllipsoid altitude above the WGS-84 ellipsoid in metres
+ * \param[out] B NED magnetic vector, same units as WMM_GetMagVector()
+ * \return 0 if the location is covered by the grid
+ * \return -1 if it is not, a refresh around it is requested and B is untouched
+ */
+int WMM_CacheGetMagVector(float Lat, float Lon, float AltEllipsoid, float B[3])
+{
+    const struct WMMCacheGrid *grid = &grids[active];
+
+    if (!grid->valid) {
+        WMM_CacheRequest(Lat, Lon, AltEllipsoid);
+        return -1;
+    }
+
+    const float x = (Lat - grid->lat) / WMM_CACHE_LAT_SPACING;
+    const float y = wrapLongitude(Lon - grid->lon) / WMM_CACHE_LON_SPACING;
+    const float z = (AltEllipsoid - grid->alt) / WMM_CACHE_ALT_SPACING;
+
+    // written so that NaN ends up outside as well
+    if (!(fabsf(x) <= HALF_SPAN && fabsf(y) <= HALF_SPAN && fabsf(z) <= HALF_SPAN)) {
+        WMM_CacheRequest(Lat, Lon, AltEllipsoid);
+        return -1;
+    }
+
+    // start moving the grid before the vehicle gets to the edge
+    WMM_CacheRequest(Lat, Lon, AltEllipsoid);
+
+    interpolate(grid, x + HALF_SPAN, y + HALF_SPAN, z + HALF_SPAN, B);
+    return 0;
+}
+
+/**
+ * Ask for the grid to be moved to a location, if it isn't already close to the
+ * centre of the current one. Cheap, can be called from any task.
+ * \param[in] Lat latitude in degrees
+ * \param[in] Lon longitude in degrees
+ * \param[in] AltEllipsoid altitude above the WGS-84 ellipsoid in metres
+ */
+void WMM_CacheRequest(float Lat, float Lon, float AltEllipsoid)
+{
+    const struct WMMCacheGrid *grid = &grids[active];
+
+    if (!(Lat >= -90.0f && Lat <= 90.0f && Lon >= -180.0f && Lon <= 180.0f && isfinite(AltEllipsoid))) {
+        return;
+    }
+    Lat = centreLatitude(Lat);
+
+    if (grid->valid &&
+        fabsf(Lat - grid->lat) <= 0.5f * WMM_CACHE_LAT_SPACING &&
+        fabsf(wrapLongitude(Lon - grid->lon)) <= 0.5f * WMM_CACHE_LON_SPACING &&
+        fabsf(AltEllipsoid - grid->alt) <= 0.5f * WMM_CACHE_ALT_SPACING) {
+        return;
+    }
+
+    // a torn update from two requesting tasks just moves the centre a little
+    requestLat = Lat;
+    requestLon = Lon;
+    requestAlt = AltEllipsoid;
+    requested  = true;
+}
+
+/**
+ * Advance the background refresh by at most one full model evaluation.
+ * WMM_GetMagVector() is not reentrant, call this from the task that owns it.
+ * \param[in] Month Day Year current date, the grid is rebuilt when the month changes
+ * \return 1 while a refresh is in progress
+ * \return 0 when idle
+ * \return < 0 if the model failed, the refresh is abandoned
+ */
+int WMM_CacheUpdate(uint16_t Month, uint16_t Day, uint16_t Year)
+{
+    struct WMMCacheGrid *next = &grids[active ^ 1];
+
+    if (step == 0) {
+        const struct WMMCacheGrid *grid = &grids[active];
+        bool dateChanged = grid->valid && (grid->year != Year || grid->month != Month);
+
+        if (!requested && !dateChanged) {
+            return 0;
+        }
+        if (requested) {
+            requested = false;
+            next->lat = requestLat;
+            next->lon = requestLon;
+            next->alt = requestAlt;
+        } else {
+            next->lat = grid->lat;
+            next->lon = grid->lon;
+            next->alt = grid->alt;
+        }
+        next->month = Month;
+        next->day   = Day;
+        next->year  = Year;
+        next->valid = false;
+        next->errorBound = 0.0f;
+    }
+
+    if (step < NODE_COUNT) {
+        const int i = step / (WMM_CACHE_NODES * WMM_CACHE_NODES);
+        const int j = (step / WMM_CACHE_NODES) % WMM_CACHE_NODES;
+        const int k = step % WMM_CACHE_NODES;
+        int returned = WMM_GetMagVector(next->lat + (i - HALF_SPAN) * WMM_CACHE_LAT_SPACING,
+                                        wrapLongitude(next->lon + (j - HALF_SPAN) * WMM_CACHE_LON_SPACING),
+                                        next->alt + (k - HALF_SPAN) * WMM_CACHE_ALT_SPACING,
+                                        next->month, next->day, next->year, next->B[i][j][k]);
+        if (returned < 0) {
+            step = 0;
+            return returned;
+        }
+    } else {
+        // Interpolation error is largest in the middle of a cell, check each one against the model
+        const int cell = step - NODE_COUNT;
+        const float x  = cell / ((WMM_CACHE_NODES - 1) * (WMM_CACHE_NODES - 1)) + 0.5f;
+        const float y  = (cell / (WMM_CACHE_NODES - 1)) % (WMM_CACHE_NODES - 1) + 0.5f;
+        const float z  = cell % (WMM_CACHE_NODES - 1) + 0.5f;
+        float model[3];
+        float interpolated[3];
+
+        int returned = WMM_GetMagVector(next->lat + (x - HALF_SPAN) * WMM_CACHE_LAT_SPACING,
+                                        wrapLongitude(next->lon + (y - HALF_SPAN) * WMM_CACHE_LON_SPACING),
+                                        next->alt + (z - HALF_SPAN) * WMM_CACHE_ALT_SPACING,
+                                        next->month, next->day, next->year, model);
+        if (returned < 0) {
+            step = 0;
+            return returned;
+        }
+        interpolate(next, x, y, z, interpolated);
+        const float dx    = interpolated[0] - model[0];
+        const float dy    = interpolated[1] - model[1];
+        const float dz    = interpolated[2] - model[2];
+        const float error = sqrtf(dx * dx + dy * dy + dz * dz);
+        if (error > next->errorBound) {
+            next->errorBound = error;
+        }
+    }
+
+    if (++step < NODE_COUNT + CELL_COUNT) {
+        return 1;
+    }
+
+    step = 0;
+    next->valid = true;
+    active ^= 1;
+    return 0;
+}
+
+/**
+ * Interpolation error of the current grid
+ * \return largest difference to the full model seen at the cell centres,
+ * same units as the field, or -1 if there is no grid
+ */
+float WMM_CacheGetErrorBound()
+{
+    const struct WMMCacheGrid *grid = &grids[active];
+
+    return grid->valid ? grid->errorBound : -1.0f;
+}
+
+/**
+ * Drop the cached grid and any refresh in progress
+ */
+void WMM_CacheInvalidate()
+{
+    grids[active].valid = false;
+    requested = false;
+    step = 0;
+}
@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ *
+ * @file       controllatency.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Latency of the control path, from the gyro sample to the
+ *             actuator outputs.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <openpilot.h>
+#include "inc/controllatency.h"
+
+// Private variables
+static volatile uint32_t sensorTimestamp; // raw time of the newest gyro sample
+static volatile bool sensorPending; // set by the sensor stamp, cleared by the control stamp
+static uint32_t controlTimestamp; // sample the last inner loop run worked on
+static bool outputPending; // set by the control stamp, cleared by the output stamp
+static struct ControlLatencyStats stats = { .controlMin = UINT32_MAX, .outputMin = UINT32_MAX };
+
+/**
+ * Record the time the newest gyro sample was taken, called right before it is published.
+ * \param[in] timestamp PIOS_DELAY_GetRaw() time of the sample
+ */
+void ControlLatencySensor(uint32_t timestamp)
+{
+    portENTER_CRITICAL();
+    if (sensorPending) {
+        stats.missed++;
+    }
+    sensorTimestamp = timestamp;
+    sensorPending   = true;
+    portEXIT_CRITICAL();
+}
+
+/**
+ * Record the start of an inner loop run. Runs that find no new gyro sample are not counted.
+ */
+void ControlLatencyControl(void)
+{
+    portENTER_CRITICAL();
+    if (!sensorPending) {
+        portEXIT_CRITICAL();
+        return;
+    }
+    controlTimestamp = sensorTimestamp;
+    sensorPending    = false;
+    outputPending    = true;
+
+    uint32_t latency = PIOS_DELAY_DiffuS(controlTimestamp);
+    stats.controlCount++;
+    stats.controlSum += latency;
+    if (latency < stats.controlMin) {
+        stats.controlMin = latency;
+    }
+    if (latency > stats.controlMax) {
+        stats.controlMax = latency;
+    }
+    portEXIT_CRITICAL();
+}
+
+/**
+ * Record that the actuator outputs were written. Only the first output after
+ * each inner loop run is counted.
+ */
+void ControlLatencyOutput(void)
+{
+    if (!outputPending) {
+        return;
+    }
+    outputPending = false;
+
+    uint32_t latency = PIOS_DELAY_DiffuS(controlTimestamp);
+    portENTER_CRITICAL();
+    stats.outputCount++;
+    stats.outputSum += latency;
+    if (latency < stats.outputMin) {
+        stats.outputMin = latency;
+    }
+    if (latency > stats.outputMax) {
+        stats.outputMax = latency;
+    }
+    portEXIT_CRITICAL();
+}
+
+/**
+ * Get the statistics gathered since the last call and start over.
+ * \param[out] out the statistics, the minimums are UINT32_MAX when nothing was counted
+ */
+void ControlLatencyGetStats(struct ControlLatencyStats *out)
+{
+    portENTER_CRITICAL();
+    *out = stats;
+    stats.controlCount = 0;
+    stats.controlMin   = UINT32_MAX;
+    stats.controlMax   = 0;
+    stats.controlSum   = 0;
+    stats.outputCount  = 0;
+    stats.outputMin    = UINT32_MAX;
+    stats.outputMax    = 0;
+    stats.outputSum    = 0;
+    stats.missed = 0;
+    portEXIT_CRITICAL();
+}
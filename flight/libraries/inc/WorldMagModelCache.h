@@ -0,0 +1,45 @@
+/**
+ ******************************************************************************
+ *
+ * @file       WorldMagModelCache.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Include file of the cached World Magnetic Model lookup.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef WORLDMAGMODELCACHE_H_
+#define WORLDMAGMODELCACHE_H_
+
+#include <stdint.h>
+
+// Grid geometry, nodes per axis centred on the requested location
+#define WMM_CACHE_NODES       3
+#define WMM_CACHE_LAT_SPACING 0.5f    // degrees
+#define WMM_CACHE_LON_SPACING 0.5f    // degrees
+#define WMM_CACHE_ALT_SPACING 2500.0f // metres
+
+// Exposed Function Prototypes
+int WMM_CacheGetMagVector(float Lat, float Lon, float AltEllipsoid, float B[3]);
+void WMM_CacheRequest(float Lat, float Lon, float AltEllipsoid);
+int WMM_CacheUpdate(uint16_t Month, uint16_t Day, uint16_t Year);
+float WMM_CacheGetErrorBound();
+void WMM_CacheInvalidate();
+
+#endif /* WORLDMAGMODELCACHE_H_ */
@@ -0,0 +1,56 @@
+/**
+ ******************************************************************************
+ *
+ * @file       controllatency.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Latency of the control path, from the gyro sample to the
+ *             actuator outputs.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef CONTROLLATENCY_H
+#define CONTROLLATENCY_H
+
+#include <stdint.h>
+
+struct ControlLatencyStats {
+    uint32_t controlCount; // inner loop runs that picked up a new gyro sample
+    uint32_t controlMin; // sensor to control, in us
+    uint32_t controlMax;
+    uint32_t controlSum;
+    uint32_t outputCount; // of those, the ones that made it to the outputs
+    uint32_t outputMin; // sensor to output, in us
+    uint32_t outputMax;
+    uint32_t outputSum;
+    uint32_t missed; // gyro samples the inner loop never saw
+};
+
+/*
+ * The three stamps are called in order along the control path, the sensor
+ * stamp by the Sensors (or Attitude) module before the gyro is published,
+ * the control stamp at the start of the inner loop and the output stamp once
+ * the actuator outputs have been written.
+ */
+void ControlLatencySensor(uint32_t timestamp);
+void ControlLatencyControl(void);
+void ControlLatencyOutput(void);
+void ControlLatencyGetStats(struct ControlLatencyStats *stats);
+
+#endif /* CONTROLLATENCY_H */
@@ -0,0 +1,386 @@
+/*
+ * Generated by make/scripts/insgps_kernelgen.py 13, do not edit.
+ *
+ * Covariance prediction and measurement kernels of the 13 state INSGPS EKF,
+ * specialized for the sparsity of F, G and H in LinearizeFG() and LinearizeH().
+ */
+#ifndef INSGPS13KERNELS_H
+#define INSGPS13KERNELS_H
+
+#include <stdint.h>
+
+/**
+ * Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G', written over P
+ */
+static inline void insgps13_covariance_prediction(float F[13][13], float G[13][9], float Q[9], float dT, float P[13][13])
+{
+    const float dT1  = 1.0f / dT;
+    const float dTsq = dT * dT;
+    float D[13][13];
+
+    // D = P/T + F*P, only where the upper triangle of Pnew needs it
+    D[0][0] = P[0][0] * dT1 + P[3][0];
+    D[0][1] = P[0][1] * dT1 + P[3][1];
+    D[0][2] = P[0][2] * dT1 + P[3][2];
+    D[0][3] = P[0][3] * dT1 + P[3][3];
+    D[0][4] = P[0][4] * dT1 + P[3][4];
+    D[0][5] = P[0][5] * dT1 + P[3][5];
+    D[0][6] = P[0][6] * dT1 + P[3][6];
+    D[0][7] = P[0][7] * dT1 + P[3][7];
+    D[0][8] = P[0][8] * dT1 + P[3][8];
+    D[0][9] = P[0][9] * dT1 + P[3][9];
+    D[0][10] = P[0][10] * dT1 + P[3][10];
+    D[0][11] = P[0][11] * dT1 + P[3][11];
+    D[0][12] = P[0][12] * dT1 + P[3][12];
+    D[1][1] = P[1][1] * dT1 + P[4][1];
+    D[1][2] = P[1][2] * dT1 + P[4][2];
+    D[1][3] = P[1][3] * dT1 + P[4][3];
+    D[1][4] = P[1][4] * dT1 + P[4][4];
+    D[1][5] = P[1][5] * dT1 + P[4][5];
+    D[1][6] = P[1][6] * dT1 + P[4][6];
+    D[1][7] = P[1][7] * dT1 + P[4][7];
+    D[1][8] = P[1][8] * dT1 + P[4][8];
+    D[1][9] = P[1][9] * dT1 + P[4][9];
+    D[1][10] = P[1][10] * dT1 + P[4][10];
+    D[1][11] = P[1][11] * dT1 + P[4][11];
+    D[1][12] = P[1][12] * dT1 + P[4][12];
+    D[2][2] = P[2][2] * dT1 + P[5][2];
+    D[2][3] = P[2][3] * dT1 + P[5][3];
+    D[2][4] = P[2][4] * dT1 + P[5][4];
+    D[2][5] = P[2][5] * dT1 + P[5][5];
+    D[2][6] = P[2][6] * dT1 + P[5][6];
+    D[2][7] = P[2][7] * dT1 + P[5][7];
+    D[2][8] = P[2][8] * dT1 + P[5][8];
+    D[2][9] = P[2][9] * dT1 + P[5][9];
+    D[2][10] = P[2][10] * dT1 + P[5][10];
+    D[2][11] = P[2][11] * dT1 + P[5][11];
+    D[2][12] = P[2][12] * dT1 + P[5][12];
+    D[3][3] = P[3][3] * dT1 + F[3][6] * P[6][3] + F[3][7] * P[7][3] + F[3][8] * P[8][3] + F[3][9] * P[9][3];
+    D[3][4] = P[3][4] * dT1 + F[3][6] * P[6][4] + F[3][7] * P[7][4] + F[3][8] * P[8][4] + F[3][9] * P[9][4];
+    D[3][5] = P[3][5] * dT1 + F[3][6] * P[6][5] + F[3][7] * P[7][5] + F[3][8] * P[8][5] + F[3][9] * P[9][5];
+    D[3][6] = P[3][6] * dT1 + F[3][6] * P[6][6] + F[3][7] * P[7][6] + F[3][8] * P[8][6] + F[3][9] * P[9][6];
+    D[3][7] = P[3][7] * dT1 + F[3][6] * P[6][7] + F[3][7] * P[7][7] + F[3][8] * P[8][7] + F[3][9] * P[9][7];
+    D[3][8] = P[3][8] * dT1 + F[3][6] * P[6][8] + F[3][7] * P[7][8] + F[3][8] * P[8][8] + F[3][9] * P[9][8];
+    D[3][9] = P[3][9] * dT1 + F[3][6] * P[6][9] + F[3][7] * P[7][9] + F[3][8] * P[8][9] + F[3][9] * P[9][9];
+    D[3][10] = P[3][10] * dT1 + F[3][6] * P[6][10] + F[3][7] * P[7][10] + F[3][8] * P[8][10] + F[3][9] * P[9][10];
+    D[3][11] = P[3][11] * dT1 + F[3][6] * P[6][11] + F[3][7] * P[7][11] + F[3][8] * P[8][11] + F[3][9] * P[9][11];
+    D[3][12] = P[3][12] * dT1 + F[3][6] * P[6][12] + F[3][7] * P[7][12] + F[3][8] * P[8][12] + F[3][9] * P[9][12];
+    D[4][4] = P[4][4] * dT1 + F[4][6] * P[6][4] + F[4][7] * P[7][4] + F[4][8] * P[8][4] + F[4][9] * P[9][4];
+    D[4][5] = P[4][5] * dT1 + F[4][6] * P[6][5] + F[4][7] * P[7][5] + F[4][8] * P[8][5] + F[4][9] * P[9][5];
+    D[4][6] = P[4][6] * dT1 + F[4][6] * P[6][6] + F[4][7] * P[7][6] + F[4][8] * P[8][6] + F[4][9] * P[9][6];
+    D[4][7] = P[4][7] * dT1 + F[4][6] * P[6][7] + F[4][7] * P[7][7] + F[4][8] * P[8][7] + F[4][9] * P[9][7];
+    D[4][8] = P[4][8] * dT1 + F[4][6] * P[6][8] + F[4][7] * P[7][8] + F[4][8] * P[8][8] + F[4][9] * P[9][8];
+    D[4][9] = P[4][9] * dT1 + F[4][6] * P[6][9] + F[4][7] * P[7][9] + F[4][8] * P[8][9] + F[4][9] * P[9][9];
+    D[4][10] = P[4][10] * dT1 + F[4][6] * P[6][10] + F[4][7] * P[7][10] + F[4][8] * P[8][10] + F[4][9] * P[9][10];
+    D[4][11] = P[4][11] * dT1 + F[4][6] * P[6][11] + F[4][7] * P[7][11] + F[4][8] * P[8][11] + F[4][9] * P[9][11];
+    D[4][12] = P[4][12] * dT1 + F[4][6] * P[6][12] + F[4][7] * P[7][12] + F[4][8] * P[8][12] + F[4][9] * P[9][12];
+    D[5][5] = P[5][5] * dT1 + F[5][6] * P[6][5] + F[5][7] * P[7][5] + F[5][8] * P[8][5] + F[5][9] * P[9][5];
+    D[5][6] = P[5][6] * dT1 + F[5][6] * P[6][6] + F[5][7] * P[7][6] + F[5][8] * P[8][6] + F[5][9] * P[9][6];
+    D[5][7] = P[5][7] * dT1 + F[5][6] * P[6][7] + F[5][7] * P[7][7] + F[5][8] * P[8][7] + F[5][9] * P[9][7];
+    D[5][8] = P[5][8] * dT1 + F[5][6] * P[6][8] + F[5][7] * P[7][8] + F[5][8] * P[8][8] + F[5][9] * P[9][8];
+    D[5][9] = P[5][9] * dT1 + F[5][6] * P[6][9] + F[5][7] * P[7][9] + F[5][8] * P[8][9] + F[5][9] * P[9][9];
+    D[5][10] = P[5][10] * dT1 + F[5][6] * P[6][10] + F[5][7] * P[7][10] + F[5][8] * P[8][10] + F[5][9] * P[9][10];
+    D[5][11] = P[5][11] * dT1 + F[5][6] * P[6][11] + F[5][7] * P[7][11] + F[5][8] * P[8][11] + F[5][9] * P[9][11];
+    D[5][12] = P[5][12] * dT1 + F[5][6] * P[6][12] + F[5][7] * P[7][12] + F[5][8] * P[8][12] + F[5][9] * P[9][12];
+    D[6][6] = P[6][6] * dT1 + F[6][7] * P[7][6] + F[6][8] * P[8][6] + F[6][9] * P[9][6] + F[6][10] * P[10][6] + F[6][11] * P[11][6] + F[6][12] * P[12][6];
+    D[6][7] = P[6][7] * dT1 + F[6][7] * P[7][7] + F[6][8] * P[8][7] + F[6][9] * P[9][7] + F[6][10] * P[10][7] + F[6][11] * P[11][7] + F[6][12] * P[12][7];
+    D[6][8] = P[6][8] * dT1 + F[6][7] * P[7][8] + F[6][8] * P[8][8] + F[6][9] * P[9][8] + F[6][10] * P[10][8] + F[6][11] * P[11][8] + F[6][12] * P[12][8];
+    D[6][9] = P[6][9] * dT1 + F[6][7] * P[7][9] + F[6][8] * P[8][9] + F[6][9] * P[9][9] + F[6][10] * P[10][9] + F[6][11] * P[11][9] + F[6][12] * P[12][9];
+    D[6][10] = P[6][10] * dT1 + F[6][7] * P[7][10] + F[6][8] * P[8][10] + F[6][9] * P[9][10] + F[6][10] * P[10][10] + F[6][11] * P[11][10] + F[6][12] * P[12][10];
+    D[6][11] = P[6][11] * dT1 + F[6][7] * P[7][11] + F[6][8] * P[8][11] + F[6][9] * P[9][11] + F[6][10] * P[10][11] + F[6][11] * P[11][11] + F[6][12] * P[12][11];
+    D[6][12] = P[6][12] * dT1 + F[6][7] * P[7][12] + F[6][8] * P[8][12] + F[6][9] * P[9][12] + F[6][10] * P[10][12] + F[6][11] * P[11][12] + F[6][12] * P[12][12];
+    D[7][6] = P[7][6] * dT1 + F[7][6] * P[6][6] + F[7][8] * P[8][6] + F[7][9] * P[9][6] + F[7][10] * P[10][6] + F[7][11] * P[11][6] + F[7][12] * P[12][6];
+    D[7][7] = P[7][7] * dT1 + F[7][6] * P[6][7] + F[7][8] * P[8][7] + F[7][9] * P[9][7] + F[7][10] * P[10][7] + F[7][11] * P[11][7] + F[7][12] * P[12][7];
+    D[7][8] = P[7][8] * dT1 + F[7][6] * P[6][8] + F[7][8] * P[8][8] + F[7][9] * P[9][8] + F[7][10] * P[10][8] + F[7][11] * P[11][8] + F[7][12] * P[12][8];
+    D[7][9] = P[7][9] * dT1 + F[7][6] * P[6][9] + F[7][8] * P[8][9] + F[7][9] * P[9][9] + F[7][10] * P[10][9] + F[7][11] * P[11][9] + F[7][12] * P[12][9];
+    D[7][10] = P[7][10] * dT1 + F[7][6] * P[6][10] + F[7][8] * P[8][10] + F[7][9] * P[9][10] + F[7][10] * P[10][10] + F[7][11] * P[11][10] + F[7][12] * P[12][10];
+    D[7][11] = P[7][11] * dT1 + F[7][6] * P[6][11] + F[7][8] * P[8][11] + F[7][9] * P[9][11] + F[7][10] * P[10][11] + F[7][11] * P[11][11] + F[7][12] * P[12][11];
+    D[7][12] = P[7][12] * dT1 + F[7][6] * P[6][12] + F[7][8] * P[8][12] + F[7][9] * P[9][12] + F[7][10] * P[10][12] + F[7][11] * P[11][12] + F[7][12] * P[12][12];
+    D[8][6] = P[8][6] * dT1 + F[8][6] * P[6][6] + F[8][7] * P[7][6] + F[8][9] * P[9][6] + F[8][10] * P[10][6] + F[8][11] * P[11][6] + F[8][12] * P[12][6];
+    D[8][7] = P[8][7] * dT1 + F[8][6] * P[6][7] + F[8][7] * P[7][7] + F[8][9] * P[9][7] + F[8][10] * P[10][7] + F[8][11] * P[11][7] + F[8][12] * P[12][7];
+    D[8][8] = P[8][8] * dT1 + F[8][6] * P[6][8] + F[8][7] * P[7][8] + F[8][9] * P[9][8] + F[8][10] * P[10][8] + F[8][11] * P[11][8] + F[8][12] * P[12][8];
+    D[8][9] = P[8][9] * dT1 + F[8][6] * P[6][9] + F[8][7] * P[7][9] + F[8][9] * P[9][9] + F[8][10] * P[10][9] + F[8][11] * P[11][9] + F[8][12] * P[12][9];
+    D[8][10] = P[8][10] * dT1 + F[8][6] * P[6][10] + F[8][7] * P[7][10] + F[8][9] * P[9][10] + F[8][10] * P[10][10] + F[8][11] * P[11][10] + F[8][12] * P[12][10];
+    D[8][11] = P[8][11] * dT1 + F[8][6] * P[6][11] + F[8][7] * P[7][11] + F[8][9] * P[9][11] + F[8][10] * P[10][11] + F[8][11] * P[11][11] + F[8][12] * P[12][11];
+    D[8][12] = P[8][12] * dT1 + F[8][6] * P[6][12] + F[8][7] * P[7][12] + F[8][9] * P[9][12] + F[8][10] * P[10][12] + F[8][11] * P[11][12] + F[8][12] * P[12][12];
+    D[9][6] = P[9][6] * dT1 + F[9][6] * P[6][6] + F[9][7] * P[7][6] + F[9][8] * P[8][6] + F[9][10] * P[10][6] + F[9][11] * P[11][6] + F[9][12] * P[12][6];
+    D[9][7] = P[9][7] * dT1 + F[9][6] * P[6][7] + F[9][7] * P[7][7] + F[9][8] * P[8][7] + F[9][10] * P[10][7] + F[9][11] * P[11][7] + F[9][12] * P[12][7];
+    D[9][8] = P[9][8] * dT1 + F[9][6] * P[6][8] + F[9][7] * P[7][8] + F[9][8] * P[8][8] + F[9][10] * P[10][8] + F[9][11] * P[11][8] + F[9][12] * P[12][8];
+    D[9][9] = P[9][9] * dT1 + F[9][6] * P[6][9] + F[9][7] * P[7][9] + F[9][8] * P[8][9] + F[9][10] * P[10][9] + F[9][11] * P[11][9] + F[9][12] * P[12][9];
+    D[9][10] = P[9][10] * dT1 + F[9][6] * P[6][10] + F[9][7] * P[7][10] + F[9][8] * P[8][10] + F[9][10] * P[10][10] + F[9][11] * P[11][10] + F[9][12] * P[12][10];
+    D[9][11] = P[9][11] * dT1 + F[9][6] * P[6][11] + F[9][7] * P[7][11] + F[9][8] * P[8][11] + F[9][10] * P[10][11] + F[9][11] * P[11][11] + F[9][12] * P[12][11];
+    D[9][12] = P[9][12] * dT1 + F[9][6] * P[6][12] + F[9][7] * P[7][12] + F[9][8] * P[8][12] + F[9][10] * P[10][12] + F[9][11] * P[11][12] + F[9][12] * P[12][12];
+    D[10][10] = P[10][10] * dT1;
+    D[10][11] = P[10][11] * dT1;
+    D[10][12] = P[10][12] * dT1;
+    D[11][11] = P[11][11] * dT1;
+    D[11][12] = P[11][12] * dT1;
+    D[12][12] = P[12][12] * dT1;
+
+    // Pnew = T^2 * (D/T + D*F' + G*Q*G'), upper triangle mirrored to the lower one
+    P[0][0] = (D[0][0] * dT1 + D[0][3]) * dTsq;
+    P[0][1] = P[1][0] = (D[0][1] * dT1 + D[0][4]) * dTsq;
+    P[0][2] = P[2][0] = (D[0][2] * dT1 + D[0][5]) * dTsq;
+    P[0][3] = P[3][0] = (D[0][3] * dT1 + D[0][6] * F[3][6] + D[0][7] * F[3][7] + D[0][8] * F[3][8] + D[0][9] * F[3][9]) * dTsq;
+    P[0][4] = P[4][0] = (D[0][4] * dT1 + D[0][6] * F[4][6] + D[0][7] * F[4][7] + D[0][8] * F[4][8] + D[0][9] * F[4][9]) * dTsq;
+    P[0][5] = P[5][0] = (D[0][5] * dT1 + D[0][6] * F[5][6] + D[0][7] * F[5][7] + D[0][8] * F[5][8] + D[0][9] * F[5][9]) * dTsq;
+    P[0][6] = P[6][0] = (D[0][6] * dT1 + D[0][7] * F[6][7] + D[0][8] * F[6][8] + D[0][9] * F[6][9] + D[0][10] * F[6][10] + D[0][11] * F[6][11] + D[0][12] * F[6][12]) * dTsq;
+    P[0][7] = P[7][0] = (D[0][7] * dT1 + D[0][6] * F[7][6] + D[0][8] * F[7][8] + D[0][9] * F[7][9] + D[0][10] * F[7][10] + D[0][11] * F[7][11] + D[0][12] * F[7][12]) * dTsq;
+    P[0][8] = P[8][0] = (D[0][8] * dT1 + D[0][6] * F[8][6] + D[0][7] * F[8][7] + D[0][9] * F[8][9] + D[0][10] * F[8][10] + D[0][11] * F[8][11] + D[0][12] * F[8][12]) * dTsq;
+    P[0][9] = P[9][0] = (D[0][9] * dT1 + D[0][6] * F[9][6] + D[0][7] * F[9][7] + D[0][8] * F[9][8] + D[0][10] * F[9][10] + D[0][11] * F[9][11] + D[0][12] * F[9][12]) * dTsq;
+    P[0][10] = P[10][0] = (D[0][10] * dT1) * dTsq;
+    P[0][11] = P[11][0] = (D[0][11] * dT1) * dTsq;
+    P[0][12] = P[12][0] = (D[0][12] * dT1) * dTsq;
+    P[1][1] = (D[1][1] * dT1 + D[1][4]) * dTsq;
+    P[1][2] = P[2][1] = (D[1][2] * dT1 + D[1][5]) * dTsq;
+    P[1][3] = P[3][1] = (D[1][3] * dT1 + D[1][6] * F[3][6] + D[1][7] * F[3][7] + D[1][8] * F[3][8] + D[1][9] * F[3][9]) * dTsq;
+    P[1][4] = P[4][1] = (D[1][4] * dT1 + D[1][6] * F[4][6] + D[1][7] * F[4][7] + D[1][8] * F[4][8] + D[1][9] * F[4][9]) * dTsq;
+    P[1][5] = P[5][1] = (D[1][5] * dT1 + D[1][6] * F[5][6] + D[1][7] * F[5][7] + D[1][8] * F[5][8] + D[1][9] * F[5][9]) * dTsq;
+    P[1][6] = P[6][1] = (D[1][6] * dT1 + D[1][7] * F[6][7] + D[1][8] * F[6][8] + D[1][9] * F[6][9] + D[1][10] * F[6][10] + D[1][11] * F[6][11] + D[1][12] * F[6][12]) * dTsq;
+    P[1][7] = P[7][1] = (D[1][7] * dT1 + D[1][6] * F[7][6] + D[1][8] * F[7][8] + D[1][9] * F[7][9] + D[1][10] * F[7][10] + D[1][11] * F[7][11] + D[1][12] * F[7][12]) * dTsq;
+    P[1][8] = P[8][1] = (D[1][8] * dT1 + D[1][6] * F[8][6] + D[1][7] * F[8][7] + D[1][9] * F[8][9] + D[1][10] * F[8][10] + D[1][11] * F[8][11] + D[1][12] * F[8][12]) * dTsq;
+    P[1][9] = P[9][1] = (D[1][9] * dT1 + D[1][6] * F[9][6] + D[1][7] * F[9][7] + D[1][8] * F[9][8] + D[1][10] * F[9][10] + D[1][11] * F[9][11] + D[1][12] * F[9][12]) * dTsq;
+    P[1][10] = P[10][1] = (D[1][10] * dT1) * dTsq;
+    P[1][11] = P[11][1] = (D[1][11] * dT1) * dTsq;
+    P[1][12] = P[12][1] = (D[1][12] * dT1) * dTsq;
+    P[2][2] = (D[2][2] * dT1 + D[2][5]) * dTsq;
+    P[2][3] = P[3][2] = (D[2][3] * dT1 + D[2][6] * F[3][6] + D[2][7] * F[3][7] + D[2][8] * F[3][8] + D[2][9] * F[3][9]) * dTsq;
+    P[2][4] = P[4][2] = (D[2][4] * dT1 + D[2][6] * F[4][6] + D[2][7] * F[4][7] + D[2][8] * F[4][8] + D[2][9] * F[4][9]) * dTsq;
+    P[2][5] = P[5][2] = (D[2][5] * dT1 + D[2][6] * F[5][6] + D[2][7] * F[5][7] + D[2][8] * F[5][8] + D[2][9] * F[5][9]) * dTsq;
+    P[2][6] = P[6][2] = (D[2][6] * dT1 + D[2][7] * F[6][7] + D[2][8] * F[6][8] + D[2][9] * F[6][9] + D[2][10] * F[6][10] + D[2][11] * F[6][11] + D[2][12] * F[6][12]) * dTsq;
+    P[2][7] = P[7][2] = (D[2][7] * dT1 + D[2][6] * F[7][6] + D[2][8] * F[7][8] + D[2][9] * F[7][9] + D[2][10] * F[7][10] + D[2][11] * F[7][11] + D[2][12] * F[7][12]) * dTsq;
+    P[2][8] = P[8][2] = (D[2][8] * dT1 + D[2][6] * F[8][6] + D[2][7] * F[8][7] + D[2][9] * F[8][9] + D[2][10] * F[8][10] + D[2][11] * F[8][11] + D[2][12] * F[8][12]) * dTsq;
+    P[2][9] = P[9][2] = (D[2][9] * dT1 + D[2][6] * F[9][6] + D[2][7] * F[9][7] + D[2][8] * F[9][8] + D[2][10] * F[9][10] + D[2][11] * F[9][11] + D[2][12] * F[9][12]) * dTsq;
+    P[2][10] = P[10][2] = (D[2][10] * dT1) * dTsq;
+    P[2][11] = P[11][2] = (D[2][11] * dT1) * dTsq;
+    P[2][12] = P[12][2] = (D[2][12] * dT1) * dTsq;
+    P[3][3] = (D[3][3] * dT1 + D[3][6] * F[3][6] + D[3][7] * F[3][7] + D[3][8] * F[3][8] + D[3][9] * F[3][9] + Q[3] * G[3][3] * G[3][3] + Q[4] * G[3][4] * G[3][4] + Q[5] * G[3][5] * G[3][5]) * dTsq;
+    P[3][4] = P[4][3] = (D[3][4] * dT1 + D[3][6] * F[4][6] + D[3][7] * F[4][7] + D[3][8] * F[4][8] + D[3][9] * F[4][9] + Q[3] * G[3][3] * G[4][3] + Q[4] * G[3][4] * G[4][4] + Q[5] * G[3][5] * G[4][5]) * dTsq;
+    P[3][5] = P[5][3] = (D[3][5] * dT1 + D[3][6] * F[5][6] + D[3][7] * F[5][7] + D[3][8] * F[5][8] + D[3][9] * F[5][9] + Q[3] * G[3][3] * G[5][3] + Q[4] * G[3][4] * G[5][4] + Q[5] * G[3][5] * G[5][5]) * dTsq;
+    P[3][6] = P[6][3] = (D[3][6] * dT1 + D[3][7] * F[6][7] + D[3][8] * F[6][8] + D[3][9] * F[6][9] + D[3][10] * F[6][10] + D[3][11] * F[6][11] + D[3][12] * F[6][12]) * dTsq;
+    P[3][7] = P[7][3] = (D[3][7] * dT1 + D[3][6] * F[7][6] + D[3][8] * F[7][8] + D[3][9] * F[7][9] + D[3][10] * F[7][10] + D[3][11] * F[7][11] + D[3][12] * F[7][12]) * dTsq;
+    P[3][8] = P[8][3] = (D[3][8] * dT1 + D[3][6] * F[8][6] + D[3][7] * F[8][7] + D[3][9] * F[8][9] + D[3][10] * F[8][10] + D[3][11] * F[8][11] + D[3][12] * F[8][12]) * dTsq;
+    P[3][9] = P[9][3] = (D[3][9] * dT1 + D[3][6] * F[9][6] + D[3][7] * F[9][7] + D[3][8] * F[9][8] + D[3][10] * F[9][10] + D[3][11] * F[9][11] + D[3][12] * F[9][12]) * dTsq;
+    P[3][10] = P[10][3] = (D[3][10] * dT1) * dTsq;
+    P[3][11] = P[11][3] = (D[3][11] * dT1) * dTsq;
+    P[3][12] = P[12][3] = (D[3][12] * dT1) * dTsq;
+    P[4][4] = (D[4][4] * dT1 + D[4][6] * F[4][6] + D[4][7] * F[4][7] + D[4][8] * F[4][8] + D[4][9] * F[4][9] + Q[3] * G[4][3] * G[4][3] + Q[4] * G[4][4] * G[4][4] + Q[5] * G[4][5] * G[4][5]) * dTsq;
+    P[4][5] = P[5][4] = (D[4][5] * dT1 + D[4][6] * F[5][6] + D[4][7] * F[5][7] + D[4][8] * F[5][8] + D[4][9] * F[5][9] + Q[3] * G[4][3] * G[5][3] + Q[4] * G[4][4] * G[5][4] + Q[5] * G[4][5] * G[5][5]) * dTsq;
+    P[4][6] = P[6][4] = (D[4][6] * dT1 + D[4][7] * F[6][7] + D[4][8] * F[6][8] + D[4][9] * F[6][9] + D[4][10] * F[6][10] + D[4][11] * F[6][11] + D[4][12] * F[6][12]) * dTsq;
+    P[4][7] = P[7][4] = (D[4][7] * dT1 + D[4][6] * F[7][6] + D[4][8] * F[7][8] + D[4][9] * F[7][9] + D[4][10] * F[7][10] + D[4][11] * F[7][11] + D[4][12] * F[7][12]) * dTsq;
+    P[4][8] = P[8][4] = (D[4][8] * dT1 + D[4][6] * F[8][6] + D[4][7] * F[8][7] + D[4][9] * F[8][9] + D[4][10] * F[8][10] + D[4][11] * F[8][11] + D[4][12] * F[8][12]) * dTsq;
+    P[4][9] = P[9][4] = (D[4][9] * dT1 + D[4][6] * F[9][6] + D[4][7] * F[9][7] + D[4][8] * F[9][8] + D[4][10] * F[9][10] + D[4][11] * F[9][11] + D[4][12] * F[9][12]) * dTsq;
+    P[4][10] = P[10][4] = (D[4][10] * dT1) * dTsq;
+    P[4][11] = P[11][4] = (D[4][11] * dT1) * dTsq;
+    P[4][12] = P[12][4] = (D[4][12] * dT1) * dTsq;
+    P[5][5] = (D[5][5] * dT1 + D[5][6] * F[5][6] + D[5][7] * F[5][7] + D[5][8] * F[5][8] + D[5][9] * F[5][9] + Q[3] * G[5][3] * G[5][3] + Q[4] * G[5][4] * G[5][4] + Q[5] * G[5][5] * G[5][5]) * dTsq;
+    P[5][6] = P[6][5] = (D[5][6] * dT1 + D[5][7] * F[6][7] + D[5][8] * F[6][8] + D[5][9] * F[6][9] + D[5][10] * F[6][10] + D[5][11] * F[6][11] + D[5][12] * F[6][12]) * dTsq;
+    P[5][7] = P[7][5] = (D[5][7] * dT1 + D[5][6] * F[7][6] + D[5][8] * F[7][8] + D[5][9] * F[7][9] + D[5][10] * F[7][10] + D[5][11] * F[7][11] + D[5][12] * F[7][12]) * dTsq;
+    P[5][8] = P[8][5] = (D[5][8] * dT1 + D[5][6] * F[8][6] + D[5][7] * F[8][7] + D[5][9] * F[8][9] + D[5][10] * F[8][10] + D[5][11] * F[8][11] + D[5][12] * F[8][12]) * dTsq;
+    P[5][9] = P[9][5] = (D[5][9] * dT1 + D[5][6] * F[9][6] + D[5][7] * F[9][7] + D[5][8] * F[9][8] + D[5][10] * F[9][10] + D[5][11] * F[9][11] + D[5][12] * F[9][12]) * dTsq;
+    P[5][10] = P[10][5] = (D[5][10] * dT1) * dTsq;
+    P[5][11] = P[11][5] = (D[5][11] * dT1) * dTsq;
+    P[5][12] = P[12][5] = (D[5][12] * dT1) * dTsq;
+    P[6][6] = (D[6][6] * dT1 + D[6][7] * F[6][7] + D[6][8] * F[6][8] + D[6][9] * F[6][9] + D[6][10] * F[6][10] + D[6][11] * F[6][11] + D[6][12] * F[6][12] + Q[0] * G[6][0] * G[6][0] + Q[1] * G[6][1] * G[6][1] + Q[2] * G[6][2] * G[6][2]) * dTsq;
+    P[6][7] = P[7][6] = (D[6][7] * dT1 + D[6][6] * F[7][6] + D[6][8] * F[7][8] + D[6][9] * F[7][9] + D[6][10] * F[7][10] + D[6][11] * F[7][11] + D[6][12] * F[7][12] + Q[0] * G[6][0] * G[7][0] + Q[1] * G[6][1] * G[7][1] + Q[2] * G[6][2] * G[7][2]) * dTsq;
+    P[6][8] = P[8][6] = (D[6][8] * dT1 + D[6][6] * F[8][6] + D[6][7] * F[8][7] + D[6][9] * F[8][9] + D[6][10] * F[8][10] + D[6][11] * F[8][11] + D[6][12] * F[8][12] + Q[0] * G[6][0] * G[8][0] + Q[1] * G[6][1] * G[8][1] + Q[2] * G[6][2] * G[8][2]) * dTsq;
+    P[6][9] = P[9][6] = (D[6][9] * dT1 + D[6][6] * F[9][6] + D[6][7] * F[9][7] + D[6][8] * F[9][8] + D[6][10] * F[9][10] + D[6][11] * F[9][11] + D[6][12] * F[9][12] + Q[0] * G[6][0] * G[9][0] + Q[1] * G[6][1] * G[9][1] + Q[2] * G[6][2] * G[9][2]) * dTsq;
+    P[6][10] = P[10][6] = (D[6][10] * dT1) * dTsq;
+    P[6][11] = P[11][6] = (D[6][11] * dT1) * dTsq;
+    P[6][12] = P[12][6] = (D[6][12] * dT1) * dTsq;
+    P[7][7] = (D[7][7] * dT1 + D[7][6] * F[7][6] + D[7][8] * F[7][8] + D[7][9] * F[7][9] + D[7][10] * F[7][10] + D[7][11] * F[7][11] + D[7][12] * F[7][12] + Q[0] * G[7][0] * G[7][0] + Q[1] * G[7][1] * G[7][1] + Q[2] * G[7][2] * G[7][2]) * dTsq;
+    P[7][8] = P[8][7] = (D[7][8] * dT1 + D[7][6] * F[8][6] + D[7][7] * F[8][7] + D[7][9] * F[8][9] + D[7][10] * F[8][10] + D[7][11] * F[8][11] + D[7][12] * F[8][12] + Q[0] * G[7][0] * G[8][0] + Q[1] * G[7][1] * G[8][1] + Q[2] * G[7][2] * G[8][2]) * dTsq;
+    P[7][9] = P[9][7] = (D[7][9] * dT1 + D[7][6] * F[9][6] + D[7][7] * F[9][7] + D[7][8] * F[9][8] + D[7][10] * F[9][10] + D[7][11] * F[9][11] + D[7][12] * F[9][12] + Q[0] * G[7][0] * G[9][0] + Q[1] * G[7][1] * G[9][1] + Q[2] * G[7][2] * G[9][2]) * dTsq;
+    P[7][10] = P[10][7] = (D[7][10] * dT1) * dTsq;
+    P[7][11] = P[11][7] = (D[7][11] * dT1) * dTsq;
+    P[7][12] = P[12][7] = (D[7][12] * dT1) * dTsq;
+    P[8][8] = (D[8][8] * dT1 + D[8][6] * F[8][6] + D[8][7] * F[8][7] + D[8][9] * F[8][9] + D[8][10] * F[8][10] + D[8][11] * F[8][11] + D[8][12] * F[8][12] + Q[0] * G[8][0] * G[8][0] + Q[1] * G[8][1] * G[8][1] + Q[2] * G[8][2] * G[8][2]) * dTsq;
+    P[8][9] = P[9][8] = (D[8][9] * dT1 + D[8][6] * F[9][6] + D[8][7] * F[9][7] + D[8][8] * F[9][8] + D[8][10] * F[9][10] + D[8][11] * F[9][11] + D[8][12] * F[9][12] + Q[0] * G[8][0] * G[9][0] + Q[1] * G[8][1] * G[9][1] + Q[2] * G[8][2] * G[9][2]) * dTsq;
+    P[8][10] = P[10][8] = (D[8][10] * dT1) * dTsq;
+    P[8][11] = P[11][8] = (D[8][11] * dT1) * dTsq;
+    P[8][12] = P[12][8] = (D[8][12] * dT1) * dTsq;
+    P[9][9] = (D[9][9] * dT1 + D[9][6] * F[9][6] + D[9][7] * F[9][7] + D[9][8] * F[9][8] + D[9][10] * F[9][10] + D[9][11] * F[9][11] + D[9][12] * F[9][12] + Q[0] * G[9][0] * G[9][0] + Q[1] * G[9][1] * G[9][1] + Q[2] * G[9][2] * G[9][2]) * dTsq;
+    P[9][10] = P[10][9] = (D[9][10] * dT1) * dTsq;
+    P[9][11] = P[11][9] = (D[9][11] * dT1) * dTsq;
+    P[9][12] = P[12][9] = (D[9][12] * dT1) * dTsq;
+    P[10][10] = (D[10][10] * dT1 + Q[6]) * dTsq;
+    P[10][11] = P[11][10] = (D[10][11] * dT1) * dTsq;
+    P[10][12] = P[12][10] = (D[10][12] * dT1) * dTsq;
+    P[11][11] = (D[11][11] * dT1 + Q[7]) * dTsq;
+    P[11][12] = P[12][11] = (D[11][12] * dT1) * dTsq;
+    P[12][12] = (D[12][12] * dT1 + Q[8]) * dTsq;
+}
+
+/**
+ * HP = H[m]*P for one measurement
+ * \return H[m]*P*H[m]' + R[m]
+ */
+static inline float insgps13_measurement_hp(uint8_t m, float H[10][13], float R[10], float P[13][13], float HP[13])
+{
+    switch (m) {
+    case 0:
+        HP[0] = P[0][0];
+        HP[1] = P[0][1];
+        HP[2] = P[0][2];
+        HP[3] = P[0][3];
+        HP[4] = P[0][4];
+        HP[5] = P[0][5];
+        HP[6] = P[0][6];
+        HP[7] = P[0][7];
+        HP[8] = P[0][8];
+        HP[9] = P[0][9];
+        HP[10] = P[0][10];
+        HP[11] = P[0][11];
+        HP[12] = P[0][12];
+        return R[0] + HP[0];
+
+    case 1:
+        HP[0] = P[1][0];
+        HP[1] = P[1][1];
+        HP[2] = P[1][2];
+        HP[3] = P[1][3];
+        HP[4] = P[1][4];
+        HP[5] = P[1][5];
+        HP[6] = P[1][6];
+        HP[7] = P[1][7];
+        HP[8] = P[1][8];
+        HP[9] = P[1][9];
+        HP[10] = P[1][10];
+        HP[11] = P[1][11];
+        HP[12] = P[1][12];
+        return R[1] + HP[1];
+
+    case 2:
+        HP[0] = P[2][0];
+        HP[1] = P[2][1];
+        HP[2] = P[2][2];
+        HP[3] = P[2][3];
+        HP[4] = P[2][4];
+        HP[5] = P[2][5];
+        HP[6] = P[2][6];
+        HP[7] = P[2][7];
+        HP[8] = P[2][8];
+        HP[9] = P[2][9];
+        HP[10] = P[2][10];
+        HP[11] = P[2][11];
+        HP[12] = P[2][12];
+        return R[2] + HP[2];
+
+    case 3:
+        HP[0] = P[3][0];
+        HP[1] = P[3][1];
+        HP[2] = P[3][2];
+        HP[3] = P[3][3];
+        HP[4] = P[3][4];
+        HP[5] = P[3][5];
+        HP[6] = P[3][6];
+        HP[7] = P[3][7];
+        HP[8] = P[3][8];
+        HP[9] = P[3][9];
+        HP[10] = P[3][10];
+        HP[11] = P[3][11];
+        HP[12] = P[3][12];
+        return R[3] + HP[3];
+
+    case 4:
+        HP[0] = P[4][0];
+        HP[1] = P[4][1];
+        HP[2] = P[4][2];
+        HP[3] = P[4][3];
+        HP[4] = P[4][4];
+        HP[5] = P[4][5];
+        HP[6] = P[4][6];
+        HP[7] = P[4][7];
+        HP[8] = P[4][8];
+        HP[9] = P[4][9];
+        HP[10] = P[4][10];
+        HP[11] = P[4][11];
+        HP[12] = P[4][12];
+        return R[4] + HP[4];
+
+    case 5:
+        HP[0] = P[5][0];
+        HP[1] = P[5][1];
+        HP[2] = P[5][2];
+        HP[3] = P[5][3];
+        HP[4] = P[5][4];
+        HP[5] = P[5][5];
+        HP[6] = P[5][6];
+        HP[7] = P[5][7];
+        HP[8] = P[5][8];
+        HP[9] = P[5][9];
+        HP[10] = P[5][10];
+        HP[11] = P[5][11];
+        HP[12] = P[5][12];
+        return R[5] + HP[5];
+
+    case 6:
+        HP[0] = H[6][6] * P[6][0] + H[6][7] * P[7][0] + H[6][8] * P[8][0] + H[6][9] * P[9][0];
+        HP[1] = H[6][6] * P[6][1] + H[6][7] * P[7][1] + H[6][8] * P[8][1] + H[6][9] * P[9][1];
+        HP[2] = H[6][6] * P[6][2] + H[6][7] * P[7][2] + H[6][8] * P[8][2] + H[6][9] * P[9][2];
+        HP[3] = H[6][6] * P[6][3] + H[6][7] * P[7][3] + H[6][8] * P[8][3] + H[6][9] * P[9][3];
+        HP[4] = H[6][6] * P[6][4] + H[6][7] * P[7][4] + H[6][8] * P[8][4] + H[6][9] * P[9][4];
+        HP[5] = H[6][6] * P[6][5] + H[6][7] * P[7][5] + H[6][8] * P[8][5] + H[6][9] * P[9][5];
+        HP[6] = H[6][6] * P[6][6] + H[6][7] * P[7][6] + H[6][8] * P[8][6] + H[6][9] * P[9][6];
+        HP[7] = H[6][6] * P[6][7] + H[6][7] * P[7][7] + H[6][8] * P[8][7] + H[6][9] * P[9][7];
+        HP[8] = H[6][6] * P[6][8] + H[6][7] * P[7][8] + H[6][8] * P[8][8] + H[6][9] * P[9][8];
+        HP[9] = H[6][6] * P[6][9] + H[6][7] * P[7][9] + H[6][8] * P[8][9] + H[6][9] * P[9][9];
+        HP[10] = H[6][6] * P[6][10] + H[6][7] * P[7][10] + H[6][8] * P[8][10] + H[6][9] * P[9][10];
+        HP[11] = H[6][6] * P[6][11] + H[6][7] * P[7][11] + H[6][8] * P[8][11] + H[6][9] * P[9][11];
+        HP[12] = H[6][6] * P[6][12] + H[6][7] * P[7][12] + H[6][8] * P[8][12] + H[6][9] * P[9][12];
+        return R[6] + HP[6] * H[6][6] + HP[7] * H[6][7] + HP[8] * H[6][8] + HP[9] * H[6][9];
+
+    case 7:
+        HP[0] = H[7][6] * P[6][0] + H[7][7] * P[7][0] + H[7][8] * P[8][0] + H[7][9] * P[9][0];
+        HP[1] = H[7][6] * P[6][1] + H[7][7] * P[7][1] + H[7][8] * P[8][1] + H[7][9] * P[9][1];
+        HP[2] = H[7][6] * P[6][2] + H[7][7] * P[7][2] + H[7][8] * P[8][2] + H[7][9] * P[9][2];
+        HP[3] = H[7][6] * P[6][3] + H[7][7] * P[7][3] + H[7][8] * P[8][3] + H[7][9] * P[9][3];
+        HP[4] = H[7][6] * P[6][4] + H[7][7] * P[7][4] + H[7][8] * P[8][4] + H[7][9] * P[9][4];
+        HP[5] = H[7][6] * P[6][5] + H[7][7] * P[7][5] + H[7][8] * P[8][5] + H[7][9] * P[9][5];
+        HP[6] = H[7][6] * P[6][6] + H[7][7] * P[7][6] + H[7][8] * P[8][6] + H[7][9] * P[9][6];
+        HP[7] = H[7][6] * P[6][7] + H[7][7] * P[7][7] + H[7][8] * P[8][7] + H[7][9] * P[9][7];
+        HP[8] = H[7][6] * P[6][8] + H[7][7] * P[7][8] + H[7][8] * P[8][8] + H[7][9] * P[9][8];
+        HP[9] = H[7][6] * P[6][9] + H[7][7] * P[7][9] + H[7][8] * P[8][9] + H[7][9] * P[9][9];
+        HP[10] = H[7][6] * P[6][10] + H[7][7] * P[7][10] + H[7][8] * P[8][10] + H[7][9] * P[9][10];
+        HP[11] = H[7][6] * P[6][11] + H[7][7] * P[7][11] + H[7][8] * P[8][11] + H[7][9] * P[9][11];
+        HP[12] = H[7][6] * P[6][12] + H[7][7] * P[7][12] + H[7][8] * P[8][12] + H[7][9] * P[9][12];
+        return R[7] + HP[6] * H[7][6] + HP[7] * H[7][7] + HP[8] * H[7][8] + HP[9] * H[7][9];
+
+    case 8:
+        HP[0] = H[8][6] * P[6][0] + H[8][7] * P[7][0] + H[8][8] * P[8][0] + H[8][9] * P[9][0];
+        HP[1] = H[8][6] * P[6][1] + H[8][7] * P[7][1] + H[8][8] * P[8][1] + H[8][9] * P[9][1];
+        HP[2] = H[8][6] * P[6][2] + H[8][7] * P[7][2] + H[8][8] * P[8][2] + H[8][9] * P[9][2];
+        HP[3] = H[8][6] * P[6][3] + H[8][7] * P[7][3] + H[8][8] * P[8][3] + H[8][9] * P[9][3];
+        HP[4] = H[8][6] * P[6][4] + H[8][7] * P[7][4] + H[8][8] * P[8][4] + H[8][9] * P[9][4];
+        HP[5] = H[8][6] * P[6][5] + H[8][7] * P[7][5] + H[8][8] * P[8][5] + H[8][9] * P[9][5];
+        HP[6] = H[8][6] * P[6][6] + H[8][7] * P[7][6] + H[8][8] * P[8][6] + H[8][9] * P[9][6];
+        HP[7] = H[8][6] * P[6][7] + H[8][7] * P[7][7] + H[8][8] * P[8][7] + H[8][9] * P[9][7];
+        HP[8] = H[8][6] * P[6][8] + H[8][7] * P[7][8] + H[8][8] * P[8][8] + H[8][9] * P[9][8];
+        HP[9] = H[8][6] * P[6][9] + H[8][7] * P[7][9] + H[8][8] * P[8][9] + H[8][9] * P[9][9];
+        HP[10] = H[8][6] * P[6][10] + H[8][7] * P[7][10] + H[8][8] * P[8][10] + H[8][9] * P[9][10];
+        HP[11] = H[8][6] * P[6][11] + H[8][7] * P[7][11] + H[8][8] * P[8][11] + H[8][9] * P[9][11];
+        HP[12] = H[8][6] * P[6][12] + H[8][7] * P[7][12] + H[8][8] * P[8][12] + H[8][9] * P[9][12];
+        return R[8] + HP[6] * H[8][6] + HP[7] * H[8][7] + HP[8] * H[8][8] + HP[9] * H[8][9];
+
+    case 9:
+        HP[0] = -P[2][0];
+        HP[1] = -P[2][1];
+        HP[2] = -P[2][2];
+        HP[3] = -P[2][3];
+        HP[4] = -P[2][4];
+        HP[5] = -P[2][5];
+        HP[6] = -P[2][6];
+        HP[7] = -P[2][7];
+        HP[8] = -P[2][8];
+        HP[9] = -P[2][9];
+        HP[10] = -P[2][10];
+        HP[11] = -P[2][11];
+        HP[12] = -P[2][12];
+        return R[9] - HP[2];
+
+    default:
+        return 0.0f;
+    }
+}
+
+#endif /* INSGPS13KERNELS_H */
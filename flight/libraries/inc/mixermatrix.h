@@ -0,0 +1,86 @@
+/**
+ ******************************************************************************
+ *
+ * @file       mixermatrix.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Mixer compiled into a dense matrix, so that the actuator loop
+ *             evaluates it as a single matrix vector product.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef MIXERMATRIX_H
+#define MIXERMATRIX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MIXERMATRIX_MAX_CHANNELS 12
+
+/* Order of the mixer vector, same as MixerSettings MixerNVector */
+typedef enum {
+    MIXERMATRIX_VECTOR_THROTTLECURVE1 = 0,
+    MIXERMATRIX_VECTOR_THROTTLECURVE2,
+    MIXERMATRIX_VECTOR_ROLL,
+    MIXERMATRIX_VECTOR_PITCH,
+    MIXERMATRIX_VECTOR_YAW,
+    MIXERMATRIX_VECTOR_SIZE
+} MixerMatrixVector;
+
+/* Channels the matrix computes, all the others come out as 0 */
+typedef enum {
+    MIXERMATRIX_CHANNEL_NONE = 0,
+    MIXERMATRIX_CHANNEL_MOTOR,
+    MIXERMATRIX_CHANNEL_REVERSIBLEMOTOR,
+    MIXERMATRIX_CHANNEL_SERVO
+} MixerMatrixChannelType;
+
+struct MixerMatrixChannel {
+    MixerMatrixChannelType type;
+    int8_t vector[MIXERMATRIX_VECTOR_SIZE]; // 128 is full scale
+};
+
+struct MixerMatrixConfig {
+    struct MixerMatrixChannel channel[MIXERMATRIX_MAX_CHANNELS];
+    uint8_t channels;
+    bool    multirotor;
+    bool    fixedwing;
+    uint8_t firstRollServo; // 1 based, 0 means no roll differential
+    int8_t  rollDifferential; // percent
+};
+
+/*
+ * Compiled mixer. The inputs are the two curves with the roll split by sign,
+ * so that the roll differential is just two different coefficients, and
+ * motors get their own copy of the inputs with the curves clamped.
+ */
+#define MIXERMATRIX_INPUTS 6
+
+struct MixerMatrix {
+    float   coeff[MIXERMATRIX_MAX_CHANNELS][MIXERMATRIX_INPUTS];
+    float   floor[MIXERMATRIX_MAX_CHANNELS]; // lowest output of each channel
+    uint8_t input[MIXERMATRIX_MAX_CHANNELS]; // which input vector each channel uses
+    uint8_t channels;
+    bool    multirotor;
+};
+
+int32_t MixerMatrixCompile(struct MixerMatrix *matrix, const struct MixerMatrixConfig *config);
+void MixerMatrixApply(const struct MixerMatrix *matrix, float curve1, float curve2, float roll, float pitch, float yaw, float *out);
+
+#endif /* MIXERMATRIX_H */
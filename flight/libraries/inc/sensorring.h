@@ -0,0 +1,62 @@
+/**
+ ******************************************************************************
+ *
+ * @file       sensorring.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Timestamped sensor sample rings between the Sensors module and
+ *             the state estimation.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SENSORRING_H
+#define SENSORRING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Samples per ring, must be a power of two */
+#define SENSORRING_LENGTH 16
+
+typedef enum {
+    SENSORRING_GYRO = 0,
+    SENSORRING_ACCEL,
+    SENSORRING_NUMTYPES
+} SensorRingType;
+
+typedef struct {
+    uint32_t timestamp; // PIOS_DELAY_GetRaw() when the sample was taken
+    float    x;
+    float    y;
+    float    z;
+    float    temperature;
+} SensorRingSample;
+
+/*
+ * One ring per sensor type, each with a single producer (the Sensors task)
+ * and a single consumer (the state estimation). No locking is needed as long
+ * as that holds.
+ */
+bool SensorRingPush(SensorRingType type, const SensorRingSample *sample);
+bool SensorRingPeek(SensorRingType type, SensorRingSample *sample);
+bool SensorRingPop(SensorRingType type, SensorRingSample *sample);
+uint32_t SensorRingCount(SensorRingType type);
+uint32_t SensorRingOverruns(SensorRingType type);
+
+#endif /* SENSORRING_H */
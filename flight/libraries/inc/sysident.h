@@ -0,0 +1,103 @@
+/**
+ ******************************************************************************
+ *
+ * @file       sysident.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ *             dRonin, http://dRonin.org/, Copyright (C) 2015-2016
+ *             Tau Labs, http://taulabs.org, Copyright (C) 2013-2014
+ * @brief      System identification of a multirotor and the PIDs derived
+ *             from it, shared by the AutoTune module and host tools.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SYSIDENT_H
+#define SYSIDENT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYSIDENT_NUMX 13
+#define SYSIDENT_NUMP 43
+
+// State vector layout
+#define SYSIDENT_X_RATE  0  // roll, pitch, yaw rate estimate
+#define SYSIDENT_X_TORQUE 3 // scaled roll, pitch, yaw torque
+#define SYSIDENT_X_BETA  6  // ln of the roll, pitch, yaw gain
+#define SYSIDENT_X_TAU   9  // ln of the motor time constant in seconds
+#define SYSIDENT_X_BIAS  10 // roll, pitch, yaw torque bias
+
+// Sanity check failures, see SysIdentCheck()
+#define SYSIDENT_ROLL_BETA_LOW  1
+#define SYSIDENT_PITCH_BETA_LOW 2
+#define SYSIDENT_YAW_BETA_LOW   4
+#define SYSIDENT_TAU_TOO_LONG   8
+#define SYSIDENT_TAU_TOO_SHORT  16
+
+/* One identification run, what the AutoTune module accumulates while shaking */
+struct SysIdent {
+    float    X[SYSIDENT_NUMX];
+    float    P[SYSIDENT_NUMP];
+    float    noise[3]; // gyro noise variance around the estimated rate
+    uint32_t predicts;
+    uint32_t throttleAccumulator; // 10000 * sum of the throttle
+};
+
+/* Same order as SystemIdentSettings CalculateYaw */
+typedef enum {
+    SYSIDENT_YAW_NONE = 0,
+    SYSIDENT_YAW_LIMITTORATIO,
+    SYSIDENT_YAW_IGNORELIMIT
+} SysIdentYaw;
+
+struct SysIdentTuning {
+    SysIdentYaw calculateYaw;
+    float yawToRollPitchPIDRatioMin;
+    float yawToRollPitchPIDRatioMax;
+    // smooth to quick range, see SysIdentSmoothToQuick()
+    float dampMin;
+    float dampRate;
+    float dampMax;
+    float noiseMin;
+    float noiseRate;
+    float noiseMax;
+};
+
+struct SysIdentPid {
+    float Kp;
+    float Ki;
+    float Kd;
+};
+
+struct SysIdentPids {
+    struct SysIdentPid rate[3]; // roll, pitch, yaw rate loops
+    float outerKp; // roll and pitch attitude loops
+    float outerKi;
+    bool  yaw; // rate[2] is only computed when asked for
+};
+
+void SysIdentInit(struct SysIdent *ident, const float beta[3], float tau);
+void SysIdentSample(struct SysIdent *ident, const float u[3], const float gyro[3], float dT_s, float throttle);
+float SysIdentHoverThrottle(const struct SysIdent *ident);
+void SysIdentPredict(float X[SYSIDENT_NUMX], float P[SYSIDENT_NUMP], const float u_in[3], const float gyro[3], const float dT_s, const float t_in);
+uint8_t SysIdentCheck(const float beta[3], float tau);
+void SysIdentComputePids(const struct SysIdentTuning *tuning, const float beta[3], float tau, float damp, float noise, struct SysIdentPids *pids);
+void SysIdentSmoothToQuick(const struct SysIdentTuning *tuning, float min, float val, float max, float *damp, float *noise);
+
+#endif /* SYSIDENT_H */
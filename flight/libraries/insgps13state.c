@@ -34,6 +34,9 @@
 #include <stdint.h>
 #include <pios_math.h>
 #include <mathmisc.h>
+#ifndef INSGPS_GENERIC_KERNELS
+#include "insgps13kernels.h"
+#endif
 
 // constants/macros/typdefs
 #define NUMX 13 // number of states, X is the state vector
@@ -59,6 +62,8 @@ static void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
 // speed optimizations, describe matrix sparsity
 // derived from state equations in
 // LinearizeFG() and LinearizeH():
+// unless INSGPS_GENERIC_KERNELS is defined, the kernels generated from this
+// by make/scripts/insgps_kernelgen.py are used instead of the tables below
 //
 // usage F:        usage G:   usage H:
 // -0123456789abc  012345678  0123456789abc
@@ -76,6 +81,7 @@ static void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
 // b.............  ......oXo
 // c.............  ......ooX
 
+#ifdef INSGPS_GENERIC_KERNELS
 static int8_t FrowMin[NUMX] = { 3, 4, 5, 6, 6, 6, 5, 5, 5, 5, 13, 13, 13 };
 static int8_t FrowMax[NUMX] = { 3, 4, 5, 9, 9, 9, 12, 12, 12, 12, -1, -1, -1 };
 
@@ -84,6 +90,7 @@ static int8_t GrowMax[NUMX] = { -1, -1, -1, 5, 5, 5, 2, 2, 2, 2, 6, 7, 8 };
 
 static int8_t HrowMin[NUMV] = { 0, 1, 2, 3, 4, 5, 6, 6, 6, 2 };
 static int8_t HrowMax[NUMV] = { 0, 1, 2, 3, 4, 5, 9, 9, 9, 2 };
+#endif
 
 static struct EKFData {
     // linearized system matrices
@@ -439,6 +446,9 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
                           float Q[NUMW], float dT, float P[NUMX][NUMX])
 {
+#ifndef INSGPS_GENERIC_KERNELS
+    insgps13_covariance_prediction(F, G, Q, dT, P);
+#else
     // Pnew = (I+F*T)*P*(I+F*T)' + (T^2)*G*Q*G' = (T^2)[(P/T + F*P)*(I/T + F') + G*Q*G')]
 
     const float dT1  = 1.0f / dT; // multiplication is faster than division on fpu.
@@ -514,6 +524,7 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
             P[j][i] = Pirow[j] = Ptmp * dTsq; // [] * (T^2)
         }
     }
+#endif /* INSGPS_GENERIC_KERNELS */
 }
 
 // *************  SerialUpdate *******************
@@ -541,6 +552,9 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
 
     for (m = 0; m < NUMV; m++) {
         if (SensorsUsed & (0x01 << m)) { // use this sensor for update
+#ifndef INSGPS_GENERIC_KERNELS
+            HPHR = insgps13_measurement_hp(m, H, R, P, HP); // Find Hp = H*P and HPHR = H*P*H' + R
+#else
             for (j = 0; j < NUMX; j++) { // Find Hp = H*P
                 HP[j] = 0;
             }
@@ -554,6 +568,7 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             for (k = HrowMin[m]; k <= HrowMax[m]; k++) {
                 HPHR += HP[k] * H[m][k];
             }
+#endif
             float invHPHR = 1.0f / HPHR;
             for (k = 0; k < NUMX; k++) {
                 Km[k] = HP[k] * invHPHR; // find K = HP/HPHR
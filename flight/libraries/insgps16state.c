@@ -32,6 +32,9 @@
 #include "insgps.h"
 #include <math.h>
 #include <stdint.h>
+#ifndef INSGPS_GENERIC_KERNELS
+#include "insgps16kernels.h"
+#endif
 
 // constants/macros/typdefs
 #define NUMX 16 // number of states, X is the state vector
@@ -394,6 +397,15 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
     }
 }
 
+#elif !defined(INSGPS_GENERIC_KERNELS)
+
+// sparsity specialized kernel generated by make/scripts/insgps_kernelgen.py
+void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
+                          float Q[NUMW], float dT, float P[NUMX][NUMX])
+{
+    insgps16_covariance_prediction(F, G, Q, dT, P);
+}
+
 #else /* ifdef COVARIANCE_PREDICTION_GENERAL */
 
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
@@ -578,6 +590,9 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
 
     for (m = 0; m < NUMV; m++) {
         if (SensorsUsed & (0x01 << m)) { // use this sensor for update
+#ifndef INSGPS_GENERIC_KERNELS
+            HPHR = insgps16_measurement_hp(m, H, R, P, HP); // Find Hp = H*P and HPHR = H*P*H' + R
+#else
             for (j = 0; j < NUMX; j++) { // Find Hp = H*P
                 HP[j] = 0.0f;
                 for (k = 0; k < NUMX; k++) {
@@ -588,6 +603,7 @@ void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
             for (k = 0; k < NUMX; k++) {
                 HPHR += HP[k] * H[m][k];
             }
+#endif
 
             for (k = 0; k < NUMX; k++) {
                 K[k][m] = HP[k] / HPHR; // find K = HP/HPHR
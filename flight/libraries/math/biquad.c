@@ -0,0 +1,279 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilot Math Utilities
+ * @{
+ * @addtogroup Biquad filter cascade
+ * @{
+ *
+ * @file       biquad.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Cascades of second order sections filtering three axes at once
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <math.h>
+#include <pios_math.h>
+#include "biquad.h"
+
+#define PEAK_AMPLITUDE_TAU   0.05f // time constant of the amplitude the hysteresis is taken from, seconds
+#define PEAK_HYSTERESIS      0.5f // a crossing only counts after the signal went below this times the amplitude
+#define PEAK_FREQUENCY_ALPHA 0.05f // smoothing of the frequency estimate, per crossing
+
+/**
+ * Coefficients of a second order low pass filter (bilinear transform, RBJ cookbook).
+ * @param[in]  fc Cut-off frequency
+ * @param[in]  fs Sample rate
+ * @param[in]  q Quality factor, 1/sqrt(2) for a single Butterworth section
+ * @param[out] coeffs Filter coefficients
+ * @returns Nothing
+ */
+void BiquadLowPass(const float fc, const float fs, const float q, struct BiquadCoefficients *coeffs)
+{
+    const float w0    = 2.0f * M_PI_F * fc / fs;
+    const float cosw0 = cosf(w0);
+    const float alpha = sinf(w0) / (2.0f * q);
+    const float a0    = 1.0f + alpha;
+
+    coeffs->b0 = (1.0f - cosw0) * 0.5f / a0;
+    coeffs->b1 = (1.0f - cosw0) / a0;
+    coeffs->b2 = coeffs->b0;
+    coeffs->a1 = 2.0f * cosw0 / a0;
+    coeffs->a2 = -(1.0f - alpha) / a0;
+}
+
+/**
+ * Coefficients of a second order high pass filter (bilinear transform, RBJ cookbook).
+ * @param[in]  fc Cut-off frequency
+ * @param[in]  fs Sample rate
+ * @param[in]  q Quality factor, 1/sqrt(2) for a single Butterworth section
+ * @param[out] coeffs Filter coefficients
+ * @returns Nothing
+ */
+void BiquadHighPass(const float fc, const float fs, const float q, struct BiquadCoefficients *coeffs)
+{
+    const float w0    = 2.0f * M_PI_F * fc / fs;
+    const float cosw0 = cosf(w0);
+    const float alpha = sinf(w0) / (2.0f * q);
+    const float a0    = 1.0f + alpha;
+
+    coeffs->b0 = (1.0f + cosw0) * 0.5f / a0;
+    coeffs->b1 = -(1.0f + cosw0) / a0;
+    coeffs->b2 = coeffs->b0;
+    coeffs->a1 = 2.0f * cosw0 / a0;
+    coeffs->a2 = -(1.0f - alpha) / a0;
+}
+
+/**
+ * Coefficients of a notch filter with unity gain away from the notch.
+ * @param[in]  f0 Notch centre frequency
+ * @param[in]  fs Sample rate
+ * @param[in]  q Quality factor, centre frequency over the -3dB bandwidth
+ * @param[out] coeffs Filter coefficients
+ * @returns Nothing
+ */
+void BiquadNotch(const float f0, const float fs, const float q, struct BiquadCoefficients *coeffs)
+{
+    const float w0    = 2.0f * M_PI_F * f0 / fs;
+    const float cosw0 = cosf(w0);
+    const float alpha = sinf(w0) / (2.0f * q);
+    const float a0    = 1.0f + alpha;
+
+    coeffs->b0 = 1.0f / a0;
+    coeffs->b1 = -2.0f * cosw0 / a0;
+    coeffs->b2 = coeffs->b0;
+    coeffs->a1 = 2.0f * cosw0 / a0;
+    coeffs->a2 = -(1.0f - alpha) / a0;
+}
+
+/**
+ * Quality factor of one section of a Butterworth low pass built from several sections.
+ * @param[in]  stages Number of second order sections, the filter order is twice that
+ * @param[in]  stage Index of the section
+ * @returns Quality factor of the section
+ */
+float BiquadButterworthQ(const uint8_t stages, const uint8_t stage)
+{
+    return 1.0f / (2.0f * cosf(M_PI_F * (float)(2 * stage + 1) / (float)(4 * stages)));
+}
+
+/**
+ * Magnitude of the frequency response of a section.
+ * @param[in]  coeffs Filter coefficients
+ * @param[in]  f Frequency
+ * @param[in]  fs Sample rate
+ * @returns Gain at frequency f
+ */
+float BiquadGain(const struct BiquadCoefficients *coeffs, const float f, const float fs)
+{
+    const float w    = 2.0f * M_PI_F * f / fs;
+    const float c1   = cosf(w);
+    const float s1   = sinf(w);
+    const float c2   = cosf(2.0f * w);
+    const float s2   = sinf(2.0f * w);
+
+    const float n_re = coeffs->b0 + coeffs->b1 * c1 + coeffs->b2 * c2;
+    const float n_im = -coeffs->b1 * s1 - coeffs->b2 * s2;
+    const float d_re = 1.0f - coeffs->a1 * c1 - coeffs->a2 * c2;
+    const float d_im = coeffs->a1 * s1 + coeffs->a2 * s2;
+
+    return sqrtf((n_re * n_re + n_im * n_im) / (d_re * d_re + d_im * d_im));
+}
+
+/**
+ * Set the coefficients of one axis of a section, the state is left alone.
+ * @param[in]  cascade Filter cascade
+ * @param[in]  stage Index of the section
+ * @param[in]  axis Axis 0..2
+ * @param[in]  coeffs Filter coefficients
+ * @returns Nothing
+ */
+void Biquad3SetStage(struct Biquad3Cascade *cascade, const uint8_t stage, const uint8_t axis, const struct BiquadCoefficients *coeffs)
+{
+    struct Biquad3Stage *s = &cascade->stage[stage];
+
+    s->b0[axis] = coeffs->b0;
+    s->b1[axis] = coeffs->b1;
+    s->b2[axis] = coeffs->b2;
+    s->a1[axis] = coeffs->a1;
+    s->a2[axis] = coeffs->a2;
+}
+
+/**
+ * Set the state of all sections to the steady state for a constant input, so the
+ * filter starts without a transient.
+ * @param[in]  cascade Filter cascade
+ * @param[in]  x0 Prescribed input of each axis
+ * @returns Nothing
+ */
+void Biquad3Reset(struct Biquad3Cascade *cascade, const float x0[3])
+{
+    float x[3] = { x0[0], x0[1], x0[2] };
+
+    for (uint8_t n = 0; n < cascade->stages; n++) {
+        struct Biquad3Stage *s = &cascade->stage[n];
+        for (uint8_t i = 0; i < 3; i++) {
+            const float gain = (s->b0[i] + s->b1[i] + s->b2[i]) / (1.0f - s->a1[i] - s->a2[i]);
+            const float y    = gain * x[i];
+            s->d2[i] = s->b2[i] * x[i] + s->a2[i] * y;
+            s->d1[i] = s->b1[i] * x[i] + s->a1[i] * y + s->d2[i];
+            x[i]     = y;
+        }
+    }
+}
+
+/**
+ * Filter a block of samples in place. The block is run through one section after
+ * the other so the coefficients of a section stay in registers.
+ * @param[in]  cascade Filter cascade
+ * @param[in,out] samples Interleaved x, y, z samples
+ * @param[in]  count Number of samples
+ * @returns Nothing
+ */
+void Biquad3Filter(struct Biquad3Cascade *cascade, float *samples, const uint32_t count)
+{
+    for (uint8_t n = 0; n < cascade->stages; n++) {
+        struct Biquad3Stage *s = &cascade->stage[n];
+        float *x = samples;
+
+        for (uint32_t k = 0; k < count; k++, x += 3) {
+            for (uint8_t i = 0; i < 3; i++) {
+                const float in  = x[i];
+                const float out = s->b0[i] * in + s->d1[i];
+                s->d1[i] = s->b1[i] * in + s->a1[i] * out + s->d2[i];
+                s->d2[i] = s->b2[i] * in + s->a2[i] * out;
+                x[i]     = out;
+            }
+        }
+    }
+}
+
+/**
+ * Set up a peak tracker. The band is isolated by a second order high pass at the lower
+ * and a second order low pass at the upper edge.
+ * @param[in]  tracker Peak tracker
+ * @param[in]  min Lower edge of the band
+ * @param[in]  max Upper edge of the band, below fs / 2
+ * @param[in]  fs Sample rate
+ * @param[in]  f0 Starting estimate of each axis
+ * @returns Nothing
+ */
+void Biquad3PeakTrackerInit(struct Biquad3PeakTracker *tracker, const float min, const float max, const float fs, const float f0[3])
+{
+    struct BiquadCoefficients highpass, lowpass;
+
+    BiquadHighPass(min, fs, M_SQRT1_2_F, &highpass);
+    BiquadLowPass(max, fs, M_SQRT1_2_F, &lowpass);
+    for (uint8_t i = 0; i < 3; i++) {
+        Biquad3SetStage(&tracker->bandpass, 0, i, &highpass);
+        Biquad3SetStage(&tracker->bandpass, 1, i, &lowpass);
+    }
+    tracker->bandpass.stages = 2;
+    const float zero[3] = { 0.0f, 0.0f, 0.0f };
+    Biquad3Reset(&tracker->bandpass, zero);
+
+    tracker->fs    = fs;
+    tracker->min   = min;
+    tracker->max   = max;
+    tracker->alpha = 1.0f / (1.0f + PEAK_AMPLITUDE_TAU * fs);
+    for (uint8_t i = 0; i < 3; i++) {
+        tracker->frequency[i] = (f0[i] < min) ? min : (f0[i] > max) ? max : f0[i];
+        tracker->amplitude[i] = 0.0f;
+        tracker->period[i]    = 0.0f;
+        tracker->last[i]      = 0.0f;
+        tracker->armed[i]     = false;
+    }
+}
+
+/**
+ * Update the frequency estimates with a block of samples. Each rising zero crossing of
+ * the band passed signal, interpolated between samples, gives one period.
+ * @param[in]  tracker Peak tracker
+ * @param[in,out] samples Interleaved x, y, z samples, overwritten with the band passed signal
+ * @param[in]  count Number of samples
+ * @returns Nothing
+ */
+void Biquad3PeakTrackerUpdate(struct Biquad3PeakTracker *tracker, float *samples, const uint32_t count)
+{
+    Biquad3Filter(&tracker->bandpass, samples, count);
+
+    const float *x = samples;
+    for (uint32_t k = 0; k < count; k++, x += 3) {
+        for (uint8_t i = 0; i < 3; i++) {
+            tracker->amplitude[i] += tracker->alpha * (fabsf(x[i]) - tracker->amplitude[i]);
+            tracker->period[i]    += 1.0f;
+            if (x[i] < -PEAK_HYSTERESIS * tracker->amplitude[i]) {
+                tracker->armed[i] = true;
+            } else if (tracker->armed[i] && x[i] >= 0.0f && tracker->last[i] < 0.0f) {
+                // the crossing lies this fraction of a sample before the current one
+                const float after  = x[i] / (x[i] - tracker->last[i]);
+                const float period = tracker->period[i] - after;
+                // the first crossing after a quiet spell does not end a period
+                if (period * tracker->min < 4.0f * tracker->fs) {
+                    float f = tracker->fs / period;
+                    f = (f < tracker->min) ? tracker->min : (f > tracker->max) ? tracker->max : f;
+                    tracker->frequency[i] += PEAK_FREQUENCY_ALPHA * (f - tracker->frequency[i]);
+                }
+                tracker->period[i]     = after;
+                tracker->armed[i]      = false;
+            }
+            tracker->last[i] = x[i];
+        }
+    }
+}
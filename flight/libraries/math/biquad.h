@@ -0,0 +1,94 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilot Math Utilities
+ * @{
+ * @addtogroup Biquad filter cascade
+ * @{
+ *
+ * @file       biquad.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Cascades of second order sections filtering three axes at once
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BIQUAD_MAX_STAGES 5
+
+// Coefficients of one second order section in the layout of the CMSIS arm_biquad_cascade_df2T_f32
+// functions, the feedback coefficients are negated: y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+struct BiquadCoefficients {
+    float b0;
+    float b1;
+    float b2;
+    float a1;
+    float a2;
+};
+
+// One section for three axes in transposed direct form 2, laid out so the axes are processed side by side
+struct Biquad3Stage {
+    float b0[3];
+    float b1[3];
+    float b2[3];
+    float a1[3];
+    float a2[3];
+    float d1[3];
+    float d2[3];
+};
+
+struct Biquad3Cascade {
+    uint8_t stages;
+    struct Biquad3Stage stage[BIQUAD_MAX_STAGES];
+};
+
+// Follows the frequency of the strongest vibration of each axis within a band, from the
+// zero crossings of the band passed signal
+struct Biquad3PeakTracker {
+    struct Biquad3Cascade bandpass;
+    float fs;
+    float min;
+    float max;
+    float alpha; // smoothing of the amplitude, per sample
+    float frequency[3]; // estimate of each axis
+    float amplitude[3]; // mean magnitude of the band passed signal, sets the hysteresis
+    float period[3]; // samples since the last rising zero crossing
+    float last[3]; // previous band passed sample
+    bool  armed[3]; // the signal went below the hysteresis since the last crossing
+};
+
+// Function declarations
+void BiquadLowPass(const float fc, const float fs, const float q, struct BiquadCoefficients *coeffs);
+void BiquadHighPass(const float fc, const float fs, const float q, struct BiquadCoefficients *coeffs);
+void BiquadNotch(const float f0, const float fs, const float q, struct BiquadCoefficients *coeffs);
+float BiquadButterworthQ(const uint8_t stages, const uint8_t stage);
+float BiquadGain(const struct BiquadCoefficients *coeffs, const float f, const float fs);
+
+void Biquad3SetStage(struct Biquad3Cascade *cascade, const uint8_t stage, const uint8_t axis, const struct BiquadCoefficients *coeffs);
+void Biquad3Reset(struct Biquad3Cascade *cascade, const float x0[3]);
+void Biquad3Filter(struct Biquad3Cascade *cascade, float *samples, const uint32_t count);
+
+void Biquad3PeakTrackerInit(struct Biquad3PeakTracker *tracker, const float min, const float max, const float fs, const float f0[3]);
+void Biquad3PeakTrackerUpdate(struct Biquad3PeakTracker *tracker, float *samples, const uint32_t count);
+
+#endif /* BIQUAD_H */
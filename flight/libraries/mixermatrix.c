@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ *
+ * @file       mixermatrix.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Mixer compiled into a dense matrix, so that the actuator loop
+ *             evaluates it as a single matrix vector product.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <math.h>
+#include "inc/mixermatrix.h"
+
+// Private constants
+#define VECTOR_SCALE (1.0f / 128.0f)
+
+// columns of the compiled matrix
+#define IN_CURVE1    0
+#define IN_CURVE2    1
+#define IN_ROLLPOS   2
+#define IN_ROLLNEG   3
+#define IN_PITCH     4
+#define IN_YAW       5
+
+// input vectors
+#define INPUT_PLAIN  0
+#define INPUT_MOTOR  1
+
+/**
+ * Compile the mixer settings, called whenever they change.
+ * \param[out] matrix The compiled mixer
+ * \param[in] config The mixer settings
+ * \return 0 on success, -1 if the settings have too many channels
+ */
+int32_t MixerMatrixCompile(struct MixerMatrix *matrix, const struct MixerMatrixConfig *config)
+{
+    if (config->channels > MIXERMATRIX_MAX_CHANNELS) {
+        return -1;
+    }
+
+    matrix->channels   = config->channels;
+    matrix->multirotor = config->multirotor;
+
+    for (uint8_t ct = 0; ct < config->channels; ct++) {
+        const struct MixerMatrixChannel *channel = &config->channel[ct];
+        float *coeff = matrix->coeff[ct];
+
+        if (channel->type == MIXERMATRIX_CHANNEL_NONE) {
+            for (int i = 0; i < MIXERMATRIX_INPUTS; i++) {
+                coeff[i] = 0.0f;
+            }
+            matrix->floor[ct] = -INFINITY;
+            matrix->input[ct] = INPUT_PLAIN;
+            continue;
+        }
+
+        // Roll differential only for fixedwing roll servos, the first roll servo gets
+        // less throw in one direction and all the others in the opposite direction
+        float rollPos = 1.0f;
+        float rollNeg = 1.0f;
+        if (config->fixedwing && config->firstRollServo > 0 &&
+            channel->type == MIXERMATRIX_CHANNEL_SERVO &&
+            channel->vector[MIXERMATRIX_VECTOR_ROLL] != 0) {
+            bool first = (ct == config->firstRollServo - 1);
+            if (config->rollDifferential > 0) {
+                float differential = 1.0f - (config->rollDifferential * 0.01f);
+                if (first) {
+                    rollPos = differential;
+                } else {
+                    rollNeg = differential;
+                }
+            } else if (config->rollDifferential < 0) {
+                float differential = 1.0f - (-config->rollDifferential * 0.01f);
+                if (first) {
+                    rollNeg = differential;
+                } else {
+                    rollPos = differential;
+                }
+            }
+        }
+
+        coeff[IN_CURVE1]  = channel->vector[MIXERMATRIX_VECTOR_THROTTLECURVE1] * VECTOR_SCALE;
+        coeff[IN_CURVE2]  = channel->vector[MIXERMATRIX_VECTOR_THROTTLECURVE2] * VECTOR_SCALE;
+        coeff[IN_ROLLPOS] = channel->vector[MIXERMATRIX_VECTOR_ROLL] * VECTOR_SCALE * rollPos;
+        coeff[IN_ROLLNEG] = channel->vector[MIXERMATRIX_VECTOR_ROLL] * VECTOR_SCALE * rollNeg;
+        coeff[IN_PITCH]   = channel->vector[MIXERMATRIX_VECTOR_PITCH] * VECTOR_SCALE;
+        coeff[IN_YAW]     = channel->vector[MIXERMATRIX_VECTOR_YAW] * VECTOR_SCALE;
+
+        if (channel->type == MIXERMATRIX_CHANNEL_MOTOR) {
+            // motors only see positive curves, the multirotor desaturation in scaleMotor() deals with the rest
+            matrix->input[ct] = INPUT_MOTOR;
+            matrix->floor[ct] = config->multirotor ? -INFINITY : 0.0f;
+        } else {
+            matrix->input[ct] = INPUT_PLAIN;
+            matrix->floor[ct] = -INFINITY;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Evaluate the compiled mixer for all channels at once
+ * \param[in] matrix The compiled mixer
+ * \param[in] curve1 Throttle curve 1 output
+ * \param[in] curve2 Throttle curve 2 output
+ * \param[in] roll Roll desired
+ * \param[in] pitch Pitch desired
+ * \param[in] yaw Yaw desired
+ * \param[out] out Mixer output of each channel, matrix->channels values
+ */
+void MixerMatrixApply(const struct MixerMatrix *matrix, float curve1, float curve2, float roll, float pitch, float yaw, float *out)
+{
+    float input[2][MIXERMATRIX_INPUTS];
+
+    input[INPUT_PLAIN][IN_CURVE1]  = curve1;
+    input[INPUT_PLAIN][IN_CURVE2]  = curve2;
+    input[INPUT_PLAIN][IN_ROLLPOS] = roll > 0.0f ? roll : 0.0f;
+    input[INPUT_PLAIN][IN_ROLLNEG] = roll < 0.0f ? roll : 0.0f;
+    input[INPUT_PLAIN][IN_PITCH]   = pitch;
+    input[INPUT_PLAIN][IN_YAW]     = yaw;
+
+    for (int i = 0; i < MIXERMATRIX_INPUTS; i++) {
+        input[INPUT_MOTOR][i] = input[INPUT_PLAIN][i];
+    }
+    if (input[INPUT_MOTOR][IN_CURVE1] < 0.0f) {
+        input[INPUT_MOTOR][IN_CURVE1] = 0.0f;
+    }
+    // negative curve 2 is allowed for multirotors, scaleMotor() does the sanity checks
+    if (!matrix->multirotor && input[INPUT_MOTOR][IN_CURVE2] < 0.0f) {
+        input[INPUT_MOTOR][IN_CURVE2] = 0.0f;
+    }
+
+    for (uint8_t ct = 0; ct < matrix->channels; ct++) {
+        const float *coeff = matrix->coeff[ct];
+        const float *in    = input[matrix->input[ct]];
+
+        float result = coeff[IN_CURVE1] * in[IN_CURVE1] +
+                       coeff[IN_CURVE2] * in[IN_CURVE2] +
+                       coeff[IN_ROLLPOS] * in[IN_ROLLPOS] +
+                       coeff[IN_ROLLNEG] * in[IN_ROLLNEG] +
+                       coeff[IN_PITCH] * in[IN_PITCH] +
+                       coeff[IN_YAW] * in[IN_YAW];
+
+        out[ct] = result < matrix->floor[ct] ? matrix->floor[ct] : result;
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ *
+ * @file       sensorring.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Timestamped sensor sample rings between the Sensors module and
+ *             the state estimation.
+ *             --
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "inc/sensorring.h"
+
+struct sensorRing {
+    volatile uint32_t head; // written by the producer only
+    volatile uint32_t tail; // written by the consumer only
+    uint32_t overruns;
+    SensorRingSample samples[SENSORRING_LENGTH];
+};
+
+static struct sensorRing rings[SENSORRING_NUMTYPES];
+
+/**
+ * Add a sample to a ring, producer side.
+ * \param[in] type The sensor type
+ * \param[in] sample The sample to add
+ * \return true on success, false if the ring was full and the sample dropped
+ */
+bool SensorRingPush(SensorRingType type, const SensorRingSample *sample)
+{
+    struct sensorRing *ring = &rings[type];
+    uint32_t head = ring->head;
+
+    if (head - ring->tail >= SENSORRING_LENGTH) {
+        ring->overruns++;
+        return false;
+    }
+    ring->samples[head & (SENSORRING_LENGTH - 1)] = *sample;
+
+    // The sample must be complete before the consumer can see it
+    __sync_synchronize();
+    ring->head = head + 1;
+    return true;
+}
+
+/**
+ * Read the oldest sample of a ring without removing it, consumer side.
+ * \param[in] type The sensor type
+ * \param[out] sample The oldest sample
+ * \return true on success, false if the ring is empty
+ */
+bool SensorRingPeek(SensorRingType type, SensorRingSample *sample)
+{
+    struct sensorRing *ring = &rings[type];
+    uint32_t tail = ring->tail;
+
+    if (ring->head == tail) {
+        return false;
+    }
+    __sync_synchronize();
+    *sample = ring->samples[tail & (SENSORRING_LENGTH - 1)];
+    return true;
+}
+
+/**
+ * Remove the oldest sample from a ring, consumer side.
+ * \param[in] type The sensor type
+ * \param[out] sample The oldest sample
+ * \return true on success, false if the ring is empty
+ */
+bool SensorRingPop(SensorRingType type, SensorRingSample *sample)
+{
+    if (!SensorRingPeek(type, sample)) {
+        return false;
+    }
+
+    // The slot must have been read before the producer can reuse it
+    __sync_synchronize();
+    rings[type].tail++;
+    return true;
+}
+
+/**
+ * Get the number of samples waiting in a ring.
+ * \param[in] type The sensor type
+ * \return Number of samples
+ */
+uint32_t SensorRingCount(SensorRingType type)
+{
+    return rings[type].head - rings[type].tail;
+}
+
+/**
+ * Get the number of samples dropped because a ring was full.
+ * \param[in] type The sensor type
+ * \return Number of dropped samples
+ */
+uint32_t SensorRingOverruns(SensorRingType type)
+{
+    return rings[type].overruns;
+}
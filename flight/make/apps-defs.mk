@@ -95,6 +95,7 @@ SRC += $(PIOSCOMMON)/pios_sensors.c
 ## Misc library functions
 SRC += $(FLIGHTLIB)/sanitycheck.c
 SRC += $(FLIGHTLIB)/CoordinateConversions.c
+SRC += $(FLIGHTLIB)/sysident.c
 SRC += $(MATHLIB)/sin_lookup.c
 
 ## PID library functions
@@ -126,9 +127,12 @@ SRC += $(PIOSCOMMON)/pios_instrumentation.c
 SRC += $(PIOSCOMMON)/pios_mem.c
 ## Misc library functions
 SRC += $(FLIGHTLIB)/fifo_buffer.c
+SRC += $(FLIGHTLIB)/controllatency.c
+SRC += $(FLIGHTLIB)/mixermatrix.c
 
 SRC += $(MATHLIB)/mathmisc.c
 SRC += $(MATHLIB)/butterworth.c
+SRC += $(MATHLIB)/biquad.c
 SRC += $(FLIGHTLIB)/printf-stdarg.c
 SRC += $(FLIGHTLIB)/optypes.c
 
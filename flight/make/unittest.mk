@@ -47,6 +47,7 @@ $(eval $(call LINK_CXX_TEMPLATE,$(OUTDIR)/$(TARGET).elf,$(ALLOBJ) $(OUTDIR)/gtes
 
 # Flags passed to the preprocessor
 CPPFLAGS += -I$(GTEST_DIR)/include
+CPPFLAGS += -I$(FLIGHT_ROOT_DIR)/tests
 
 # Flags passed to the C++ compiler
 CXXFLAGS += -g -Wall -Wextra -Wno-missing-field-initializers
@@ -80,3 +81,9 @@ $(OUTDIR)/test-reports/$(TARGET).xml: $(OUTDIR)/$(TARGET).elf
 run: $(OUTDIR)/$(TARGET).elf
 	$(V0) @echo " TEST RUN  $(MSG_EXTRA)  $(call toprel, $<)"
 	$(V1) $<
+
+# Benchmarks are disabled tests, they only report timings and are never part of a test run
+.PHONY: bench
+bench: $(OUTDIR)/$(TARGET).elf
+	$(V0) @echo " BENCH RUN $(MSG_EXTRA)  $(call toprel, $<)"
+	$(V1) $< --gtest_also_run_disabled_tests --gtest_filter='*.DISABLED_Benchmark*'
@@ -50,6 +50,10 @@
 #include "taskinfo.h"
 #include <systemsettings.h>
 #include <sanitycheck.h>
+#include <stabilizationsettings.h>
+#include "controllatencystatus.h"
+#include <controllatency.h>
+#include <mixermatrix.h>
 #ifndef PIOS_EXCLUDE_ADVANCED_FEATURES
 #include <vtolpathfollowersettings.h>
 #endif
@@ -71,6 +75,7 @@ static int8_t counter;
 
 #define TASK_PRIORITY                    (tskIDLE_PRIORITY + 4) // device driver
 #define FAILSAFE_TIMEOUT_MS              100
+#define CONTROL_LATENCY_PERIOD_MS        1000
 #define MAX_MIX_ACTUATORS                ACTUATORCOMMAND_CHANNEL_NUMELEM
 
 #define CAMERA_BOOT_DELAY_MS             7000
@@ -89,6 +94,12 @@ static xTaskHandle taskHandle;
 static FrameType_t frameType = FRAME_TYPE_MULTIROTOR;
 static SystemSettingsThrustControlOptions thrustType = SYSTEMSETTINGS_THRUSTCONTROL_THROTTLE;
 static bool camStabEnabled;
+static portTickType lastSysTime;
+
+// fast path, the mixer runs from ActuatorDesiredSet() and the task only handles the failsafe
+static xSemaphoreHandle fastPathLock;
+static volatile uint32_t fastPathUpdates;
+static portTickType latencyPublishTime;
 
 static uint8_t pinsMode[MAX_MIX_ACTUATORS];
 // used to inform the actuator thread that actuator update rate is changed
@@ -99,8 +110,15 @@ static bool spinWhileArmed;
 static MixerSettingsData mixerSettings;
 static int mixer_settings_count = 2;
 
+// mixer compiled from the settings, double buffered so the settings can change while mixing
+static struct MixerMatrix mixerMatrix[2];
+static volatile uint8_t mixerMatrixActive;
+
 // Private functions
 static void actuatorTask(void *parameters);
+static void actuatorUpdate();
+static void ActuatorDesiredFastCb(UAVObjEvent *ev);
+static void publishControlLatency();
 static int16_t scaleChannel(float value, int16_t max, int16_t min, int16_t neutral);
 static int16_t scaleMotor(float value, int16_t max, int16_t min, int16_t neutral, float maxMotor, float minMotor, bool armed, bool alwaysStabilizeWhenArmed, float throttleDesired);
 static void setFailsafe();
@@ -111,9 +129,7 @@ static void actuator_update_rate_if_changed(bool force_update);
 static void MixerSettingsUpdatedCb(UAVObjEvent *ev);
 static void ActuatorSettingsUpdatedCb(UAVObjEvent *ev);
 static void SettingsUpdatedCb(UAVObjEvent *ev);
-float ProcessMixer(const int index, const float curve1, const float curve2,
-                   ActuatorDesiredData *desired,
-                   bool multirotor, bool fixedwing);
+static void compileMixer();
 
 // this structure is equivalent to the UAVObjects for one mixer.
 typedef struct {
@@ -156,7 +172,18 @@ int32_t ActuatorInitialize()
     // Listen for ActuatorDesired updates (Primary input to this module)
     ActuatorDesiredInitialize();
     queue = xQueueCreate(MAX_QUEUE_SIZE, sizeof(UAVObjEvent));
-    ActuatorDesiredConnectQueue(queue);
+
+    // The fast path is only read at boot
+    StabilizationSettingsFastPathOptions fastPath;
+    StabilizationSettingsInitialize();
+    StabilizationSettingsFastPathGet(&fastPath);
+    if (fastPath == STABILIZATIONSETTINGS_FASTPATH_TRUE) {
+        fastPathLock = xSemaphoreCreateMutex();
+        ActuatorDesiredConnectFastCallback(ActuatorDesiredFastCb);
+    } else {
+        ActuatorDesiredConnectQueue(queue);
+    }
+    ControlLatencyStatusInitialize();
 
     // Register AccessoryDesired (Secondary input to this module)
     AccessoryDesiredInitialize();
@@ -202,17 +229,6 @@ MODULE_INITCALL(ActuatorInitialize, ActuatorStart);
 static void actuatorTask(__attribute__((unused)) void *parameters)
 {
     UAVObjEvent ev;
-    portTickType lastSysTime;
-    portTickType thisSysTime;
-    uint32_t dTMilliseconds;
-
-    ActuatorCommandData command;
-    ActuatorDesiredData desired;
-    MixerStatusData mixerStatus;
-    FlightModeSettingsData settings;
-    FlightStatusData flightStatus;
-    float throttleDesired;
-    float collectiveDesired;
 
 #ifdef PIOS_INCLUDE_INSTRUMENTATION
     counter = PIOS_Instrumentation_CreateCounter(0xAC700001);
@@ -223,6 +239,7 @@ static void actuatorTask(__attribute__((unused)) void *parameters)
 
     /* Read initial values of MixerSettings */
     MixerSettingsGet(&mixerSettings);
+    compileMixer();
 
     /* Force an initial configuration of the actuator update rates */
     actuator_update_rate_if_changed(true);
@@ -232,374 +249,424 @@ static void actuatorTask(__attribute__((unused)) void *parameters)
 
     // Main task loop
     lastSysTime = xTaskGetTickCount();
+    latencyPublishTime = lastSysTime;
     while (1) {
 #ifdef PIOS_INCLUDE_WDG
         PIOS_WDG_UpdateFlag(PIOS_WDG_ACTUATOR);
 #endif
 
-        // Wait until the ActuatorDesired object is updated
+        // Wait until the ActuatorDesired object is updated, in fast path mode most
+        // updates are mixed right away by ActuatorDesiredFastCb() and never get here
         uint8_t rc = xQueueReceive(queue, &ev, FAILSAFE_TIMEOUT_MS / portTICK_RATE_MS);
-#ifdef PIOS_INCLUDE_INSTRUMENTATION
-        PIOS_Instrumentation_TimeStart(counter);
-#endif
 
-        if (rc != pdTRUE) {
+        if (fastPathLock) {
+            xSemaphoreTake(fastPathLock, portMAX_DELAY);
+        }
+        if (rc == pdTRUE) {
+            actuatorUpdate();
+        } else if (fastPathUpdates == 0) {
             /* Update of ActuatorDesired timed out.  Go to failsafe */
             setFailsafe();
-            continue;
         }
-
-        // Check how long since last update
-        thisSysTime    = xTaskGetTickCount();
-        dTMilliseconds = (thisSysTime == lastSysTime) ? 1 : (thisSysTime - lastSysTime) * portTICK_RATE_MS;
-        lastSysTime    = thisSysTime;
-
-        FlightStatusGet(&flightStatus);
-        FlightModeSettingsGet(&settings);
-        ActuatorDesiredGet(&desired);
-        ActuatorCommandGet(&command);
-
-        // read in throttle and collective -demultiplex thrust
-        switch (thrustType) {
-        case SYSTEMSETTINGS_THRUSTCONTROL_THROTTLE:
-            throttleDesired = desired.Thrust;
-            ManualControlCommandCollectiveGet(&collectiveDesired);
-            break;
-        case SYSTEMSETTINGS_THRUSTCONTROL_COLLECTIVE:
-            ManualControlCommandThrottleGet(&throttleDesired);
-            collectiveDesired = desired.Thrust;
-            break;
-        default:
-            ManualControlCommandThrottleGet(&throttleDesired);
-            ManualControlCommandCollectiveGet(&collectiveDesired);
+        fastPathUpdates = 0;
+        if (fastPathLock) {
+            xSemaphoreGive(fastPathLock);
         }
 
-        bool armed = flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED;
-        bool activeThrottle   = (throttleDesired < -0.001f || throttleDesired > 0.001f); // for ground and reversible motors
-        bool positiveThrottle = (throttleDesired > 0.00f);
-        bool multirotor  = (GetCurrentFrameType() == FRAME_TYPE_MULTIROTOR); // check if frame is a multirotor.
-        bool fixedwing   = (GetCurrentFrameType() == FRAME_TYPE_FIXED_WING); // check if frame is a fixedwing.
-        bool alwaysArmed = settings.Arming == FLIGHTMODESETTINGS_ARMING_ALWAYSARMED;
-        bool alwaysStabilizeWhenArmed = flightStatus.AlwaysStabilizeWhenArmed == FLIGHTSTATUS_ALWAYSSTABILIZEWHENARMED_TRUE;
+        publishControlLatency();
+    }
+}
 
-        if (alwaysArmed) {
-            alwaysStabilizeWhenArmed = false; // Do not allow always stabilize when alwaysArmed is active. This is dangerous.
-        }
-        // safety settings
-        if (!armed) {
-            throttleDesired = 0.00f; // this also happens in scaleMotors as a per axis check
-        }
+/**
+ * Fast path callback, invoked directly by ActuatorDesiredSet(). When the update comes
+ * from the inner loop the mixer runs right here, so the outputs are written in the same
+ * pass as the gyro update. Anything else is left to the actuator task.
+ */
+static void ActuatorDesiredFastCb(UAVObjEvent *ev)
+{
+    FlightStatusControlChainData cchain;
 
-        if ((frameType == FRAME_TYPE_GROUND && !activeThrottle) || (frameType != FRAME_TYPE_GROUND && throttleDesired <= 0.00f) || !armed) {
-            // throttleDesired should never be 0 or go below 0.
-            // force set all other controls to zero if throttle is cut (previously set in Stabilization)
-            // todo: can probably remove this
-            if (!(multirotor && alwaysStabilizeWhenArmed && armed)) { // we don't do this if this is a multirotor AND AlwaysStabilizeWhenArmed is true and the model is armed
-                if (actuatorSettings.LowThrottleZeroAxis.Roll == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
-                    desired.Roll = 0.00f;
-                }
-                if (actuatorSettings.LowThrottleZeroAxis.Pitch == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
-                    desired.Pitch = 0.00f;
-                }
-                if (actuatorSettings.LowThrottleZeroAxis.Yaw == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
-                    desired.Yaw = 0.00f;
-                }
-            }
-        }
+    FlightStatusControlChainGet(&cchain);
+    if (cchain.Stabilization != FLIGHTSTATUS_CONTROLCHAIN_TRUE) {
+        xQueueSend(queue, ev, 0);
+        return;
+    }
 
-#ifdef DIAG_MIXERSTATUS
-        MixerStatusGet(&mixerStatus);
+    // the actuator task is going to failsafe or mixing itself, this update is dropped
+    if (xSemaphoreTake(fastPathLock, 0) != pdTRUE) {
+        return;
+    }
+    actuatorUpdate();
+    fastPathUpdates++;
+    xSemaphoreGive(fastPathLock);
+}
+
+/**
+ * Mix the latest ActuatorDesired and write the outputs
+ */
+static void actuatorUpdate()
+{
+    portTickType thisSysTime;
+    uint32_t dTMilliseconds;
+
+    ActuatorCommandData command;
+    ActuatorDesiredData desired;
+    MixerStatusData mixerStatus;
+    float throttleDesired;
+    float collectiveDesired;
+
+#ifdef PIOS_INCLUDE_INSTRUMENTATION
+    PIOS_Instrumentation_TimeStart(counter);
 #endif
 
-        if ((mixer_settings_count < 2) && !ActuatorCommandReadOnly()) { // Nothing can fly with less than two mixers.
-            setFailsafe();
-            continue;
-        }
+    // Check how long since last update
+    thisSysTime    = xTaskGetTickCount();
+    dTMilliseconds = (thisSysTime == lastSysTime) ? 1 : (thisSysTime - lastSysTime) * portTICK_RATE_MS;
+    lastSysTime    = thisSysTime;
 
-        AlarmsClear(SYSTEMALARMS_ALARM_ACTUATOR);
+    // Only a few fields are needed, borrow the objects rather than copying them
+    bool armed;
+    bool alwaysStabilizeWhenArmed;
+    {
+        const FlightStatusData *flightStatus;
+        uint32_t version;
+        do {
+            flightStatus = FlightStatusBorrow(&version);
+            armed = flightStatus->Armed == FLIGHTSTATUS_ARMED_ARMED;
+            alwaysStabilizeWhenArmed = flightStatus->AlwaysStabilizeWhenArmed == FLIGHTSTATUS_ALWAYSSTABILIZEWHENARMED_TRUE;
+        } while (!FlightStatusBorrowValid(version));
+    }
+    FlightModeSettingsArmingOptions arming;
+    FlightModeSettingsArmingGet(&arming);
+    ActuatorDesiredGet(&desired);
+    ActuatorCommandGet(&command);
+
+    // read in throttle and collective -demultiplex thrust
+    switch (thrustType) {
+    case SYSTEMSETTINGS_THRUSTCONTROL_THROTTLE:
+        throttleDesired = desired.Thrust;
+        ManualControlCommandCollectiveGet(&collectiveDesired);
+        break;
+    case SYSTEMSETTINGS_THRUSTCONTROL_COLLECTIVE:
+        ManualControlCommandThrottleGet(&throttleDesired);
+        collectiveDesired = desired.Thrust;
+        break;
+    default:
+        ManualControlCommandThrottleGet(&throttleDesired);
+        ManualControlCommandCollectiveGet(&collectiveDesired);
+    }
 
-        float curve1 = 0.0f; // curve 1 is the throttle curve applied to all motors.
-        float curve2 = 0.0f;
+    bool activeThrottle   = (throttleDesired < -0.001f || throttleDesired > 0.001f); // for ground and reversible motors
+    bool positiveThrottle = (throttleDesired > 0.00f);
+    bool multirotor  = (GetCurrentFrameType() == FRAME_TYPE_MULTIROTOR); // check if frame is a multirotor.
+    bool alwaysArmed = arming == FLIGHTMODESETTINGS_ARMING_ALWAYSARMED;
 
-        // Interpolate curve 1 from throttleDesired as input.
-        // assume reversible motor/mixer initially. We can later reverse this. The difference is simply that -ve throttleDesired values
-        // map differently
-        curve1 = MixerCurveFullRangeProportional(throttleDesired, mixerSettings.ThrottleCurve1, MIXERSETTINGS_THROTTLECURVE1_NUMELEM, multirotor);
+    if (alwaysArmed) {
+        alwaysStabilizeWhenArmed = false; // Do not allow always stabilize when alwaysArmed is active. This is dangerous.
+    }
+    // safety settings
+    if (!armed) {
+        throttleDesired = 0.00f; // this also happens in scaleMotors as a per axis check
+    }
 
-        // The source for the secondary curve is selectable
-        AccessoryDesiredData accessory;
-        uint8_t curve2Source = mixerSettings.Curve2Source;
-        switch (curve2Source) {
-        case MIXERSETTINGS_CURVE2SOURCE_THROTTLE:
-            // assume reversible motor/mixer initially
-            curve2 = MixerCurveFullRangeProportional(throttleDesired, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            break;
-        case MIXERSETTINGS_CURVE2SOURCE_ROLL:
-            // Throttle curve contribution the same for +ve vs -ve roll
-            if (multirotor) {
-                curve2 = MixerCurveFullRangeProportional(desired.Roll, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            } else {
-                curve2 = MixerCurveFullRangeAbsolute(desired.Roll, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+    if ((frameType == FRAME_TYPE_GROUND && !activeThrottle) || (frameType != FRAME_TYPE_GROUND && throttleDesired <= 0.00f) || !armed) {
+        // throttleDesired should never be 0 or go below 0.
+        // force set all other controls to zero if throttle is cut (previously set in Stabilization)
+        // todo: can probably remove this
+        if (!(multirotor && alwaysStabilizeWhenArmed && armed)) { // we don't do this if this is a multirotor AND AlwaysStabilizeWhenArmed is true and the model is armed
+            if (actuatorSettings.LowThrottleZeroAxis.Roll == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
+                desired.Roll = 0.00f;
             }
-            break;
-        case MIXERSETTINGS_CURVE2SOURCE_PITCH:
-            // Throttle curve contribution the same for +ve vs -ve pitch
-            if (multirotor) {
-                curve2 = MixerCurveFullRangeProportional(desired.Pitch, mixerSettings.ThrottleCurve2,
-                                                         MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            } else {
-                curve2 = MixerCurveFullRangeAbsolute(desired.Pitch, mixerSettings.ThrottleCurve2,
-                                                     MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+            if (actuatorSettings.LowThrottleZeroAxis.Pitch == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
+                desired.Pitch = 0.00f;
             }
-            break;
-        case MIXERSETTINGS_CURVE2SOURCE_YAW:
-            // Throttle curve contribution the same for +ve vs -ve yaw
-            if (multirotor) {
-                curve2 = MixerCurveFullRangeProportional(desired.Yaw, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            } else {
-                curve2 = MixerCurveFullRangeAbsolute(desired.Yaw, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+            if (actuatorSettings.LowThrottleZeroAxis.Yaw == ACTUATORSETTINGS_LOWTHROTTLEZEROAXIS_TRUE) {
+                desired.Yaw = 0.00f;
             }
-            break;
-        case MIXERSETTINGS_CURVE2SOURCE_COLLECTIVE:
-            // assume reversible motor/mixer initially
-            curve2 = MixerCurveFullRangeProportional(collectiveDesired, mixerSettings.ThrottleCurve2,
+        }
+    }
+
+#ifdef DIAG_MIXERSTATUS
+    MixerStatusGet(&mixerStatus);
+#endif
+
+    if ((mixer_settings_count < 2) && !ActuatorCommandReadOnly()) { // Nothing can fly with less than two mixers.
+        setFailsafe();
+        return;
+    }
+
+    AlarmsClear(SYSTEMALARMS_ALARM_ACTUATOR);
+
+    float curve1 = 0.0f; // curve 1 is the throttle curve applied to all motors.
+    float curve2 = 0.0f;
+
+    // Interpolate curve 1 from throttleDesired as input.
+    // assume reversible motor/mixer initially. We can later reverse this. The difference is simply that -ve throttleDesired values
+    // map differently
+    curve1 = MixerCurveFullRangeProportional(throttleDesired, mixerSettings.ThrottleCurve1, MIXERSETTINGS_THROTTLECURVE1_NUMELEM, multirotor);
+
+    // The source for the secondary curve is selectable
+    AccessoryDesiredData accessory;
+    uint8_t curve2Source = mixerSettings.Curve2Source;
+    switch (curve2Source) {
+    case MIXERSETTINGS_CURVE2SOURCE_THROTTLE:
+        // assume reversible motor/mixer initially
+        curve2 = MixerCurveFullRangeProportional(throttleDesired, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        break;
+    case MIXERSETTINGS_CURVE2SOURCE_ROLL:
+        // Throttle curve contribution the same for +ve vs -ve roll
+        if (multirotor) {
+            curve2 = MixerCurveFullRangeProportional(desired.Roll, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        } else {
+            curve2 = MixerCurveFullRangeAbsolute(desired.Roll, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        }
+        break;
+    case MIXERSETTINGS_CURVE2SOURCE_PITCH:
+        // Throttle curve contribution the same for +ve vs -ve pitch
+        if (multirotor) {
+            curve2 = MixerCurveFullRangeProportional(desired.Pitch, mixerSettings.ThrottleCurve2,
                                                      MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            break;
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY0:
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY1:
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY2:
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY3:
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY4:
-        case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY5:
-            if (AccessoryDesiredInstGet(mixerSettings.Curve2Source - MIXERSETTINGS_CURVE2SOURCE_ACCESSORY0, &accessory) == 0) {
-                // Throttle curve contribution the same for +ve vs -ve accessory....maybe not want we want.
-                curve2 = MixerCurveFullRangeAbsolute(accessory.AccessoryVal, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
-            } else {
-                curve2 = 0.0f;
-            }
-            break;
-        default:
+        } else {
+            curve2 = MixerCurveFullRangeAbsolute(desired.Pitch, mixerSettings.ThrottleCurve2,
+                                                 MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        }
+        break;
+    case MIXERSETTINGS_CURVE2SOURCE_YAW:
+        // Throttle curve contribution the same for +ve vs -ve yaw
+        if (multirotor) {
+            curve2 = MixerCurveFullRangeProportional(desired.Yaw, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        } else {
+            curve2 = MixerCurveFullRangeAbsolute(desired.Yaw, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        }
+        break;
+    case MIXERSETTINGS_CURVE2SOURCE_COLLECTIVE:
+        // assume reversible motor/mixer initially
+        curve2 = MixerCurveFullRangeProportional(collectiveDesired, mixerSettings.ThrottleCurve2,
+                                                 MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        break;
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY0:
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY1:
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY2:
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY3:
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY4:
+    case MIXERSETTINGS_CURVE2SOURCE_ACCESSORY5:
+        if (AccessoryDesiredInstGet(mixerSettings.Curve2Source - MIXERSETTINGS_CURVE2SOURCE_ACCESSORY0, &accessory) == 0) {
+            // Throttle curve contribution the same for +ve vs -ve accessory....maybe not want we want.
+            curve2 = MixerCurveFullRangeAbsolute(accessory.AccessoryVal, mixerSettings.ThrottleCurve2, MIXERSETTINGS_THROTTLECURVE2_NUMELEM, multirotor);
+        } else {
             curve2 = 0.0f;
-            break;
         }
+        break;
+    default:
+        curve2 = 0.0f;
+        break;
+    }
 
-        float *status   = (float *)&mixerStatus; // access status objects as an array of floats
-        Mixer_t *mixers = (Mixer_t *)&mixerSettings.Mixer1Type;
-        float maxMotor  = -1.0f; // highest motor value. Addition method needs this to be -1.0f, division method needs this to be 1.0f
-        float minMotor  = 1.0f; // lowest motor value Addition method needs this to be 1.0f, division method needs this to be -1.0f
+    // All motor, reversable motor and servo channels in one go
+    float mixed[MAX_MIX_ACTUATORS];
+    MixerMatrixApply(&mixerMatrix[mixerMatrixActive], curve1, curve2, desired.Roll, desired.Pitch, desired.Yaw, mixed);
 
-        for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
-            // During boot all camera actuators should be completely disabled (PWM pulse = 0).
-            // command.Channel[i] is reused below as a channel PWM activity flag:
-            // 0 - PWM disabled, >0 - PWM set to real mixer value using scaleChannel() later.
-            // Setting it to 1 by default means "Rescale this channel and enable PWM on its output".
-            command.Channel[ct] = 1;
+    float *status   = (float *)&mixerStatus; // access status objects as an array of floats
+    Mixer_t *mixers = (Mixer_t *)&mixerSettings.Mixer1Type;
+    float maxMotor  = -1.0f; // highest motor value. Addition method needs this to be -1.0f, division method needs this to be 1.0f
+    float minMotor  = 1.0f; // lowest motor value Addition method needs this to be 1.0f, division method needs this to be -1.0f
 
-            uint8_t mixer_type = mixers[ct].type;
+    for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
+        // During boot all camera actuators should be completely disabled (PWM pulse = 0).
+        // command.Channel[i] is reused below as a channel PWM activity flag:
+        // 0 - PWM disabled, >0 - PWM set to real mixer value using scaleChannel() later.
+        // Setting it to 1 by default means "Rescale this channel and enable PWM on its output".
+        command.Channel[ct] = 1;
 
-            if (mixer_type == MIXERSETTINGS_MIXER1TYPE_DISABLED) {
-                // Set to minimum if disabled.  This is not the same as saying PWM pulse = 0 us
-                status[ct] = -1;
-                continue;
-            }
+        uint8_t mixer_type = mixers[ct].type;
 
-            if ((mixer_type == MIXERSETTINGS_MIXER1TYPE_MOTOR)) {
-                float nonreversible_curve1 = curve1;
-                float nonreversible_curve2 = curve2;
-                if (nonreversible_curve1 < 0.0f) {
-                    nonreversible_curve1 = 0.0f;
-                }
-                if (nonreversible_curve2 < 0.0f) {
-                    if (!multirotor) { // allow negative throttle if multirotor. function scaleMotors handles the sanity checks.
-                        nonreversible_curve2 = 0.0f;
-                    }
-                }
-                status[ct] = ProcessMixer(ct, nonreversible_curve1, nonreversible_curve2, &desired, multirotor, fixedwing);
-                // If not armed or motors aren't meant to spin all the time
-                if (!armed ||
-                    (!spinWhileArmed && !positiveThrottle)) {
-                    status[ct] = -1; // force min throttle
-                }
-                // If armed meant to keep spinning,
-                else if ((spinWhileArmed && !positiveThrottle) ||
-                         (status[ct] < 0)) {
-                    if (!multirotor) {
-                        status[ct] = 0;
-                        // allow throttle values lower than 0 if multirotor.
-                        // Values will be scaled to 0 if they need to be in the scaleMotor function
-                    }
-                }
-            } else if (mixer_type == MIXERSETTINGS_MIXER1TYPE_REVERSABLEMOTOR) {
-                status[ct] = ProcessMixer(ct, curve1, curve2, &desired, multirotor, fixedwing);
-                // Reversable Motors are like Motors but go to neutral instead of minimum
-                // If not armed or motor is inactive - no "spinwhilearmed" for this engine type
-                if (!armed || !activeThrottle) {
-                    status[ct] = 0; // force neutral throttle
+        if (mixer_type == MIXERSETTINGS_MIXER1TYPE_DISABLED) {
+            // Set to minimum if disabled.  This is not the same as saying PWM pulse = 0 us
+            status[ct] = -1;
+            continue;
+        }
+
+        if ((mixer_type == MIXERSETTINGS_MIXER1TYPE_MOTOR)) {
+            status[ct] = mixed[ct];
+            // If not armed or motors aren't meant to spin all the time
+            if (!armed ||
+                (!spinWhileArmed && !positiveThrottle)) {
+                status[ct] = -1; // force min throttle
+            }
+            // If armed meant to keep spinning,
+            else if ((spinWhileArmed && !positiveThrottle) ||
+                     (status[ct] < 0)) {
+                if (!multirotor) {
+                    status[ct] = 0;
+                    // allow throttle values lower than 0 if multirotor.
+                    // Values will be scaled to 0 if they need to be in the scaleMotor function
                 }
-            } else if (mixer_type == MIXERSETTINGS_MIXER1TYPE_SERVO) {
-                status[ct] = ProcessMixer(ct, curve1, curve2, &desired, multirotor, fixedwing);
-            } else {
-                status[ct] = -1;
-
-                // If an accessory channel is selected for direct bypass mode
-                // In this configuration the accessory channel is scaled and mapped
-                // directly to output.  Note: THERE IS NO SAFETY CHECK HERE FOR ARMING
-                // these also will not be updated in failsafe mode.  I'm not sure what
-                // the correct behavior is since it seems domain specific.  I don't love
-                // this code
-                if ((mixer_type >= MIXERSETTINGS_MIXER1TYPE_ACCESSORY0) &&
-                    (mixer_type <= MIXERSETTINGS_MIXER1TYPE_ACCESSORY5)) {
-                    if (AccessoryDesiredInstGet(mixer_type - MIXERSETTINGS_MIXER1TYPE_ACCESSORY0, &accessory) == 0) {
-                        status[ct] = accessory.AccessoryVal;
-                    } else {
-                        status[ct] = -1;
-                    }
+            }
+        } else if (mixer_type == MIXERSETTINGS_MIXER1TYPE_REVERSABLEMOTOR) {
+            status[ct] = mixed[ct];
+            // Reversable Motors are like Motors but go to neutral instead of minimum
+            // If not armed or motor is inactive - no "spinwhilearmed" for this engine type
+            if (!armed || !activeThrottle) {
+                status[ct] = 0; // force neutral throttle
+            }
+        } else if (mixer_type == MIXERSETTINGS_MIXER1TYPE_SERVO) {
+            status[ct] = mixed[ct];
+        } else {
+            status[ct] = -1;
+
+            // If an accessory channel is selected for direct bypass mode
+            // In this configuration the accessory channel is scaled and mapped
+            // directly to output.  Note: THERE IS NO SAFETY CHECK HERE FOR ARMING
+            // these also will not be updated in failsafe mode.  I'm not sure what
+            // the correct behavior is since it seems domain specific.  I don't love
+            // this code
+            if ((mixer_type >= MIXERSETTINGS_MIXER1TYPE_ACCESSORY0) &&
+                (mixer_type <= MIXERSETTINGS_MIXER1TYPE_ACCESSORY5)) {
+                if (AccessoryDesiredInstGet(mixer_type - MIXERSETTINGS_MIXER1TYPE_ACCESSORY0, &accessory) == 0) {
+                    status[ct] = accessory.AccessoryVal;
+                } else {
+                    status[ct] = -1;
                 }
+            }
 
-                if ((mixer_type >= MIXERSETTINGS_MIXER1TYPE_CAMERAROLLORSERVO1) &&
-                    (mixer_type <= MIXERSETTINGS_MIXER1TYPE_CAMERAYAW)) {
-                    if (camStabEnabled) {
-                        CameraDesiredData cameraDesired;
-                        CameraDesiredGet(&cameraDesired);
-                        switch (mixer_type) {
-                        case MIXERSETTINGS_MIXER1TYPE_CAMERAROLLORSERVO1:
-                            status[ct] = cameraDesired.RollOrServo1;
-                            break;
-                        case MIXERSETTINGS_MIXER1TYPE_CAMERAPITCHORSERVO2:
-                            status[ct] = cameraDesired.PitchOrServo2;
-                            break;
-                        case MIXERSETTINGS_MIXER1TYPE_CAMERAYAW:
-                            status[ct] = cameraDesired.Yaw;
-                            break;
-                        default:
-                            break;
-                        }
-                    } else {
-                        status[ct] = -1;
-                    }
-
-                    // Disable camera actuators for CAMERA_BOOT_DELAY_MS after boot
-                    if (thisSysTime < (CAMERA_BOOT_DELAY_MS / portTICK_RATE_MS)) {
-                        command.Channel[ct] = 0;
+            if ((mixer_type >= MIXERSETTINGS_MIXER1TYPE_CAMERAROLLORSERVO1) &&
+                (mixer_type <= MIXERSETTINGS_MIXER1TYPE_CAMERAYAW)) {
+                if (camStabEnabled) {
+                    CameraDesiredData cameraDesired;
+                    CameraDesiredGet(&cameraDesired);
+                    switch (mixer_type) {
+                    case MIXERSETTINGS_MIXER1TYPE_CAMERAROLLORSERVO1:
+                        status[ct] = cameraDesired.RollOrServo1;
+                        break;
+                    case MIXERSETTINGS_MIXER1TYPE_CAMERAPITCHORSERVO2:
+                        status[ct] = cameraDesired.PitchOrServo2;
+                        break;
+                    case MIXERSETTINGS_MIXER1TYPE_CAMERAYAW:
+                        status[ct] = cameraDesired.Yaw;
+                        break;
+                    default:
+                        break;
                     }
+                } else {
+                    status[ct] = -1;
                 }
-            }
 
-            // If mixer type is motor we need to find which motor has the highest value and which motor has the lowest value.
-            // For use in function scaleMotor
-            if (mixers[ct].type == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
-                if (maxMotor < status[ct]) {
-                    maxMotor = status[ct];
-                }
-                if (minMotor > status[ct]) {
-                    minMotor = status[ct];
+                // Disable camera actuators for CAMERA_BOOT_DELAY_MS after boot
+                if (thisSysTime < (CAMERA_BOOT_DELAY_MS / portTICK_RATE_MS)) {
+                    command.Channel[ct] = 0;
                 }
             }
         }
 
-        // Set real actuator output values scaling them from mixers. All channels
-        // will be set except explicitly disabled (which will have PWM pulse = 0).
-        for (int i = 0; i < MAX_MIX_ACTUATORS; i++) {
-            if (command.Channel[i]) {
-                if (mixers[i].type == MIXERSETTINGS_MIXER1TYPE_MOTOR) { // If mixer is for a motor we need to find the highest value of all motors
-                    command.Channel[i] = scaleMotor(status[i],
-                                                    actuatorSettings.ChannelMax[i],
-                                                    actuatorSettings.ChannelMin[i],
-                                                    actuatorSettings.ChannelNeutral[i],
-                                                    maxMotor,
-                                                    minMotor,
-                                                    armed,
-                                                    alwaysStabilizeWhenArmed,
-                                                    throttleDesired);
-                } else { // else we scale the channel
-                    command.Channel[i] = scaleChannel(status[i],
-                                                      actuatorSettings.ChannelMax[i],
-                                                      actuatorSettings.ChannelMin[i],
-                                                      actuatorSettings.ChannelNeutral[i]);
-                }
+        // If mixer type is motor we need to find which motor has the highest value and which motor has the lowest value.
+        // For use in function scaleMotor
+        if (mixers[ct].type == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
+            if (maxMotor < status[ct]) {
+                maxMotor = status[ct];
+            }
+            if (minMotor > status[ct]) {
+                minMotor = status[ct];
             }
         }
+    }
 
-        // Store update time
-        command.UpdateTime = dTMilliseconds;
-        if (command.UpdateTime > command.MaxUpdateTime) {
-            command.MaxUpdateTime = command.UpdateTime;
+    // Set real actuator output values scaling them from mixers. All channels
+    // will be set except explicitly disabled (which will have PWM pulse = 0).
+    for (int i = 0; i < MAX_MIX_ACTUATORS; i++) {
+        if (command.Channel[i]) {
+            if (mixers[i].type == MIXERSETTINGS_MIXER1TYPE_MOTOR) { // If mixer is for a motor we need to find the highest value of all motors
+                command.Channel[i] = scaleMotor(status[i],
+                                                actuatorSettings.ChannelMax[i],
+                                                actuatorSettings.ChannelMin[i],
+                                                actuatorSettings.ChannelNeutral[i],
+                                                maxMotor,
+                                                minMotor,
+                                                armed,
+                                                alwaysStabilizeWhenArmed,
+                                                throttleDesired);
+            } else { // else we scale the channel
+                command.Channel[i] = scaleChannel(status[i],
+                                                  actuatorSettings.ChannelMax[i],
+                                                  actuatorSettings.ChannelMin[i],
+                                                  actuatorSettings.ChannelNeutral[i]);
+            }
         }
-        // Update output object
-        ActuatorCommandSet(&command);
-        // Update in case read only (eg. during servo configuration)
-        ActuatorCommandGet(&command);
+    }
+
+    // Store update time
+    command.UpdateTime = dTMilliseconds;
+    if (command.UpdateTime > command.MaxUpdateTime) {
+        command.MaxUpdateTime = command.UpdateTime;
+    }
+    // Update output object
+    ActuatorCommandSet(&command);
+    // Update in case read only (eg. during servo configuration)
+    ActuatorCommandGet(&command);
 
 #ifdef DIAG_MIXERSTATUS
-        MixerStatusSet(&mixerStatus);
+    MixerStatusSet(&mixerStatus);
 #endif
 
 
-        // Update servo outputs
-        bool success = true;
+    // Update servo outputs
+    bool success = true;
 
-        for (int n = 0; n < ACTUATORCOMMAND_CHANNEL_NUMELEM; ++n) {
-            success &= set_channel(n, command.Channel[n]);
-        }
+    for (int n = 0; n < ACTUATORCOMMAND_CHANNEL_NUMELEM; ++n) {
+        success &= set_channel(n, command.Channel[n]);
+    }
 
-        PIOS_Servo_Update();
+    PIOS_Servo_Update();
+    ControlLatencyOutput();
 
-        if (!success) {
-            command.NumFailedUpdates++;
-            ActuatorCommandSet(&command);
-            AlarmsSet(SYSTEMALARMS_ALARM_ACTUATOR, SYSTEMALARMS_ALARM_CRITICAL);
-        }
+    if (!success) {
+        command.NumFailedUpdates++;
+        ActuatorCommandSet(&command);
+        AlarmsSet(SYSTEMALARMS_ALARM_ACTUATOR, SYSTEMALARMS_ALARM_CRITICAL);
+    }
 #ifdef PIOS_INCLUDE_INSTRUMENTATION
-        PIOS_Instrumentation_TimeEnd(counter);
+    PIOS_Instrumentation_TimeEnd(counter);
 #endif
-    }
 }
 
-
 /**
- * Process mixing for one actuator
+ * Publish the control path latency gathered over the last CONTROL_LATENCY_PERIOD_MS
  */
-float ProcessMixer(const int index, const float curve1, const float curve2,
-                   ActuatorDesiredData *desired, bool multirotor, bool fixedwing)
+static void publishControlLatency()
 {
-    const Mixer_t *mixers = (Mixer_t *)&mixerSettings.Mixer1Type; // pointer to array of mixers in UAVObjects
-    const Mixer_t *mixer  = &mixers[index];
-    float differential    = 1.0f;
-
-    // Apply differential only for fixedwing and Roll servos
-    if (fixedwing && (mixerSettings.FirstRollServo > 0) &&
-        (mixer->type == MIXERSETTINGS_MIXER1TYPE_SERVO) &&
-        (mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_ROLL] != 0)) {
-        // Positive differential
-        if (mixerSettings.RollDifferential > 0) {
-            // Check for first Roll servo (should be left aileron or elevon) and Roll desired (positive/negative)
-            if (((index == mixerSettings.FirstRollServo - 1) && (desired->Roll > 0.0f))
-                || ((index != mixerSettings.FirstRollServo - 1) && (desired->Roll < 0.0f))) {
-                differential -= (mixerSettings.RollDifferential * 0.01f);
-            }
-        } else if (mixerSettings.RollDifferential < 0) {
-            if (((index == mixerSettings.FirstRollServo - 1) && (desired->Roll < 0.0f))
-                || ((index != mixerSettings.FirstRollServo - 1) && (desired->Roll > 0.0f))) {
-                differential -= (-mixerSettings.RollDifferential * 0.01f);
-            }
-        }
-    }
-
-    float result = ((((float)mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE1]) * curve1) +
-                    (((float)mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_THROTTLECURVE2]) * curve2) +
-                    (((float)mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_ROLL]) * desired->Roll * differential) +
-                    (((float)mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_PITCH]) * desired->Pitch) +
-                    (((float)mixer->matrix[MIXERSETTINGS_MIXER1VECTOR_YAW]) * desired->Yaw)) / 128.0f;
+    portTickType now = xTaskGetTickCount();
 
-    if (mixer->type == MIXERSETTINGS_MIXER1TYPE_MOTOR) {
-        if (!multirotor) { // we allow negative throttle with a multirotor
-            if (result < 0.0f) { // zero throttle
-                result = 0.0f;
-            }
-        }
+    if (now - latencyPublishTime < CONTROL_LATENCY_PERIOD_MS / portTICK_RATE_MS) {
+        return;
     }
-
-    return result;
+    float period = (float)((now - latencyPublishTime) * portTICK_RATE_MS) * 0.001f;
+    latencyPublishTime = now;
+
+    struct ControlLatencyStats stats;
+    ControlLatencyGetStats(&stats);
+
+    ControlLatencyStatusData latency;
+    latency.FastPath = fastPathLock ? CONTROLLATENCYSTATUS_FASTPATH_TRUE : CONTROLLATENCYSTATUS_FASTPATH_FALSE;
+    if (stats.controlCount) {
+        latency.SensorToControl.Min  = stats.controlMin;
+        latency.SensorToControl.Mean = (float)stats.controlSum / (float)stats.controlCount;
+        latency.SensorToControl.Max  = stats.controlMax;
+    } else {
+        latency.SensorToControl.Min  = 0.0f;
+        latency.SensorToControl.Mean = 0.0f;
+        latency.SensorToControl.Max  = 0.0f;
+    }
+    if (stats.outputCount) {
+        latency.SensorToOutput.Min  = stats.outputMin;
+        latency.SensorToOutput.Mean = (float)stats.outputSum / (float)stats.outputCount;
+        latency.SensorToOutput.Max  = stats.outputMax;
+    } else {
+        latency.SensorToOutput.Min  = 0.0f;
+        latency.SensorToOutput.Mean = 0.0f;
+        latency.SensorToOutput.Max  = 0.0f;
+    }
+    latency.OutputRate = (float)stats.outputCount / period;
+    latency.Missed     = stats.missed;
+    ControlLatencyStatusSet(&latency);
 }
 
 
@@ -821,6 +888,7 @@ static void setFailsafe()
     }
     // Send the updated command
     PIOS_Servo_Update();
+    ControlLatencyOutput();
 
     // Update output object's parts that we changed
     ActuatorCommandChannelSet(Channel);
@@ -1054,6 +1122,7 @@ static void MixerSettingsUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
             mixer_settings_count++;
         }
     }
+    compileMixer();
 }
 static void SettingsUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
@@ -1078,6 +1147,45 @@ static void SettingsUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 #endif
 
     SystemSettingsThrustControlGet(&thrustType);
+    compileMixer();
+}
+
+/**
+ * Compile the mixer settings into the inactive matrix and switch over to it
+ */
+static void compileMixer()
+{
+    const Mixer_t *mixers = (Mixer_t *)&mixerSettings.Mixer1Type;
+    struct MixerMatrixConfig config;
+    uint8_t next = mixerMatrixActive ^ 1;
+
+    PIOS_STATIC_ASSERT(MAX_MIX_ACTUATORS <= MIXERMATRIX_MAX_CHANNELS);
+    config.channels   = MAX_MIX_ACTUATORS;
+    config.multirotor = (GetCurrentFrameType() == FRAME_TYPE_MULTIROTOR);
+    config.fixedwing  = (GetCurrentFrameType() == FRAME_TYPE_FIXED_WING);
+    config.firstRollServo   = mixerSettings.FirstRollServo;
+    config.rollDifferential = mixerSettings.RollDifferential;
+
+    for (int ct = 0; ct < MAX_MIX_ACTUATORS; ct++) {
+        switch (mixers[ct].type) {
+        case MIXERSETTINGS_MIXER1TYPE_MOTOR:
+            config.channel[ct].type = MIXERMATRIX_CHANNEL_MOTOR;
+            break;
+        case MIXERSETTINGS_MIXER1TYPE_REVERSABLEMOTOR:
+            config.channel[ct].type = MIXERMATRIX_CHANNEL_REVERSIBLEMOTOR;
+            break;
+        case MIXERSETTINGS_MIXER1TYPE_SERVO:
+            config.channel[ct].type = MIXERMATRIX_CHANNEL_SERVO;
+            break;
+        default:
+            config.channel[ct].type = MIXERMATRIX_CHANNEL_NONE;
+            break;
+        }
+        memcpy(config.channel[ct].vector, mixers[ct].matrix, sizeof(config.channel[ct].vector));
+    }
+
+    MixerMatrixCompile(&mixerMatrix[next], &config);
+    mixerMatrixActive = next;
 }
 
 /**
@@ -62,6 +62,7 @@
 #include "flightstatus.h"
 #include "manualcontrolcommand.h"
 #include "taskinfo.h"
+#include "stabilizationsettings.h"
 
 #include <pios_sensors.h>
 #include <pios_adxl345.h>
@@ -72,6 +73,7 @@
 #include <mathmisc.h>
 #include <pios_constants.h>
 #include <pios_instrumentation_helper.h>
+#include <controllatency.h>
 
 PERF_DEFINE_COUNTER(counterUpd);
 PERF_DEFINE_COUNTER(counterAccelSamples);
@@ -84,8 +86,9 @@ PERF_DEFINE_COUNTER(counterAtt);
 // - 0xA7710004 number of accel samples read for each loop (cc only).
 
 // Private constants
-#define STACK_SIZE_BYTES     540
-#define TASK_PRIORITY        (tskIDLE_PRIORITY + 3)
+#define STACK_SIZE_BYTES          540
+#define FASTPATH_STACK_SIZE_BYTES 1400 // inner loop and mixer run in this task with the fast path
+#define TASK_PRIORITY             (tskIDLE_PRIORITY + 3)
 
 // Attitude module loop interval (defined by sensor rate in pios_config.h)
 static const uint32_t sensor_period_ms = ((uint32_t)1000.0f / PIOS_SENSOR_RATE);
@@ -117,6 +120,7 @@ static void AttitudeTask(void *parameters);
 
 static float gyro_correct_int[3] = { 0, 0, 0 };
 static xQueueHandle gyro_queue;
+static uint32_t gyroTimestamp; // newest gyro sample, the control path latency starts there
 
 static int32_t updateSensors(AccelStateData *, GyroStateData *);
 static int32_t updateSensorsCC3D(AccelStateData *accelStateData, GyroStateData *gyrosData);
@@ -181,8 +185,17 @@ static const struct pios_board_info *bdinfo = &pios_board_info_blob;
  */
 int32_t AttitudeStart(void)
 {
+    StabilizationSettingsFastPathOptions fastPath;
+    uint32_t stackSize = STACK_SIZE_BYTES;
+
+    StabilizationSettingsInitialize();
+    StabilizationSettingsFastPathGet(&fastPath);
+    if (fastPath == STABILIZATIONSETTINGS_FASTPATH_TRUE) {
+        stackSize += FASTPATH_STACK_SIZE_BYTES;
+    }
+
     // Start main task
-    xTaskCreate(AttitudeTask, "Attitude", STACK_SIZE_BYTES / 4, NULL, TASK_PRIORITY, &taskHandle);
+    xTaskCreate(AttitudeTask, "Attitude", stackSize / 4, NULL, TASK_PRIORITY, &taskHandle);
     PIOS_TASK_MONITOR_RegisterTask(TASKINFO_RUNNING_ATTITUDE, taskHandle);
 #ifdef PIOS_INCLUDE_WDG
     PIOS_WDG_RegisterFlag(PIOS_WDG_ATTITUDE);
@@ -386,6 +399,7 @@ static int32_t updateSensors(AccelStateData *accelState, GyroStateData *gyros)
         AlarmsSet(SYSTEMALARMS_ALARM_ATTITUDE, SYSTEMALARMS_ALARM_ERROR);
         return -1;
     }
+    gyroTimestamp = PIOS_DELAY_GetRaw();
 
     // Do not read raw sensor data in simulation mode
     if (GyroStateReadOnly() || AccelStateReadOnly()) {
@@ -483,6 +497,7 @@ static int32_t updateSensors(AccelStateData *accelState, GyroStateData *gyros)
     gyro_correct_int[2] += -gyros->z * yawBiasRate;
     PERF_TIMED_SECTION_END(counterUpd);
 
+    ControlLatencySensor(gyroTimestamp);
     GyroStateSet(gyros);
     AccelStateSet(accelState);
 
@@ -515,6 +530,7 @@ static int32_t updateSensorsCC3D(AccelStateData *accelStateData, GyroStateData *
         accels[2] += mpu6000_data->sample[0].z;
 
         temp += mpu6000_data->temperature;
+        gyroTimestamp = mpu6000_data->timestamp ? mpu6000_data->timestamp : PIOS_DELAY_GetRaw();
 
         count++;
         // check if further samples are already in queue
@@ -613,6 +629,7 @@ static int32_t updateSensorsCC3D(AccelStateData *accelStateData, GyroStateData *
     // and make it average zero (weakly)
     gyro_correct_int[2] += -gyrosData->z * yawBiasRate;
     PERF_TIMED_SECTION_END(counterUpd);
+    ControlLatencySensor(gyroTimestamp);
     GyroStateSet(gyrosData);
     AccelStateSet(accelStateData);
 
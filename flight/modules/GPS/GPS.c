@@ -43,6 +43,7 @@
 #include "hwsettings.h"
 #include "auxmagsensor.h"
 #include "WorldMagModel.h"
+#include "WorldMagModelCache.h"
 #include "CoordinateConversions.h"
 #include <pios_com.h>
 
@@ -106,6 +107,9 @@ void updateGpsSettings(__attribute__((unused)) UAVObjEvent *ev);
 
 #define GPS_LOOP_DELAY_MS          6
 
+// largest interpolation error of the magnetic field grid still good enough for the home location
+#define GPS_WMM_CACHE_MAX_ERROR    0.5f
+
 #ifdef PIOS_GPS_SETS_HOMELOCATION
 // Unfortunately need a good size stack for the WMM calculation
         #define STACK_SIZE_BYTES   1024
@@ -433,6 +437,15 @@ static void gpsTask(__attribute__((unused)) void *parameters)
                     } else {
                         homelocationSetDelay = 0;
                     }
+
+                    // Keep the magnetic field grid around the vehicle, at most one model evaluation per update
+                    GPSTimeData gpstime;
+                    GPSTimeGet(&gpstime);
+                    if (gpstime.Year >= 2000) {
+                        WMM_CacheRequest(gpspositionsensor.Latitude / 10e6f, gpspositionsensor.Longitude / 10e6f,
+                                         gpspositionsensor.Altitude + gpspositionsensor.GeoidSeparation);
+                        WMM_CacheUpdate(gpstime.Month, gpstime.Day, gpstime.Year);
+                    }
 #endif
                     // else if (we are at least getting what might be usable GPS data to finish a flight with) {
                 } else if ((gpspositionsensor.Status == GPSPOSITIONSENSOR_STATUS_FIX3D) &&
@@ -487,8 +500,10 @@ static void setHomeLocation(GPSPositionSensorData *gpsData)
 
         float LLA[3] = { (home.Latitude) / 10e6f, (home.Longitude) / 10e6f, (home.Altitude) };
 
-        /* Compute magnetic flux direction at home location */
-        if (WMM_GetMagVector(LLA[0], LLA[1], LLA[2], gps.Month, gps.Day, gps.Year, &home.Be[0]) == 0) {
+        /* Compute magnetic flux direction at home location, from the cached grid when it is good enough */
+        bool cached = WMM_CacheGetErrorBound() < GPS_WMM_CACHE_MAX_ERROR &&
+                      WMM_CacheGetMagVector(LLA[0], LLA[1], LLA[2], &home.Be[0]) == 0;
+        if (cached || WMM_GetMagVector(LLA[0], LLA[1], LLA[2], gps.Month, gps.Day, gps.Year, &home.Be[0]) == 0) {
             /*Compute local acceleration due to gravity.  Vehicles that span a very large
              * range of altitude (say, weather balloons) may need to update this during the
              * flight. */
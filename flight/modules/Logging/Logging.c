@@ -36,6 +36,13 @@
 #include "debuglogstatus.h"
 #include "debuglogentry.h"
 #include "flightstatus.h"
+#include "callbackinfo.h"
+
+// Private constants
+#define FLUSH_STACK_SIZE_BYTES  512
+#define FLUSH_RETRY_MS          100
+#define STREAM_STACK_SIZE_BYTES 512
+#define STREAM_WINDOW           8 // DebugLogEntry instances entries are streamed through
 
 // private variables
 static DebugLogSettingsData settings;
@@ -43,12 +50,30 @@ static DebugLogControlData control;
 static DebugLogStatusData status;
 static FlightStatusData flightstatus;
 static DebugLogEntryData *entry; // would be better on stack but event dispatcher stack might be insufficient
+static DelayedCallbackInfo *flushCallback;
+static DelayedCallbackInfo *streamCallback;
+static DebugLogEntryData *streamEntry; // allocated along with the extra instances on the first stream request
+static uint16_t streamFlight;
+static uint16_t streamEntryId;
+static uint8_t streamCount;
+static uint8_t streamInstance;
+// stream request from the event dispatcher, StreamCb takes it over before sending the next entry
+static struct {
+    uint16_t flight;
+    uint16_t entryId;
+    uint8_t  count;
+    bool     pending;
+} streamRequest;
 
 // private functions
 static void SettingsUpdatedCb(UAVObjEvent *ev);
 static void ControlUpdatedCb(UAVObjEvent *ev);
 static void StatusUpdatedCb(UAVObjEvent *ev);
 static void FlightStatusUpdatedCb(UAVObjEvent *ev);
+static void FlushRequest(void);
+static void FlushCb(void);
+static void StreamStart(uint16_t flight, uint16_t entryId, uint8_t count);
+static void StreamCb(void);
 
 int32_t LoggingInitialize(void)
 {
@@ -63,6 +88,15 @@ int32_t LoggingInitialize(void)
         return -1;
     }
 
+    // write the log buffers to flash from the lowest priority, modules logging objects never wait for it
+    flushCallback = PIOS_CALLBACKSCHEDULER_Create(&FlushCb, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, CALLBACKINFO_RUNNING_LOGGING, FLUSH_STACK_SIZE_BYTES);
+    if (!flushCallback) {
+        return -1;
+    }
+    PIOS_DEBUGLOG_SetFlushRequest(&FlushRequest);
+    // log downloads read the flash from the lowest priority too
+    streamCallback = PIOS_CALLBACKSCHEDULER_Create(&StreamCb, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, -1, STREAM_STACK_SIZE_BYTES);
+
     return 0;
 }
 
@@ -89,10 +123,102 @@ MODULE_INITCALL(LoggingInitialize, LoggingStart);
 
 static void StatusUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
+    struct PIOS_DEBUGLOG_Stats stats;
+
     PIOS_DEBUGLOG_Info(&status.Flight, &status.Entry, &status.FreeSlots, &status.UsedSlots);
+    PIOS_DEBUGLOG_GetStats(&stats);
+    status.DroppedEntries = stats.dropped;
+    status.FlushTime    = stats.flush_time;
+    status.FlushTimeMax = stats.flush_time_max;
     DebugLogStatusSet(&status);
 }
 
+// called by PIOS_DEBUGLOG from whichever task filled a buffer
+static void FlushRequest(void)
+{
+    PIOS_CALLBACKSCHEDULER_Dispatch(flushCallback);
+}
+
+static void FlushCb(void)
+{
+    // try again later if the flash failed or an entry was still being copied in
+    if (PIOS_DEBUGLOG_Flush() > 0) {
+        PIOS_CALLBACKSCHEDULER_Schedule(flushCallback, FLUSH_RETRY_MS, CALLBACK_UPDATEMODE_LATER);
+    }
+}
+
+/**
+ * Send the next entry of a stream request, each one to its own instance so
+ * that telemetry still has all of them when they are queued back to back.
+ */
+static void StreamCb(void)
+{
+    portENTER_CRITICAL();
+    if (streamRequest.pending) {
+        streamFlight   = streamRequest.flight;
+        streamEntryId  = streamRequest.entryId;
+        streamCount    = streamRequest.count;
+        streamInstance = 0;
+        streamRequest.pending = false;
+    }
+    portEXIT_CRITICAL();
+
+    if (!streamCount) {
+        return;
+    }
+
+    memset(streamEntry, 0, sizeof(DebugLogEntryData));
+    bool found = PIOS_DEBUGLOG_Read(streamEntry, streamFlight, streamEntryId) == 0;
+    if (!found) {
+        // tell where the flight ends
+        streamEntry->Flight = streamFlight;
+        streamEntry->Entry  = streamEntryId;
+        streamEntry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
+    }
+    DebugLogEntryInstSet(streamInstance, streamEntry);
+    DebugLogEntryInstUpdated(streamInstance);
+
+    streamEntryId++;
+    streamInstance++;
+    streamCount = found ? streamCount - 1 : 0;
+    if (streamCount) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(streamCallback);
+    }
+}
+
+/**
+ * Stream count entries of a flight, replacing any stream still running
+ */
+static void StreamStart(uint16_t flight, uint16_t entryId, uint8_t count)
+{
+    if (!streamCallback) {
+        return;
+    }
+    if (!streamEntry) {
+        streamEntry = pios_malloc(sizeof(DebugLogEntryData));
+        if (!streamEntry) {
+            return;
+        }
+    }
+    // only needed while downloading, created on demand
+    while (UAVObjGetNumInstances(DebugLogEntryHandle()) < STREAM_WINDOW && DebugLogEntryCreateInstance() != 0) {
+        ;
+    }
+    uint16_t instances = UAVObjGetNumInstances(DebugLogEntryHandle());
+    if (count > instances) {
+        count = instances;
+    }
+
+    // the stream state belongs to StreamCb, it picks the request up on its next run
+    portENTER_CRITICAL();
+    streamRequest.flight  = flight;
+    streamRequest.entryId = entryId;
+    streamRequest.count   = count;
+    streamRequest.pending = true;
+    portEXIT_CRITICAL();
+    PIOS_CALLBACKSCHEDULER_Dispatch(streamCallback);
+}
+
 static void FlightStatusUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
     FlightStatusGet(&flightstatus);
@@ -133,6 +259,8 @@ static void ControlUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
             entry->Type   = DEBUGLOGENTRY_TYPE_EMPTY;
         }
         DebugLogEntrySet(entry);
+    } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_STREAM) {
+        StreamStart(control.Flight, control.Entry, control.Count);
     } else if (control.Operation == DEBUGLOGCONTROL_OPERATION_FORMATFLASH) {
         FlightStatusArmedOptions armed;
         FlightStatusArmedGet(&armed);
@@ -56,17 +56,41 @@
 #define TASK_PRIORITY               CALLBACK_TASK_NAVIGATION
 #define MAX_QUEUE_SIZE              2
 #define PATH_PLANNER_UPDATE_RATE_MS 100 // can be slow, since we listen to status updates as well
+#define PLAN_CLEAN                  0xffff // no instance changed since the last check
+#define PLAN_ALLOC_STEP             16 // grow the plan cache in steps, uploads add one waypoint at a time
 
 // Private types
 
+// Copy of the path plan in RAM. Waypoint and PathAction instances are looked up
+// through the instance list, which gets slow with hundreds of waypoints, so only
+// the instances reported changed are read again. The validation and any lookahead
+// then work on the tables.
+struct planCache {
+    WaypointData   *waypoints;
+    PathActionData *actions;
+    uint8_t  *waypointCrc; // running crc up to and including each waypoint
+    uint8_t  *actionCrc;   // running crc up to and including each action, continues the waypoints
+    uint16_t waypointSize; // allocated entries
+    uint16_t actionSize;
+    uint16_t waypointCount; // loaded entries
+    uint16_t actionCount;
+    uint8_t  actionSeed; // crc of the waypoints the action crcs were computed from
+    uint8_t  planCrc; // PathPlan Crc the result is for
+    bool     valid;
+};
+
 // Private functions
 static void pathPlannerTask();
 static void commandUpdated(UAVObjEvent *ev);
+static void planUpdated(UAVObjEvent *ev);
 static void statusUpdated(UAVObjEvent *ev);
 static void updatePathDesired();
 static void setWaypoint(uint16_t num);
 
 static uint8_t checkPathPlan();
+static int32_t planReserve(uint16_t waypointCount, uint16_t actionCount);
+static const WaypointData *planWaypoint(int32_t index);
+static const PathActionData *planAction(int32_t index);
 static uint8_t pathConditionCheck();
 static uint8_t conditionNone();
 static uint8_t conditionTimeOut();
@@ -90,6 +114,10 @@ static PathActionData pathAction;
 static bool pathplanner_active = false;
 static FrameType_t frameType;
 static bool mode3D;
+static struct planCache plan;
+// lowest instance changed since the last check, set from the event callbacks
+static volatile uint16_t waypointDirtyFrom = 0;
+static volatile uint16_t actionDirtyFrom   = 0;
 
 extern FrameType_t GetCurrentFrameType();
 
@@ -100,9 +128,9 @@ int32_t PathPlannerStart()
 {
     plan_initialize();
     // when the active waypoint changes, update pathDesired
-    WaypointConnectCallback(commandUpdated);
+    WaypointConnectCallback(planUpdated);
     WaypointActiveConnectCallback(commandUpdated);
-    PathActionConnectCallback(commandUpdated);
+    PathActionConnectCallback(planUpdated);
     PathStatusConnectCallback(statusUpdated);
     SettingsUpdatedCb(NULL);
     SystemSettingsConnectCallback(&SettingsUpdatedCb);
@@ -234,8 +262,13 @@ static void pathPlannerTask()
         }
     }
 
-    WaypointInstGet(waypointActive.Index, &waypoint);
-    PathActionInstGet(waypoint.Action, &pathAction);
+    const WaypointData *activeWaypoint = planWaypoint(waypointActive.Index);
+    if (!activeWaypoint) {
+        // not part of the plan, wait for a valid WaypointActive
+        return;
+    }
+    waypoint   = *activeWaypoint;
+    pathAction = *planAction(waypoint.Action);
     PathStatusData pathStatus;
     PathStatusGet(&pathStatus);
 
@@ -297,11 +330,18 @@ void updatePathDesired()
         return;
     }
 
-    // find out current waypoint
+    // find out current waypoint, this runs in the planner task too and
+    // may be ahead of it after a waypoint change, so update the plan first
     WaypointActiveGet(&waypointActive);
-    WaypointInstGet(waypointActive.Index, &waypoint);
-
-    PathActionInstGet(waypoint.Action, &pathAction);
+    if (!checkPathPlan()) {
+        return;
+    }
+    const WaypointData *activeWaypoint = planWaypoint(waypointActive.Index);
+    if (!activeWaypoint) {
+        return;
+    }
+    waypoint   = *activeWaypoint;
+    pathAction = *planAction(waypoint.Action);
 
     PathDesiredData pathDesired;
 
@@ -333,13 +373,12 @@ void updatePathDesired()
         pathDesired.StartingVelocity = pathDesired.EndingVelocity;
     } else {
         // Get previous waypoint as start point
-        WaypointData waypointPrev;
-        WaypointInstGet(waypointActive.Index - 1, &waypointPrev);
+        const WaypointData *waypointPrev = planWaypoint(waypointActive.Index - 1);
 
-        pathDesired.Start.North = waypointPrev.Position.North;
-        pathDesired.Start.East  = waypointPrev.Position.East;
-        pathDesired.Start.Down  = waypointPrev.Position.Down;
-        pathDesired.StartingVelocity = waypointPrev.Velocity;
+        pathDesired.Start.North = waypointPrev->Position.North;
+        pathDesired.Start.East  = waypointPrev->Position.East;
+        pathDesired.Start.Down  = waypointPrev->Position.Down;
+        pathDesired.StartingVelocity = waypointPrev->Velocity;
     }
 
     PathDesiredSet(&pathDesired);
@@ -347,44 +386,78 @@ void updatePathDesired()
 
 
 // safety checks for path plan integrity
+// only the instances changed since the last call are read, nothing else when there are none
 static uint8_t checkPathPlan()
 {
     uint16_t i;
-    uint16_t waypointCount;
-    uint16_t actionCount;
+    uint16_t waypointFrom;
+    uint16_t actionFrom;
     uint8_t pathCrc;
     PathPlanData pathPlan;
 
-    // WaypointData waypoint; // using global instead (?)
-    // PathActionData action; // using global instead (?)
-
     PathPlanGet(&pathPlan);
 
-    waypointCount = pathPlan.WaypointCount;
-    if (waypointCount == 0) {
-        // an empty path plan is invalid
+    // take the changes reported since the last check
+    portENTER_CRITICAL();
+    waypointFrom      = waypointDirtyFrom;
+    actionFrom        = actionDirtyFrom;
+    waypointDirtyFrom = PLAN_CLEAN;
+    actionDirtyFrom   = PLAN_CLEAN;
+    portEXIT_CRITICAL();
+
+    if (waypointFrom == PLAN_CLEAN && actionFrom == PLAN_CLEAN &&
+        pathPlan.WaypointCount == plan.waypointCount &&
+        pathPlan.PathActionCount == plan.actionCount &&
+        pathPlan.Crc == plan.planCrc) {
+        return plan.valid;
+    }
+
+    plan.valid   = false;
+    plan.planCrc = pathPlan.Crc;
+
+    // an empty path plan is invalid, as are inconsistent counts
+    if (pathPlan.WaypointCount == 0 ||
+        pathPlan.WaypointCount > UAVObjGetNumInstances(WaypointHandle()) ||
+        pathPlan.PathActionCount > UAVObjGetNumInstances(PathActionHandle()) ||
+        planReserve(pathPlan.WaypointCount, pathPlan.PathActionCount) < 0) {
+        // PIOS_DEBUGLOG_Printf("PathPlan : waypoint or path action count error!");
+        // load everything once the plan is complete
+        plan.waypointCount = 0;
+        plan.actionCount   = 0;
         return false;
     }
-    actionCount = pathPlan.PathActionCount;
 
-    // check count consistency
-    if (waypointCount > UAVObjGetNumInstances(WaypointHandle())) {
-        // PIOS_DEBUGLOG_Printf("PathPlan : waypoint count error!");
-        return false;
+    // entries past the ones loaded before are new
+    if (waypointFrom > plan.waypointCount) {
+        waypointFrom = plan.waypointCount;
     }
-    if (actionCount > UAVObjGetNumInstances(PathActionHandle())) {
-        // PIOS_DEBUGLOG_Printf("PathPlan : path action count error!");
-        return false;
+    if (actionFrom > plan.actionCount) {
+        actionFrom = plan.actionCount;
     }
+    plan.waypointCount = pathPlan.WaypointCount;
+    plan.actionCount   = pathPlan.PathActionCount;
 
-    // check CRC
-    pathCrc = 0;
-    for (i = 0; i < waypointCount; i++) {
+    // read what changed and continue the CRC from there
+    // an instance changing while it is read is reported again and read on the next check
+    pathCrc = waypointFrom ? plan.waypointCrc[waypointFrom - 1] : 0;
+    for (i = waypointFrom; i < plan.waypointCount; i++) {
+        WaypointInstGet(i, &plan.waypoints[i]);
         pathCrc = UAVObjUpdateCRC(WaypointHandle(), i, pathCrc);
+        plan.waypointCrc[i] = pathCrc;
+    }
+    pathCrc = plan.waypointCrc[plan.waypointCount - 1];
+    if (pathCrc != plan.actionSeed) {
+        actionFrom = 0;
+        plan.actionSeed = pathCrc;
     }
-    for (i = 0; i < actionCount; i++) {
+    pathCrc = actionFrom ? plan.actionCrc[actionFrom - 1] : plan.actionSeed;
+    for (i = actionFrom; i < plan.actionCount; i++) {
+        PathActionInstGet(i, &plan.actions[i]);
         pathCrc = UAVObjUpdateCRC(PathActionHandle(), i, pathCrc);
+        plan.actionCrc[i] = pathCrc;
     }
+
+    // check CRC
     if (pathCrc != pathPlan.Crc) {
         // failed crc check
         // PIOS_DEBUGLOG_Printf("PathPlan : bad CRC (%d / %d)!", pathCrc, pathPlan.Crc);
@@ -392,38 +465,127 @@ static uint8_t checkPathPlan()
     }
 
     // waypoint consistency
-    for (i = 0; i < waypointCount; i++) {
-        WaypointInstGet(i, &waypoint);
-        if (waypoint.Action >= actionCount) {
+    for (i = 0; i < plan.waypointCount; i++) {
+        if (plan.waypoints[i].Action >= plan.actionCount) {
             // path action id is out of range
             return false;
         }
     }
 
     // path action consistency
-    for (i = 0; i < actionCount; i++) {
-        PathActionInstGet(i, &pathAction);
-        if (pathAction.ErrorDestination >= waypointCount) {
+    for (i = 0; i < plan.actionCount; i++) {
+        if (plan.actions[i].ErrorDestination >= plan.waypointCount) {
             // waypoint id is out of range
             return false;
         }
-        if (pathAction.JumpDestination >= waypointCount) {
+        if (plan.actions[i].JumpDestination >= plan.waypointCount) {
             // waypoint id is out of range
             return false;
         }
     }
 
     // path plan passed checks
+    plan.valid = true;
 
     return true;
 }
 
+/**
+ * Make room in the plan cache, growing drops what was loaded
+ * @return 0 on success or -1 if out of memory
+ */
+static int32_t planReserve(uint16_t waypointCount, uint16_t actionCount)
+{
+    if (waypointCount > plan.waypointSize) {
+        uint16_t size = (waypointCount + PLAN_ALLOC_STEP - 1) / PLAN_ALLOC_STEP * PLAN_ALLOC_STEP;
+        if (plan.waypoints) {
+            pios_free(plan.waypoints);
+            pios_free(plan.waypointCrc);
+        }
+        plan.waypoints     = pios_malloc(size * sizeof(plan.waypoints[0]));
+        plan.waypointCrc   = pios_malloc(size * sizeof(plan.waypointCrc[0]));
+        plan.waypointSize  = size;
+        plan.waypointCount = 0;
+        if (!plan.waypoints || !plan.waypointCrc) {
+            pios_free(plan.waypoints);
+            pios_free(plan.waypointCrc);
+            plan.waypoints    = NULL;
+            plan.waypointCrc  = NULL;
+            plan.waypointSize = 0;
+            return -1;
+        }
+    }
+    if (actionCount > plan.actionSize) {
+        uint16_t size = (actionCount + PLAN_ALLOC_STEP - 1) / PLAN_ALLOC_STEP * PLAN_ALLOC_STEP;
+        if (plan.actions) {
+            pios_free(plan.actions);
+            pios_free(plan.actionCrc);
+        }
+        plan.actions     = pios_malloc(size * sizeof(plan.actions[0]));
+        plan.actionCrc   = pios_malloc(size * sizeof(plan.actionCrc[0]));
+        plan.actionSize  = size;
+        plan.actionCount = 0;
+        if (!plan.actions || !plan.actionCrc) {
+            pios_free(plan.actions);
+            pios_free(plan.actionCrc);
+            plan.actions    = NULL;
+            plan.actionCrc  = NULL;
+            plan.actionSize = 0;
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Waypoint of the current plan, only meaningful while checkPathPlan() returns true
+ * @return NULL if the plan has no such waypoint
+ */
+static const WaypointData *planWaypoint(int32_t index)
+{
+    if (index < 0 || index >= plan.waypointCount) {
+        return NULL;
+    }
+    return &plan.waypoints[index];
+}
+
+/**
+ * Path action of the current plan, only meaningful while checkPathPlan() returns true
+ * @return NULL if the plan has no such action
+ */
+static const PathActionData *planAction(int32_t index)
+{
+    if (index < 0 || index >= plan.actionCount) {
+        return NULL;
+    }
+    return &plan.actions[index];
+}
+
 // callback function when status changed, issue execution of state machine
 void commandUpdated(__attribute__((unused)) UAVObjEvent *ev)
 {
     PIOS_CALLBACKSCHEDULER_Dispatch(pathDesiredUpdaterHandle);
 }
 
+// callback function when a waypoint or path action changed, remember which one
+static void planUpdated(UAVObjEvent *ev)
+{
+    uint16_t instId = (ev->instId == UAVOBJ_ALL_INSTANCES) ? 0 : ev->instId;
+
+    portENTER_CRITICAL();
+    if (ev->obj == WaypointHandle()) {
+        if (instId < waypointDirtyFrom) {
+            waypointDirtyFrom = instId;
+        }
+    } else if (instId < actionDirtyFrom) {
+        actionDirtyFrom = instId;
+    }
+    portEXIT_CRITICAL();
+
+    commandUpdated(ev);
+}
+
 // callback function when waypoints changed in any way, update pathDesired
 void statusUpdated(__attribute__((unused)) UAVObjEvent *ev)
 {
@@ -652,15 +814,14 @@ static uint8_t conditionAboveSpeed()
  */
 static uint8_t conditionPointingTowardsNext()
 {
-    uint16_t nextWaypointId = waypointActive.Index + 1;
+    // path plans wrap around
+    const WaypointData *nextWaypoint = planWaypoint(waypointActive.Index + 1);
 
-    if (nextWaypointId >= UAVObjGetNumInstances(WaypointHandle())) {
-        nextWaypointId = 0;
+    if (!nextWaypoint) {
+        nextWaypoint = planWaypoint(0);
     }
-    WaypointData nextWaypoint;
-    WaypointInstGet(nextWaypointId, &nextWaypoint);
 
-    float angle1 = atan2f((nextWaypoint.Position.North - waypoint.Position.North), (nextWaypoint.Position.East - waypoint.Position.East));
+    float angle1 = atan2f((nextWaypoint->Position.North - waypoint.Position.North), (nextWaypoint->Position.East - waypoint.Position.East));
 
     VelocityStateData velocity;
     VelocityStateGet(&velocity);
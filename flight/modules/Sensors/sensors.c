@@ -61,11 +61,16 @@
 #include <auxmagsettings.h>
 #include <auxmagsensor.h>
 #include <auxmagsupport.h>
+#include <sensorring.h>
+#include <controllatency.h>
 #include <accelgyrosettings.h>
+#include <sensorfiltersettings.h>
+#include <stabilizationsettings.h>
 #include <revosettings.h>
 #include <UBX.h>
 
 #include <mathmisc.h>
+#include <biquad.h>
 #include <taskinfo.h>
 #include <pios_math.h>
 #include <pios_constants.h>
@@ -74,8 +79,9 @@
 #include <string.h>
 
 // Private constants
-#define STACK_SIZE_BYTES         1000
-#define TASK_PRIORITY            (tskIDLE_PRIORITY + 3)
+#define STACK_SIZE_BYTES          1000
+#define FASTPATH_STACK_SIZE_BYTES 1600 // inner loop and mixer run in this task with the fast path
+#define TASK_PRIORITY             (tskIDLE_PRIORITY + 3)
 
 #define MAX_SENSORS_PER_INSTANCE 2
 #ifdef PIOS_INCLUDE_WDG
@@ -106,14 +112,38 @@ static const float temp_alpha_baro = TEMP_DT_BARO / (TEMP_DT_BARO + 1.0f / (2.0f
 
 #define ZERO_ROT_ANGLE           0.00001f
 
+// Decimation filters
+#define FILTER_CHUNK             8 // samples converted and filtered at once, keeps the stack small
+#define FILTER_RATE_ALPHA        0.01f // smoothing of the input sample rate estimate
+#define FILTER_RATE_TOLERANCE    0.1f // the filters are redesigned when the input rate moves this much
+#define FILTER_MAX_FREQUENCY     0.45f // highest cutoff or notch frequency relative to the input rate, below Nyquist
+#define FILTER_NOTCH_TOLERANCE   0.02f // a dynamic notch is moved once the tracked vibration is this far off
+
 // Private types
 typedef struct {
     // used to accumulate all samples in a task iteration
     Vector3i32 accum[2];
     int32_t    temperature;
     uint32_t   count;
+    // latest output of the decimation filters
+    float      decimated[2][3];
+    bool       filtered[2];
 } sensor_fetch_context;
 
+// Decimation filter of the accel or gyro samples, replaces the plain average when enabled
+typedef struct {
+    struct Biquad3Cascade cascade;
+    float rate; // estimated input sample rate
+    float design_rate; // input sample rate the coefficients were calculated for, 0 if not designed yet
+    bool  enabled;
+    // dynamic notches, gyro only
+    struct Biquad3PeakTracker tracker;
+    float   scratch[FILTER_CHUNK][3]; // copy of a chunk the tracker band passes, kept off the small task stack
+    float   notch[3]; // current notch frequency of each axis, 0 for axes without a notch
+    uint8_t notch_stage; // index of the notch section in the cascade
+    bool    tracking; // the notches follow the tracker
+} sensor_filter;
+
 #define MAX_SENSOR_DATA_SIZE (sizeof(PIOS_SENSORS_3Axis_SensorsWithTemp) + MAX_SENSORS_PER_INSTANCE * sizeof(Vector3i16))
 typedef union {
     PIOS_SENSORS_3Axis_SensorsWithTemp sensorSample3Axis;
@@ -129,6 +159,7 @@ PERF_DEFINE_COUNTER(counterMagPeriod);
 PERF_DEFINE_COUNTER(counterBaroPeriod);
 PERF_DEFINE_COUNTER(counterSensorPeriod);
 PERF_DEFINE_COUNTER(counterSensorResets);
+PERF_DEFINE_COUNTER(counterSensorFilter);
 
 #if defined(PIOS_INCLUDE_HMC5X83)
 void aux_hmc5x83_load_settings();
@@ -139,11 +170,22 @@ static void SensorsTask(void *parameters);
 static void settingsUpdatedCb(UAVObjEvent *objEv);
 
 static void accumulateSamples(sensor_fetch_context *sensor_context, sensor_data *sample);
+static void accumulateBlock(sensor_fetch_context *sensor_context, const PIOS_SENSORS_3Axis_SampleBlock *block);
+static void filterSamples(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor, const Vector3i16 *sample, uint32_t count, uint8_t sensors, float temperature, uint32_t timestamp, uint32_t period);
+static void decimateSamples(sensor_fetch_context *sensor_context, sensor_filter *filter, uint8_t index, float scale, float *samples);
+static sensor_filter *getFilter(const PIOS_SENSORS_Instance *sensor, uint8_t index);
+static void updateFilterSettings();
+static void designFilter(sensor_filter *filter, bool gyro);
+static void trackNotches(sensor_filter *filter);
+static uint32_t sampleTimestamp(const sensor_data *sample);
+static void pushRingSample(SensorRingType type, const float *sample, float scale, float temperature, uint32_t timestamp);
 static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor);
 static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const PIOS_SENSORS_Instance *sensor);
 
 static void clearContext(sensor_fetch_context *sensor_context);
 
+static void calibrateAccel(const float *raw, float *out);
+static void calibrateGyro(const float *raw, float *out);
 static void handleAccel(float *samples, float temperature);
 static void handleGyro(float *samples, float temperature);
 static void handleMag(float *samples, float temperature);
@@ -159,6 +201,7 @@ static void updateBaroTempBias(float temperature);
 // Private variables
 static sensor_data *source_data;
 static xTaskHandle sensorsTaskHandle;
+static uint32_t lastGyroTimestamp; // newest gyro sample, the control path latency starts there
 RevoCalibrationData cal;
 AccelGyroSettingsData agcal;
 
@@ -192,6 +235,11 @@ static float baro_temp_bias   = 0;
 static float baro_temperature = NAN;
 static uint8_t baro_temp_calibration_count = 0;
 
+static SensorFilterSettingsData filter_settings;
+static volatile bool filter_settings_updated = false;
+static sensor_filter accel_filter;
+static sensor_filter gyro_filter;
+
 #if defined(PIOS_INCLUDE_HMC5X83)
 // Allow AuxMag to be disabled without reboot
 // because the other mags are that way
@@ -213,6 +261,7 @@ int32_t SensorsInitialize(void)
     RevoSettingsInitialize();
     AttitudeSettingsInitialize();
     AccelGyroSettingsInitialize();
+    SensorFilterSettingsInitialize();
 
 #if defined(PIOS_INCLUDE_HMC5X83)
     // for auxmagsupport.c helpers
@@ -224,6 +273,7 @@ int32_t SensorsInitialize(void)
     RevoCalibrationConnectCallback(&settingsUpdatedCb);
     AttitudeSettingsConnectCallback(&settingsUpdatedCb);
     AccelGyroSettingsConnectCallback(&settingsUpdatedCb);
+    SensorFilterSettingsConnectCallback(&settingsUpdatedCb);
 
     return 0;
 }
@@ -234,8 +284,17 @@ int32_t SensorsInitialize(void)
  */
 int32_t SensorsStart(void)
 {
+    StabilizationSettingsFastPathOptions fastPath;
+    uint32_t stackSize = STACK_SIZE_BYTES;
+
+    StabilizationSettingsInitialize();
+    StabilizationSettingsFastPathGet(&fastPath);
+    if (fastPath == STABILIZATIONSETTINGS_FASTPATH_TRUE) {
+        stackSize += FASTPATH_STACK_SIZE_BYTES;
+    }
+
     // Start main task
-    xTaskCreate(SensorsTask, "Sensors", STACK_SIZE_BYTES / 4, NULL, TASK_PRIORITY, &sensorsTaskHandle);
+    xTaskCreate(SensorsTask, "Sensors", stackSize / 4, NULL, TASK_PRIORITY, &sensorsTaskHandle);
     PIOS_TASK_MONITOR_RegisterTask(TASKINFO_RUNNING_SENSORS, sensorsTaskHandle);
     REGISTER_WDG();
     return 0;
@@ -274,6 +333,7 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
     PERF_INIT_COUNTER(counterBaroPeriod, 0x53000004);
     PERF_INIT_COUNTER(counterSensorPeriod, 0x53000005);
     PERF_INIT_COUNTER(counterSensorResets, 0x53000006);
+    PERF_INIT_COUNTER(counterSensorFilter, 0x53000007);
 
     // Test sensors
     bool sensors_test = true;
@@ -310,6 +370,11 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
         }
 
 
+        if (filter_settings_updated) {
+            filter_settings_updated = false;
+            updateFilterSettings();
+        }
+
         // reset the fetch context
         clearContext(&sensor_context);
         LL_FOREACH((PIOS_SENSORS_Instance *)sensors_list, sensor) {
@@ -317,11 +382,27 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
             bool is_primary = (sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL);
 
             if (!sensor->driver->is_polled) {
-                const QueueHandle_t queue = PIOS_SENSORS_GetQueue(sensor);
-                while (xQueueReceive(queue,
-                                     (void *)source_data,
-                                     (is_primary && !sensor_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
-                    accumulateSamples(&sensor_context, source_data);
+                PIOS_SENSORS_Ring *ring = PIOS_SENSORS_GetRing(sensor);
+                if (ring) {
+                    // block delivering drivers wake the task once per block, not once per sample
+                    if (!is_primary || PIOS_SENSORS_RingWait(ring, sensor_period_ticks)) {
+                        PIOS_SENSORS_3Axis_SampleBlock block;
+                        while (PIOS_SENSORS_RingFetch(ring, &block)) {
+                            accumulateBlock(&sensor_context, &block);
+                            filterSamples(&sensor_context, sensor, block.sample, block.count, block.sensors,
+                                          (float)block.temperature * 0.01f, block.timestamp, block.period);
+                            PIOS_SENSORS_RingRelease(ring, &block);
+                        }
+                    }
+                } else {
+                    const QueueHandle_t queue = PIOS_SENSORS_GetQueue(sensor);
+                    while (xQueueReceive(queue,
+                                         (void *)source_data,
+                                         (is_primary && !sensor_context.count) ? sensor_period_ticks : 0) == pdTRUE) {
+                        accumulateSamples(&sensor_context, source_data);
+                        filterSamples(&sensor_context, sensor, source_data->sensorSample3Axis.sample, 1, source_data->sensorSample3Axis.count,
+                                      (float)source_data->sensorSample3Axis.temperature * 0.01f, sampleTimestamp(source_data), 0);
+                    }
                 }
                 if (sensor_context.count) {
                     processSamples3d(&sensor_context, sensor);
@@ -337,6 +418,8 @@ static void SensorsTask(__attribute__((unused)) void *parameters)
                     PIOS_SENSOR_Fetch(sensor, (void *)source_data, MAX_SENSORS_PER_INSTANCE);
                     if (sensor->type & PIOS_SENSORS_TYPE_3D) {
                         accumulateSamples(&sensor_context, source_data);
+                        filterSamples(&sensor_context, sensor, source_data->sensorSample3Axis.sample, 1, source_data->sensorSample3Axis.count,
+                                      (float)source_data->sensorSample3Axis.temperature * 0.01f, sampleTimestamp(source_data), 0);
                         processSamples3d(&sensor_context, sensor);
                     } else {
                         processSamples1d(&source_data->sensorSample1Axis, sensor);
@@ -358,6 +441,7 @@ static void clearContext(sensor_fetch_context *sensor_context)
         sensor_context->accum[i].x = 0;
         sensor_context->accum[i].y = 0;
         sensor_context->accum[i].z = 0;
+        sensor_context->filtered[i] = false;
     }
     sensor_context->temperature = 0;
     sensor_context->count = 0;
@@ -374,6 +458,275 @@ static void accumulateSamples(sensor_fetch_context *sensor_context, sensor_data
     sensor_context->count++;
 }
 
+static void accumulateBlock(sensor_fetch_context *sensor_context, const PIOS_SENSORS_3Axis_SampleBlock *block)
+{
+    const Vector3i16 *sample = block->sample;
+
+    for (uint32_t n = 0; n < block->count; n++, sample += block->sensors) {
+        for (uint32_t i = 0; (i < MAX_SENSORS_PER_INSTANCE) && (i < block->sensors); i++) {
+            sensor_context->accum[i].x += sample[i].x;
+            sensor_context->accum[i].y += sample[i].y;
+            sensor_context->accum[i].z += sample[i].z;
+        }
+    }
+    sensor_context->temperature += block->temperature * block->count;
+    sensor_context->count += block->count;
+}
+
+/**
+ * Run the accel and gyro samples through their decimation filters and pass every single
+ * output on to the state estimation along with its timestamp, the sample timestamps of a
+ * block are spaced by its period. The last output of each filter is kept in the context
+ * for the sensor objects, which are still updated once per task iteration.
+ */
+static void filterSamples(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor, const Vector3i16 *sample, uint32_t count, uint8_t sensors, float temperature, uint32_t timestamp, uint32_t period)
+{
+    float buffer[FILTER_CHUNK][3];
+    float scales[MAX_SENSORS_PER_INSTANCE];
+
+    if (!(sensor->type & (PIOS_SENSORS_TYPE_3AXIS_ACCEL | PIOS_SENSORS_TYPE_3AXIS_GYRO)) || !count) {
+        return;
+    }
+
+    PIOS_SENSORS_GetScales(sensor, scales, MAX_SENSORS_PER_INSTANCE);
+    // a combined gyro/accel instance delivers the accel first, then the gyro
+    const uint8_t used = (sensor->type == PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL) ? 2 : 1;
+    for (uint8_t i = 0; (i < used) && (i < sensors); i++) {
+        const SensorRingType type = ((sensor->type == PIOS_SENSORS_TYPE_3AXIS_GYRO) || i) ? SENSORRING_GYRO : SENSORRING_ACCEL;
+        sensor_filter *filter     = getFilter(sensor, i);
+        // frequencies out of range for the input rate can leave no stage at all
+        const bool filtered = filter && filter->design_rate && filter->cascade.stages;
+
+        const Vector3i16 *in = &sample[i];
+        uint32_t stamp = timestamp;
+        uint32_t remaining = count;
+        uint32_t n = 0;
+        while (remaining) {
+            n = (remaining < FILTER_CHUNK) ? remaining : FILTER_CHUNK;
+            for (uint32_t k = 0; k < n; k++, in += sensors) {
+                buffer[k][0] = (float)in->x;
+                buffer[k][1] = (float)in->y;
+                buffer[k][2] = (float)in->z;
+            }
+            if (filtered) {
+                PERF_TIMED_SECTION_START(counterSensorFilter);
+                if (filter->tracking) {
+                    memcpy(filter->scratch, buffer, n * sizeof(buffer[0]));
+                    Biquad3PeakTrackerUpdate(&filter->tracker, &filter->scratch[0][0], n);
+                }
+                Biquad3Filter(&filter->cascade, &buffer[0][0], n);
+                PERF_TIMED_SECTION_END(counterSensorFilter);
+            }
+            for (uint32_t k = 0; k < n; k++, stamp += period) {
+                pushRingSample(type, buffer[k], scales[i], temperature, stamp);
+            }
+            remaining -= n;
+        }
+        if (filtered) {
+            sensor_context->decimated[i][0] = buffer[n - 1][0];
+            sensor_context->decimated[i][1] = buffer[n - 1][1];
+            sensor_context->decimated[i][2] = buffer[n - 1][2];
+            sensor_context->filtered[i]     = true;
+            if (filter->tracking) {
+                trackNotches(filter);
+            }
+        }
+    }
+}
+
+/**
+ * Reduce the samples of one sensor in a task iteration to one sample, the output of the
+ * decimation filter if there is one or the average otherwise. Also keeps track of the
+ * input sample rate the filter is designed for.
+ */
+static void decimateSamples(sensor_fetch_context *sensor_context, sensor_filter *filter, uint8_t index, float scale, float *samples)
+{
+    const float inv_count = 1.0f / (float)sensor_context->count;
+
+    if (sensor_context->filtered[index]) {
+        samples[0] = sensor_context->decimated[index][0] * scale;
+        samples[1] = sensor_context->decimated[index][1] * scale;
+        samples[2] = sensor_context->decimated[index][2] * scale;
+    } else {
+        float t = inv_count * scale;
+        samples[0] = ((float)sensor_context->accum[index].x * t);
+        samples[1] = ((float)sensor_context->accum[index].y * t);
+        samples[2] = ((float)sensor_context->accum[index].z * t);
+    }
+
+    if (!filter || !filter->enabled) {
+        return;
+    }
+
+    // samples per iteration times the iteration rate, smoothed against late iterations
+    float rate = (float)sensor_context->count * PIOS_SENSOR_RATE;
+    filter->rate = filter->rate > 0.0f ? filter->rate + FILTER_RATE_ALPHA * (rate - filter->rate) : rate;
+    if (fabsf(filter->rate - filter->design_rate) > FILTER_RATE_TOLERANCE * filter->rate) {
+        bool initial = !filter->design_rate;
+        designFilter(filter, filter == &gyro_filter);
+        if (initial) {
+            // start from the current average instead of from zero
+            const float x0[3] = { (float)sensor_context->accum[index].x * inv_count,
+                                  (float)sensor_context->accum[index].y * inv_count,
+                                  (float)sensor_context->accum[index].z * inv_count };
+            Biquad3Reset(&filter->cascade, x0);
+        }
+    }
+}
+
+/**
+ * The filter for a sensor of an instance, NULL for sensors that are not filtered
+ */
+static sensor_filter *getFilter(const PIOS_SENSORS_Instance *sensor, uint8_t index)
+{
+    sensor_filter *filter;
+
+    switch (sensor->type) {
+    case PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL:
+        filter = index ? &gyro_filter : &accel_filter;
+        break;
+    case PIOS_SENSORS_TYPE_3AXIS_ACCEL:
+        filter = &accel_filter;
+        break;
+    case PIOS_SENSORS_TYPE_3AXIS_GYRO:
+        filter = &gyro_filter;
+        break;
+    default:
+        return NULL;
+    }
+    return filter->enabled ? filter : NULL;
+}
+
+/**
+ * Apply new filter settings, the filters are designed again once the input rate is known
+ */
+static void updateFilterSettings()
+{
+    SensorFilterSettingsGet(&filter_settings);
+
+    accel_filter.enabled     = filter_settings.LowPassCutoff.Accel > 0.0f;
+    accel_filter.design_rate = 0.0f;
+
+    gyro_filter.enabled = filter_settings.LowPassCutoff.Gyro > 0.0f ||
+                          (filter_settings.NotchQ > 0.0f &&
+                           (filter_settings.NotchFrequency.X > 0.0f ||
+                            filter_settings.NotchFrequency.Y > 0.0f ||
+                            filter_settings.NotchFrequency.Z > 0.0f));
+    gyro_filter.design_rate = 0.0f;
+    gyro_filter.tracking    = false;
+    memset(gyro_filter.notch, 0, sizeof(gyro_filter.notch));
+}
+
+/**
+ * Calculate the coefficients for the current input rate estimate: a Butterworth low pass
+ * made of second order sections, followed by the per axis notches on the gyro. Dynamic
+ * notches keep the frequency they were tracked to when the input rate changes.
+ */
+static void designFilter(sensor_filter *filter, bool gyro)
+{
+    struct BiquadCoefficients coeffs;
+    const float rate   = filter->rate;
+    const float cutoff = gyro ? filter_settings.LowPassCutoff.Gyro : filter_settings.LowPassCutoff.Accel;
+    // LowPassOrder options are 2, 4, 6 and 8
+    const uint8_t stages = (gyro ? filter_settings.LowPassOrder.Gyro : filter_settings.LowPassOrder.Accel) + 1;
+    uint8_t n = 0;
+
+    if (cutoff > 0.0f && cutoff < FILTER_MAX_FREQUENCY * rate) {
+        for (uint8_t stage = 0; stage < stages; stage++, n++) {
+            BiquadLowPass(cutoff, rate, BiquadButterworthQ(stages, stage), &coeffs);
+            for (uint8_t axis = 0; axis < 3; axis++) {
+                Biquad3SetStage(&filter->cascade, n, axis, &coeffs);
+            }
+        }
+    }
+
+    filter->tracking = false;
+    if (gyro) {
+        // sensor axes, the board rotation is only applied after filtering
+        const float notch[3] = { filter_settings.NotchFrequency.X,
+                                 filter_settings.NotchFrequency.Y,
+                                 filter_settings.NotchFrequency.Z };
+        const float min      = filter_settings.DynamicNotchRange.Min;
+        const float max      = fminf(filter_settings.DynamicNotchRange.Max, FILTER_MAX_FREQUENCY * rate);
+        const bool dynamic   = filter_settings.NotchMode == SENSORFILTERSETTINGS_NOTCHMODE_DYNAMIC && min > 0.0f && min < max;
+        bool used = false;
+        for (uint8_t axis = 0; axis < 3; axis++) {
+            float f = notch[axis];
+            if (dynamic && f > 0.0f) {
+                f = filter->notch[axis] > 0.0f ? filter->notch[axis] : f;
+                f = (f < min) ? min : (f > max) ? max : f;
+            }
+            if (f > 0.0f && f < FILTER_MAX_FREQUENCY * rate && filter_settings.NotchQ > 0.0f) {
+                BiquadNotch(f, rate, filter_settings.NotchQ, &coeffs);
+                used = true;
+            } else {
+                // pass the axis through unchanged
+                coeffs = (struct BiquadCoefficients) { .b0 = 1.0f };
+                f = 0.0f;
+            }
+            Biquad3SetStage(&filter->cascade, n, axis, &coeffs);
+            filter->notch[axis] = f;
+        }
+        if (used) {
+            filter->notch_stage = n++;
+            if (dynamic) {
+                Biquad3PeakTrackerInit(&filter->tracker, min, max, rate, filter->notch);
+                filter->tracking = true;
+            }
+        }
+    }
+
+    filter->cascade.stages = n;
+    filter->design_rate    = rate;
+}
+
+/**
+ * Move the notch of each axis to the tracked vibration once it is far enough off, the
+ * state of the section is kept so the output does not jump
+ */
+static void trackNotches(sensor_filter *filter)
+{
+    struct BiquadCoefficients coeffs;
+
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        const float f = filter->tracker.frequency[axis];
+        if (filter->notch[axis] > 0.0f && fabsf(f - filter->notch[axis]) > FILTER_NOTCH_TOLERANCE * filter->notch[axis]) {
+            BiquadNotch(f, filter->design_rate, filter_settings.NotchQ, &coeffs);
+            Biquad3SetStage(&filter->cascade, filter->notch_stage, axis, &coeffs);
+            filter->notch[axis] = f;
+        }
+    }
+}
+
+/**
+ * Time a single sample was taken at, drivers that don't stamp their samples get the time
+ * they were picked up
+ */
+static uint32_t sampleTimestamp(const sensor_data *sample)
+{
+    return sample->sensorSample3Axis.timestamp ? sample->sensorSample3Axis.timestamp : PIOS_DELAY_GetRaw();
+}
+
+/**
+ * Calibrate a gyro or accel sample and pass it on to the state estimation
+ */
+static void pushRingSample(SensorRingType type, const float *sample, float scale, float temperature, uint32_t timestamp)
+{
+    SensorRingSample out;
+    const float raw[3] = { sample[0] * scale, sample[1] * scale, sample[2] * scale };
+
+    out.timestamp   = timestamp;
+    out.temperature = temperature;
+
+    if (type == SENSORRING_ACCEL) {
+        calibrateAccel(raw, &out.x);
+    } else {
+        calibrateGyro(raw, &out.x);
+        lastGyroTimestamp = timestamp;
+    }
+    SensorRingPush(type, &out);
+}
+
 static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SENSORS_Instance *sensor)
 {
     float samples[3];
@@ -388,10 +741,7 @@ static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SE
         || (sensor->type == PIOS_SENSORS_TYPE_3AXIS_AUXMAG)
 #endif
         ) {
-        float t = inv_count * scales[0];
-        samples[0]  = ((float)sensor_context->accum[0].x * t);
-        samples[1]  = ((float)sensor_context->accum[0].y * t);
-        samples[2]  = ((float)sensor_context->accum[0].z * t);
+        decimateSamples(sensor_context, (sensor->type & PIOS_SENSORS_TYPE_3AXIS_ACCEL) ? &accel_filter : NULL, 0, scales[0], samples);
         temperature = (float)sensor_context->temperature * inv_count * 0.01f;
         switch (sensor->type) {
         case PIOS_SENSORS_TYPE_3AXIS_MAG:
@@ -419,10 +769,7 @@ static void processSamples3d(sensor_fetch_context *sensor_context, const PIOS_SE
         if (sensor->type == PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL) {
             index = 1;
         }
-        float t = inv_count * scales[index];
-        samples[0]  = ((float)sensor_context->accum[index].x * t);
-        samples[1]  = ((float)sensor_context->accum[index].y * t);
-        samples[2]  = ((float)sensor_context->accum[index].z * t);
+        decimateSamples(sensor_context, &gyro_filter, index, scales[index], samples);
         temperature = (float)sensor_context->temperature * inv_count * 0.01f;
         handleGyro(samples, temperature);
         return;
@@ -442,16 +789,30 @@ static void processSamples1d(PIOS_SENSORS_1Axis_SensorsWithTemp *sample, const P
     }
 }
 
+static void calibrateAccel(const float *raw, float *out)
+{
+    float accels_out[3] = { (raw[0] - agcal.accel_bias.X) * agcal.accel_scale.X - accel_temp_bias[0],
+                            (raw[1] - agcal.accel_bias.Y) * agcal.accel_scale.Y - accel_temp_bias[1],
+                            (raw[2] - agcal.accel_bias.Z) * agcal.accel_scale.Z - accel_temp_bias[2] };
+
+    rot_mult(R, accels_out, out);
+}
+
+static void calibrateGyro(const float *raw, float *out)
+{
+    float gyros_out[3] = { raw[0] * agcal.gyro_scale.X - agcal.gyro_bias.X - gyro_temp_bias[0],
+                           raw[1] * agcal.gyro_scale.Y - agcal.gyro_bias.Y - gyro_temp_bias[1],
+                           raw[2] * agcal.gyro_scale.Z - agcal.gyro_bias.Z - gyro_temp_bias[2] };
+
+    rot_mult(R, gyros_out, out);
+}
+
 static void handleAccel(float *samples, float temperature)
 {
     AccelSensorData accelSensorData;
 
     updateAccelTempBias(temperature);
-    float accels_out[3] = { (samples[0] - agcal.accel_bias.X) * agcal.accel_scale.X - accel_temp_bias[0],
-                            (samples[1] - agcal.accel_bias.Y) * agcal.accel_scale.Y - accel_temp_bias[1],
-                            (samples[2] - agcal.accel_bias.Z) * agcal.accel_scale.Z - accel_temp_bias[2] };
-
-    rot_mult(R, accels_out, samples);
+    calibrateAccel(samples, samples);
     accelSensorData.x = samples[0];
     accelSensorData.y = samples[1];
     accelSensorData.z = samples[2];
@@ -464,16 +825,13 @@ static void handleGyro(float *samples, float temperature)
     GyroSensorData gyroSensorData;
 
     updateGyroTempBias(temperature);
-    float gyros_out[3] = { samples[0] * agcal.gyro_scale.X - agcal.gyro_bias.X - gyro_temp_bias[0],
-                           samples[1] * agcal.gyro_scale.Y - agcal.gyro_bias.Y - gyro_temp_bias[1],
-                           samples[2] * agcal.gyro_scale.Z - agcal.gyro_bias.Z - gyro_temp_bias[2] };
-
-    rot_mult(R, gyros_out, samples);
+    calibrateGyro(samples, samples);
     gyroSensorData.temperature = temperature;
     gyroSensorData.x = samples[0];
     gyroSensorData.y = samples[1];
     gyroSensorData.z = samples[2];
 
+    ControlLatencySensor(lastGyroTimestamp);
     GyroSensorSet(&gyroSensorData);
 }
 
@@ -592,6 +950,7 @@ static void settingsUpdatedCb(__attribute__((unused)) UAVObjEvent *objEv)
     mag_bias[2] = cal.mag_bias.Z;
 
     AccelGyroSettingsGet(&agcal);
+    filter_settings_updated = true;
     accel_temp_calibrated = (agcal.temp_calibrated_extent.max - agcal.temp_calibrated_extent.min > .1f) &&
                             (fabsf(agcal.accel_temp_coeff.X) > 1e-9f || fabsf(agcal.accel_temp_coeff.Y) > 1e-9f || fabsf(agcal.accel_temp_coeff.Z) > 1e-9f);
     gyro_temp_calibrated  = (agcal.temp_calibrated_extent.max - agcal.temp_calibrated_extent.min > .1f) &&
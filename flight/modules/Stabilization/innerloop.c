@@ -51,6 +51,7 @@
 #include <virtualflybar.h>
 #include <cruisecontrol.h>
 #include <sanitycheck.h>
+#include <controllatency.h>
 #if !defined(PIOS_EXCLUDE_ADVANCED_FEATURES)
 #include <systemidentstate.h>
 #endif /* !defined(PIOS_EXCLUDE_ADVANCED_FEATURES) */
@@ -83,12 +84,14 @@ static PiOSDeltatimeConfig timeval;
 static float speedScaleFactor = 1.0f;
 static bool frame_is_multirotor;
 static bool measuredDterm_enabled;
+static xSemaphoreHandle fastPathLock; // only created when the fast path is enabled
 #if !defined(PIOS_EXCLUDE_ADVANCED_FEATURES)
 static uint32_t systemIdentTimeVal = 0;
 #endif /* !defined(PIOS_EXCLUDE_ADVANCED_FEATURES) */
 
 // Private functions
 static void stabilizationInnerloopTask();
+static void stabilizationInnerloop();
 static void GyroStateUpdatedCb(__attribute__((unused)) UAVObjEvent *ev);
 #ifdef REVOLUTION
 static void AirSpeedUpdatedCb(__attribute__((unused)) UAVObjEvent *ev);
@@ -114,7 +117,17 @@ void stabilizationInnerloopInit()
     PIOS_DELTATIME_Init(&timeval, UPDATE_EXPECTED, UPDATE_MIN, UPDATE_MAX, UPDATE_ALPHA);
 
     callbackHandle = PIOS_CALLBACKSCHEDULER_Create(&stabilizationInnerloopTask, CALLBACK_PRIORITY, CBTASK_PRIORITY, CALLBACKINFO_RUNNING_STABILIZATION1, STACK_SIZE_BYTES);
-    GyroStateConnectCallback(GyroStateUpdatedCb);
+
+    // in fast path mode the inner loop runs straight from GyroStateSet(), in the task that publishes the gyro,
+    // the callback is then only left with the failsafe runs
+    StabilizationSettingsFastPathOptions fastPath;
+    StabilizationSettingsFastPathGet(&fastPath);
+    if (fastPath == STABILIZATIONSETTINGS_FASTPATH_TRUE) {
+        fastPathLock = xSemaphoreCreateMutex();
+        GyroStateConnectFastCallback(GyroStateUpdatedCb);
+    } else {
+        GyroStateConnectCallback(GyroStateUpdatedCb);
+    }
 
     // schedule dead calls every FAILSAFE_TIMEOUT_MS to have the watchdog cleared
     PIOS_CALLBACKSCHEDULER_Schedule(callbackHandle, FAILSAFE_TIMEOUT_MS, CALLBACK_UPDATEMODE_LATER);
@@ -202,12 +215,31 @@ static pid_scaler create_pid_scaler(int axis)
     return scaler;
 }
 
+/**
+ * Runs the inner loop, from the callback scheduler or in fast path mode directly
+ * from the gyro update. Either way only one of them may be in it at a time, when
+ * the other one holds the lock this run is simply skipped.
+ */
+static void stabilizationInnerloopTask()
+{
+    if (fastPathLock && xSemaphoreTake(fastPathLock, 0) != pdTRUE) {
+        return;
+    }
+
+    ControlLatencyControl();
+    stabilizationInnerloop();
+
+    if (fastPathLock) {
+        xSemaphoreGive(fastPathLock);
+    }
+}
+
 /**
  * WARNING! This callback executes with critical flight control priority every
  * time a gyroscope update happens do NOT put any time consuming calculations
  * in this loop unless they really have to execute with every gyro update
  */
-static void stabilizationInnerloopTask()
+static void stabilizationInnerloop()
 {
     // watchdog and error handling
     {
@@ -465,31 +497,42 @@ static void stabilizationInnerloopTask()
 
 static void GyroStateUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
-    GyroStateData gyroState;
+    const GyroStateData *gyroState;
+    uint32_t version;
+    float gyro[3];
 
-    GyroStateGet(&gyroState);
+    do {
+        gyroState = GyroStateBorrow(&version);
+        gyro[0]   = gyroState->x;
+        gyro[1]   = gyroState->y;
+        gyro[2]   = gyroState->z;
+    } while (!GyroStateBorrowValid(version));
 
-    gyro_filtered[0] = gyro_filtered[0] * stabSettings.gyro_alpha + gyroState.x * (1 - stabSettings.gyro_alpha);
-    gyro_filtered[1] = gyro_filtered[1] * stabSettings.gyro_alpha + gyroState.y * (1 - stabSettings.gyro_alpha);
-    gyro_filtered[2] = gyro_filtered[2] * stabSettings.gyro_alpha + gyroState.z * (1 - stabSettings.gyro_alpha);
+    gyro_filtered[0] = gyro_filtered[0] * stabSettings.gyro_alpha + gyro[0] * (1 - stabSettings.gyro_alpha);
+    gyro_filtered[1] = gyro_filtered[1] * stabSettings.gyro_alpha + gyro[1] * (1 - stabSettings.gyro_alpha);
+    gyro_filtered[2] = gyro_filtered[2] * stabSettings.gyro_alpha + gyro[2] * (1 - stabSettings.gyro_alpha);
 
-    PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
     stabSettings.monitor.gyroupdates++;
+    if (fastPathLock) {
+        stabilizationInnerloopTask();
+    } else {
+        PIOS_CALLBACKSCHEDULER_Dispatch(callbackHandle);
+    }
 }
 
 #ifdef REVOLUTION
 static void AirSpeedUpdatedCb(__attribute__((unused)) UAVObjEvent *ev)
 {
     // Scale PID coefficients based on current airspeed estimation - needed for fixed wing planes
-    AirspeedStateData airspeedState;
+    float calibratedAirspeed;
 
-    AirspeedStateGet(&airspeedState);
-    if (stabSettings.settings.ScaleToAirspeed < 0.1f || airspeedState.CalibratedAirspeed < 0.1f) {
+    AirspeedStateCalibratedAirspeedGet(&calibratedAirspeed);
+    if (stabSettings.settings.ScaleToAirspeed < 0.1f || calibratedAirspeed < 0.1f) {
         // feature has been turned off
         speedScaleFactor = 1.0f;
     } else {
         // scale the factor to be 1.0 at the specified airspeed (for example 10m/s) but scaled by 1/speed^2
-        speedScaleFactor = boundf((stabSettings.settings.ScaleToAirspeed * stabSettings.settings.ScaleToAirspeed) / (airspeedState.CalibratedAirspeed * airspeedState.CalibratedAirspeed),
+        speedScaleFactor = boundf((stabSettings.settings.ScaleToAirspeed * stabSettings.settings.ScaleToAirspeed) / (calibratedAirspeed * calibratedAirspeed),
                                   stabSettings.settings.ScaleToAirspeedLimits.Min,
                                   stabSettings.settings.ScaleToAirspeedLimits.Max);
     }
@@ -61,6 +61,7 @@ struct data {
     float   accels_filtered[3];
     float   grot_filtered[3];
     float   gyroBias[3];
+    float   attitude[4]; // last valid estimate, the base for the next update
     bool    accelUpdated;
     bool    magUpdated;
     float   accel_alpha;
@@ -83,7 +84,7 @@ static int32_t initwithmag(stateFilter *self);
 static int32_t initwithoutmag(stateFilter *self);
 static int32_t maininit(stateFilter *self);
 static filterResult filter(stateFilter *self, stateEstimation *state);
-static filterResult complementaryFilter(struct data *this, float gyro[3], float accel[3], float mag[3], float attitude[4]);
+static filterResult complementaryFilter(struct data *this, float gyro[3], float accel[3], float mag[3], float sampleDT, float attitude[4]);
 
 static void flightStatusUpdatedCb(UAVObjEvent *ev);
 
@@ -186,8 +187,9 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
     if (IS_SET(state->updated, SENSORUPDATES_gyro)) {
         if (this->accelUpdated) {
             float attitude[4];
-            result = complementaryFilter(this, state->gyro, this->currentAccel, this->currentMag, attitude);
+            result = complementaryFilter(this, state->gyro, this->currentAccel, this->currentMag, state->dT, attitude);
             if (result == FILTERRESULT_OK) {
+                quat_copy(attitude, this->attitude);
                 state->attitude[0] = attitude[0];
                 state->attitude[1] = attitude[1];
                 state->attitude[2] = attitude[2];
@@ -215,7 +217,7 @@ static inline void apply_accel_filter(const struct data *this, const float *raw,
     }
 }
 
-static filterResult complementaryFilter(struct data *this, float gyro[3], float accel[3], float mag[3], float attitude[4])
+static filterResult complementaryFilter(struct data *this, float gyro[3], float accel[3], float mag[3], float sampleDT, float attitude[4])
 {
     float dT;
 
@@ -336,18 +338,19 @@ static filterResult complementaryFilter(struct data *this, float gyro[3], float
         this->init = 1;
     }
 
-    // Compute the dT using the cpu clock
-    dT = PIOS_DELAY_DiffuS(this->timeval) / 1000000.0f;
-    this->timeval = PIOS_DELAY_GetRaw();
-    if (dT < 0.001f) { // safe bounds
-        dT = 0.001f;
+    // Compute the dT from the sample timestamps if known, using the cpu clock otherwise
+    if (sampleDT > 0.0f) {
+        dT = sampleDT;
+    } else {
+        dT = PIOS_DELAY_DiffuS(this->timeval) / 1000000.0f;
+        if (dT < 0.001f) { // safe bounds
+            dT = 0.001f;
+        }
     }
+    this->timeval = PIOS_DELAY_GetRaw();
 
-    AttitudeStateData attitudeState; // base on previous state
-    AttitudeStateGet(&attitudeState);
-
-    // Get the current attitude estimate
-    quat_copy(&attitudeState.q1, attitude);
+    // Get the current attitude estimate, several gyro samples may be processed before AttitudeState is updated
+    quat_copy(this->attitude, attitude);
 
     // Apply smoothing to accel values, to reduce vibration noise before main calculations.
     apply_accel_filter(this, accel, this->accels_filtered);
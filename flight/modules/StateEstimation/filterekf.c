@@ -40,6 +40,7 @@
 
 #include <insgps.h>
 #include <CoordinateConversions.h>
+#include <mathmisc.h>
 
 // Private constants
 
@@ -234,6 +235,10 @@ static filterResult filter(stateFilter *self, stateEstimation *state)
     }
 
     dT = PIOS_DELTATIME_GetAverageSeconds(&this->dtconfig);
+    if (state->dT > 0.0f) {
+        // sample timestamps are known, predict with the true interval instead of the average
+        dT = boundf(state->dT, DT_MIN, DT_MAX);
+    }
 
     if (!this->inited && IS_SET(this->work.updated, SENSORUPDATES_mag) && IS_SET(this->work.updated, SENSORUPDATES_baro) && IS_SET(this->work.updated, SENSORUPDATES_pos)) {
         // Don't initialize until all sensors are read
@@ -72,6 +72,7 @@ typedef struct {
     float   auxMag[3];
     uint8_t magStatus;
     float   boardMag[3];
+    float   dT; // seconds since the previous gyro sample if known from sample timestamps, 0 otherwise
     sensorUpdates updated;
 } stateEstimation;
 
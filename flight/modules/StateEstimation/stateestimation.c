@@ -54,8 +54,10 @@
 
 #include "revosettings.h"
 #include "flightstatus.h"
+#include "stabilizationsettings.h"
 
 #include "CoordinateConversions.h"
+#include "sensorring.h"
 
 // Private constants
 #define STACK_SIZE_BYTES        256
@@ -63,19 +65,32 @@
 #define TASK_PRIORITY           CALLBACK_TASK_FLIGHTCONTROL
 #define TIMEOUT_MS              10
 
+// Gyro samples from the sensor ring are preferred over the sensor objects unless none arrived for this long
+#define RING_TIMEOUT_US         (1000 * TIMEOUT_MS)
+// Upper bound for the filter chain runs of one callback execution
+#define MAX_RING_SAMPLES        SENSORRING_LENGTH
+
 // Private filter init const
 #define FILTER_INIT_FORCE       -1
 #define FILTER_INIT_IF_POSSIBLE -2
 
 // local macros, ONLY to be used in the middle of StateEstimationCb in section RUNSTATE_LOAD after the update of states updated!
+// sensor objects are borrowed rather than copied, only the used fields are read (again if a write happened meanwhile)
 #define FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(sensorname, shortname, a1, a2, a3) \
     if (IS_SET(states.updated, SENSORUPDATES_##shortname)) { \
-        sensorname##Data s; \
-        sensorname##Get(&s); \
-        if (IS_REAL(s.a1) && IS_REAL(s.a2) && IS_REAL(s.a3)) { \
-            states.shortname[0] = s.a1; \
-            states.shortname[1] = s.a2; \
-            states.shortname[2] = s.a3; \
+        const sensorname##Data *s; \
+        uint32_t version; \
+        float v[3]; \
+        do { \
+            s    = sensorname##Borrow(&version); \
+            v[0] = s->a1; \
+            v[1] = s->a2; \
+            v[2] = s->a3; \
+        } while (!sensorname##BorrowValid(version)); \
+        if (IS_REAL(v[0]) && IS_REAL(v[1]) && IS_REAL(v[2])) { \
+            states.shortname[0] = v[0]; \
+            states.shortname[1] = v[1]; \
+            states.shortname[2] = v[2]; \
         } \
         else { \
             UNSET_MASK(states.updated, SENSORUPDATES_##shortname); \
@@ -84,10 +99,17 @@
 
 #define FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_1_DIMENSION_WITH_CUSTOM_EXTRA_CHECK(sensorname, shortname, a1, EXTRACHECK) \
     if (IS_SET(states.updated, SENSORUPDATES_##shortname)) { \
-        sensorname##Data s; \
-        sensorname##Get(&s); \
-        if (IS_REAL(s.a1) && EXTRACHECK) { \
-            states.shortname[0] = s.a1; \
+        const sensorname##Data *s; \
+        uint32_t version; \
+        float v[1]; \
+        bool check; \
+        do { \
+            s     = sensorname##Borrow(&version); \
+            v[0]  = s->a1; \
+            check = (EXTRACHECK); \
+        } while (!sensorname##BorrowValid(version)); \
+        if (IS_REAL(v[0]) && check) { \
+            states.shortname[0] = v[0]; \
         } \
         else { \
             UNSET_MASK(states.updated, SENSORUPDATES_##shortname); \
@@ -96,11 +118,19 @@
 
 #define FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_2_DIMENSION_WITH_CUSTOM_EXTRA_CHECK(sensorname, shortname, a1, a2, EXTRACHECK) \
     if (IS_SET(states.updated, SENSORUPDATES_##shortname)) { \
-        sensorname##Data s; \
-        sensorname##Get(&s); \
-        if (IS_REAL(s.a1) && IS_REAL(s.a2) && EXTRACHECK) { \
-            states.shortname[0] = s.a1; \
-            states.shortname[1] = s.a2; \
+        const sensorname##Data *s; \
+        uint32_t version; \
+        float v[2]; \
+        bool check; \
+        do { \
+            s     = sensorname##Borrow(&version); \
+            v[0]  = s->a1; \
+            v[1]  = s->a2; \
+            check = (EXTRACHECK); \
+        } while (!sensorname##BorrowValid(version)); \
+        if (IS_REAL(v[0]) && IS_REAL(v[1]) && check) { \
+            states.shortname[0] = v[0]; \
+            states.shortname[1] = v[1]; \
         } \
         else { \
             UNSET_MASK(states.updated, SENSORUPDATES_##shortname); \
@@ -108,23 +138,26 @@
     }
 
 // local macros, ONLY to be used in the middle of StateEstimationCb in section RUNSTATE_SAVE before the check of alarms!
+// state objects are borrowed for writing, fields not handled here keep their value
 #define EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(statename, shortname, a1, a2, a3) \
     if (IS_SET(states.updated, SENSORUPDATES_##shortname)) { \
-        statename##Data s; \
-        statename##Get(&s); \
-        s.a1 = states.shortname[0]; \
-        s.a2 = states.shortname[1]; \
-        s.a3 = states.shortname[2]; \
-        statename##Set(&s); \
+        statename##Data *s = statename##BorrowWrite(); \
+        if (s) { \
+            s->a1 = states.shortname[0]; \
+            s->a2 = states.shortname[1]; \
+            s->a3 = states.shortname[2]; \
+            statename##Commit(); \
+        } \
     }
 
 #define EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_2_DIMENSIONS(statename, shortname, a1, a2) \
     if (IS_SET(states.updated, SENSORUPDATES_##shortname)) { \
-        statename##Data s; \
-        statename##Get(&s); \
-        s.a1 = states.shortname[0]; \
-        s.a2 = states.shortname[1]; \
-        statename##Set(&s); \
+        statename##Data *s = statename##BorrowWrite(); \
+        if (s) { \
+            s->a1 = states.shortname[0]; \
+            s->a2 = states.shortname[1]; \
+            statename##Commit(); \
+        } \
     }
 
 
@@ -161,6 +194,7 @@ static stateFilter ekf13Filter;
 // this is a hack to provide a computational shortcut for faster gyro state progression
 static float gyroRaw[3];
 static float gyroDelta[3];
+static bool fastPath; // the shortcut runs in the context of the task publishing the gyro
 
 // preconfigured filter chains selectable via revoSettings.FusionAlgorithm
 static const filterPipeline *cfQueue = &(filterPipeline) {
@@ -255,8 +289,11 @@ static const filterPipeline *ekf13Queue = &(filterPipeline) {
 
 static void settingsUpdatedCb(UAVObjEvent *objEv);
 static void sensorUpdatedCb(UAVObjEvent *objEv);
+static void gyroUpdatedFastCb(UAVObjEvent *objEv);
+static void updateGyroState(void);
 static void criticalConfigUpdatedCb(UAVObjEvent *objEv);
 static void StateEstimationCb(void);
+static bool loadRingSample(stateEstimation *states);
 
 static inline int32_t maxint32_t(int32_t a, int32_t b)
 {
@@ -297,6 +334,15 @@ int32_t StateEstimationInitialize(void)
     HomeLocationConnectCallback(&criticalConfigUpdatedCb);
     AuxMagSettingsConnectCallback(&criticalConfigUpdatedCb);
 
+    // the fast path is only read at boot, the callbacks cannot be swapped safely later
+    StabilizationSettingsInitialize();
+    StabilizationSettingsData stabSettings;
+    StabilizationSettingsGet(&stabSettings);
+    fastPath = (stabSettings.FastPath == STABILIZATIONSETTINGS_FASTPATH_TRUE);
+    if (fastPath) {
+        GyroSensorConnectFastCallback(&gyroUpdatedFastCb);
+    }
+
     GyroSensorConnectCallback(&sensorUpdatedCb);
     AccelSensorConnectCallback(&sensorUpdatedCb);
     MagSensorConnectCallback(&sensorUpdatedCb);
@@ -428,35 +474,51 @@ static void StateEstimationCb(void)
     updatedSensors = 0;
 
     // fetch sensors, check values, and load into state struct
-    FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(GyroSensor, gyro, x, y, z);
-    if (IS_SET(states.updated, SENSORUPDATES_gyro)) {
-        gyroRaw[0] = states.gyro[0];
-        gyroRaw[1] = states.gyro[1];
-        gyroRaw[2] = states.gyro[2];
+    // gyro and accel samples come from the sensor ring with their timestamps if the Sensors module provides them
+    bool fromRing = loadRingSample(&states);
+    if (!fromRing) {
+        FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(GyroSensor, gyro, x, y, z);
+        if (IS_SET(states.updated, SENSORUPDATES_gyro)) {
+            gyroRaw[0] = states.gyro[0];
+            gyroRaw[1] = states.gyro[1];
+            gyroRaw[2] = states.gyro[2];
+        }
+        FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(AccelSensor, accel, x, y, z);
     }
-    FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(AccelSensor, accel, x, y, z);
     FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(MagSensor, boardMag, x, y, z);
     FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(AuxMagSensor, auxMag, x, y, z);
     FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_3_DIMENSIONS(GPSVelocitySensor, vel, North, East, Down);
     FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_1_DIMENSION_WITH_CUSTOM_EXTRA_CHECK(BaroSensor, baro, Altitude, true);
-    FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_2_DIMENSION_WITH_CUSTOM_EXTRA_CHECK(AirspeedSensor, airspeed, CalibratedAirspeed, TrueAirspeed, s.SensorConnected == AIRSPEEDSENSOR_SENSORCONNECTED_TRUE);
+    FETCH_SENSOR_FROM_UAVOBJECT_CHECK_AND_LOAD_TO_STATE_2_DIMENSION_WITH_CUSTOM_EXTRA_CHECK(AirspeedSensor, airspeed, CalibratedAirspeed, TrueAirspeed, s->SensorConnected == AIRSPEEDSENSOR_SENSORCONNECTED_TRUE);
 
     // GPS position data (LLA) is not fetched here since it does not contain floats. The filter must do all checks itself
 
     // at this point sensor state is stored in "states" with some rudimentary filtering applied
 
-    // apply all filters in the current filter chain
-    current = filterChain;
-
-    // we are not done, re-dispatch self execution
+    // apply all filters in the current filter chain, once for every gyro sample waiting in the ring
+    // outputs are exported once at the end, with the union of everything updated in between
+    sensorUpdates exported = 0;
+    uint32_t runs = 0;
+    for (;;) {
+        current = filterChain;
+        while (current) {
+            filterResult result = current->filter->filter((stateFilter *)current->filter, &states);
+            if (result > alarm) {
+                alarm = result;
+            }
+            current = current->next;
+        }
+        exported |= states.updated;
 
-    while (current) {
-        filterResult result = current->filter->filter((stateFilter *)current->filter, &states);
-        if (result > alarm) {
-            alarm = result;
+        if (!fromRing || ++runs >= MAX_RING_SAMPLES) {
+            break;
+        }
+        states.updated = 0;
+        if (!loadRingSample(&states)) {
+            break;
         }
-        current = current->next;
     }
+    states.updated = exported;
 
     // the final output of filters is saved in state variables
     // EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(GyroState, gyro, x, y, z) // replaced by performance shortcut
@@ -467,38 +529,40 @@ static void StateEstimationCb(void)
     }
     EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(AccelState, accel, x, y, z);
     if (IS_SET(states.updated, SENSORUPDATES_mag)) {
-        MagStateData s;
-
-        MagStateGet(&s);
-        s.x = states.mag[0];
-        s.y = states.mag[1];
-        s.z = states.mag[2];
-        switch (states.magStatus) {
-        case MAGSTATUS_OK:
-            s.Source = MAGSTATE_SOURCE_ONBOARD;
-            break;
-        case MAGSTATUS_AUX:
-            s.Source = MAGSTATE_SOURCE_AUX;
-            break;
-        default:
-            s.Source = MAGSTATE_SOURCE_INVALID;
+        MagStateData *s = MagStateBorrowWrite();
+
+        if (s) {
+            s->x = states.mag[0];
+            s->y = states.mag[1];
+            s->z = states.mag[2];
+            switch (states.magStatus) {
+            case MAGSTATUS_OK:
+                s->Source = MAGSTATE_SOURCE_ONBOARD;
+                break;
+            case MAGSTATUS_AUX:
+                s->Source = MAGSTATE_SOURCE_AUX;
+                break;
+            default:
+                s->Source = MAGSTATE_SOURCE_INVALID;
+            }
+            MagStateCommit();
         }
-        MagStateSet(&s);
     }
 
     EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(PositionState, pos, North, East, Down);
     EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_3_DIMENSIONS(VelocityState, vel, North, East, Down);
     EXPORT_STATE_TO_UAVOBJECT_IF_UPDATED_2_DIMENSIONS(AirspeedState, airspeed, CalibratedAirspeed, TrueAirspeed);
     // attitude nees manual conversion from quaternion to euler
-    if (IS_SET(states.updated, SENSORUPDATES_attitude)) { \
-        AttitudeStateData s;
-        AttitudeStateGet(&s);
-        s.q1 = states.attitude[0];
-        s.q2 = states.attitude[1];
-        s.q3 = states.attitude[2];
-        s.q4 = states.attitude[3];
-        Quaternion2RPY(&s.q1, &s.Roll);
-        AttitudeStateSet(&s);
+    if (IS_SET(states.updated, SENSORUPDATES_attitude)) {
+        AttitudeStateData *s = AttitudeStateBorrowWrite();
+        if (s) {
+            s->q1 = states.attitude[0];
+            s->q2 = states.attitude[1];
+            s->q3 = states.attitude[2];
+            s->q4 = states.attitude[3];
+            Quaternion2RPY(&s->q1, &s->Roll);
+            AttitudeStateCommit();
+        }
     }
     // throttle alarms, raise alarm flags immediately
     // but require system to run for a while before decreasing
@@ -534,6 +598,58 @@ static void StateEstimationCb(void)
 }
 
 
+/**
+ * Load the next gyro sample from the sensor ring into the state, together with the newest
+ * accel sample not taken after it.
+ * \param[in,out] states The state, gyro and accel updates are cleared if the ring is in use
+ * \return true if a gyro sample was loaded
+ */
+static bool loadRingSample(stateEstimation *states)
+{
+    static uint32_t lastRingTime;
+    static uint32_t lastTimestamp;
+    static bool ringActive = false;
+    SensorRingSample sample;
+
+    if (!SensorRingPop(SENSORRING_GYRO, &sample)) {
+        // the averaged sensor objects only duplicate what was already taken from the ring
+        if (ringActive && PIOS_DELAY_DiffuS(lastRingTime) < RING_TIMEOUT_US) {
+            UNSET_MASK(states->updated, SENSORUPDATES_gyro | SENSORUPDATES_accel);
+        } else {
+            ringActive = false;
+        }
+        states->dT = 0.0f;
+        return false;
+    }
+
+    UNSET_MASK(states->updated, SENSORUPDATES_gyro | SENSORUPDATES_accel);
+    states->dT   = ringActive ? PIOS_DELAY_DiffuS2(lastTimestamp, sample.timestamp) * 1e-6f : 0.0f;
+    lastTimestamp = sample.timestamp;
+    lastRingTime = PIOS_DELAY_GetRaw();
+    ringActive   = true;
+
+    if (IS_REAL(sample.x) && IS_REAL(sample.y) && IS_REAL(sample.z)) {
+        states->gyro[0] = gyroRaw[0] = sample.x;
+        states->gyro[1] = gyroRaw[1] = sample.y;
+        states->gyro[2] = gyroRaw[2] = sample.z;
+        states->updated |= SENSORUPDATES_gyro;
+    }
+
+    // accels are sampled along with the gyros, use the newest one up to the gyro timestamp
+    const uint32_t gyroTimestamp = sample.timestamp;
+    while (SensorRingPeek(SENSORRING_ACCEL, &sample) && (int32_t)(sample.timestamp - gyroTimestamp) <= 0) {
+        SensorRingPop(SENSORRING_ACCEL, &sample);
+        if (IS_REAL(sample.x) && IS_REAL(sample.y) && IS_REAL(sample.z)) {
+            states->accel[0] = sample.x;
+            states->accel[1] = sample.y;
+            states->accel[2] = sample.z;
+            states->updated |= SENSORUPDATES_accel;
+        }
+    }
+
+    return true;
+}
+
 /**
  * Callback for eventdispatcher when RevoSettings has been updated
  */
@@ -565,14 +681,9 @@ static void sensorUpdatedCb(UAVObjEvent *ev)
 
     if (ev->obj == GyroSensorHandle()) {
         updatedSensors |= SENSORUPDATES_gyro;
-        // shortcut - update GyroState right away
-        GyroSensorData s;
-        GyroStateData t;
-        GyroSensorGet(&s);
-        t.x = s.x + gyroDelta[0];
-        t.y = s.y + gyroDelta[1];
-        t.z = s.z + gyroDelta[2];
-        GyroStateSet(&t);
+        if (!fastPath) {
+            updateGyroState();
+        }
     }
 
     if (ev->obj == AccelSensorHandle()) {
@@ -606,6 +717,33 @@ static void sensorUpdatedCb(UAVObjEvent *ev)
     PIOS_CALLBACKSCHEDULER_Dispatch(stateEstimationCallback);
 }
 
+/**
+ * Fast path callback, invoked directly by GyroSensorSet() so the inner loop
+ * gets the new GyroState without a trip through the event dispatcher
+ */
+static void gyroUpdatedFastCb(__attribute__((unused)) UAVObjEvent *ev)
+{
+    updateGyroState();
+}
+
+/**
+ * shortcut - update GyroState right away with the latest bias estimate
+ */
+static void updateGyroState(void)
+{
+    const GyroSensorData *s;
+    uint32_t version;
+    GyroStateData t;
+
+    do {
+        s   = GyroSensorBorrow(&version);
+        t.x = s->x + gyroDelta[0];
+        t.y = s->y + gyroDelta[1];
+        t.z = s->z + gyroDelta[2];
+    } while (!GyroSensorBorrowValid(version));
+    GyroStateSet(&t);
+}
+
 
 /**
  * @}
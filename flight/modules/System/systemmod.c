@@ -69,10 +69,17 @@
 #include <pios_instrumentation.h>
 #endif
 
+#ifdef MODULE_STATEESTIMATION_BUILTIN
+#include <sensorring.h>
+#endif
 #if defined(PIOS_INCLUDE_RFM22B)
 #include <oplinkstatus.h>
 #endif
 
+#if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
+#include <pios_flashfs_logfs_priv.h>
+#endif
+
 // Flight Libraries
 #include <sanitycheck.h>
 
@@ -96,6 +103,8 @@
 
 #define TASK_PRIORITY           (tskIDLE_PRIORITY + 1)
 
+#define FLASHGC_STACK_SIZE_BYTES 512
+
 // Private types
 
 // Private variables
@@ -105,6 +114,9 @@ static enum { STACKOVERFLOW_NONE = 0, STACKOVERFLOW_WARNING = 1, STACKOVERFLOW_C
 static bool mallocFailed;
 static HwSettingsData bootHwSettings;
 static FrameType_t bootFrameType;
+#if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
+static DelayedCallbackInfo *flashGCCallback;
+#endif
 
 volatile int initTaskDone = 0;
 
@@ -122,6 +134,11 @@ static void systemTask(void *parameters);
 static void updateI2Cstats();
 static void updateWDGstats();
 #endif
+#if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
+static void flashGCInit();
+static void flashGCRequest();
+static void flashGCCb();
+#endif
 
 extern uintptr_t pios_uavo_settings_fs_id;
 extern uintptr_t pios_user_fs_id;
@@ -198,6 +215,10 @@ static void systemTask(__attribute__((unused)) void *parameters)
     /* create all modules thread */
     MODULE_TASKCREATE_ALL;
 
+#if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
+    flashGCInit();
+#endif
+
     /* start the delayed callback scheduler */
     PIOS_CALLBACKSCHEDULER_Start();
 
@@ -476,6 +497,12 @@ static void callbackSchedulerForEachCallback(int16_t callback_id, const struct p
     ((uint8_t *)&callbackData->Running)[callback_id] = callback_info->is_running;
     ((uint32_t *)&callbackData->RunningTime)[callback_id]   = callback_info->running_time_count;
     ((int16_t *)&callbackData->StackRemaining)[callback_id] = callback_info->stack_remaining;
+    ((uint32_t *)&callbackData->DispatchLatencyMax)[callback_id] = callback_info->latency_max;
+    ((uint16_t *)&callbackData->DispatchLatency100us)[callback_id] = callback_info->latency_histogram[0];
+    ((uint16_t *)&callbackData->DispatchLatency1ms)[callback_id]   = callback_info->latency_histogram[1];
+    ((uint16_t *)&callbackData->DispatchLatency5ms)[callback_id]   = callback_info->latency_histogram[2];
+    ((uint16_t *)&callbackData->DispatchLatency20ms)[callback_id]  = callback_info->latency_histogram[3];
+    ((uint16_t *)&callbackData->DispatchLatencyAbove20ms)[callback_id] = callback_info->latency_histogram[4];
 }
 #endif /* ifdef DIAG_TASKS */
 
@@ -548,6 +575,55 @@ static uint16_t GetFreeIrqStackSize(void)
     return i;
 }
 
+#if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS)
+/**
+ * Collect logfs garbage in the background when a filesystem is filling up,
+ * so that settings saves and log writes don't have to wait for it
+ */
+static void flashGCInit()
+{
+    bool background = false;
+
+    if (pios_uavo_settings_fs_id && PIOS_FLASHFS_Logfs_SetGCRequest(pios_uavo_settings_fs_id, flashGCRequest) == 0) {
+        background = true;
+    }
+    if (pios_user_fs_id && PIOS_FLASHFS_Logfs_SetGCRequest(pios_user_fs_id, flashGCRequest) == 0) {
+        background = true;
+    }
+    if (background) {
+        flashGCCallback = PIOS_CALLBACKSCHEDULER_Create(&flashGCCb, CALLBACK_PRIORITY_LOW, CALLBACK_TASK_AUXILIARY, -1, FLASHGC_STACK_SIZE_BYTES);
+    }
+}
+
+/**
+ * Called from within saves, just wake up the callback
+ */
+static void flashGCRequest()
+{
+    if (flashGCCallback) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(flashGCCallback);
+    }
+}
+
+/**
+ * One bounded step per filesystem, then let the tasks waiting on the flash have it
+ */
+static void flashGCCb()
+{
+    bool more = false;
+
+    if (pios_uavo_settings_fs_id && PIOS_FLASHFS_Logfs_GCStep(pios_uavo_settings_fs_id) > 0) {
+        more = true;
+    }
+    if (pios_user_fs_id && PIOS_FLASHFS_Logfs_GCStep(pios_user_fs_id) > 0) {
+        more = true;
+    }
+    if (more) {
+        PIOS_CALLBACKSCHEDULER_Dispatch(flashGCCallback);
+    }
+}
+#endif /* if !defined(ARCH_POSIX) && !defined(ARCH_WIN32) && defined(PIOS_INCLUDE_FLASH_LOGFS_SETTINGS) */
+
 /**
  * Called periodically to update the system stats
  */
@@ -583,6 +659,11 @@ static void updateStats()
         stats.UsrSlotsFree   = fsStats.num_free_slots;
         stats.UsrSlotsActive = fsStats.num_active_slots;
     }
+#endif
+#ifdef MODULE_STATEESTIMATION_BUILTIN
+    // Sensor samples the state estimation did not fetch in time
+    stats.SensorRingOverruns.Gyro  = SensorRingOverruns(SENSORRING_GYRO);
+    stats.SensorRingOverruns.Accel = SensorRingOverruns(SENSORRING_ACCEL);
 #endif
     stats.CPUIdleTicks     = PIOS_TASK_MONITOR_GetIdleTicksCount();
     stats.CPUZeroLoadTicks = PIOS_TASK_MONITOR_GetZeroLoadTicksCount();
@@ -655,14 +736,22 @@ static void updateSystemAlarms()
         AlarmsClear(SYSTEMALARMS_ALARM_EVENTSYSTEM);
     }
 
+    SystemStatsData sysStats;
+    SystemStatsGet(&sysStats);
     if (objStats.lastCallbackErrorID || objStats.lastQueueErrorID || evStats.lastErrorID) {
-        SystemStatsData sysStats;
-        SystemStatsGet(&sysStats);
         sysStats.EventSystemWarningID    = evStats.lastErrorID;
         sysStats.ObjectManagerCallbackID = objStats.lastCallbackErrorID;
         sysStats.ObjectManagerQueueID    = objStats.lastQueueErrorID;
-        SystemStatsSet(&sysStats);
     }
+    // Object data access contention since the last update
+    sysStats.ObjectManagerReadRetries      = objStats.readRetries;
+    sysStats.ObjectManagerWriteContentions = objStats.writeContentions;
+    // Updates merged into one still pending on a coalescing queue
+    sysStats.ObjectManagerEventsCoalesced  = objStats.eventsCoalesced;
+    // Periodic event delays since the last update
+    sysStats.EventSystemPeriodicMaxJitter = evStats.maxJitterMs;
+    sysStats.EventSystemPeriodicAvgJitter = evStats.periodicEvents ? evStats.totalJitterMs / evStats.periodicEvents : 0;
+    SystemStatsSet(&sysStats);
 }
 
 /**
@@ -304,6 +304,9 @@ int32_t TelemetryInitialize(void)
         TelemetryInitializeChannel(&localChannel);
         // Initialise UAVTalk
         localChannel.uavTalkCon = UAVTalkInitialize(&transmitLocalData);
+#ifdef PIOS_TELEM_DELTA_ENCODING
+        UAVTalkSetDeltaMode(localChannel.uavTalkCon, true);
+#endif
     }
 #endif /* ifdef HAS_RADIO */
 
@@ -317,6 +320,9 @@ int32_t TelemetryInitialize(void)
     TelemetryInitializeChannel(&radioChannel);
     // Initialise UAVTalk
     radioChannel.uavTalkCon = UAVTalkInitialize(&transmitRadioData);
+#ifdef PIOS_TELEM_DELTA_ENCODING
+    UAVTalkSetDeltaMode(radioChannel.uavTalkCon, true);
+#endif
 
     return 0;
 }
@@ -334,9 +340,9 @@ static void registerLocalObject(UAVObjHandle obj)
     if (UAVObjIsMetaobject(obj)) {
         // Only connect change notifications for meta objects.  No periodic updates
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
-        UAVObjConnectQueue(obj, localChannel.priorityQueue, EV_MASK_ALL_UPDATES);
+        UAVObjConnectQueueCoalesced(obj, localChannel.priorityQueue, EV_MASK_ALL_UPDATES);
 #else /* PIOS_TELEM_PRIORITY_QUEUE */
-        UAVObjConnectQueue(obj, localChannel.queue, EV_MASK_ALL_UPDATES);
+        UAVObjConnectQueueCoalesced(obj, localChannel.queue, EV_MASK_ALL_UPDATES);
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
     } else {
         // Setup object for periodic updates
@@ -353,9 +359,9 @@ static void registerRadioObject(UAVObjHandle obj)
     if (UAVObjIsMetaobject(obj)) {
         // Only connect change notifications for meta objects.  No periodic updates
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
-        UAVObjConnectQueue(obj, radioChannel.priorityQueue, EV_MASK_ALL_UPDATES);
+        UAVObjConnectQueueCoalesced(obj, radioChannel.priorityQueue, EV_MASK_ALL_UPDATES);
 #else /* PIOS_TELEM_PRIORITY_QUEUE */
-        UAVObjConnectQueue(obj, radioChannel.queue, EV_MASK_ALL_UPDATES);
+        UAVObjConnectQueueCoalesced(obj, radioChannel.queue, EV_MASK_ALL_UPDATES);
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
     } else {
         // Setup object for periodic updates
@@ -470,11 +476,11 @@ static void updateObject(
     // note that all setting objects have implicitly IsPriority=true
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
     if (UAVObjIsPriority(obj)) {
-        UAVObjConnectQueue(obj, channel->priorityQueue, eventMask);
+        UAVObjConnectQueueCoalesced(obj, channel->priorityQueue, eventMask);
     } else
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
 
-    UAVObjConnectQueue(obj, channel->queue, eventMask);
+    UAVObjConnectQueueCoalesced(obj, channel->queue, eventMask);
 }
 
 
@@ -507,11 +513,18 @@ static void processObjEvent(
             || (ev->event == EV_UPDATED_PERIODIC && updateMode != UPDATEMODE_THROTTLED)) {
             // Send update to GCS (with retries)
             while (retries < MAX_RETRIES && success == -1) {
-                // call blocks until ack is received or timeout
-                success = UAVTalkSendObject(channel->uavTalkCon,
-                                            ev->obj,
-                                            ev->instId,
-                                            UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);
+                if (UAVObjGetTelemetryAcked(&metadata)) {
+                    // call blocks until ack is received or timeout
+                    success = UAVTalkSendObject(channel->uavTalkCon,
+                                                ev->obj,
+                                                ev->instId,
+                                                1, REQ_TIMEOUT_MS);
+                } else {
+                    // unacked updates are packed together until the queues are drained
+                    success = UAVTalkSendObjectPacked(channel->uavTalkCon,
+                                                      ev->obj,
+                                                      ev->instId);
+                }
                 if (success == -1) {
                     ++retries;
                 }
@@ -602,24 +615,34 @@ static void telemetryTxTask(void *parameters)
 
 #ifdef PIOS_TELEM_PRIORITY_QUEUE
         // empty priority queue, non-blocking
-        while (xQueueReceive(channel->priorityQueue, &ev, 0) == pdTRUE) {
+        while (UAVObjQueueReceive(channel->priorityQueue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
         }
         // check regular queue and process update - non-blocking
-        if (xQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
-            // Process event
-            processObjEvent(channel, &ev);
-            // if both queues are empty, wait on priority queue for updates (1 tick) then repeat cycle
-        } else if (xQueueReceive(channel->priorityQueue, &ev, 1) == pdTRUE) {
+        if (UAVObjQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
+            // if both queues are empty, send what was packed and wait on priority queue for updates (1 tick) then repeat cycle
+        } else {
+            UAVTalkFlushPacked(channel->uavTalkCon);
+            if (UAVObjQueueReceive(channel->priorityQueue, &ev, 1) == pdTRUE) {
+                // Process event
+                processObjEvent(channel, &ev);
+            }
         }
 #else
-        // wait on queue for updates (1 tick) then repeat cycle
-        if (xQueueReceive(channel->queue, &ev, 1) == pdTRUE) {
+        // check queue and process update - non-blocking
+        if (UAVObjQueueReceive(channel->queue, &ev, 0) == pdTRUE) {
             // Process event
             processObjEvent(channel, &ev);
+            // if the queue is empty, send what was packed and wait on queue for updates (1 tick) then repeat cycle
+        } else {
+            UAVTalkFlushPacked(channel->uavTalkCon);
+            if (UAVObjQueueReceive(channel->queue, &ev, 1) == pdTRUE) {
+                // Process event
+                processObjEvent(channel, &ev);
+            }
         }
 #endif /* PIOS_TELEM_PRIORITY_QUEUE */
     }
@@ -881,6 +904,11 @@ static void updateTelemetryStats()
         // Wait for connection request
         if (gcsStats.Status == GCSTELEMETRYSTATS_STATUS_HANDSHAKEREQ) {
             flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_HANDSHAKEACK;
+            // a new GCS may be connected, offer multi object packets to it
+            UAVTalkAnnounceMultiObject(radioChannel.uavTalkCon);
+#ifdef HAS_RADIO
+            UAVTalkAnnounceMultiObject(localChannel.uavTalkCon);
+#endif
         }
     } else if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_HANDSHAKEACK) {
         // Wait for connection
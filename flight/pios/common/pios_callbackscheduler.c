@@ -36,14 +36,27 @@
 #define STACK_SIZE        (300 + STACK_SAFETYSIZE)
 #define STACK_SAFETYSIZE  8
 #define MAX_SLEEP         1000
+#define NOT_SCHEDULED     0xFFFF
+#define HEAP_MIN_SIZE     4
+#define MAX_PENDING_RUNS  1024 // bound for PIOS_CALLBACKSCHEDULER_RunPending(), catches callbacks rescheduling themselves forever
 
 // Private types
 /**
  * task information
+ * Callbacks that are due wait in a FIFO per priority (fed by the dispatch
+ * functions, also from ISRs, so the FIFOs are protected by critical sections).
+ * Scheduled callbacks wait in a min-heap ordered by scheduletime until they
+ * are due (protected by the mutex).
  */
 struct DelayedCallbackTaskStruct {
     DelayedCallbackInfo *callbackQueue[CALLBACK_PRIORITY_LOW + 1];
-    DelayedCallbackInfo *queueCursor[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyHead[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo *readyTail[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t numCallbacks[CALLBACK_PRIORITY_LOW + 1];
+    uint16_t roundCount[CALLBACK_PRIORITY_LOW + 1];
+    DelayedCallbackInfo * *heap;
+    uint16_t    heapCount;
+    uint16_t    heapSize;
     xTaskHandle callbackSchedulerTaskHandle;
     char name[3];
     uint32_t    stackSize;
@@ -58,6 +71,7 @@ struct DelayedCallbackTaskStruct {
 struct DelayedCallbackInfoStruct {
     DelayedCallback   cb;
     int16_t callbackID;
+    DelayedCallbackPriority priority;
     bool volatile     waiting;
     uint32_t volatile scheduletime;
     uint32_t stackSize;
@@ -66,8 +80,13 @@ struct DelayedCallbackInfoStruct {
     uint16_t stackSafetyCount;
     uint16_t currentSafetyCount;
     uint32_t runCount;
+    uint32_t readyTime; /* PIOS_DELAY raw time at which the callback became due */
+    uint16_t latencyHistogram[CALLBACK_LATENCY_BUCKETS];
+    uint32_t latencyMax;
+    uint16_t heapIndex;
     struct DelayedCallbackTaskStruct *task;
     struct DelayedCallbackInfoStruct *next;
+    struct DelayedCallbackInfoStruct *readyNext;
 };
 
 
@@ -75,10 +94,17 @@ struct DelayedCallbackInfoStruct {
 static struct DelayedCallbackTaskStruct *schedulerTasks;
 static xSemaphoreHandle mutex;
 static bool schedulerStarted;
+static const uint32_t latencyBounds[CALLBACK_LATENCY_BUCKETS - 1] = CALLBACK_LATENCY_BOUNDS_US;
 
 // Private functions
 static void CallbackSchedulerTask(void *task);
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task);
+static void readyEnqueue(DelayedCallbackInfo *cbinfo);
+static DelayedCallbackInfo *nextReady(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority);
+static void heapInsert(DelayedCallbackInfo *cbinfo);
+static void heapRemove(DelayedCallbackInfo *cbinfo);
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index);
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index);
 
 /**
  * Initialize the scheduler
@@ -143,6 +169,33 @@ int32_t PIOS_CALLBACKSCHEDULER_Start()
     return 0;
 }
 
+/**
+ * Run all callbacks that are due in the context of the caller.
+ * \return Number of callbacks run
+ */
+int32_t PIOS_CALLBACKSCHEDULER_RunPending()
+{
+    int32_t count = 0;
+    bool ran;
+
+    PIOS_Assert(schedulerStarted == false);
+
+    // callbacks dispatching each other are run until all are idle, but a callback
+    // that keeps dispatching itself must not lock up the caller
+    do {
+        struct DelayedCallbackTaskStruct *cursor = NULL;
+        ran = false;
+        LL_FOREACH(schedulerTasks, cursor) {
+            while (count < MAX_PENDING_RUNS && runNextCallback(cursor) == 0) {
+                ran = true;
+                count++;
+            }
+        }
+    } while (ran && count < MAX_PENDING_RUNS);
+
+    return count;
+}
+
 /**
  * Schedule dispatching a callback at some point in the future. The function returns immediately.
  * \param[in] *cbinfo the callback handle
@@ -187,6 +240,13 @@ int32_t PIOS_CALLBACKSCHEDULER_Schedule(
             result = 2;
         }
         cbinfo->scheduletime = new;
+        if (cbinfo->heapIndex == NOT_SCHEDULED) {
+            heapInsert(cbinfo);
+        } else if (diff < 0) {
+            heapSiftUp(cbinfo->task, cbinfo->heapIndex);
+        } else {
+            heapSiftDown(cbinfo->task, cbinfo->heapIndex);
+        }
 
         // scheduler needs to be notified to adapt sleep times
         xSemaphoreGive(cbinfo->task->signal);
@@ -207,8 +267,10 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo)
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, only a short critical section to queue it
+    portENTER_CRITICAL();
+    readyEnqueue(cbinfo);
+    portEXIT_CRITICAL();
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGive(cbinfo->task->signal);
 }
@@ -231,8 +293,10 @@ int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long
 {
     PIOS_Assert(cbinfo);
 
-    // no semaphore needed for the callback
-    cbinfo->waiting = true;
+    // no semaphore needed for the callback, only masked interrupts to queue it
+    unsigned portBASE_TYPE mask = portSET_INTERRUPT_MASK_FROM_ISR();
+    readyEnqueue(cbinfo);
+    portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
     // but the scheduler as a whole needs to be notified
     return xSemaphoreGiveFromISR(cbinfo->task->signal, pxHigherPriorityTaskWoken);
 }
@@ -282,8 +346,14 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         // initialize structure
         for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
             task->callbackQueue[p] = NULL;
-            task->queueCursor[p]   = NULL;
+            task->readyHead[p]     = NULL;
+            task->readyTail[p]     = NULL;
+            task->numCallbacks[p]  = 0;
+            task->roundCount[p]    = 0;
         }
+        task->heap         = NULL;
+        task->heapCount    = 0;
+        task->heapSize     = 0;
         task->name[0]      = 'C';
         task->name[1]      = 'a' + t;
         task->name[2]      = 0;
@@ -328,18 +398,42 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
         return NULL; // error - not enough memory
     }
 
+    // make sure the schedule heap can hold all callbacks of this task
+    uint16_t numCallbacks = 1;
+    for (DelayedCallbackPriority p = 0; p <= CALLBACK_PRIORITY_LOW; p++) {
+        numCallbacks += task->numCallbacks[p];
+    }
+    if (numCallbacks > task->heapSize) {
+        uint16_t heapSize = task->heapSize ? 2 * task->heapSize : HEAP_MIN_SIZE;
+        DelayedCallbackInfo * *heap = (DelayedCallbackInfo * *)pios_malloc(heapSize * sizeof(DelayedCallbackInfo *));
+        if (!heap) {
+            xSemaphoreGiveRecursive(mutex);
+            return NULL; // error - not enough memory
+        }
+        if (task->heap) {
+            memcpy(heap, task->heap, task->heapCount * sizeof(DelayedCallbackInfo *));
+            pios_free(task->heap);
+        }
+        task->heap     = heap;
+        task->heapSize = heapSize;
+    }
+
     // initialize callback scheduling info
     DelayedCallbackInfo *info = (DelayedCallbackInfo *)pios_malloc(sizeof(DelayedCallbackInfo));
     if (!info) {
         xSemaphoreGiveRecursive(mutex);
         return NULL; // error - not enough memory
     }
+    memset(info, 0, sizeof(DelayedCallbackInfo));
     info->next               = NULL;
+    info->readyNext          = NULL;
+    info->heapIndex          = NOT_SCHEDULED;
     info->waiting            = false;
     info->scheduletime       = 0;
     info->task               = task;
     info->cb = cb;
     info->callbackID         = callbackID;
+    info->priority           = priority;
     info->runCount           = 0;
     info->stackSize          = stacksize - STACK_SIZE;
     info->stackNotFree       = info->stackSize;
@@ -349,6 +443,7 @@ DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(
 
     // add to scheduling queue
     LL_APPEND(task->callbackQueue[priority], info);
+    task->numCallbacks[priority]++;
 
     xSemaphoreGiveRecursive(mutex);
 
@@ -380,6 +475,8 @@ void PIOS_CALLBACKSCHEDULER_ForEachCallback(CallbackSchedulerCallbackInfoCallbac
                 info.is_running = true;
                 info.stack_remaining    = cbinfo->stackNotFree;
                 info.running_time_count = cbinfo->runCount;
+                memcpy(info.latency_histogram, cbinfo->latencyHistogram, sizeof(info.latency_histogram));
+                info.latency_max = cbinfo->latencyMax;
                 xSemaphoreGiveRecursive(mutex);
                 callback(cbinfo->callbackID, &info, context);
             }
@@ -457,76 +554,215 @@ static void checkStack(DelayedCallbackInfo *current)
     }
 }
 
+/**
+ * Mark a callback as due and append it to the ready FIFO of its priority,
+ * must be called in a critical section
+ */
+static void readyEnqueue(DelayedCallbackInfo *cbinfo)
+{
+    if (cbinfo->waiting) {
+        return; // already queued
+    }
+    cbinfo->waiting   = true;
+    cbinfo->readyTime = PIOS_DELAY_GetRaw();
+    cbinfo->readyNext = NULL;
+
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+    DelayedCallbackPriority priority = cbinfo->priority;
+    if (task->readyTail[priority]) {
+        task->readyTail[priority]->readyNext = cbinfo;
+    } else {
+        task->readyHead[priority] = cbinfo;
+    }
+    task->readyTail[priority] = cbinfo;
+}
+
+/**
+ * Take the next callback to run off the ready FIFOs.
+ * Every time as many callbacks ran on one priority as are registered on it,
+ * a callback with lower priority gets the chance to run.
+ * \param[in] task The scheduler task in question
+ * \param[in] priority The highest scheduling priority to search
+ * \return The callback or NULL if none is ready
+ */
+static DelayedCallbackInfo *nextReady(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+{
+    for (; priority <= CALLBACK_PRIORITY_LOW; priority++) {
+        if (task->readyHead[priority] == NULL) {
+            continue;
+        }
+
+        if (task->roundCount[priority] >= task->numCallbacks[priority]) {
+            task->roundCount[priority] = 0;
+            DelayedCallbackInfo *lower = nextReady(task, priority + 1);
+            if (lower) {
+                return lower;
+            }
+        }
+
+        portENTER_CRITICAL();
+        DelayedCallbackInfo *current = task->readyHead[priority];
+        if (current) {
+            task->readyHead[priority] = current->readyNext;
+            if (!task->readyHead[priority]) {
+                task->readyTail[priority] = NULL;
+            }
+            current->waiting = false; // the flag is reset just before execution.
+        }
+        portEXIT_CRITICAL();
+
+        if (current) {
+            task->roundCount[priority]++;
+            return current;
+        }
+    }
+    return NULL;
+}
+
 /**
  * Scheduler subtask
  * \param[in] task The scheduler task in question
- * \param[in] priority The scheduling priority of the callback to search for
  * \return wait time until next scheduled callback is due - 0 if a callback has just been executed
  */
-static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task, DelayedCallbackPriority priority)
+static int32_t runNextCallback(struct DelayedCallbackTaskStruct *task)
 {
     int32_t result = MAX_SLEEP;
-    int32_t diff   = 0;
 
-    // no such queue
-    if (priority > CALLBACK_PRIORITY_LOW) {
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
+
+    // move all callbacks whose schedule is due to the ready queues
+    uint32_t now = xTaskGetTickCount();
+    while (task->heapCount && (int32_t)(task->heap[0]->scheduletime - now) <= 0) {
+        DelayedCallbackInfo *due = task->heap[0];
+        heapRemove(due);
+        due->scheduletime = 0;
+        portENTER_CRITICAL();
+        readyEnqueue(due);
+        portEXIT_CRITICAL();
+    }
+
+    DelayedCallbackInfo *current = nextReady(task, CALLBACK_PRIORITY_CRITICAL);
+    if (!current) {
+        // nothing to do, sleep until the next schedule is due
+        if (task->heapCount) {
+            int32_t diff = task->heap[0]->scheduletime - now;
+            if (diff < result) {
+                result = diff;
+            }
+        }
+        xSemaphoreGiveRecursive(mutex);
         return result;
     }
 
-    // queue is empty, search a lower priority queue
-    if (task->callbackQueue[priority] == NULL) {
-        return runNextCallback(task, priority + 1);
+    // any schedules are reset
+    if (current->heapIndex != NOT_SCHEDULED) {
+        heapRemove(current);
     }
+    current->scheduletime = 0;
+    xSemaphoreGiveRecursive(mutex);
 
-    DelayedCallbackInfo *current = task->queueCursor[priority];
-    DelayedCallbackInfo *next;
-    do {
-        if (current == NULL) {
-            next = task->callbackQueue[priority]; // loop around the end of the list
-            // also attempt to run a callback that has lower priority
-            // every time the queue is completely traversed
-            diff = runNextCallback(task, priority + 1);
-            if (!diff) {
-                task->queueCursor[priority] = next; // the recursive call has executed a callback
-                return 0;
-            }
-            if (diff < result) {
-                result = diff; // adjust sleep time
-            }
-        } else {
-            next = current->next;
-            xSemaphoreTakeRecursive(mutex, portMAX_DELAY); // access to scheduletime should be mutex protected
-            if (current->scheduletime) {
-                diff = current->scheduletime - xTaskGetTickCount();
-                if (diff <= 0) {
-                    current->waiting = true;
-                } else if (diff < result) {
-                    result = diff; // adjust sleep time
-                }
-            }
-            if (current->waiting) {
-                task->queueCursor[priority] = next;
-                current->scheduletime = 0; // any schedules are reset
-                current->waiting = false; // the flag is reset just before execution.
-                xSemaphoreGiveRecursive(mutex);
+    // account the dispatch latency
+    uint32_t latency = PIOS_DELAY_DiffuS(current->readyTime);
+    uint8_t bucket   = 0;
+    while (bucket < CALLBACK_LATENCY_BUCKETS - 1 && latency > latencyBounds[bucket]) {
+        bucket++;
+    }
+    if (current->latencyHistogram[bucket] < 0xffff) {
+        current->latencyHistogram[bucket]++;
+    }
+    if (latency > current->latencyMax) {
+        current->latencyMax = latency;
+    }
 
-                /* callback gets invoked here - check stack sizes */
-                markStack(current);
+    /* callback gets invoked here - check stack sizes */
+    markStack(current);
 
-                current->cb(); // call the callback
+    current->cb(); // call the callback
 
-                checkStack(current);
+    checkStack(current);
 
-                current->runCount++;
+    current->runCount++;
 
-                return 0;
-            }
-            xSemaphoreGiveRecursive(mutex);
+    return 0;
+}
+
+/**
+ * Add a callback to the schedule heap of its task, must be called with the mutex held.
+ * Room for all callbacks of a task is reserved in PIOS_CALLBACKSCHEDULER_Create()
+ */
+static void heapInsert(DelayedCallbackInfo *cbinfo)
+{
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+
+    PIOS_Assert(task->heapCount < task->heapSize);
+    cbinfo->heapIndex = task->heapCount;
+    task->heap[task->heapCount++] = cbinfo;
+    heapSiftUp(task, cbinfo->heapIndex);
+}
+
+/**
+ * Remove a callback from the schedule heap of its task, must be called with the mutex held
+ */
+static void heapRemove(DelayedCallbackInfo *cbinfo)
+{
+    struct DelayedCallbackTaskStruct *task = cbinfo->task;
+    uint16_t index = cbinfo->heapIndex;
+
+    cbinfo->heapIndex = NOT_SCHEDULED;
+    if (index == --task->heapCount) {
+        return;
+    }
+    // move the last entry into the hole and restore the heap order
+    task->heap[index] = task->heap[task->heapCount];
+    task->heap[index]->heapIndex = index;
+    heapSiftUp(task, index);
+    heapSiftDown(task, task->heap[index]->heapIndex);
+}
+
+/**
+ * Move a heap entry towards the root until its parent is due earlier (wraparound safe)
+ */
+static void heapSiftUp(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo *cbinfo = task->heap[index];
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if ((int32_t)(task->heap[parent]->scheduletime - cbinfo->scheduletime) <= 0) {
+            break;
         }
-        current = next;
-    } while (current != task->queueCursor[priority]);
-    // once the list has been traversed entirely without finding any to be executed task, abort (nothing to do)
-    return result;
+        task->heap[index] = task->heap[parent];
+        task->heap[index]->heapIndex = index;
+        index = parent;
+    }
+    task->heap[index]  = cbinfo;
+    cbinfo->heapIndex  = index;
+}
+
+/**
+ * Move a heap entry towards the leaves until its children are due later (wraparound safe)
+ */
+static void heapSiftDown(struct DelayedCallbackTaskStruct *task, uint16_t index)
+{
+    DelayedCallbackInfo *cbinfo = task->heap[index];
+
+    for (;;) {
+        uint32_t child = 2 * (uint32_t)index + 1;
+        if (child >= task->heapCount) {
+            break;
+        }
+        if (child + 1 < task->heapCount && (int32_t)(task->heap[child + 1]->scheduletime - task->heap[child]->scheduletime) < 0) {
+            child++;
+        }
+        if ((int32_t)(cbinfo->scheduletime - task->heap[child]->scheduletime) <= 0) {
+            break;
+        }
+        task->heap[index] = task->heap[child];
+        task->heap[index]->heapIndex = index;
+        index = child;
+    }
+    task->heap[index]  = cbinfo;
+    cbinfo->heapIndex  = index;
 }
 
 /**
@@ -538,7 +774,7 @@ static void CallbackSchedulerTask(void *task)
     uint32_t delay = 0;
 
     while (1) {
-        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task, CALLBACK_PRIORITY_CRITICAL);
+        delay = runNextCallback((struct DelayedCallbackTaskStruct *)task);
         if (delay) {
             // nothing to do but sleep
             xSemaphoreTake(((struct DelayedCallbackTaskStruct *)task)->signal, delay);
@@ -41,22 +41,38 @@ extern uintptr_t pios_user_fs_id; // flash filesystem for logging
 
 #if defined(PIOS_INCLUDE_FREERTOS)
 static xSemaphoreHandle mutex = 0;
-#define mutexlock()   xSemaphoreTakeRecursive(mutex, portMAX_DELAY)
-#define mutexunlock() xSemaphoreGiveRecursive(mutex)
+#define mutexlock()     xSemaphoreTakeRecursive(mutex, portMAX_DELAY)
+#define mutexunlock()   xSemaphoreGiveRecursive(mutex)
+#define criticalenter() portENTER_CRITICAL()
+#define criticalexit()  portEXIT_CRITICAL()
 #else
 #define mutexlock()
 #define mutexunlock()
+#define criticalenter()
+#define criticalexit()
+#endif
+
+// Entries are collected in RAM and written to flash from the background, one
+// buffer is filled while the others wait for the flash. The mutex only
+// serializes flash access, logging an entry never waits for it.
+#ifndef PIOS_DEBUGLOG_BUFFERS
+#define PIOS_DEBUGLOG_BUFFERS 3
 #endif
 
 static bool logging_enabled = false;
 #define MAX_CONSECUTIVE_FAILS_COUNT 10
-static bool log_is_full     = false;
-static uint8_t fails_count  = 0;
+static volatile bool log_is_full = false;
+static uint8_t fails_count = 0;
 static uint16_t flightnum   = 0;
-static uint16_t lognum = 0;
-static DebugLogEntryData *buffer = 0;
+static uint16_t lognum = 0; // entry number of the buffer being filled
+static bool next_flight = false; // start the next flight once the buffer being filled is queued
+// separate allocations, arrays of DebugLogEntryData would not keep the entries aligned
+static DebugLogEntryData *buffers[PIOS_DEBUGLOG_BUFFERS];
+static bool buffers_allocated = false;
 #if !defined(PIOS_INCLUDE_FREERTOS)
-static DebugLogEntryData staticbuffer;
+static struct {
+    DebugLogEntryData entry;
+} staticbuffers[PIOS_DEBUGLOG_BUFFERS];
 #endif
 
 #define LOG_ENTRY_MAX_DATA_SIZE (sizeof(((DebugLogEntryData *)0)->Data))
@@ -64,11 +80,23 @@ static DebugLogEntryData staticbuffer;
 // build the obj_id as a DEBUGLOGENTRY ID with least significant byte zeroed and filled with flight number
 #define LOG_GET_FLIGHT_OBJID(x) ((DEBUGLOGENTRY_OBJID & ~0xFF) | (x & 0xFF))
 
-static uint32_t used_buffer_space = 0;
+// Ring of buffers, the full ones from flush_head on, followed by the one being filled
+static uint8_t flush_head   = 0;
+static uint8_t full_buffers = 0;
+static uint8_t writers[PIOS_DEBUGLOG_BUFFERS]; // entries reserved in a buffer and still being copied in
+static uint8_t entries[PIOS_DEBUGLOG_BUFFERS];
+static uint32_t used_buffer_space = 0; // in the buffer being filled
+
+static void (*flush_request)(void) = 0;
+static struct PIOS_DEBUGLOG_Stats log_stats;
 
 /* Private Function Prototypes */
-static void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data);
-static bool write_current_buffer();
+static DebugLogEntryData *reserve_entry(size_t size, bool whole_buffer, uint8_t *index);
+static void commit_entry(uint8_t index, bool seal);
+static void request_flush();
+static void copy_data(void *context, uint8_t *data, size_t size);
+static bool seal_current_buffer();
+static void reset_buffer(uint8_t index);
 /**
  * @brief Initialize the log facility
  */
@@ -76,27 +104,50 @@ void PIOS_DEBUGLOG_Initialize()
 {
 #if defined(PIOS_INCLUDE_FREERTOS)
     if (!mutex) {
-        mutex  = xSemaphoreCreateRecursiveMutex();
-        buffer = pios_malloc(sizeof(DebugLogEntryData));
+        mutex = xSemaphoreCreateRecursiveMutex();
+        buffers_allocated = true;
+        for (uint8_t i = 0; i < PIOS_DEBUGLOG_BUFFERS; i++) {
+            buffers[i] = pios_malloc(sizeof(DebugLogEntryData));
+            buffers_allocated &= (buffers[i] != 0);
+        }
     }
 #else
-    buffer = &staticbuffer;
+    for (uint8_t i = 0; i < PIOS_DEBUGLOG_BUFFERS; i++) {
+        buffers[i] = &staticbuffers[i].entry;
+    }
+    buffers_allocated = true;
 #endif
-    if (!buffer) {
+    if (!buffers_allocated) {
         return;
     }
     mutexlock();
     lognum      = 0;
     flightnum   = 0;
     fails_count = 0;
+    flush_head  = 0;
+    full_buffers = 0;
     used_buffer_space = 0;
+    next_flight = false;
     log_is_full = false;
-    while (PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
+    while (PIOS_FLASHFS_ObjLoad(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffers[0], sizeof(DebugLogEntryData)) == 0) {
         flightnum++;
     }
+    for (uint8_t i = 0; i < PIOS_DEBUGLOG_BUFFERS; i++) {
+        reset_buffer(i);
+    }
     mutexunlock();
 }
 
+/**
+ * @brief Have full buffers written from the background
+ * @param[in] request called from the logging task when a buffer is ready,
+ * it should arrange for PIOS_DEBUGLOG_Flush() to be called soon.
+ * Without one entries are dropped, the flash is never written by the task logging them.
+ */
+void PIOS_DEBUGLOG_SetFlushRequest(void (*request)(void))
+{
+    flush_request = request;
+}
 
 /**
  * @brief Enables or Disables logging globally
@@ -106,8 +157,13 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
 {
     // increase the flight num as soon as logging is disabled
     if (logging_enabled && !enabled) {
-        flightnum++;
-        lognum = 0;
+        criticalenter();
+        // what was logged so far still belongs to this flight, if all buffers are
+        // waiting for the flash the switch happens once this one could be queued
+        next_flight = true;
+        seal_current_buffer();
+        criticalexit();
+        request_flush();
     }
     logging_enabled = enabled;
 }
@@ -122,14 +178,37 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled)
  */
 void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
 {
-    if (!logging_enabled || !buffer || log_is_full) {
+    PIOS_DEBUGLOG_UAVObjectCopy(objid, instid, size, &copy_data, data);
+}
+
+/**
+ * @brief Write a debug log entry with a uavobject, copied straight into the log buffer
+ * @param[in] objectid
+ * @param[in] instanceid
+ * @param[in] size of object
+ * @param[in] copy fills in the entry data, called with at most size bytes of room
+ * @param[in] context passed on to copy
+ */
+void PIOS_DEBUGLOG_UAVObjectCopy(uint32_t objid, uint16_t instid, size_t size, void (*copy)(void *context, uint8_t *data, size_t size), void *context)
+{
+    if (!logging_enabled || !buffers_allocated) {
         return;
     }
-    mutexlock();
+    if (size > LOG_ENTRY_MAX_DATA_SIZE) {
+        size = LOG_ENTRY_MAX_DATA_SIZE;
+    }
 
-    enqueue_data(objid, instid, size, data);
+    uint8_t index;
+    DebugLogEntryData *entry = reserve_entry(size, false, &index);
+    if (!entry) {
+        return;
+    }
+    entry->ObjectID   = objid;
+    entry->InstanceID = instid;
+    entry->Size = size;
+    copy(context, entry->Data, size);
 
-    mutexunlock();
+    commit_entry(index, false);
 }
 /**
  * @brief Write a debug log entry with text
@@ -139,35 +218,90 @@ void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8
  */
 void PIOS_DEBUGLOG_Printf(char *format, ...)
 {
-    if (!logging_enabled || !buffer || log_is_full) {
+    if (!logging_enabled || !buffers_allocated) {
+        return;
+    }
+
+    // text gets a buffer of its own
+    uint8_t index;
+    DebugLogEntryData *entry = reserve_entry(LOG_ENTRY_MAX_DATA_SIZE, true, &index);
+    if (!entry) {
         return;
     }
 
     va_list args;
     va_start(args, format);
-    mutexlock();
-    // flush any pending buffer before writing debug text
-    if (used_buffer_space) {
-        write_current_buffer();
+    vsnprintf((char *)entry->Data, sizeof(entry->Data), (char *)format, args);
+    va_end(args);
+    entry->Type       = DEBUGLOGENTRY_TYPE_TEXT;
+    entry->ObjectID   = 0;
+    entry->InstanceID = 0;
+    entry->Size       = strlen((const char *)entry->Data);
+
+    commit_entry(index, true);
+}
+
+/**
+ * @brief Write the buffers that are ready to flash. Takes as long as the
+ * flash writes, call it from a low priority task.
+ * @return number of full buffers still waiting
+ */
+int32_t PIOS_DEBUGLOG_Flush()
+{
+    if (!buffers_allocated) {
+        return 0;
     }
-    memset(buffer->Data, 0xff, sizeof(buffer->Data));
-    vsnprintf((char *)buffer->Data, sizeof(buffer->Data), (char *)format, args);
-    buffer->Flight     = flightnum;
 
-    buffer->FlightTime = PIOS_DELAY_GetuS();
+    mutexlock();
+    while (true) {
+        criticalenter();
+        uint8_t index = flush_head;
+        bool ready    = full_buffers > 0 && writers[index] == 0;
+        criticalexit();
+        if (!ready) {
+            break;
+        }
 
-    buffer->Entry      = lognum;
-    buffer->Type       = DEBUGLOGENTRY_TYPE_TEXT;
-    buffer->ObjectID   = 0;
-    buffer->InstanceID = 0;
-    buffer->Size       = strlen((const char *)buffer->Data);
+        DebugLogEntryData *buffer = buffers[index];
+        if (entries[index] > 1) {
+            buffer->Type = DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS;
+        }
 
-    if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
-        lognum++;
+        uint32_t start = PIOS_DELAY_GetRaw();
+        if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(buffer->Flight), buffer->Entry, (uint8_t *)buffer, sizeof(DebugLogEntryData)) != 0) {
+            if (fails_count++ > MAX_CONSECUTIVE_FAILS_COUNT) {
+                // give up, drop everything that is waiting
+                log_is_full = true;
+                while (full_buffers && writers[flush_head] == 0) {
+                    log_stats.dropped += entries[flush_head];
+                    reset_buffer(flush_head);
+                    criticalenter();
+                    flush_head = (flush_head + 1) % PIOS_DEBUGLOG_BUFFERS;
+                    full_buffers--;
+                    criticalexit();
+                }
+            }
+            break;
+        }
+        uint32_t elapsed = PIOS_DELAY_DiffuS(start);
+        log_stats.flush_time = elapsed;
+        if (elapsed > log_stats.flush_time_max) {
+            log_stats.flush_time_max = elapsed;
+        }
+        log_stats.flushes++;
+        fails_count = 0;
+
+        reset_buffer(index);
+        criticalenter();
+        flush_head = (flush_head + 1) % PIOS_DEBUGLOG_BUFFERS;
+        full_buffers--;
+        criticalexit();
     }
+    int32_t waiting = full_buffers;
     mutexunlock();
-}
 
+    return waiting;
+}
 
 /**
  * @brief Load one object instance from the filesystem
@@ -212,75 +346,148 @@ void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint1
     }
 }
 
+/**
+ * @brief Retrieve the buffering statistics
+ * @param[out] stats dropped entries and flash write times
+ */
+void PIOS_DEBUGLOG_GetStats(struct PIOS_DEBUGLOG_Stats *mystats)
+{
+    PIOS_Assert(mystats);
+    criticalenter();
+    *mystats = log_stats;
+    criticalexit();
+}
+
 /**
  * @brief Format entire flash memory!!!
  */
 void PIOS_DEBUGLOG_Format(void)
 {
     mutexlock();
-    PIOS_FLASHFS_Format(pios_user_fs_id);
+    criticalenter();
     lognum      = 0;
     flightnum   = 0;
     log_is_full = false;
-    fails_count = 0;
+    flush_head  = 0;
+    full_buffers = 0;
     used_buffer_space = 0;
+    next_flight = false;
+    criticalexit();
+    fails_count = 0;
+    for (uint8_t i = 0; i < PIOS_DEBUGLOG_BUFFERS; i++) {
+        reset_buffer(i);
+    }
+    PIOS_FLASHFS_Format(pios_user_fs_id);
     mutexunlock();
 }
 
-void enqueue_data(uint32_t objid, uint16_t instid, size_t size, uint8_t *data)
+/**
+ * Take room for an entry and fill in its header. The data can then be copied
+ * in without holding anything, commit_entry() tells when it is complete.
+ * \param[in] size of the entry data
+ * \param[in] whole_buffer start a buffer of its own for the entry
+ * \param[out] index of the buffer for commit_entry()
+ * \return the entry or NULL if all buffers are waiting for the flash
+ */
+static DebugLogEntryData *reserve_entry(size_t size, bool whole_buffer, uint8_t *index)
 {
-    DebugLogEntryData *entry;
+    DebugLogEntryData *entry = NULL;
 
-    // start a new block
+    criticalenter();
+    if (log_is_full || !flush_request) {
+        log_stats.dropped++;
+        goto out_exit;
+    }
+
+    // if there is not enough space left or a new flight started, queue the buffer and start the next one
+    if ((used_buffer_space || next_flight) &&
+        (whole_buffer || next_flight || used_buffer_space + size + LOG_ENTRY_HEADER_SIZE > LOG_ENTRY_MAX_DATA_SIZE) &&
+        !seal_current_buffer()) {
+        log_stats.dropped++;
+        goto out_exit;
+    }
+
+    *index = (flush_head + full_buffers) % PIOS_DEBUGLOG_BUFFERS;
     if (!used_buffer_space) {
-        entry = buffer;
-        memset(buffer->Data, 0xff, sizeof(buffer->Data));
-        used_buffer_space += size;
+        // the first entry uses the buffer header
+        entry = buffers[*index];
+        used_buffer_space = whole_buffer ? LOG_ENTRY_MAX_DATA_SIZE : size;
     } else {
-        // if an instance is being filled and there is enough space, does enqueues new data.
-        if (used_buffer_space + size + LOG_ENTRY_HEADER_SIZE > LOG_ENTRY_MAX_DATA_SIZE) {
-            buffer->Type = DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS;
-            if (!write_current_buffer()) {
-                return;
-            }
-            entry = buffer;
-            memset(buffer->Data, 0xff, sizeof(buffer->Data));
-            used_buffer_space += size;
-        } else {
-            entry = (DebugLogEntryData *)&buffer->Data[used_buffer_space];
-            used_buffer_space += size + LOG_ENTRY_HEADER_SIZE;
-        }
+        entry = (DebugLogEntryData *)&buffers[*index]->Data[used_buffer_space];
+        used_buffer_space += size + LOG_ENTRY_HEADER_SIZE;
     }
+    writers[*index]++;
+    entries[*index]++;
 
     entry->Flight     = flightnum;
     entry->FlightTime = PIOS_DELAY_GetuS();
-    entry->Entry = lognum;
+    entry->Entry      = lognum;
     entry->Type = DEBUGLOGENTRY_TYPE_UAVOBJECT;
-    entry->ObjectID   = objid;
-    entry->InstanceID = instid;
-    if (size > sizeof(buffer->Data)) {
-        size = sizeof(buffer->Data);
+
+out_exit:
+    criticalexit();
+    return entry;
+}
+
+/**
+ * Mark an entry complete and get full buffers written
+ * \param[in] index of the buffer the entry is in
+ * \param[in] seal queue the buffer now instead of when it is full
+ */
+static void commit_entry(uint8_t index, bool seal)
+{
+    criticalenter();
+    writers[index]--;
+    if (seal && index == (flush_head + full_buffers) % PIOS_DEBUGLOG_BUFFERS) {
+        seal_current_buffer();
     }
-    entry->Size = size;
+    bool ready = full_buffers > 0 && writers[flush_head] == 0;
+    criticalexit();
 
-    memcpy(entry->Data, data, size);
+    if (ready) {
+        request_flush();
+    }
 }
 
-bool write_current_buffer()
+/* Get the full buffers written in the background */
+static void request_flush()
 {
-    // not enough space, write the block and start a new one
-    if (PIOS_FLASHFS_ObjSave(pios_user_fs_id, LOG_GET_FLIGHT_OBJID(flightnum), lognum, (uint8_t *)buffer, sizeof(DebugLogEntryData)) == 0) {
-        lognum++;
-        fails_count = 0;
-        used_buffer_space = 0;
-    } else {
-        if (fails_count++ > MAX_CONSECUTIVE_FAILS_COUNT) {
-            log_is_full = true;
+    if (flush_request) {
+        flush_request();
+    }
+}
+
+static void copy_data(void *context, uint8_t *data, size_t size)
+{
+    memcpy(data, context, size);
+}
+
+/* Queue the buffer being filled for writing, must be called in a critical section */
+static bool seal_current_buffer()
+{
+    if (used_buffer_space) {
+        if (full_buffers + 1 >= PIOS_DEBUGLOG_BUFFERS) {
+            // no buffer left to fill
+            return false;
         }
-        return false;
+        full_buffers++;
+        used_buffer_space = 0;
+        lognum++;
+    }
+    if (next_flight) {
+        flightnum++;
+        lognum      = 0;
+        next_flight = false;
     }
     return true;
 }
+
+/* Empty a buffer that is not in use */
+static void reset_buffer(uint8_t index)
+{
+    memset(buffers[index]->Data, 0xff, sizeof(buffers[index]->Data));
+    entries[index] = 0;
+}
 #endif /* ifdef PIOS_INCLUDE_DEBUGLOG */
 /**
  * @}
@@ -86,7 +86,7 @@ static int32_t PIOS_Flash_Jedec_ReadID(struct jedec_flash_dev *flash_dev);
 static int32_t PIOS_Flash_Jedec_ReadStatus(struct jedec_flash_dev *flash_dev);
 static int32_t PIOS_Flash_Jedec_ClaimBus(struct jedec_flash_dev *flash_dev, bool fast);
 static int32_t PIOS_Flash_Jedec_ReleaseBus(struct jedec_flash_dev *flash_dev);
-static int32_t PIOS_Flash_Jedec_WriteEnable(struct jedec_flash_dev *flash_dev);
+static int32_t PIOS_Flash_Jedec_ClaimReady(struct jedec_flash_dev *flash_dev, bool fast, bool write_enable);
 static int32_t PIOS_Flash_Jedec_Busy(struct jedec_flash_dev *flash_dev);
 
 /**
@@ -207,18 +207,43 @@ static int32_t PIOS_Flash_Jedec_Busy(struct jedec_flash_dev *flash_dev)
 }
 
 /**
- * @brief Execute the write enable instruction and returns the status
- * @returns 0 if successful, -1 if unable to claim bus
+ * @brief Claim the bus once the chip has finished any write or erase and optionally
+ * execute the write enable instruction, then assert CS for the caller's instruction.
+ * Logfs erases sectors outside of transactions, holding the bus throughout keeps
+ * anything else from getting in between.
+ * @returns 0 if successful, -1 if unable to claim bus or read the status
  */
-static int32_t PIOS_Flash_Jedec_WriteEnable(struct jedec_flash_dev *flash_dev)
+static int32_t PIOS_Flash_Jedec_ClaimReady(struct jedec_flash_dev *flash_dev, bool fast, bool write_enable)
 {
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, true) != 0) {
-        return -1;
+    uint8_t out[2] = { JEDEC_READ_STATUS, 0 };
+    uint8_t in[2]  = { 0, 0 };
+
+    while (true) {
+        if (PIOS_Flash_Jedec_ClaimBus(flash_dev, fast) != 0) {
+            return -1;
+        }
+        if (PIOS_SPI_TransferBlock(flash_dev->spi_id, out, in, sizeof(out), NULL) < 0) {
+            PIOS_Flash_Jedec_ReleaseBus(flash_dev);
+            return -1;
+        }
+        if (!(in[1] & JEDEC_STATUS_BUSY)) {
+            break;
+        }
+        PIOS_Flash_Jedec_ReleaseBus(flash_dev);
+#if defined(FLASH_FREERTOS)
+        vTaskDelay(1);
+#endif
     }
+    PIOS_SPI_RC_PinSet(flash_dev->spi_id, flash_dev->slave_num, 1);
 
-    uint8_t out[] = { JEDEC_WRITE_ENABLE };
-    PIOS_SPI_TransferBlock(flash_dev->spi_id, out, NULL, sizeof(out), NULL);
-    PIOS_Flash_Jedec_ReleaseBus(flash_dev);
+    if (write_enable) {
+        uint8_t wren[] = { JEDEC_WRITE_ENABLE };
+        PIOS_SPI_RC_PinSet(flash_dev->spi_id, flash_dev->slave_num, 0);
+        PIOS_SPI_TransferBlock(flash_dev->spi_id, wren, NULL, sizeof(wren), NULL);
+        PIOS_SPI_RC_PinSet(flash_dev->spi_id, flash_dev->slave_num, 1);
+    }
+
+    PIOS_SPI_RC_PinSet(flash_dev->spi_id, flash_dev->slave_num, 0);
 
     return 0;
 }
@@ -350,14 +375,9 @@ static int32_t PIOS_Flash_Jedec_EraseSector(uintptr_t flash_id, uint32_t addr)
         return -1;
     }
 
-    uint8_t ret;
     uint8_t out[] = { flash_dev->cfg->sector_erase, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff };
 
-    if ((ret = PIOS_Flash_Jedec_WriteEnable(flash_dev)) != 0) {
-        return ret;
-    }
-
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, true) != 0) {
+    if (PIOS_Flash_Jedec_ClaimReady(flash_dev, true, true) != 0) {
         return -1;
     }
 
@@ -393,14 +413,9 @@ static int32_t PIOS_Flash_Jedec_EraseChip(uintptr_t flash_id)
         return -1;
     }
 
-    uint8_t ret;
     uint8_t out[] = { flash_dev->cfg->chip_erase };
 
-    if ((ret = PIOS_Flash_Jedec_WriteEnable(flash_dev)) != 0) {
-        return ret;
-    }
-
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, true) != 0) {
+    if (PIOS_Flash_Jedec_ClaimReady(flash_dev, true, true) != 0) {
         return -1;
     }
 
@@ -449,7 +464,6 @@ static int32_t PIOS_Flash_Jedec_WriteData(uintptr_t flash_id, uint32_t addr, uin
         return -1;
     }
 
-    uint8_t ret;
     uint8_t out[4] = { JEDEC_PAGE_WRITE, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff };
 
     /* Can only write one page at a time */
@@ -461,12 +475,9 @@ static int32_t PIOS_Flash_Jedec_WriteData(uintptr_t flash_id, uint32_t addr, uin
     if (((addr & 0xff) + len) > 0x100) {
         return -3;
     }
-    if ((ret = PIOS_Flash_Jedec_WriteEnable(flash_dev)) != 0) {
-        return ret;
-    }
 
     /* Execute write page command and clock in address.  Keep CS asserted */
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, true) != 0) {
+    if (PIOS_Flash_Jedec_ClaimReady(flash_dev, true, true) != 0) {
         return -1;
     }
     if (PIOS_SPI_TransferBlock(flash_dev->spi_id, out, NULL, sizeof(out), NULL) < 0) {
@@ -523,7 +534,6 @@ static int32_t PIOS_Flash_Jedec_WriteChunks(uintptr_t flash_id, uint32_t addr, s
         return -1;
     }
 
-    uint8_t ret;
     uint8_t out[4] = { JEDEC_PAGE_WRITE, (addr >> 16) & 0xff, (addr >> 8) & 0xff, addr & 0xff };
 
     /* Can only write one page at a time */
@@ -540,12 +550,9 @@ static int32_t PIOS_Flash_Jedec_WriteChunks(uintptr_t flash_id, uint32_t addr, s
     if (((addr & 0xff) + len) > 0x100) {
         return -3;
     }
-    if ((ret = PIOS_Flash_Jedec_WriteEnable(flash_dev)) != 0) {
-        return ret;
-    }
 
     /* Execute write page command and clock in address.  Keep CS asserted */
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, true) != 0) {
+    if (PIOS_Flash_Jedec_ClaimReady(flash_dev, true, true) != 0) {
         return -1;
     }
 
@@ -586,7 +593,7 @@ static int32_t PIOS_Flash_Jedec_ReadData(uintptr_t flash_id, uint32_t addr, uint
         return -1;
     }
     bool fast_read = flash_dev->cfg->fast_read != 0;
-    if (PIOS_Flash_Jedec_ClaimBus(flash_dev, fast_read) == -1) {
+    if (PIOS_Flash_Jedec_ClaimReady(flash_dev, fast_read, false) != 0) {
         return -1;
     }
     /* Execute read command and clock in address.  Keep CS asserted */
@@ -630,6 +637,7 @@ const struct pios_flash_driver pios_jedec_flash_driver = {
     .write_chunks = PIOS_Flash_Jedec_WriteChunks,
     .write_data   = PIOS_Flash_Jedec_WriteData,
     .read_data    = PIOS_Flash_Jedec_ReadData,
+    .unlocked_erase = true,
 };
 
 #endif /* PIOS_INCLUDE_FLASH */
@@ -43,6 +43,31 @@ enum pios_flashfs_logfs_dev_magic {
     PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
 
+/*
+ * Index entry mapping an object to its one active slot.
+ * Slot 0 holds the arena header, a slot_id of 0 marks an unused entry.
+ */
+struct logfs_index_entry {
+    uint32_t obj_id;
+    uint16_t obj_inst_id;
+    uint16_t slot_id;
+    uint16_t gc_slot_id; /* copy in the arena being collected into, 0 if not copied yet */
+};
+
+/*
+ * Garbage collection into the next arena, done a bounded step at a time
+ * while the log stays mounted, see logfs_gc_step()
+ */
+enum logfs_gc_state {
+    LOGFS_GC_IDLE,
+    LOGFS_GC_REQUESTED, /* the log is filling up, nothing done yet */
+    LOGFS_GC_ERASE, /* erasing the destination arena a sector at a time */
+    LOGFS_GC_COPY, /* copying the active slots up to the end of the log */
+};
+
+/* Source slots looked at in one step, each active one is a slot header read and a copy */
+#define LOGFS_GC_COPY_SLOTS 4
+
 struct logfs_state {
     enum pios_flashfs_logfs_dev_magic magic;
     const struct flashfs_logfs_cfg    *cfg;
@@ -56,6 +81,29 @@ struct logfs_state {
     uint16_t num_free_slots; /* slots in free state */
     uint16_t num_active_slots; /* slots in active state */
 
+    /*
+     * Optional open addressed hash table of the active slots, built when
+     * the log is mounted. Once it has overflowed or turned out wrong it is
+     * no longer used or maintained until the next mount.
+     */
+    struct logfs_index_entry *index;
+    uint16_t index_capacity; /* entries in the table */
+    uint16_t index_count; /* entries in use */
+    bool     index_complete; /* every active slot is in the index */
+
+    /*
+     * Garbage collection in progress. Saves keep appending to the active
+     * arena, slots before gc_src_slot have been copied and deleting them
+     * obsoletes the copy as well.
+     */
+    enum logfs_gc_state gc_state;
+    uint8_t  gc_dst_arena_id;
+    uint16_t gc_sector; /* next sector of the destination to erase */
+    uint16_t gc_src_slot; /* next slot of the active arena to copy */
+    uint16_t gc_dst_slot; /* next free slot of the destination */
+    bool     gc_erasing; /* a background step is erasing a destination sector without the transaction lock */
+    void     (*gc_request)(void); /* called when there is background work to do */
+
     /* Underlying flash driver glue */
     const struct pios_flash_driver *driver;
     uintptr_t flash_id;
@@ -110,6 +158,32 @@ struct arena_header {
 * Arena life-cycle transition functions
 ****************************************/
 
+/**
+ * @brief Sets an arena whose sectors have all been erased to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_mark_arena_erased(const struct logfs_state *logfs, uint8_t arena_id)
+{
+    uintptr_t arena_addr = logfs_get_addr(logfs, arena_id, 0);
+
+    /* Mark this arena as fully erased */
+    struct arena_header arena_hdr = {
+        .magic = logfs->cfg->fs_magic,
+        .state = ARENA_STATE_ERASED,
+    };
+
+    if (logfs->driver->write_data(logfs->flash_id,
+                                  arena_addr,
+                                  (uint8_t *)&arena_hdr,
+                                  sizeof(arena_hdr)) != 0) {
+        return -1;
+    }
+
+    /* Arena is ready to be activated */
+    return 0;
+}
+
 /**
  * @brief Erases all sectors within the given arena and sets arena to erased state.
  * @return 0 if success, < 0 on failure
@@ -132,16 +206,7 @@ static int32_t logfs_erase_arena(const struct logfs_state *logfs, uint8_t arena_
         }
     }
 
-    /* Mark this arena as fully erased */
-    struct arena_header arena_hdr = {
-        .magic = logfs->cfg->fs_magic,
-        .state = ARENA_STATE_ERASED,
-    };
-
-    if (logfs->driver->write_data(logfs->flash_id,
-                                  arena_addr,
-                                  (uint8_t *)&arena_hdr,
-                                  sizeof(arena_hdr)) != 0) {
+    if (logfs_mark_arena_erased(logfs, arena_id) != 0) {
         return -2;
     }
 
@@ -353,6 +418,132 @@ struct slot_header {
     uint16_t obj_size;
 } __attribute__((packed));
 
+/*
+ * Object index
+ */
+
+static uint16_t logfs_index_hash(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    /* Object ids are hashes already, spread the instances */
+    uint32_t h = obj_id + obj_inst_id * 0x9E3779B1;
+
+    h ^= h >> 16;
+    return h % logfs->index_capacity;
+}
+
+/* Position of the object in the index, or of the unused entry where it would go */
+static uint16_t logfs_index_probe(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    uint16_t pos = logfs_index_hash(logfs, obj_id, obj_inst_id);
+
+    /* There is always an unused entry, see logfs_index_insert() */
+    while (logfs->index[pos].slot_id != 0 &&
+           (logfs->index[pos].obj_id != obj_id || logfs->index[pos].obj_inst_id != obj_inst_id)) {
+        pos = (pos + 1) % logfs->index_capacity;
+    }
+    return pos;
+}
+
+static void logfs_index_reset(struct logfs_state *logfs)
+{
+    for (uint16_t i = 0; i < logfs->index_capacity; i++) {
+        logfs->index[i].slot_id = 0;
+    }
+    logfs->index_count    = 0;
+    logfs->index_complete = (logfs->index != NULL);
+}
+
+static void logfs_index_insert(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+    if (!logfs->index_complete) {
+        return;
+    }
+
+    uint16_t pos = logfs_index_probe(logfs, obj_id, obj_inst_id);
+
+    if (logfs->index[pos].slot_id != 0 || logfs->index_count + 1 >= logfs->index_capacity) {
+        /* More than one active version, or no room left to keep probes short. Fall back to scanning. */
+        logfs->index_complete = false;
+        return;
+    }
+
+    logfs->index[pos].obj_id      = obj_id;
+    logfs->index[pos].obj_inst_id = obj_inst_id;
+    logfs->index[pos].slot_id     = slot_id;
+    logfs->index[pos].gc_slot_id  = 0;
+    logfs->index_count++;
+}
+
+static void logfs_index_remove(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    if (!logfs->index_complete) {
+        return;
+    }
+
+    uint16_t hole = logfs_index_probe(logfs, obj_id, obj_inst_id);
+    if (logfs->index[hole].slot_id == 0) {
+        return;
+    }
+
+    /* Move later entries of the probe sequence into the hole so lookups don't stop early */
+    uint16_t pos = hole;
+    while (true) {
+        pos = (pos + 1) % logfs->index_capacity;
+        if (logfs->index[pos].slot_id == 0) {
+            break;
+        }
+        uint16_t home = logfs_index_hash(logfs, logfs->index[pos].obj_id, logfs->index[pos].obj_inst_id);
+        /* Entries whose home is cyclically in (hole, pos] stay */
+        bool stays = (hole <= pos) ? (home > hole && home <= pos) : (home > hole || home <= pos);
+        if (!stays) {
+            logfs->index[hole] = logfs->index[pos];
+            hole = pos;
+        }
+    }
+    logfs->index[hole].slot_id = 0;
+    logfs->index_count--;
+}
+
+/*
+ * Find the active slot of an object with a single header read
+ * @return 0 if found, slot_hdr and slot_id are filled in
+ * @retval -1 if the object is not in the log
+ * @retval -2 if reading the slot header failed
+ * @retval -3 if the index can't be used, scan the log instead
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static int8_t logfs_index_find(struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t *slot_id, uint32_t obj_id, uint16_t obj_inst_id)
+{
+    if (!logfs->index_complete) {
+        return -3;
+    }
+
+    uint16_t pos = logfs_index_probe(logfs, obj_id, obj_inst_id);
+    if (logfs->index[pos].slot_id == 0) {
+        return -1;
+    }
+
+    uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, logfs->index[pos].slot_id);
+    if (logfs->driver->read_data(logfs->flash_id,
+                                 slot_addr,
+                                 (uint8_t *)slot_hdr,
+                                 sizeof(*slot_hdr)) != 0) {
+        return -2;
+    }
+
+    if (slot_hdr->state != SLOT_STATE_ACTIVE ||
+        slot_hdr->obj_id != obj_id ||
+        slot_hdr->obj_inst_id != obj_inst_id) {
+        /* The index doesn't match the flash, don't trust it any more */
+        PIOS_DEBUG_Assert(0);
+        logfs->index_complete = false;
+        return -3;
+    }
+
+    *slot_id = logfs->index[pos].slot_id;
+    return 0;
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int32_t logfs_raw_copy_bytes(const struct logfs_state *logfs, uintptr_t src_addr, uint16_t src_size, uintptr_t dst_addr)
 {
@@ -422,7 +613,9 @@ static int32_t logfs_unmount_log(struct logfs_state *logfs)
 
     logfs->num_active_slots = 0;
     logfs->num_free_slots   = 0;
-    logfs->mounted = false;
+    logfs->index_complete   = false;
+    logfs->gc_state = LOGFS_GC_IDLE;
+    logfs->mounted  = false;
 
     return 0;
 }
@@ -434,8 +627,10 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
     logfs->num_active_slots = 0;
     logfs->num_free_slots   = 0;
     logfs->active_arena_id  = arena_id;
+    logfs->gc_state = LOGFS_GC_IDLE;
+    logfs_index_reset(logfs);
 
-    /* Scan the log to find out how full it is */
+    /* Scan the log to find out how full it is and index the active slots */
     for (uint16_t slot_id = 1;
          slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
          slot_id++) {
@@ -467,6 +662,7 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
             break;
         case SLOT_STATE_ACTIVE:
             logfs->num_active_slots++;
+            logfs_index_insert(logfs, slot_hdr.obj_id, slot_hdr.obj_inst_id, slot_id);
             break;
         case SLOT_STATE_RESERVED:
         case SLOT_STATE_OBSOLETE:
@@ -493,7 +689,7 @@ static bool PIOS_FLASHFS_Logfs_validate(const struct logfs_state *logfs)
 }
 
 #if defined(PIOS_INCLUDE_FREERTOS)
-static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
+static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(const struct flashfs_logfs_cfg *cfg)
 {
     struct logfs_state *logfs;
 
@@ -502,6 +698,21 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
         return NULL;
     }
 
+    /* The index is optional, run without it if there isn't enough memory */
+    logfs->index_capacity = MIN(cfg->index_size / sizeof(struct logfs_index_entry), UINT16_MAX);
+    logfs->index = NULL;
+    if (logfs->index_capacity > 1) {
+        logfs->index = (struct logfs_index_entry *)pios_malloc(logfs->index_capacity * sizeof(struct logfs_index_entry));
+    }
+    if (!logfs->index) {
+        logfs->index_capacity = 0;
+    }
+    logfs->index_count    = 0;
+    logfs->index_complete = false;
+    logfs->gc_state   = LOGFS_GC_IDLE;
+    logfs->gc_erasing = false;
+    logfs->gc_request = NULL;
+
     logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
     return logfs;
 }
@@ -509,12 +720,15 @@ static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 {
     /* Invalidate the magic */
     logfs->magic = ~PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+    if (logfs->index) {
+        vPortFree(logfs->index);
+    }
     vPortFree(logfs);
 }
 #else
 static struct logfs_state pios_flashfs_logfs_devs[PIOS_FLASHFS_LOGFS_MAX_DEVS];
 static uint8_t pios_flashfs_logfs_num_devs;
-static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
+static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(__attribute__((unused)) const struct flashfs_logfs_cfg *cfg)
 {
     struct logfs_state *logfs;
 
@@ -523,6 +737,16 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
     }
 
     logfs = &pios_flashfs_logfs_devs[pios_flashfs_logfs_num_devs++];
+
+    /* No heap for the index, always scan */
+    logfs->index = NULL;
+    logfs->index_capacity = 0;
+    logfs->index_count    = 0;
+    logfs->index_complete = false;
+    logfs->gc_state   = LOGFS_GC_IDLE;
+    logfs->gc_erasing = false;
+    logfs->gc_request = NULL;
+
     logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
 
     return logfs;
@@ -565,7 +789,7 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
 
     struct logfs_state *logfs;
 
-    logfs = (struct logfs_state *)PIOS_FLASHFS_Logfs_alloc();
+    logfs = (struct logfs_state *)PIOS_FLASHFS_Logfs_alloc(cfg);
     if (logfs) {
         while (rc && count++ < 2) {
             /* Bind configuration parameters to this filesystem instance */
@@ -639,78 +863,288 @@ out_exit:
     return rc;
 }
 
-/* NOTE: Must be called while holding the flash transaction lock */
-static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+/*
+ * Switch over to the destination arena once every active slot has been copied
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_finalize(struct logfs_state *logfs)
 {
-    PIOS_Assert(logfs->mounted);
-
-    /* Source arena is the active arena */
     uint8_t src_arena_id = logfs->active_arena_id;
+    uint8_t dst_arena_id = logfs->gc_dst_arena_id;
+    uint16_t num_active_slots = logfs->num_active_slots;
+    uint16_t num_free_slots   = (logfs->cfg->arena_size / logfs->cfg->slot_size) - logfs->gc_dst_slot;
 
-    /* Compute destination arena */
-    uint8_t dst_arena_id = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+    /* The index can be moved over if it knows where every copy went, otherwise mount from scratch */
+    bool remap = logfs->index_complete;
 
-    /* Erase destination arena */
-    if (logfs_erase_arena(logfs, dst_arena_id) != 0) {
+    for (uint16_t i = 0; remap && i < logfs->index_capacity; i++) {
+        if (logfs->index[i].slot_id != 0 && logfs->index[i].gc_slot_id == 0) {
+            remap = false;
+        }
+    }
+
+    /* Activate the destination arena */
+    if (logfs_activate_arena(logfs, dst_arena_id) != 0) {
+        logfs->gc_state = LOGFS_GC_IDLE;
         return -1;
     }
 
-    /* Reserve the destination arena so we can start filling it */
-    if (logfs_reserve_arena(logfs, dst_arena_id) != 0) {
-        /* Unable to reserve the arena */
+    /* Unmount the source arena */
+    if (logfs_unmount_log(logfs) != 0) {
         return -2;
     }
 
-    /* Copy active slots from active arena to destination arena */
-    uint16_t dst_slot_id = 1;
-    for (uint16_t src_slot_id = 1;
-         src_slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-         src_slot_id++) {
-        struct slot_header slot_hdr;
-        uintptr_t src_addr = logfs_get_addr(logfs, src_arena_id, src_slot_id);
-        if (logfs->driver->read_data(logfs->flash_id,
-                                     src_addr,
-                                     (uint8_t *)&slot_hdr,
-                                     sizeof(slot_hdr)) != 0) {
-            return -3;
+    /* Obsolete the source arena */
+    if (logfs_obsolete_arena(logfs, src_arena_id) != 0) {
+        return -3;
+    }
+
+    if (!remap) {
+        /* Mount the new arena */
+        return (logfs_mount_log(logfs, dst_arena_id) == 0) ? 0 : -4;
+    }
+
+    for (uint16_t i = 0; i < logfs->index_capacity; i++) {
+        if (logfs->index[i].slot_id != 0) {
+            logfs->index[i].slot_id    = logfs->index[i].gc_slot_id;
+            logfs->index[i].gc_slot_id = 0;
+        }
+    }
+    logfs->index_complete   = true;
+    logfs->num_active_slots = num_active_slots;
+    logfs->num_free_slots   = num_free_slots;
+    logfs->active_arena_id  = dst_arena_id;
+    logfs->mounted = true;
+
+    return 0;
+}
+
+/*
+ * Wait for a background step to finish erasing a destination sector, it
+ * does so without the transaction lock
+ * @return 0 if success, < 0 if the lock could not be taken again
+ * NOTE: Must be called while holding the flash transaction lock, it is given up while waiting
+ */
+static int32_t logfs_wait_gc_erase(struct logfs_state *logfs)
+{
+    while (logfs->gc_erasing) {
+        logfs->driver->end_transaction(logfs->flash_id);
+#if defined(PIOS_INCLUDE_FREERTOS)
+        vTaskDelay(1);
+#endif
+        if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Do a bounded amount of garbage collection: erase one sector of the
+ * destination arena or look at a few slots of the active one
+ * @param[in] unlock_erase give up the transaction lock while erasing, nothing
+ * else uses the destination arena and the erase takes a long time
+ * @return 1 if there is more to do
+ * @retval 0 if idle or the collection has just completed
+ * @retval < 0 on failure, the collection is abandoned
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_step(struct logfs_state *logfs, bool unlock_erase)
+{
+    PIOS_Assert(logfs->mounted);
+
+    uint16_t num_slots = logfs->cfg->arena_size / logfs->cfg->slot_size;
+
+    switch (logfs->gc_state) {
+    case LOGFS_GC_IDLE:
+        return 0;
+
+    case LOGFS_GC_REQUESTED:
+        /* Destination is the next arena */
+        logfs->gc_dst_arena_id = (logfs->active_arena_id + 1) % (logfs->cfg->total_fs_size / logfs->cfg->arena_size);
+        logfs->gc_sector = 0;
+        logfs->gc_state  = LOGFS_GC_ERASE;
+        return 1;
+
+    case LOGFS_GC_ERASE:
+    {
+        uintptr_t sector_addr = logfs_get_addr(logfs, logfs->gc_dst_arena_id, 0) +
+                                (logfs->gc_sector * logfs->cfg->sector_size);
+        int32_t erased;
+        if (unlock_erase) {
+            /* Saves and loads on the active arena can go ahead meanwhile, a save into a full log or a format waits */
+            logfs->gc_erasing = true;
+            logfs->driver->end_transaction(logfs->flash_id);
+            erased = logfs->driver->erase_sector(logfs->flash_id, sector_addr);
+            int32_t locked = logfs->driver->start_transaction(logfs->flash_id);
+            PIOS_Assert(locked == 0);
+            logfs->gc_erasing = false;
+        } else {
+            erased = logfs->driver->erase_sector(logfs->flash_id, sector_addr);
+        }
+        if (erased != 0) {
+            logfs->gc_state = LOGFS_GC_IDLE;
+            return -1;
+        }
+        if (++logfs->gc_sector < (logfs->cfg->arena_size / logfs->cfg->sector_size)) {
+            return 1;
         }
 
-        if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-            uintptr_t dst_addr = logfs_get_addr(logfs, dst_arena_id, dst_slot_id);
+        /* Reserve the destination arena so we can start filling it */
+        if (logfs_mark_arena_erased(logfs, logfs->gc_dst_arena_id) != 0 ||
+            logfs_reserve_arena(logfs, logfs->gc_dst_arena_id) != 0) {
+            logfs->gc_state = LOGFS_GC_IDLE;
+            return -2;
+        }
+        logfs->gc_src_slot = 1;
+        logfs->gc_dst_slot = 1;
+        logfs->gc_state    = LOGFS_GC_COPY;
+        return 1;
+    }
+
+    case LOGFS_GC_COPY:
+        /* Copy active slots, saves keep appending so the end of the log moves */
+        for (uint8_t n = 0;
+             n < LOGFS_GC_COPY_SLOTS && logfs->gc_src_slot < num_slots - logfs->num_free_slots;
+             n++, logfs->gc_src_slot++) {
+            struct slot_header slot_hdr;
+            uintptr_t src_addr = logfs_get_addr(logfs, logfs->active_arena_id, logfs->gc_src_slot);
+            if (logfs->driver->read_data(logfs->flash_id,
+                                         src_addr,
+                                         (uint8_t *)&slot_hdr,
+                                         sizeof(slot_hdr)) != 0) {
+                logfs->gc_state = LOGFS_GC_IDLE;
+                return -3;
+            }
+
+            if (slot_hdr.state != SLOT_STATE_ACTIVE) {
+                continue;
+            }
+
+            uintptr_t dst_addr = logfs_get_addr(logfs, logfs->gc_dst_arena_id, logfs->gc_dst_slot);
             if (logfs_raw_copy_bytes(logfs,
                                      src_addr,
                                      sizeof(slot_hdr) + slot_hdr.obj_size,
                                      dst_addr) != 0) {
                 /* Failed to copy all bytes */
+                logfs->gc_state = LOGFS_GC_IDLE;
                 return -4;
             }
-            dst_slot_id++;
+
+            /* Remember where the copy went in case it is deleted before the switch over */
+            if (logfs->index_complete) {
+                uint16_t pos = logfs_index_probe(logfs, slot_hdr.obj_id, slot_hdr.obj_inst_id);
+                if (logfs->index[pos].slot_id == logfs->gc_src_slot) {
+                    logfs->index[pos].gc_slot_id = logfs->gc_dst_slot;
+                } else {
+                    PIOS_DEBUG_Assert(0);
+                    logfs->index_complete = false;
+                }
+            }
+            logfs->gc_dst_slot++;
+        }
+
+        if (logfs->gc_src_slot < num_slots - logfs->num_free_slots) {
+            return 1;
         }
+
+        /* Caught up with the end of the log */
+        return (logfs_gc_finalize(logfs) == 0) ? 0 : -5;
+    }
+
+    return 0;
+}
+
+/*
+ * Run a garbage collection to the end, starting one if none is in progress
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_garbage_collect(struct logfs_state *logfs)
+{
+    int32_t rc;
+
+    if (logfs->gc_state == LOGFS_GC_IDLE) {
+        logfs->gc_state = LOGFS_GC_REQUESTED;
+    }
+
+    while ((rc = logfs_gc_step(logfs, false)) > 0) {
 #ifdef PIOS_INCLUDE_WDG
         PIOS_WDG_Clear();
 #endif
     }
 
-    /* Activate the destination arena */
-    if (logfs_activate_arena(logfs, dst_arena_id) != 0) {
-        return -5;
+    return rc;
+}
+
+/*
+ * Ask for a background garbage collection once the free slots drop below the
+ * watermark. Only when it frees enough to get back above it, a log full of
+ * active slots would otherwise be copied over and over again.
+ */
+static void logfs_gc_check(struct logfs_state *logfs)
+{
+    uint16_t watermark = logfs->cfg->gc_watermark;
+
+    if (logfs->gc_state == LOGFS_GC_IDLE && logfs->num_free_slots < watermark) {
+        uint16_t reclaimable = (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1 -
+                               logfs->num_free_slots - logfs->num_active_slots;
+        if (reclaimable >= watermark) {
+            logfs->gc_state = LOGFS_GC_REQUESTED;
+        }
     }
 
-    /* Unmount the source arena */
-    if (logfs_unmount_log(logfs) != 0) {
-        return -6;
+    if (logfs->gc_state != LOGFS_GC_IDLE && logfs->gc_request) {
+        logfs->gc_request();
     }
+}
 
-    /* Obsolete the source arena */
-    if (logfs_obsolete_arena(logfs, src_arena_id) != 0) {
-        return -7;
+/*
+ * Obsolete the copy a running garbage collection has made of a slot
+ * @return 0 if success or there was no copy, < 0 on failure
+ * NOTE: Must be called while holding the flash transaction lock
+ */
+static int8_t logfs_gc_obsolete_copy(struct logfs_state *logfs, const struct slot_header *slot_hdr)
+{
+    struct slot_header dst_hdr;
+    uint16_t dst_slot_id = 1;
+    uint16_t end_slot_id = logfs->gc_dst_slot;
+
+    /* The index knows where the copy went, otherwise look through the copies */
+    if (logfs->index_complete) {
+        uint16_t pos = logfs_index_probe(logfs, slot_hdr->obj_id, slot_hdr->obj_inst_id);
+        if (logfs->index[pos].slot_id != 0 && logfs->index[pos].gc_slot_id != 0) {
+            dst_slot_id = logfs->index[pos].gc_slot_id;
+            end_slot_id = dst_slot_id + 1;
+        }
     }
 
-    /* Mount the new arena */
-    if (logfs_mount_log(logfs, dst_arena_id) != 0) {
-        return -8;
+    for (; dst_slot_id < end_slot_id; dst_slot_id++) {
+        uintptr_t dst_addr = logfs_get_addr(logfs, logfs->gc_dst_arena_id, dst_slot_id);
+        if (logfs->driver->read_data(logfs->flash_id,
+                                     dst_addr,
+                                     (uint8_t *)&dst_hdr,
+                                     sizeof(dst_hdr)) != 0) {
+            return -1;
+        }
+        if (dst_hdr.state == SLOT_STATE_ACTIVE &&
+            dst_hdr.obj_id == slot_hdr->obj_id &&
+            dst_hdr.obj_inst_id == slot_hdr->obj_inst_id) {
+            dst_hdr.state = SLOT_STATE_OBSOLETE;
+            if (logfs->driver->write_data(logfs->flash_id,
+                                          dst_addr,
+                                          (uint8_t *)&dst_hdr,
+                                          sizeof(dst_hdr)) != 0) {
+                return -2;
+            }
+            return 0;
+        }
+#ifdef PIOS_INCLUDE_WDG
+        PIOS_WDG_Clear();
+#endif
     }
 
+    /* Not copied after all */
     return 0;
 }
 
@@ -757,31 +1191,64 @@ static int16_t logfs_object_find_next(const struct logfs_state *logfs, struct sl
 }
 
 /* NOTE: Must be called while holding the flash transaction lock */
-/* OPTIMIZE: could trust that there is at most one active version of every object and terminate the search when we find one */
+static int8_t logfs_obsolete_slot(struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t slot_id)
+{
+    /* A running garbage collection may have copied it already, give up on the collection if that copy can't go */
+    if (logfs->gc_state == LOGFS_GC_COPY && slot_id < logfs->gc_src_slot &&
+        logfs_gc_obsolete_copy(logfs, slot_hdr) != 0) {
+        logfs->gc_state = LOGFS_GC_IDLE;
+    }
+
+    slot_hdr->state = SLOT_STATE_OBSOLETE;
+    uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, slot_id);
+
+    if (logfs->driver->write_data(logfs->flash_id,
+                                  slot_addr,
+                                  (uint8_t *)slot_hdr,
+                                  sizeof(*slot_hdr)) != 0) {
+        return -1;
+    }
+    /* Object has been successfully obsoleted and is no longer active */
+    logfs->num_active_slots--;
+    logfs_index_remove(logfs, slot_hdr->obj_id, slot_hdr->obj_inst_id);
+
+    return 0;
+}
+
+/* NOTE: Must be called while holding the flash transaction lock */
 static int8_t logfs_delete_object(struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
 {
     int8_t rc;
 
     bool more = true;
     uint16_t curr_slot_id = 0;
+    struct slot_header slot_hdr;
+
+    /* The index knows the one active version, if any */
+    switch (logfs_index_find(logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id)) {
+    case 0:
+        return (logfs_obsolete_slot(logfs, &slot_hdr, curr_slot_id) == 0) ? 0 : -2;
+
+    case -1:
+        return 0;
+
+    case -2:
+        return -1;
+
+    default:
+        /* No usable index, scan the log */
+        curr_slot_id = 0;
+        break;
+    }
 
     do {
-        struct slot_header slot_hdr;
         switch (logfs_object_find_next(logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id)) {
         case 0:
             /* Found a matching slot.  Obsolete it. */
-            slot_hdr.state = SLOT_STATE_OBSOLETE;
-            uintptr_t slot_addr = logfs_get_addr(logfs, logfs->active_arena_id, curr_slot_id);
-
-            if (logfs->driver->write_data(logfs->flash_id,
-                                          slot_addr,
-                                          (uint8_t *)&slot_hdr,
-                                          sizeof(slot_hdr)) != 0) {
+            if (logfs_obsolete_slot(logfs, &slot_hdr, curr_slot_id) != 0) {
                 rc = -2;
                 goto out_exit;
             }
-            /* Object has been successfully obsoleted and is no longer active */
-            logfs->num_active_slots--;
             break;
         case -1:
             /* Search completed, object not found */
@@ -902,6 +1369,7 @@ static int8_t logfs_append_to_log(struct logfs_state *logfs, uint32_t obj_id, ui
 
     /* Object has been successfully written to the slot */
     logfs->num_active_slots++;
+    logfs_index_insert(logfs, obj_id, obj_inst_id, free_slot_id);
     return 0;
 }
 
@@ -947,6 +1415,12 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_exit;
     }
 
+    /* A full log is collected right here, which can't start while a background step is erasing */
+    if (logfs_log_is_full(logfs) && logfs_wait_gc_erase(logfs) != 0) {
+        rc = -2;
+        goto out_exit;
+    }
+
     if (logfs_delete_object(logfs, obj_id, obj_inst_id) != 0) {
         rc = -3;
         goto out_end_trans;
@@ -971,6 +1445,11 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
             rc = -5;
             goto out_end_trans;
         }
+        /* A collection that was already under way may have copied versions obsoleted since, start a fresh one */
+        if (logfs_log_is_full(logfs) && logfs_garbage_collect(logfs) != 0) {
+            rc = -5;
+            goto out_end_trans;
+        }
         /* Check one more time just to be sure we actually free'd some space */
         if (logfs_log_is_full(logfs)) {
             /*
@@ -991,6 +1470,9 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_end_trans;
     }
 
+    /* Make room in the background before the log is full */
+    logfs_gc_check(logfs);
+
     /* Object successfully written to the log */
     rc = 0;
 
@@ -1033,10 +1515,15 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
         goto out_exit;
     }
 
-    /* Find the object in the log */
+    /* Find the object in the log, a single read if it is indexed */
     uint16_t slot_id = 0;
     struct slot_header slot_hdr;
-    if (logfs_object_find_next(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
+    int8_t found     = logfs_index_find(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id);
+    if (found == -3) {
+        slot_id = 0;
+        found   = logfs_object_find_next(logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id);
+    }
+    if (found != 0) {
         /* Object does not exist in fs */
         rc = -3;
         goto out_end_trans;
@@ -1134,15 +1621,21 @@ int32_t PIOS_FLASHFS_Format(uintptr_t fs_id)
         goto out_exit;
     }
 
-    if (logfs->mounted) {
-        logfs_unmount_log(logfs);
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
     }
 
-    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+    /* A background step erasing without the lock would otherwise finish after the format */
+    if (logfs_wait_gc_erase(logfs) != 0) {
         rc = -2;
         goto out_exit;
     }
 
+    if (logfs->mounted) {
+        logfs_unmount_log(logfs);
+    }
+
     if (logfs_erase_all_arenas(logfs) != 0) {
         rc = -3;
         goto out_end_trans;
@@ -1187,6 +1680,76 @@ int32_t PIOS_FLASHFS_GetStats(uintptr_t fs_id, struct PIOS_FLASHFS_Stats *stats)
     stats->num_free_slots   = logfs->num_free_slots;
     return 0;
 }
+
+/**
+ * @brief Does a bounded amount of background garbage collection, erasing one
+ * sector of the next arena or copying a few slots into it
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 1 if there is more to do, call again
+ * @retval 0 if there is nothing to do
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if garbage collection failed, saves will collect when the log is full
+ */
+int32_t PIOS_FLASHFS_Logfs_GCStep(uintptr_t fs_id)
+{
+    int32_t rc;
+
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        rc = -1;
+        goto out_exit;
+    }
+
+    if (logfs->gc_state == LOGFS_GC_IDLE) {
+        rc = 0;
+        goto out_exit;
+    }
+
+    if (logfs->driver->start_transaction(logfs->flash_id) != 0) {
+        rc = -2;
+        goto out_exit;
+    }
+
+    if (logfs->gc_erasing) {
+        /* Another caller is erasing, come back later */
+        rc = 1;
+    } else {
+        rc = logfs->mounted ? logfs_gc_step(logfs, logfs->driver->unlocked_erase) : 0;
+        if (rc < 0) {
+            rc = -3;
+        }
+    }
+
+    logfs->driver->end_transaction(logfs->flash_id);
+
+out_exit:
+    return rc;
+}
+
+/**
+ * @brief Sets the function called when the filesystem wants PIOS_FLASHFS_Logfs_GCStep()
+ * to be called until it returns 0. It is called from within saves, it must not block.
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] request The function, NULL to only collect when the log is full
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if the filesystem has no watermark for background collection
+ */
+int32_t PIOS_FLASHFS_Logfs_SetGCRequest(uintptr_t fs_id, void (*request)(void))
+{
+    struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+    if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+        return -1;
+    }
+    if (logfs->cfg->gc_watermark == 0) {
+        return -2;
+    }
+    logfs->gc_request = request;
+    return 0;
+}
 #endif /* PIOS_INCLUDE_FLASH */
 
 /**
@@ -735,6 +735,7 @@ void PIOS_HMC5x83_driver_fetch(void *data, uint8_t size, uintptr_t context)
     tmp->sample[0].y = dev->magData[1];
     tmp->sample[0].z = dev->magData[2];
     tmp->temperature = 0;
+    tmp->timestamp   = 0;
 }
 
 
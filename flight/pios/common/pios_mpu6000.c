@@ -546,6 +546,11 @@ bool PIOS_MPU6000_IRQHandler(void)
         return false;
     }
 
+    // Stamp the sample as close to the data ready interrupt as possible
+    if (queue_data) {
+        queue_data->timestamp = PIOS_DELAY_GetRaw();
+    }
+
     bool read_ok = false;
     read_ok = PIOS_MPU6000_ReadSensor(&woken);
 
@@ -209,8 +209,9 @@ static struct mpu9250_dev *PIOS_MPU9250_alloc(const struct pios_mpu9250_cfg *cfg
     queue_data->count = SENSOR_COUNT;
 
     mag_data = (PIOS_SENSORS_3Axis_SensorsWithTemp *)pios_malloc(MAG_SENSOR_DATA_SIZE);
-    mag_data->count   = 1;
     PIOS_Assert(mag_data);
+    mag_data->count     = 1;
+    mag_data->timestamp = 0;
     return mpu9250_dev;
 }
 
@@ -821,6 +822,11 @@ bool PIOS_MPU9250_IRQHandler(void)
         return false;
     }
 
+    // Stamp the sample as close to the data ready interrupt as possible
+    if (queue_data) {
+        queue_data->timestamp = PIOS_DELAY_GetRaw();
+    }
+
 #if defined(PIOS_MPU9250_MAG)
     PIOS_MPU9250_ReadMag(&woken);
 #endif
@@ -28,10 +28,31 @@
 #include <pios_sensors.h>
 #include <string.h>
 
+// private types
+
+struct PIOS_SENSORS_Ring {
+    volatile uint32_t head; // written by the producer only
+    volatile uint32_t tail; // written by the consumer only
+    uint16_t length;
+    uint16_t watermark;
+    uint8_t  sensors;
+    volatile int16_t temperature;
+    uint32_t period; // last measured sample period, for single sample blocks
+    uint32_t fetchTime; // PIOS_DELAY_GetRaw() of the last fetch
+    xSemaphoreHandle signal;
+    uint32_t   *timestamps;
+    Vector3i16 *samples;
+    PIOS_SENSORS_RingStats stats;
+};
+
 // private variables
 
 static PIOS_SENSORS_Instance *sensor_list = 0;
 
+// private functions
+
+static bool ringPush(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp, bool *signal);
+
 PIOS_SENSORS_Instance *PIOS_SENSORS_Register(const PIOS_SENSORS_Driver *driver, PIOS_SENSORS_TYPE type, uintptr_t context)
 {
     PIOS_SENSORS_Instance *instance = (PIOS_SENSORS_Instance *)pios_malloc(sizeof(PIOS_SENSORS_Instance));
@@ -63,3 +84,148 @@ PIOS_SENSORS_Instance *PIOS_SENSORS_GetInstanceByType(const PIOS_SENSORS_Instanc
     }
     return NULL;
 }
+
+PIOS_SENSORS_Ring *PIOS_SENSORS_RingCreate(uint16_t length, uint8_t sensors, uint16_t watermark)
+{
+    PIOS_Assert(length && !(length & (length - 1)));
+    PIOS_Assert(watermark && watermark <= length);
+
+    PIOS_SENSORS_Ring *ring = (PIOS_SENSORS_Ring *)pios_malloc(sizeof(PIOS_SENSORS_Ring));
+    if (!ring) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(PIOS_SENSORS_Ring));
+    ring->length     = length;
+    ring->watermark  = watermark;
+    ring->sensors    = sensors;
+    ring->timestamps = (uint32_t *)pios_malloc(length * sizeof(uint32_t));
+    ring->samples    = (Vector3i16 *)pios_malloc(length * sensors * sizeof(Vector3i16));
+    if (ring->timestamps && ring->samples) {
+        vSemaphoreCreateBinary(ring->signal);
+    }
+    if (!ring->signal) {
+        if (ring->samples) {
+            pios_free(ring->samples);
+        }
+        if (ring->timestamps) {
+            pios_free(ring->timestamps);
+        }
+        pios_free(ring);
+        return NULL;
+    }
+    // the consumer waits for the first watermark
+    xSemaphoreTake(ring->signal, 0);
+    return ring;
+}
+
+bool PIOS_SENSORS_RingPush(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp)
+{
+    bool signal;
+
+    if (!ringPush(ring, sample, temperature, timestamp, &signal)) {
+        return false;
+    }
+    if (signal) {
+        xSemaphoreGive(ring->signal);
+    }
+    return true;
+}
+
+bool PIOS_SENSORS_RingPushFromISR(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp, bool *woken)
+{
+    bool signal;
+
+    if (!ringPush(ring, sample, temperature, timestamp, &signal)) {
+        return false;
+    }
+    if (signal) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        xSemaphoreGiveFromISR(ring->signal, &higherPriorityTaskWoken);
+        *woken |= (higherPriorityTaskWoken == pdTRUE);
+    }
+    return true;
+}
+
+uint16_t PIOS_SENSORS_RingCount(const PIOS_SENSORS_Ring *ring)
+{
+    return ring->head - ring->tail;
+}
+
+bool PIOS_SENSORS_RingWait(PIOS_SENSORS_Ring *ring, TickType_t timeout)
+{
+    if (PIOS_SENSORS_RingCount(ring) >= ring->watermark) {
+        return true;
+    }
+    xSemaphoreTake(ring->signal, timeout);
+    return PIOS_SENSORS_RingCount(ring) > 0;
+}
+
+bool PIOS_SENSORS_RingFetch(PIOS_SENSORS_Ring *ring, PIOS_SENSORS_3Axis_SampleBlock *block)
+{
+    uint32_t tail  = ring->tail;
+    uint32_t count = ring->head - tail;
+
+    if (!count) {
+        return false;
+    }
+    // the samples must be read after the head that published them
+    __sync_synchronize();
+
+    uint32_t slot = tail & (ring->length - 1);
+    if (slot + count > ring->length) {
+        count = ring->length - slot;
+    }
+    if (count > 1) {
+        ring->period = (ring->timestamps[slot + count - 1] - ring->timestamps[slot]) / (count - 1);
+    }
+
+    block->count       = count;
+    block->sensors     = ring->sensors;
+    block->temperature = ring->temperature;
+    block->timestamp   = ring->timestamps[slot];
+    block->period      = ring->period;
+    block->sample      = &ring->samples[slot * ring->sensors];
+
+    ring->fetchTime    = PIOS_DELAY_GetRaw();
+    return true;
+}
+
+void PIOS_SENSORS_RingRelease(PIOS_SENSORS_Ring *ring, const PIOS_SENSORS_3Axis_SampleBlock *block)
+{
+    ring->stats.busy     += PIOS_DELAY_DiffuS(ring->fetchTime);
+    ring->stats.released += block->count;
+
+    // the block must have been read before the producer can reuse it
+    __sync_synchronize();
+    ring->tail += block->count;
+}
+
+void PIOS_SENSORS_RingGetStats(const PIOS_SENSORS_Ring *ring, PIOS_SENSORS_RingStats *stats)
+{
+    *stats = ring->stats;
+}
+
+static bool ringPush(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp, bool *signal)
+{
+    uint32_t head  = ring->head;
+    uint32_t count = head - ring->tail;
+
+    if (count >= ring->length) {
+        ring->stats.dropped++;
+        return false;
+    }
+
+    uint32_t slot = head & (ring->length - 1);
+    memcpy(&ring->samples[slot * ring->sensors], sample, ring->sensors * sizeof(Vector3i16));
+    ring->timestamps[slot] = timestamp;
+    ring->temperature = temperature;
+
+    // the sample must be complete before the consumer can see it
+    __sync_synchronize();
+    ring->head = head + 1;
+    ring->stats.pushed++;
+
+    // one wakeup per block instead of one per sample
+    *signal = (count + 1 == ring->watermark);
+    return true;
+}
@@ -127,6 +127,15 @@ int32_t PIOS_CALLBACKSCHEDULER_Initialize();
  */
 int32_t PIOS_CALLBACKSCHEDULER_Start();
 
+/**
+ * Run all callbacks that are due in the context of the caller.
+ * For hosts that drive the callbacks themselves instead of starting the
+ * scheduler tasks, like the offline state estimation replay. Must not be
+ * used once PIOS_CALLBACKSCHEDULER_Start() has been called.
+ * \return Number of callbacks run
+ */
+int32_t PIOS_CALLBACKSCHEDULER_RunPending();
+
 /**
  * Register a new callback to be called by a delayed callback scheduler task.
  * If a scheduler task with the specified task priority does not exist yet, it
@@ -186,6 +195,13 @@ int32_t PIOS_CALLBACKSCHEDULER_Dispatch(DelayedCallbackInfo *cbinfo);
  */
 int32_t PIOS_CALLBACKSCHEDULER_DispatchFromISR(DelayedCallbackInfo *cbinfo, long *pxHigherPriorityTaskWoken);
 
+/**
+ * Upper bounds (in us) of the dispatch latency histogram buckets,
+ * the last bucket counts everything above the last bound.
+ */
+#define CALLBACK_LATENCY_BOUNDS_US { 100, 1000, 5000, 20000 }
+#define CALLBACK_LATENCY_BUCKETS   5
+
 /**
  * Information about a running callback that has been registered
  * via a call to PIOS_CALLBACKSCHEDULER_Create().
@@ -197,6 +213,10 @@ struct pios_callback_info {
     bool     is_running;
     /** Count of executions of the callback since system start */
     uint32_t running_time_count;
+    /** Histogram of the time from dispatch to execution since system start */
+    uint16_t latency_histogram[CALLBACK_LATENCY_BUCKETS];
+    /** Largest time from dispatch to execution in us */
+    uint32_t latency_max;
 };
 
 /**
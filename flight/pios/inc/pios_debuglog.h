@@ -31,12 +31,33 @@
 #ifndef PIOS_DEBUGLOG_H
 #define PIOS_DEBUGLOG_H
 
+struct PIOS_DEBUGLOG_Stats {
+    uint32_t dropped; /* entries lost because all buffers were waiting for the flash or it was full */
+    uint32_t flushes; /* buffers written */
+    uint32_t flush_time; /* duration of the last buffer write in us */
+    uint32_t flush_time_max; /* longest buffer write in us */
+};
 
 /**
  * @brief Initialize the log facility
  */
 void PIOS_DEBUGLOG_Initialize();
 
+/**
+ * @brief Have full buffers written from the background
+ * @param[in] request called from the logging task when a buffer is ready,
+ * it should arrange for PIOS_DEBUGLOG_Flush() to be called soon.
+ * Without one entries are dropped, the flash is never written by the task logging them.
+ */
+void PIOS_DEBUGLOG_SetFlushRequest(void (*request)(void));
+
+/**
+ * @brief Write the buffers that are ready to flash. Takes as long as the
+ * flash writes, call it from a low priority task.
+ * @return number of full buffers still waiting
+ */
+int32_t PIOS_DEBUGLOG_Flush();
+
 /**
  * @brief Enables or Disables logging globally
  * @param[in] enable or disable logging
@@ -53,6 +74,16 @@ void PIOS_DEBUGLOG_Enable(uint8_t enabled);
  */
 void PIOS_DEBUGLOG_UAVObject(uint32_t objid, uint16_t instid, size_t size, uint8_t *data);
 
+/**
+ * @brief Write a debug log entry with a uavobject, copied straight into the log buffer
+ * @param[in] objectid
+ * @param[in] instanceid
+ * @param[in] size of object
+ * @param[in] copy fills in the entry data, called with at most size bytes of room
+ * @param[in] context passed on to copy
+ */
+void PIOS_DEBUGLOG_UAVObjectCopy(uint32_t objid, uint16_t instid, size_t size, void (*copy)(void *context, uint8_t *data, size_t size), void *context);
+
 /**
  * @brief Write a debug log entry with text
  * @param[in] format - as in printf
@@ -84,6 +115,12 @@ int32_t PIOS_DEBUGLOG_Read(void *buffer, uint16_t flight, uint16_t inst);
  */
 void PIOS_DEBUGLOG_Info(uint16_t *flight, uint16_t *entry, uint16_t *free, uint16_t *used);
 
+/**
+ * @brief Retrieve the buffering statistics
+ * @param[out] stats dropped entries and flash write times
+ */
+void PIOS_DEBUGLOG_GetStats(struct PIOS_DEBUGLOG_Stats *stats);
+
 /**
  * @brief Format entire flash memory!!!
  */
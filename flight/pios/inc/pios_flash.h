@@ -28,6 +28,7 @@
 #define PIOS_FLASH_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 struct pios_flash_chunk {
     uint8_t  *addr;
@@ -44,6 +45,8 @@ struct pios_flash_driver {
     int32_t (*rewrite_data)(uintptr_t flash_id, uint32_t addr, uint8_t *data, uint16_t len);
     int32_t (*rewrite_chunks)(uintptr_t flash_id, uint32_t addr, struct pios_flash_chunk chunks[], uint32_t num_chunks);
     int32_t (*read_data)(uintptr_t flash_id, uint32_t addr, uint8_t *data, uint16_t len);
+    /* erase_sector may run outside of a transaction on a sector nothing else uses, other calls wait for it */
+    bool    unlocked_erase;
 };
 
 #endif /* PIOS_FLASH_H */
@@ -39,10 +39,17 @@ struct flashfs_logfs_cfg {
     uint32_t start_offset; /* Offset into flash where this filesystem starts */
     uint32_t sector_size; /* Size of a flash erase block */
     uint32_t page_size; /* Maximum flash burst write size */
+
+    uint32_t index_size; /* RAM for the object to slot index, 0 to always scan the log */
+    uint16_t gc_watermark; /* Free slots left when garbage collection starts in the background, 0 to only collect a full log */
 };
 
 int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg *cfg, const struct pios_flash_driver *driver, uintptr_t flash_id);
 
 int32_t PIOS_FLASHFS_Logfs_Destroy(uintptr_t fs_id);
 
+int32_t PIOS_FLASHFS_Logfs_GCStep(uintptr_t fs_id);
+
+int32_t PIOS_FLASHFS_Logfs_SetGCRequest(uintptr_t fs_id, void (*request)(void));
+
 #endif /* PIOS_FLASHFS_LOGFS_PRIV_H */
@@ -42,6 +42,8 @@ typedef void (*PIOS_SENSORS_fetch_function)(void *samples, uint8_t size, uintptr
  */
 typedef void (*PIOS_SENSORS_get_scale_function)(float *, uint8_t size, uintptr_t context);
 typedef QueueHandle_t (*PIOS_SENSORS_get_queue_function)(uintptr_t context);
+typedef struct PIOS_SENSORS_Ring PIOS_SENSORS_Ring;
+typedef PIOS_SENSORS_Ring *(*PIOS_SENSORS_get_ring_function)(uintptr_t context);
 
 typedef struct PIOS_SENSORS_Driver {
     PIOS_SENSORS_test_function      test; // called at startup to test the sensor
@@ -49,6 +51,7 @@ typedef struct PIOS_SENSORS_Driver {
     PIOS_SENSORS_fetch_function     fetch; // called to fetch data for polled sensors
     PIOS_SENSORS_reset_function     reset; // reset sensor. for example if data are not received in the allotted time
     PIOS_SENSORS_get_queue_function get_queue; // get the queue reference
+    PIOS_SENSORS_get_ring_function  get_ring; // get the sample ring for sensors delivering blocks, takes precedence over the queue
     PIOS_SENSORS_get_scale_function get_scale; // return scales for the sensors
     bool is_polled;
 } PIOS_SENSORS_Driver;
@@ -78,6 +81,7 @@ typedef struct PIOS_SENSORS_Instance {
 typedef struct PIOS_SENSORS_3Axis_SensorsWithTemp {
     uint16_t   count; // number of sensor instances
     int16_t    temperature;  // Degrees Celsius * 100
+    uint32_t   timestamp; // PIOS_DELAY_GetRaw() when the sample was taken, 0 if not known
     Vector3i16 sample[];
 } PIOS_SENSORS_3Axis_SensorsWithTemp;
 
@@ -86,6 +90,29 @@ typedef struct PIOS_SENSORS_1Axis_SensorsWithTemp {
     float sample; // sample
 } PIOS_SENSORS_1Axis_SensorsWithTemp;
 
+/**
+ * A block of consecutive 3d samples taken from a sample ring.
+ * The samples point into the ring and stay valid until the block is released.
+ */
+typedef struct PIOS_SENSORS_3Axis_SampleBlock {
+    uint16_t count; // number of samples in the block
+    uint16_t sensors; // number of sensor instances per sample
+    int16_t  temperature; // Degrees Celsius * 100 of the latest sample
+    uint32_t timestamp; // PIOS_DELAY_GetRaw() when the first sample was taken
+    uint32_t period; // PIOS_DELAY_GetRaw() ticks between samples, 0 if not known
+    const Vector3i16 *sample; // sample i of sensor instance n is sample[i * sensors + n]
+} PIOS_SENSORS_3Axis_SampleBlock;
+
+/**
+ * Counters of a sample ring, for throughput measurements
+ */
+typedef struct PIOS_SENSORS_RingStats {
+    uint32_t pushed; // samples added by the driver
+    uint32_t dropped; // samples lost because the ring was full
+    uint32_t released; // samples processed by the consumer
+    uint32_t busy; // time in us the consumer spent between fetching and releasing blocks
+} PIOS_SENSORS_RingStats;
+
 /**
  * Register a new sensor instance with sensor subsystem
  * @param driver sensor driver
@@ -163,6 +190,20 @@ static inline QueueHandle_t PIOS_SENSORS_GetQueue(const PIOS_SENSORS_Instance *s
     }
     return sensor->driver->get_queue(sensor->context);
 }
+/**
+ * retrieve the sample ring of sensors that deliver blocks of samples
+ * @param sensor
+ * @return sensor ring or null if not supported
+ */
+static inline PIOS_SENSORS_Ring *PIOS_SENSORS_GetRing(const PIOS_SENSORS_Instance *sensor)
+{
+    PIOS_Assert(sensor);
+    if (!sensor->driver->get_ring) {
+        return NULL;
+    }
+    return sensor->driver->get_ring(sensor->context);
+}
+
 /**
  * Get the sensor scales.
  * @param sensor sensor instance
@@ -188,4 +229,71 @@ PIOS_SENSORS_Instance *PIOS_SENSORS_GetList();
  */
 PIOS_SENSORS_Instance *PIOS_SENSORS_GetInstanceByType(const PIOS_SENSORS_Instance *previous_instance, PIOS_SENSORS_TYPE type);
 
+/**
+ * Create a sample ring for a driver delivering blocks of samples.
+ * There is one producer (the driver) and one consumer (the sensors task).
+ * So far only the simulated IMU produces blocks, the hardware drivers
+ * still deliver single samples through their queue.
+ * @param length number of samples the ring holds, must be a power of two
+ * @param sensors number of sensor instances per sample, e.g. 2 for accel and gyro
+ * @param watermark number of samples after which the consumer is woken up
+ * @return the new ring or NULL on failure
+ */
+PIOS_SENSORS_Ring *PIOS_SENSORS_RingCreate(uint16_t length, uint8_t sensors, uint16_t watermark);
+
+/**
+ * Add a sample to the ring, producer side from task context
+ * @param ring the sample ring
+ * @param sample one vector per sensor instance
+ * @param temperature Degrees Celsius * 100
+ * @param timestamp PIOS_DELAY_GetRaw() when the sample was taken
+ * @return true on success, false if the ring was full and the sample dropped
+ */
+bool PIOS_SENSORS_RingPush(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp);
+
+/**
+ * Add a sample to the ring, producer side from interrupt context
+ * @param woken set to true if a higher priority task was woken
+ * @return true on success, false if the ring was full and the sample dropped
+ */
+bool PIOS_SENSORS_RingPushFromISR(PIOS_SENSORS_Ring *ring, const Vector3i16 *sample, int16_t temperature, uint32_t timestamp, bool *woken);
+
+/**
+ * Get the number of samples waiting in the ring
+ * @param ring the sample ring
+ * @return number of samples
+ */
+uint16_t PIOS_SENSORS_RingCount(const PIOS_SENSORS_Ring *ring);
+
+/**
+ * Wait until the watermark is reached, consumer side
+ * @param ring the sample ring
+ * @param timeout ticks to wait at most
+ * @return true if samples are waiting
+ */
+bool PIOS_SENSORS_RingWait(PIOS_SENSORS_Ring *ring, TickType_t timeout);
+
+/**
+ * Get the oldest contiguous block of samples, consumer side.
+ * At the end of the ring storage a block is split in two.
+ * @param ring the sample ring
+ * @param block filled with the samples, valid until released
+ * @return true if a block was returned, false if the ring is empty
+ */
+bool PIOS_SENSORS_RingFetch(PIOS_SENSORS_Ring *ring, PIOS_SENSORS_3Axis_SampleBlock *block);
+
+/**
+ * Return the space of a fetched block to the producer
+ * @param ring the sample ring
+ * @param block a block returned by PIOS_SENSORS_RingFetch()
+ */
+void PIOS_SENSORS_RingRelease(PIOS_SENSORS_Ring *ring, const PIOS_SENSORS_3Axis_SampleBlock *block);
+
+/**
+ * Get the ring counters
+ * @param ring the sample ring
+ * @param stats filled with the counters
+ */
+void PIOS_SENSORS_RingGetStats(const PIOS_SENSORS_Ring *ring, PIOS_SENSORS_RingStats *stats);
+
 #endif /* PIOS_SENSORS_H */
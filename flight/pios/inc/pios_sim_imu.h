@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ *
+ * @file       pios_sim_imu.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Simulated high rate IMU for the posix target
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PIOS_SIM_IMU_H
+#define PIOS_SIM_IMU_H
+
+#include <pios_sensors.h>
+
+/* Global Types */
+struct pios_sim_imu_cfg {
+    uint32_t rate; // samples per second
+    uint16_t ring_length; // samples the ring holds, power of two
+    uint16_t watermark; // samples per block handed to the sensors task
+};
+
+/* Public Functions */
+int32_t PIOS_SIM_IMU_Init(const struct pios_sim_imu_cfg *cfg);
+
+#endif /* PIOS_SIM_IMU_H */
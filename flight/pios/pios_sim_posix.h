@@ -94,6 +94,10 @@ extern void PIOS_LED_Init(void);
 #include <pios_flash.h>
 #include <pios_flashfs.h>
 
+#ifdef PIOS_INCLUDE_SIM_IMU
+#include <pios_sim_imu.h>
+#endif
+
 #if defined(PIOS_INCLUDE_IAP)
 #include <pios_iap.h>
 #endif
@@ -141,5 +141,14 @@ uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
     return PIOS_DELAY_GetuS() - raw;
 }
 
+/**
+ * @brief Subtract two raw times and convert to us.
+ * @return Interval between raw times in microseconds
+ */
+uint32_t PIOS_DELAY_DiffuS2(uint32_t raw, uint32_t later)
+{
+    return later - raw;
+}
+
 
 #endif /* if defined(PIOS_INCLUDE_DELAY) */
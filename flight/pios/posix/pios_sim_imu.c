@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ *
+ * @file       pios_sim_imu.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Simulated high rate IMU for the posix target.
+ *                 - produces accel and gyro samples at a fixed rate and hands
+ *                   them to the Sensors module in blocks through a sample ring
+ *                 - reports the throughput of the sensor path on the console
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "pios.h"
+
+#if defined(PIOS_INCLUDE_SIM_IMU)
+
+#include <pios_sim_imu.h>
+#include <pios_math.h>
+
+#define SIM_IMU_TASK_PRIORITY   (configMAX_PRIORITIES - 1)
+#define SIM_IMU_TASK_STACK      (1024 / 4)
+#define SIM_IMU_ACCEL_SCALE     (9.81f / 4096.0f) // +/-8g range
+#define SIM_IMU_GYRO_SCALE      (1.0f / 16.4f) // +/-2000 deg/s range
+#define SIM_IMU_ONE_G           4096
+#define SIM_IMU_GYRO_AMPLITUDE  164.0f // 10 deg/s
+#define SIM_IMU_GYRO_FREQUENCY  0.5f // Hz
+#define SIM_IMU_TEMPERATURE     2500
+#define SIM_IMU_REPORT_PERIOD   5000000 // us
+#define SIM_IMU_MAX_LAG         1000000 // us, samples older than this are skipped
+
+static const struct pios_sim_imu_cfg *dev_cfg;
+static PIOS_SENSORS_Ring *dev_ring;
+static xTaskHandle taskHandle;
+
+static bool PIOS_SIM_IMU_driver_Test(uintptr_t context);
+static void PIOS_SIM_IMU_driver_Reset(uintptr_t context);
+static void PIOS_SIM_IMU_driver_get_scale(float *scales, uint8_t size, uintptr_t context);
+static PIOS_SENSORS_Ring *PIOS_SIM_IMU_driver_get_ring(uintptr_t context);
+static void PIOS_SIM_IMU_Task(void *parameters);
+
+const PIOS_SENSORS_Driver PIOS_SIM_IMU_Driver = {
+    .test      = PIOS_SIM_IMU_driver_Test,
+    .poll      = NULL,
+    .fetch     = NULL,
+    .reset     = PIOS_SIM_IMU_driver_Reset,
+    .get_queue = NULL,
+    .get_ring  = PIOS_SIM_IMU_driver_get_ring,
+    .get_scale = PIOS_SIM_IMU_driver_get_scale,
+    .is_polled = false,
+};
+
+/**
+ * Initialise the simulated IMU and register it with the sensors subsystem
+ * \param[in] cfg sample rate and ring configuration
+ * \return < 0 if initialisation failed
+ */
+int32_t PIOS_SIM_IMU_Init(const struct pios_sim_imu_cfg *cfg)
+{
+    PIOS_Assert(cfg);
+
+    if (cfg->rate == 0 || cfg->watermark == 0 || cfg->watermark > cfg->ring_length) {
+        return -1;
+    }
+
+    dev_cfg  = cfg;
+    dev_ring = PIOS_SENSORS_RingCreate(cfg->ring_length, 2, cfg->watermark);
+    if (!dev_ring) {
+        return -1;
+    }
+
+    if (xTaskCreate(PIOS_SIM_IMU_Task, "SimIMU", SIM_IMU_TASK_STACK, NULL, SIM_IMU_TASK_PRIORITY, &taskHandle) != pdPASS) {
+        return -1;
+    }
+
+    PIOS_SENSORS_Register(&PIOS_SIM_IMU_Driver, PIOS_SENSORS_TYPE_3AXIS_GYRO_ACCEL, 0);
+
+    return 0;
+}
+
+/**
+ * Produce the samples due since the last tick, as a sensor interrupt would
+ * do at the configured rate, and report the throughput periodically.
+ */
+static void PIOS_SIM_IMU_Task(__attribute__((unused)) void *parameters)
+{
+    const uint32_t sample_us = 1000000 / dev_cfg->rate;
+    uint32_t next_sample     = PIOS_DELAY_GetRaw();
+    uint32_t report_time     = next_sample;
+    uint32_t sample_count    = 0;
+    PIOS_SENSORS_RingStats last_stats = { 0 };
+    TickType_t lastWakeTime  = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&lastWakeTime, 1);
+
+        uint32_t now = PIOS_DELAY_GetRaw();
+        if (PIOS_DELAY_DiffuS2(next_sample, now) > SIM_IMU_MAX_LAG) {
+            // the host stalled, do not try to catch up
+            next_sample = now;
+        }
+
+        while ((int32_t)(now - next_sample) >= 0) {
+            // level board, rolling back and forth slowly. raw time is in us on posix
+            float t = (float)sample_count / (float)dev_cfg->rate;
+            Vector3i16 sample[2];
+            sample[0].x = 0;
+            sample[0].y = 0;
+            sample[0].z = -SIM_IMU_ONE_G;
+            sample[1].x = (int16_t)(SIM_IMU_GYRO_AMPLITUDE * sinf(2.0f * M_PI_F * SIM_IMU_GYRO_FREQUENCY * t));
+            sample[1].y = 0;
+            sample[1].z = 0;
+            PIOS_SENSORS_RingPush(dev_ring, sample, SIM_IMU_TEMPERATURE, next_sample);
+            next_sample += sample_us;
+            sample_count++;
+        }
+
+        uint32_t elapsed = PIOS_DELAY_DiffuS2(report_time, now);
+        if (elapsed >= SIM_IMU_REPORT_PERIOD) {
+            PIOS_SENSORS_RingStats stats;
+            PIOS_SENSORS_RingGetStats(dev_ring, &stats);
+            uint32_t pushed   = stats.pushed - last_stats.pushed;
+            uint32_t released = stats.released - last_stats.released;
+            uint32_t busy     = stats.busy - last_stats.busy;
+            fprintf(stderr, "SimIMU: %u samples/s produced, %u samples/s processed, %u dropped, %u.%03u us/sample\n",
+                    (unsigned)((uint64_t)pushed * 1000000 / elapsed),
+                    (unsigned)((uint64_t)released * 1000000 / elapsed),
+                    (unsigned)(stats.dropped - last_stats.dropped),
+                    (unsigned)(released ? busy / released : 0),
+                    (unsigned)(released ? ((uint64_t)busy * 1000 / released) % 1000 : 0));
+            last_stats  = stats;
+            report_time = now;
+        }
+    }
+}
+
+static bool PIOS_SIM_IMU_driver_Test(__attribute__((unused)) uintptr_t context)
+{
+    return true;
+}
+
+static void PIOS_SIM_IMU_driver_Reset(__attribute__((unused)) uintptr_t context)
+{}
+
+static void PIOS_SIM_IMU_driver_get_scale(float *scales, uint8_t size, __attribute__((unused)) uintptr_t context)
+{
+    PIOS_Assert(size >= 2);
+    scales[0] = SIM_IMU_ACCEL_SCALE;
+    scales[1] = SIM_IMU_GYRO_SCALE;
+}
+
+static PIOS_SENSORS_Ring *PIOS_SIM_IMU_driver_get_ring(__attribute__((unused)) uintptr_t context)
+{
+    return dev_ring;
+}
+
+#endif /* PIOS_INCLUDE_SIM_IMU */
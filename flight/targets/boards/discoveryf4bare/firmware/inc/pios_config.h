@@ -57,6 +57,10 @@
 #define PIOS_INCLUDE_SYS
 #define PIOS_INCLUDE_TASK_MONITOR
 
+/* PIOS CRC engines */
+#define PIOS_CRC_SLICE_BY_4
+#define PIOS_CRC32_HARDWARE
+
 #define PIOS_INSTRUMENTATION_MAX_COUNTERS 10
 #define PIOS_INCLUDE_INSTRUMENTATION
 
@@ -146,6 +150,7 @@
 #define PIOS_INCLUDE_COM_FLEXI
 /* #define PIOS_INCLUDE_COM_AUX */
 #define PIOS_TELEM_PRIORITY_QUEUE
+#define PIOS_TELEM_DELTA_ENCODING
 #define PIOS_INCLUDE_GPS
 /* #define PIOS_GPS_MINIMAL */
 #define PIOS_INCLUDE_GPS_NMEA_PARSER
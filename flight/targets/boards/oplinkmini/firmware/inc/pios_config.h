@@ -56,6 +56,10 @@
 #define PIOS_INCLUDE_SYS
 #define PIOS_INCLUDE_TASK_MONITOR
 
+/* PIOS CRC engines */
+/* #define PIOS_CRC_SLICE_BY_4 */
+/* #define PIOS_CRC32_HARDWARE */
+
 /* PIOS hardware peripherals */
 #define PIOS_INCLUDE_IRQ
 #define PIOS_INCLUDE_RTC
@@ -135,6 +139,7 @@
 /* #define PIOS_INCLUDE_COM_FLEXI */
 /* #define PIOS_INCLUDE_COM_AUX */
 /* #define PIOS_TELEM_PRIORITY_QUEUE */
+/* #define PIOS_TELEM_DELTA_ENCODING */
 /* #define PIOS_INCLUDE_GPS */
 /* #define PIOS_GPS_MINIMAL */
 /* #define PIOS_INCLUDE_GPS_NMEA_PARSER */
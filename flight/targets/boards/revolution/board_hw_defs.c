@@ -691,6 +691,9 @@ static const struct flashfs_logfs_cfg flashfs_external_user_cfg = {
     .start_offset  = 0x00040000, /* start offset */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .index_size    = 0x00000600, /* 128 objects, scans the log when there are more */
+    .gc_watermark  = 512,        /* collect in the background, a few seconds of logging ahead */
 };
 
 static const struct flashfs_logfs_cfg flashfs_external_system_cfg = {
@@ -702,6 +705,9 @@ static const struct flashfs_logfs_cfg flashfs_external_system_cfg = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .index_size    = 0x00000C00, /* index every slot of the arena, 12 bytes each */
+    .gc_watermark  = 32,         /* collect in the background before settings saves have to */
 };
 
 
@@ -140,7 +140,7 @@ extern uint32_t pios_com_msp_id;
 // ------------------------
 // TELEMETRY
 // ------------------------
-#define TELEM_QUEUE_SIZE      80
+#define TELEM_QUEUE_SIZE      50
 #define PIOS_TELEM_STACK_SIZE 800
 
 // -------------------------
@@ -0,0 +1,411 @@
+/**
+ ******************************************************************************
+ *
+ * @file       autotune.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Offline AutoTune system identification of flight logs.
+ *             GyroState and ActuatorDesired recorded in GCS .opl logs or in
+ *             on-board DebugLog dumps are run through the same identification
+ *             the AutoTune module runs in flight, and the PIDs for a set of
+ *             smooth/quick candidates are written to a CSV file per log.
+ *             Logs are processed in parallel, one process per log.
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <openpilot.h>
+#include <uavobjectsinit.h>
+#include <gyrostate.h>
+#include <actuatordesired.h>
+#include <flightstatus.h>
+#include <systemidentsettings.h>
+#include <systemidentstate.h>
+#include <sysident.h>
+#include <logreader.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Private constants
+#define MAX_JOBS       64
+#define MAX_CANDIDATES 16
+#define MAX_DT_S       0.010f  /* same limit as the AutoTune module */
+#define MAX_GAP_US     100000  /* longer pauses do not count towards the sample period */
+
+// Private types
+struct sample {
+    uint32_t time_us;
+    float    y[3];     /* GyroState */
+    float    u[3];     /* ActuatorDesired roll, pitch, yaw */
+    float    throttle; /* ActuatorDesired thrust */
+};
+
+struct candidate {
+    float damp;
+    float noise;
+};
+
+// Private variables
+static float minThrottle     = 0.05f;
+static bool autoTuneOnly    = false;
+static const char *outputDir = NULL;
+static struct candidate candidates[MAX_CANDIDATES];
+static uint32_t numCandidates = 0;
+
+// per log
+static struct sample *samples;
+static uint32_t numSamples;
+static uint32_t maxSamples;
+static uint32_t logTime_us;
+static bool usResolution;
+
+// Board globals the PIOS and UAVObject libraries refer to
+uint32_t pios_com_aux_id;
+uintptr_t pios_uavo_settings_fs_id;
+uintptr_t pios_user_fs_id;
+
+// Private functions
+static int32_t tuneLog(const char *path);
+static void objectUnpacked(uint32_t objId, uint32_t time_us);
+static float samplePeriod(void);
+static void getTuning(struct SysIdentTuning *tuning);
+static void usage(const char *name);
+
+int main(int argc, char *argv[])
+{
+    int jobs = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:j:mo:t:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            if (numCandidates >= MAX_CANDIDATES ||
+                sscanf(optarg, "%f,%f", &candidates[numCandidates].damp, &candidates[numCandidates].noise) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            numCandidates++;
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            if (jobs < 1 || jobs > MAX_JOBS) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'm':
+            autoTuneOnly = true;
+            break;
+        case 'o':
+            outputDir = optarg;
+            break;
+        case 't':
+            minThrottle = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // all object state is static, so every log gets a process of its own
+    int running = 0;
+    int failed  = 0;
+    for (int i = optind; i < argc || running > 0;) {
+        if (i < argc && running < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                exit(tuneLog(argv[i]) == 0 ? 0 : 1);
+            }
+            if (pid < 0) {
+                perror("fork");
+                failed++;
+            } else {
+                running++;
+            }
+            i++;
+            continue;
+        }
+        int status;
+        if (wait(&status) < 0) {
+            break;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
+
+/**
+ * Identify the system in one log file and compute the PIDs for all candidates
+ * \param[in] path log file, .opl files are read as GCS logs, anything else as DebugLog dump
+ * \return 0 on success or -1 on failure
+ */
+static int32_t tuneLog(const char *path)
+{
+    PIOS_CALLBACKSCHEDULER_Initialize();
+    EventDispatcherInitialize();
+    UAVObjInitialize();
+    UAVObjectsInitializeAll();
+    AlarmsInitialize();
+
+    // the identification starts from the SystemIdentState defaults, like the module does
+    SystemIdentStateData initial;
+    SystemIdentStateGet(&initial);
+
+    usResolution = !LogReaderIsOpl(path);
+    if (LogReaderRead(path, NULL, &objectUnpacked) < 0) {
+        return -1;
+    }
+    if (numSamples < 2) {
+        fprintf(stderr, "%s: no armed samples above %.2f thrust\n", path, (double)minThrottle);
+        return -1;
+    }
+
+    // GCS logs only have millisecond timestamps, the module's view of the gyro period is
+    // best matched by the average over the log there
+    const float period = samplePeriod();
+    struct SysIdent ident;
+    SysIdentInit(&ident, SystemIdentStateBetaToArray(initial.Beta), initial.Tau);
+    for (uint32_t i = 0; i < numSamples; i++) {
+        float dT_s = period;
+        if (usResolution && i > 0) {
+            dT_s = (samples[i].time_us - samples[i - 1].time_us) * 1.0e-6f;
+        }
+        if (dT_s > MAX_DT_S) {
+            dT_s = MAX_DT_S;
+        }
+        SysIdentSample(&ident, samples[i].u, samples[i].y, dT_s, samples[i].throttle);
+    }
+    free(samples);
+
+    // the settings in effect at the end of the log
+    struct SysIdentTuning tuning;
+    getTuning(&tuning);
+    if (numCandidates == 0) {
+        SysIdentSmoothToQuick(&tuning, -1.0f, -1.0f, 1.0f, &candidates[0].damp, &candidates[0].noise);
+        SysIdentSmoothToQuick(&tuning, -1.0f, 0.0f, 1.0f, &candidates[1].damp, &candidates[1].noise);
+        SysIdentSmoothToQuick(&tuning, -1.0f, 1.0f, 1.0f, &candidates[2].damp, &candidates[2].noise);
+        numCandidates = 3;
+    }
+
+    const float *beta  = &ident.X[SYSIDENT_X_BETA];
+    const float tau    = ident.X[SYSIDENT_X_TAU];
+    const uint8_t check = SysIdentCheck(beta, tau);
+    const float hover  = SysIdentHoverThrottle(&ident);
+
+    // output goes next to the log unless a directory is given
+    const char *base = strrchr(path, '/');
+    char outPath[1024];
+    if (outputDir) {
+        snprintf(outPath, sizeof(outPath), "%s/%s.autotune.csv", outputDir, base ? base + 1 : path);
+    } else {
+        snprintf(outPath, sizeof(outPath), "%s.autotune.csv", path);
+    }
+    FILE *output = fopen(outPath, "w");
+    if (!output) {
+        perror(outPath);
+        return -1;
+    }
+    fprintf(output, "Damp,Noise,BetaRoll,BetaPitch,BetaYaw,Tau,NoiseRoll,NoisePitch,NoiseYaw,HoverThrottle,Samples,Period,Check,"
+            "RollKp,RollKi,RollKd,PitchKp,PitchKi,PitchKd,YawKp,YawKi,YawKd,OuterKp,OuterKi\n");
+
+    struct SysIdentPids pids[MAX_CANDIDATES];
+    for (uint32_t c = 0; c < numCandidates; c++) {
+        memset(&pids[c], 0, sizeof(pids[c]));
+        SysIdentComputePids(&tuning, beta, tau, candidates[c].damp, candidates[c].noise, &pids[c]);
+        fprintf(output, "%g,%g,%f,%f,%f,%f,%f,%f,%f,%f,%u,%f,%u", (double)candidates[c].damp, (double)candidates[c].noise,
+                (double)beta[0], (double)beta[1], (double)beta[2], (double)tau,
+                (double)ident.noise[0], (double)ident.noise[1], (double)ident.noise[2],
+                (double)hover, ident.predicts, (double)period * 1000.0, check);
+        for (int i = 0; i < 3; i++) {
+            fprintf(output, ",%f,%f,%f", (double)pids[c].rate[i].Kp, (double)pids[c].rate[i].Ki, (double)pids[c].rate[i].Kd);
+        }
+        fprintf(output, ",%f,%f\n", (double)pids[c].outerKp, (double)pids[c].outerKi);
+    }
+    fclose(output);
+
+    printf("%s: %u samples, %.2fms, %.1fs of flight, beta %.2f %.2f %.2f, tau %.1fms, hover %.2f%s\n",
+           path, ident.predicts, (double)period * 1000.0, logTime_us * 1e-6,
+           (double)beta[0], (double)beta[1], (double)beta[2], (double)expf(tau) * 1000.0, (double)hover,
+           check ? ", failed sanity checks" : "");
+    for (uint32_t c = 0; c < numCandidates; c++) {
+        printf("  damp %3g noise %4g: roll %.5f %.5f %.6f  pitch %.5f %.5f %.6f  yaw %.5f %.5f %.6f\n",
+               (double)candidates[c].damp, (double)candidates[c].noise,
+               (double)pids[c].rate[0].Kp, (double)pids[c].rate[0].Ki, (double)pids[c].rate[0].Kd,
+               (double)pids[c].rate[1].Kp, (double)pids[c].rate[1].Ki, (double)pids[c].rate[1].Kd,
+               (double)pids[c].rate[2].Kp, (double)pids[c].rate[2].Ki, (double)pids[c].rate[2].Kd);
+    }
+
+    return 0;
+}
+
+/**
+ * Collect a sample for every gyro update while flying, with the latest actuator command,
+ * which is what the AutoTune module queues in flight
+ */
+static void objectUnpacked(uint32_t objId, uint32_t time_us)
+{
+    logTime_us = time_us;
+
+    // nothing listens, just keep the event queue empty
+    PIOS_CALLBACKSCHEDULER_RunPending();
+
+    if (objId != GYROSTATE_OBJID) {
+        return;
+    }
+
+    FlightStatusData flightStatus;
+    FlightStatusGet(&flightStatus);
+    if (flightStatus.Armed != FLIGHTSTATUS_ARMED_ARMED ||
+        (autoTuneOnly && flightStatus.FlightMode != FLIGHTSTATUS_FLIGHTMODE_AUTOTUNE)) {
+        return;
+    }
+
+    ActuatorDesiredData actuators;
+    ActuatorDesiredGet(&actuators);
+    if (actuators.Thrust < minThrottle) {
+        return;
+    }
+
+    if (numSamples >= maxSamples) {
+        maxSamples = maxSamples ? 2 * maxSamples : 4096;
+        samples    = realloc(samples, maxSamples * sizeof(samples[0]));
+        if (!samples) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    GyroStateData gyro;
+    GyroStateGet(&gyro);
+
+    struct sample *s = &samples[numSamples++];
+    s->time_us  = logTime_us;
+    s->y[0]     = gyro.x;
+    s->y[1]     = gyro.y;
+    s->y[2]     = gyro.z;
+    s->u[0]     = actuators.Roll;
+    s->u[1]     = actuators.Pitch;
+    s->u[2]     = actuators.Yaw;
+    s->throttle = actuators.Thrust;
+}
+
+/**
+ * Average time between samples, pauses in the flying (landed, disarmed) are left out
+ * \return sample period in seconds
+ */
+static float samplePeriod(void)
+{
+    uint64_t total     = 0;
+    uint32_t intervals = 0;
+
+    for (uint32_t i = 1; i < numSamples; i++) {
+        uint32_t interval = samples[i].time_us - samples[i - 1].time_us;
+        if (interval <= MAX_GAP_US) {
+            total += interval;
+            intervals++;
+        }
+    }
+    if (total == 0) {
+        return MAX_DT_S;
+    }
+    float period = (float)total / intervals * 1.0e-6f;
+    return period > MAX_DT_S ? MAX_DT_S : period;
+}
+
+/**
+ * The part of SystemIdentSettings the PID calculation depends on, as in the module
+ */
+static void getTuning(struct SysIdentTuning *tuning)
+{
+    SystemIdentSettingsData settings;
+
+    SystemIdentSettingsGet(&settings);
+    switch (settings.CalculateYaw) {
+    case SYSTEMIDENTSETTINGS_CALCULATEYAW_FALSE:
+        tuning->calculateYaw = SYSIDENT_YAW_NONE;
+        break;
+    case SYSTEMIDENTSETTINGS_CALCULATEYAW_TRUELIMITTORATIO:
+        tuning->calculateYaw = SYSIDENT_YAW_LIMITTORATIO;
+        break;
+    case SYSTEMIDENTSETTINGS_CALCULATEYAW_TRUEIGNORELIMIT:
+    default:
+        tuning->calculateYaw = SYSIDENT_YAW_IGNORELIMIT;
+        break;
+    }
+    tuning->yawToRollPitchPIDRatioMin = settings.YawToRollPitchPIDRatioMin;
+    tuning->yawToRollPitchPIDRatioMax = settings.YawToRollPitchPIDRatioMax;
+    tuning->dampMin   = settings.DampMin;
+    tuning->dampRate  = settings.DampRate;
+    tuning->dampMax   = settings.DampMax;
+    tuning->noiseMin  = settings.NoiseMin;
+    tuning->noiseRate = settings.NoiseRate;
+    tuning->noiseMax  = settings.NoiseMax;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-d damp,noise]... [-t minthrust] [-m] [-j jobs] [-o outdir] log...\n", name);
+    fprintf(stderr, "  .opl files are read as GCS logs, everything else as DebugLog dump\n");
+    fprintf(stderr, "  -d  PID candidate, default the smoothest, default and quickest of SystemIdentSettings\n");
+    fprintf(stderr, "  -t  ignore samples below this ActuatorDesired thrust, default 0.05\n");
+    fprintf(stderr, "  -m  only use samples flown in the AutoTune flight mode\n");
+    fprintf(stderr, "  writes <log>.autotune.csv with the identified system and the PIDs of each candidate\n");
+}
+
+/**
+ * Called by the RTOS when a stack overflow is detected, no tasks run here.
+ */
+void vApplicationStackOverflowHook(__attribute__((unused)) xTaskHandle *pxTask,
+                                   __attribute__((unused)) signed portCHAR *pcTaskName)
+{}
+
+/**
+ * There is no settings storage, the defaults plus the settings in the log are all that is used
+ * \return -1, nothing is ever found or stored
+ */
+int32_t PIOS_FLASHFS_ObjLoad(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                             __attribute__((unused)) uint16_t obj_inst_id, __attribute__((unused)) uint8_t *obj_data,
+                             __attribute__((unused)) uint16_t obj_size)
+{
+    return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjSave(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                             __attribute__((unused)) uint16_t obj_inst_id, __attribute__((unused)) uint8_t *obj_data,
+                             __attribute__((unused)) uint16_t obj_size)
+{
+    return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjDelete(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                               __attribute__((unused)) uint16_t obj_inst_id)
+{
+    return -1;
+}
@@ -73,3 +73,14 @@ const struct pios_udp_cfg pios_udp_aux_cfg = {
 #if defined(PIOS_INCLUDE_FLASH)
 #include "pios_flashfs_logfs_priv.h"
 #endif
+
+#if defined(PIOS_INCLUDE_SIM_IMU)
+/*
+ * Simulated IMU, hands blocks of samples to the sensors task at PIOS_SENSOR_RATE
+ */
+static const struct pios_sim_imu_cfg pios_sim_imu_cfg = {
+    .rate        = PIOS_SIM_IMU_RATE,
+    .ring_length = 256,
+    .watermark   = (uint16_t)(PIOS_SIM_IMU_RATE / PIOS_SENSOR_RATE),
+};
+#endif /* PIOS_INCLUDE_SIM_IMU */
@@ -61,6 +61,9 @@
 #define PIOS_INCLUDE_WDG
 #define PIOS_INCLUDE_UDP
 
+/* CRC engines */
+#define PIOS_CRC_SLICE_BY_8
+
 /* Select the sensors to include */
 // #define PIOS_INCLUDE_BMA180
 // #define PIOS_INCLUDE_HMC5X83
@@ -107,6 +110,7 @@
 /* Flags that alter behaviors - mostly to lower resources for CC */
 #define PIOS_INCLUDE_INITCALL          /* Include init call structures */
 #define PIOS_TELEM_PRIORITY_QUEUE      /* Enable a priority queue in telemetry */
+#define PIOS_TELEM_DELTA_ENCODING      /* Delta encode packed telemetry updates */
 #define PIOS_QUATERNION_STABILIZATION  /* Stabilization options */
 // #define PIOS_GPS_SETS_HOMELOCATION      /* GPS options */
 
@@ -208,6 +208,12 @@ void PIOS_Board_Init(void)
     default:
         break;
     } /* hwsettings_rv_auxport */
+
+#if defined(PIOS_INCLUDE_SIM_IMU)
+    if (PIOS_SIM_IMU_Init(&pios_sim_imu_cfg)) {
+        PIOS_Assert(0);
+    }
+#endif
 }
 
 /**
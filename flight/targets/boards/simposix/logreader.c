@@ -0,0 +1,246 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logreader.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Log reader of the offline simposix tools, unpacks the objects of
+ *             GCS .opl logs and on-board DebugLog dumps in logged order
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <openpilot.h>
+#include <debuglogentry.h>
+#include "logreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Private constants
+#define LOG_ENTRY_MAX_DATA_SIZE (sizeof(((DebugLogEntryData *)0)->Data))
+#define LOG_ENTRY_HEADER_SIZE   (sizeof(DebugLogEntryData) - LOG_ENTRY_MAX_DATA_SIZE)
+// GCS log header and keyframe index, see Utils::LogFile
+#define OPL_MAGIC               "LPLOG\0\0"
+#define OPL_INDEX_MAGIC         "LPLOGIDX"
+#define OPL_HEADER_SIZE         24
+#define OPL_TRAILER_SIZE        24
+
+// Private variables
+static LogReaderSkipCallback skipCb;
+static LogReaderUnpackedCallback unpackedCb;
+
+// Private functions
+static int32_t readOpl(const uint8_t *data, size_t size);
+static size_t oplRecords(const uint8_t *data, size_t *size);
+static int32_t readDebugLog(const uint8_t *data, size_t size);
+static void readObject(uint32_t objId, uint16_t instId, uint16_t size, const uint8_t *data, uint32_t time_us);
+static int32_t discardOutput(uint8_t *data, int32_t length);
+
+/**
+ * Tell the log formats apart
+ * \param[in] path log file
+ * \return true for GCS logs, false for DebugLog dumps
+ */
+bool LogReaderIsOpl(const char *path)
+{
+    const char *ext = strrchr(path, '.');
+
+    return ext && !strcmp(ext, ".opl");
+}
+
+/**
+ * Unpack all objects of a log in the order they were logged
+ * \param[in] path log file, .opl files are read as GCS logs, anything else as DebugLog dump
+ * \param[in] skip objects to leave out, NULL to unpack all
+ * \param[in] unpacked called after every object
+ * \return 0 on success or -1 on failure
+ */
+int32_t LogReaderRead(const char *path, LogReaderSkipCallback skip, LogReaderUnpackedCallback unpacked)
+{
+    FILE *in = fopen(path, "rb");
+
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+    fseek(in, 0, SEEK_END);
+    size_t size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    uint8_t *data = malloc(size);
+    if (!data || fread(data, 1, size, in) != size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        fclose(in);
+        free(data);
+        return -1;
+    }
+    fclose(in);
+
+    skipCb     = skip;
+    unpackedCb = unpacked;
+
+    int32_t ret;
+    if (LogReaderIsOpl(path)) {
+        ret = readOpl(data, size);
+    } else {
+        ret = readDebugLog(data, size);
+    }
+    free(data);
+
+    return ret;
+}
+
+/**
+ * Read a GCS log, records of [uint32 timestamp ms][int64 size][UAVTalk stream]
+ * after the header if there is one
+ * \return 0 on success or -1 on failure
+ */
+static int32_t readOpl(const uint8_t *data, size_t size)
+{
+    UAVTalkConnection connection = UAVTalkInitialize(&discardOutput);
+    size_t offset = oplRecords(data, &size);
+
+    if (!connection) {
+        return -1;
+    }
+
+    while (offset + sizeof(uint32_t) + sizeof(int64_t) <= size) {
+        uint32_t timestamp;
+        int64_t length;
+
+        memcpy(&timestamp, &data[offset], sizeof(timestamp));
+        memcpy(&length, &data[offset + sizeof(timestamp)], sizeof(length));
+        offset += sizeof(timestamp) + sizeof(length);
+        bool keyframe = length < 0;
+        if (keyframe) {
+            length = -length;
+        }
+        if ((uint64_t)length > size - offset) {
+            fprintf(stderr, "corrupt log record at offset %u\n", (unsigned)offset);
+            return -1;
+        }
+        if (keyframe) {
+            // the last update of every object again, only there for seeking
+            offset += length;
+            continue;
+        }
+
+        // the parser takes at most 255 bytes at a time
+        size_t end = offset + length;
+        while (offset < end) {
+            uint8_t chunk    = (end - offset) > 255 ? 255 : (end - offset);
+            uint8_t position = 0;
+            while (position < chunk) {
+                if (UAVTalkProcessInputStreamQuiet(connection, (uint8_t *)&data[offset], chunk, &position) != UAVTALK_STATE_COMPLETE) {
+                    continue;
+                }
+                uint32_t objId = UAVTalkGetPacketObjId(connection);
+                if (!skipCb || !skipCb(objId)) {
+                    UAVTalkReceiveObject(connection);
+                    unpackedCb(objId, timestamp * 1000);
+                }
+            }
+            offset += chunk;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Find the records of a GCS log, skipping the header with the object
+ * definitions and the keyframe index written after them by newer GCS
+ * \param[in,out] size of the log, reduced to the end of the records
+ * \return offset of the first record
+ */
+static size_t oplRecords(const uint8_t *data, size_t *size)
+{
+    uint32_t headerSize;
+    int64_t indexOffset;
+
+    if (*size < OPL_HEADER_SIZE || memcmp(data, OPL_MAGIC, 8)) {
+        return 0;
+    }
+    memcpy(&headerSize, &data[12], sizeof(headerSize));
+    if (headerSize > *size) {
+        return *size;
+    }
+    if (*size >= headerSize + OPL_TRAILER_SIZE && !memcmp(&data[*size - 8], OPL_INDEX_MAGIC, 8)) {
+        memcpy(&indexOffset, &data[*size - 16], sizeof(indexOffset));
+        if (indexOffset >= headerSize && (uint64_t)indexOffset <= *size) {
+            *size = indexOffset;
+        }
+    }
+    return headerSize;
+}
+
+/**
+ * Read a DebugLog dump, a sequence of DebugLogEntry records as stored in flash
+ * \return 0 on success or -1 on failure
+ */
+static int32_t readDebugLog(const uint8_t *data, size_t size)
+{
+    DebugLogEntryData entry;
+
+    for (size_t offset = 0; offset + sizeof(entry) <= size; offset += sizeof(entry)) {
+        memcpy(&entry, &data[offset], sizeof(entry));
+        if (entry.Type != DEBUGLOGENTRY_TYPE_UAVOBJECT && entry.Type != DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS) {
+            continue;
+        }
+
+        // the first object is in the record itself, further ones are packed behind it
+        readObject(entry.ObjectID, entry.InstanceID, entry.Size, entry.Data, entry.FlightTime);
+
+        uint32_t start = entry.Size;
+        while (entry.Type == DEBUGLOGENTRY_TYPE_MULTIPLEUAVOBJECTS && start + LOG_ENTRY_HEADER_SIZE + 1 < LOG_ENTRY_MAX_DATA_SIZE) {
+            // sub entries are laid out as DebugLogEntryData, the header is copied out of the block
+            DebugLogEntryData sub;
+            memcpy(&sub, &entry.Data[start], offsetof(DebugLogEntryData, Data));
+            // unused space is 0xff filled, so this also ends on the first empty slot
+            if (sub.Type != DEBUGLOGENTRY_TYPE_UAVOBJECT || start + LOG_ENTRY_HEADER_SIZE + sub.Size > LOG_ENTRY_MAX_DATA_SIZE) {
+                break;
+            }
+            readObject(sub.ObjectID, sub.InstanceID, sub.Size, &entry.Data[start + offsetof(DebugLogEntryData, Data)], sub.FlightTime);
+            start += LOG_ENTRY_HEADER_SIZE + sub.Size;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Unpack one logged object, objects unknown to this build or of a different size are skipped
+ */
+static void readObject(uint32_t objId, uint16_t instId, uint16_t size, const uint8_t *data, uint32_t time_us)
+{
+    UAVObjHandle obj = UAVObjGetByID(objId);
+
+    if (!obj || UAVObjGetNumBytes(obj) != size || (skipCb && skipCb(objId))) {
+        return;
+    }
+    UAVObjUnpack(obj, instId, data);
+    unpackedCb(objId, time_us);
+}
+
+/**
+ * UAVTalk output stream, acks and requests of the log connection go nowhere
+ */
+static int32_t discardOutput(__attribute__((unused)) uint8_t *data, int32_t length)
+{
+    return length;
+}
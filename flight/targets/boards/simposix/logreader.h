@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logreader.h
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Log reader of the offline simposix tools, unpacks the objects of
+ *             GCS .opl logs and on-board DebugLog dumps in logged order
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+/**
+ * Called after every unpacked object with the time it was logged at
+ */
+typedef void (*LogReaderUnpackedCallback)(uint32_t objId, uint32_t time_us);
+
+/**
+ * Objects it returns true for are left out instead of being unpacked
+ */
+typedef bool (*LogReaderSkipCallback)(uint32_t objId);
+
+bool LogReaderIsOpl(const char *path);
+int32_t LogReaderRead(const char *path, LogReaderSkipCallback skip, LogReaderUnpackedCallback unpacked);
+
+#endif /* LOGREADER_H */
@@ -0,0 +1,344 @@
+/**
+ ******************************************************************************
+ *
+ * @file       replay.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      Offline replay of flight logs through the state estimation.
+ *             Sensor objects recorded in GCS .opl logs or in on-board
+ *             DebugLog dumps are fed into the StateEstimation module as fast
+ *             as the host allows, the resulting AttitudeState, PositionState
+ *             and VelocityState series are written to a CSV file per log.
+ *             Logs are replayed in parallel, one process per log.
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <openpilot.h>
+#include <uavobjectsinit.h>
+#include <revosettings.h>
+#include <gyrosensor.h>
+#include <attitudestate.h>
+#include <positionstate.h>
+#include <velocitystate.h>
+#include <logreader.h>
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Private constants
+#define OUTPUT_QUEUE_SIZE 32
+#define MAX_JOBS          64
+
+// Private types
+struct replayStats {
+    uint32_t samples;
+    uint32_t rows;
+    uint64_t cycles;
+};
+
+// Private variables
+static const struct {
+    const char *name;
+    RevoSettingsFusionAlgorithmOptions algorithm;
+} algorithms[] = {
+    { "none",   REVOSETTINGS_FUSIONALGORITHM_NONE                       },
+    { "cf",     REVOSETTINGS_FUSIONALGORITHM_BASICCOMPLEMENTARY         },
+    { "cfmi",   REVOSETTINGS_FUSIONALGORITHM_COMPLEMENTARYMAG           },
+    { "cfm",    REVOSETTINGS_FUSIONALGORITHM_COMPLEMENTARYMAGGPSOUTDOOR },
+    { "ekf13i", REVOSETTINGS_FUSIONALGORITHM_INS13INDOOR                },
+    { "ekf13",  REVOSETTINGS_FUSIONALGORITHM_GPSNAVIGATIONINS13         },
+};
+
+static bool forceAlgorithm = false;
+static RevoSettingsFusionAlgorithmOptions forcedAlgorithm;
+static const char *outputDir = NULL;
+static xQueueHandle outputQueue;
+static FILE *output;
+static struct replayStats stats;
+
+// Board globals the PIOS and UAVObject libraries refer to
+uint32_t pios_com_aux_id;
+uintptr_t pios_uavo_settings_fs_id;
+uintptr_t pios_user_fs_id;
+
+// Module entry points, called by the generated InitMods.c on simposix
+extern int32_t StateEstimationInitialize(void);
+extern int32_t StateEstimationStart(void);
+
+// Private functions
+static int32_t replayLog(const char *path);
+static bool isEstimatorOutput(uint32_t objId);
+static void replayUnpacked(uint32_t objId, uint32_t time_us);
+static void writeRow(void);
+static uint64_t cycles(void);
+static void usage(const char *name);
+
+int main(int argc, char *argv[])
+{
+    int jobs = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "a:j:o:h")) != -1) {
+        switch (opt) {
+        case 'a':
+            for (uint32_t i = 0; i < NELEMENTS(algorithms); i++) {
+                if (!strcmp(optarg, algorithms[i].name)) {
+                    forcedAlgorithm = algorithms[i].algorithm;
+                    forceAlgorithm  = true;
+                }
+            }
+            if (!forceAlgorithm) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'j':
+            jobs = atoi(optarg);
+            if (jobs < 1 || jobs > MAX_JOBS) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            outputDir = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // all module and object state is static, so every log gets a process of its own
+    int running = 0;
+    int failed  = 0;
+    for (int i = optind; i < argc || running > 0;) {
+        if (i < argc && running < jobs) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                exit(replayLog(argv[i]) == 0 ? 0 : 1);
+            }
+            if (pid < 0) {
+                perror("fork");
+                failed++;
+            } else {
+                running++;
+            }
+            i++;
+            continue;
+        }
+        int status;
+        if (wait(&status) < 0) {
+            break;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
+
+/**
+ * Replay one log file in a freshly initialised system
+ * \param[in] path log file, .opl files are read as GCS logs, anything else as DebugLog dump
+ * \return 0 on success or -1 on failure
+ */
+static int32_t replayLog(const char *path)
+{
+    // output goes next to the log unless a directory is given
+    const char *base = strrchr(path, '/');
+    char outPath[1024];
+    if (outputDir) {
+        snprintf(outPath, sizeof(outPath), "%s/%s.csv", outputDir, base ? base + 1 : path);
+    } else {
+        snprintf(outPath, sizeof(outPath), "%s.csv", path);
+    }
+    output = fopen(outPath, "w");
+    if (!output) {
+        perror(outPath);
+        return -1;
+    }
+    fprintf(output, "time_us,q1,q2,q3,q4,Roll,Pitch,Yaw,North,East,Down,vNorth,vEast,vDown\n");
+
+    // bring up the same libraries the simposix firmware runs, but without starting the scheduler
+    PIOS_DELAY_Init();
+    PIOS_CALLBACKSCHEDULER_Initialize();
+    EventDispatcherInitialize();
+    UAVObjInitialize();
+    UAVObjectsInitializeAll();
+    AlarmsInitialize();
+    StateEstimationInitialize();
+    if (forceAlgorithm) {
+        RevoSettingsFusionAlgorithmSet(&forcedAlgorithm);
+    }
+    StateEstimationStart();
+
+    outputQueue = xQueueCreate(OUTPUT_QUEUE_SIZE, sizeof(UAVObjEvent));
+    // unpacked objects do not show up here, only what the estimator writes
+    UAVObjConnectQueue(AttitudeStateHandle(), outputQueue, EV_UPDATED);
+    UAVObjConnectQueue(GyroSensorHandle(), outputQueue, EV_UNPACKED);
+
+    memset(&stats, 0, sizeof(stats));
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int32_t ret = LogReaderRead(path, &isEstimatorOutput, &replayUnpacked);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    double logTime = PIOS_DELAY_GetuS() * 1e-6;
+
+    fclose(output);
+
+    printf("%s: %u samples, %u rows, %.0f cycles/sample, %.1fs log in %.2fs (%.0fx)\n",
+           path, stats.samples, stats.rows,
+           stats.samples ? (double)stats.cycles / stats.samples : 0.0,
+           logTime, wall, wall > 0.0 ? logTime / wall : 0.0);
+
+    return ret;
+}
+
+/**
+ * Recorded states are skipped, so the output never mixes logged and replayed values
+ * when the chain under test does not produce all of them
+ */
+static bool isEstimatorOutput(uint32_t objId)
+{
+    return objId == ATTITUDESTATE_OBJID || objId == POSITIONSTATE_OBJID || objId == VELOCITYSTATE_OBJID;
+}
+
+/**
+ * Let the estimator process whatever was just unpacked and collect its output
+ */
+static void replayUnpacked(__attribute__((unused)) uint32_t objId, uint32_t time_us)
+{
+    UAVObjEvent ev;
+
+    ReplayDelaySet(time_us);
+
+    if (forceAlgorithm) {
+        RevoSettingsFusionAlgorithmOptions algorithm;
+        RevoSettingsFusionAlgorithmGet(&algorithm);
+        if (algorithm != forcedAlgorithm) {
+            // a logged RevoSettings must not switch the chain under test
+            RevoSettingsFusionAlgorithmSet(&forcedAlgorithm);
+        }
+    }
+
+    uint64_t start = cycles();
+    PIOS_CALLBACKSCHEDULER_RunPending();
+    stats.cycles += cycles() - start;
+
+    while (xQueueReceive(outputQueue, &ev, 0) == pdTRUE) {
+        if (ev.obj == GyroSensorHandle()) {
+            stats.samples++;
+        } else if (ev.obj == AttitudeStateHandle()) {
+            writeRow();
+        }
+    }
+}
+
+/**
+ * Write the current state, position and velocity are the latest ones at the time of the attitude update
+ */
+static void writeRow(void)
+{
+    AttitudeStateData attitude;
+    PositionStateData position;
+    VelocityStateData velocity;
+
+    AttitudeStateGet(&attitude);
+    PositionStateGet(&position);
+    VelocityStateGet(&velocity);
+
+    fprintf(output, "%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", PIOS_DELAY_GetuS(),
+            (double)attitude.q1, (double)attitude.q2, (double)attitude.q3, (double)attitude.q4,
+            (double)attitude.Roll, (double)attitude.Pitch, (double)attitude.Yaw,
+            (double)position.North, (double)position.East, (double)position.Down,
+            (double)velocity.North, (double)velocity.East, (double)velocity.Down);
+    stats.rows++;
+}
+
+/**
+ * Cycle counter where the host has one, nanoseconds otherwise
+ */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+#endif
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-a none|cf|cfmi|cfm|ekf13i|ekf13] [-j jobs] [-o outdir] log...\n", name);
+    fprintf(stderr, "  .opl files are read as GCS logs, everything else as DebugLog dump\n");
+    fprintf(stderr, "  writes <log>.csv with the AttitudeState, PositionState and VelocityState series\n");
+}
+
+/**
+ * Called by the RTOS when a stack overflow is detected, no tasks run in the replay.
+ */
+void vApplicationStackOverflowHook(__attribute__((unused)) xTaskHandle *pxTask,
+                                   __attribute__((unused)) signed portCHAR *pcTaskName)
+{}
+
+/**
+ * There is no settings storage in the replay, the defaults plus the settings in the
+ * log are all that is used, so results do not depend on leftovers of a simulator run
+ * \return -1, nothing is ever found or stored
+ */
+int32_t PIOS_FLASHFS_ObjLoad(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                             __attribute__((unused)) uint16_t obj_inst_id, __attribute__((unused)) uint8_t *obj_data,
+                             __attribute__((unused)) uint16_t obj_size)
+{
+    return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjSave(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                             __attribute__((unused)) uint16_t obj_inst_id, __attribute__((unused)) uint8_t *obj_data,
+                             __attribute__((unused)) uint16_t obj_size)
+{
+    return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjDelete(__attribute__((unused)) uintptr_t fs_id, __attribute__((unused)) uint32_t obj_id,
+                               __attribute__((unused)) uint16_t obj_inst_id)
+{
+    return -1;
+}
@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ *
+ * @file       replay_delay.c
+ * @author     The LibrePilot Project, http://www.librepilot.org Copyright (C) 2016.
+ * @brief      PIOS_DELAY functions on the virtual clock of the log replay
+ *                 - time only advances when the replay moves on to the next
+ *                   log record, so filters see log time instead of host time
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <openpilot.h>
+#include "replay.h"
+
+#define US_PER_TICK (1000000 / configTICK_RATE_HZ)
+
+static uint32_t now_us;
+static uint32_t tick_us;
+static TickType_t ticks;
+
+/**
+ * Move the virtual clock forward, the FreeRTOS tick count follows it.
+ * The clock never goes backwards, out of order timestamps are ignored.
+ * \param[in] us new time in microseconds
+ */
+void ReplayDelaySet(uint32_t us)
+{
+    if ((int32_t)(us - now_us) <= 0) {
+        return;
+    }
+    now_us = us;
+
+    while ((int32_t)(now_us - tick_us) >= US_PER_TICK) {
+        tick_us += US_PER_TICK;
+        ticks++;
+    }
+}
+
+/**
+ * Tick count on the virtual clock. The scheduler never runs in the replay, so the
+ * kernel tick cannot be used, the Makefile links all callers here with --wrap.
+ * \return ticks since the start of the log
+ */
+TickType_t __wrap_xTaskGetTickCount(void)
+{
+    return ticks;
+}
+
+/**
+ * Initialises the virtual clock
+ * \return < 0 if initialisation failed
+ */
+int32_t PIOS_DELAY_Init(void)
+{
+    now_us  = 0;
+    tick_us = 0;
+    ticks   = 0;
+
+    return 0;
+}
+
+/**
+ * Waits for a specific number of uS, advances the virtual clock
+ * \param[in] uS delay
+ * \return < 0 on errors
+ */
+int32_t PIOS_DELAY_WaituS(uint32_t uS)
+{
+    ReplayDelaySet(now_us + uS);
+
+    return 0;
+}
+
+/**
+ * Waits for a specific number of mS, advances the virtual clock
+ * \param[in] mS delay
+ * \return < 0 on errors
+ */
+int32_t PIOS_DELAY_WaitmS(uint32_t mS)
+{
+    ReplayDelaySet(now_us + mS * 1000);
+
+    return 0;
+}
+
+/**
+ * @brief Query the virtual clock for the current uS
+ * @return A microsecond value
+ */
+uint32_t PIOS_DELAY_GetuS()
+{
+    return now_us;
+}
+
+/**
+ * @brief Calculate time in microseconds since a previous time
+ * @param[in] t previous time
+ * @return time in us since previous time t.
+ */
+uint32_t PIOS_DELAY_GetuSSince(uint32_t t)
+{
+    return now_us - t;
+}
+
+/**
+ * @brief Get the raw delay timer, useful for timing
+ * @return Unitless value (uint32 wrap around)
+ */
+uint32_t PIOS_DELAY_GetRaw()
+{
+    return now_us;
+}
+
+/**
+ * @brief Compare to raw times to and convert to us
+ * @return A microsecond value
+ */
+uint32_t PIOS_DELAY_DiffuS(uint32_t raw)
+{
+    return now_us - raw;
+}
+
+/**
+ * @brief Subtract two raw times and convert to us.
+ * @return Interval between raw times in microseconds
+ */
+uint32_t PIOS_DELAY_DiffuS2(uint32_t raw, uint32_t later)
+{
+    return later - raw;
+}
@@ -185,7 +185,7 @@ extern uint32_t pios_packet_handler;
 // ------------------------
 // TELEMETRY
 // ------------------------
-#define TELEM_QUEUE_SIZE        80
+#define TELEM_QUEUE_SIZE        50
 #define PIOS_TELEM_STACK_SIZE   800
 
 // -------------------------
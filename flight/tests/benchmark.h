@@ -0,0 +1,40 @@
+/*
+ * Timing helpers for the DISABLED_Benchmark* tests, which only the
+ * bench_<test> targets run. Benchmarks print what they measure, they
+ * never pass or fail on it.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <stdint.h>
+#include <stdio.h> /* printf */
+#include <time.h> /* clock_gettime */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> /* __rdtsc */
+#endif
+
+/* Cycle counter where the host has one, nanoseconds otherwise */
+static inline uint64_t bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+
+#endif
+}
+
+static inline double bench_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#endif /* BENCHMARK_H */
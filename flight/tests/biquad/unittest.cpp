@@ -0,0 +1,355 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <math.h> /* sinf */
+
+extern "C" {
+#include <stdint.h>
+#include "biquad.h"
+}
+
+#define SAMPLE_RATE   8000.0f
+#define OUTPUT_RATE   500.0f
+#define DECIMATION    16
+#define CUTOFF        100.0f
+#define STAGES        2
+#define BENCH_SAMPLES 200000
+
+// To use a test fixture, derive a class from testing::Test.
+class BiquadTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        memset(&cascade, 0, sizeof(cascade));
+    }
+
+    virtual void TearDown()
+    {}
+
+    // Butterworth low pass on all axes, the way the Sensors module sets it up
+    void lowPass(float fc, uint8_t stages)
+    {
+        struct BiquadCoefficients coeffs;
+
+        for (uint8_t stage = 0; stage < stages; stage++) {
+            BiquadLowPass(fc, SAMPLE_RATE, BiquadButterworthQ(stages, stage), &coeffs);
+            for (uint8_t axis = 0; axis < 3; axis++) {
+                Biquad3SetStage(&cascade, stage, axis, &coeffs);
+            }
+            gain[stage] = coeffs;
+        }
+        cascade.stages = stages;
+    }
+
+    float expectedGain(float f)
+    {
+        float g = 1.0f;
+
+        for (uint8_t stage = 0; stage < cascade.stages; stage++) {
+            g *= BiquadGain(&gain[stage], f, SAMPLE_RATE);
+        }
+        return g;
+    }
+
+    // Amplitude of the filter output for a sine input, once the filter settled
+    void measureGain(float f, float out[3])
+    {
+        float samples[3];
+
+        out[0] = out[1] = out[2] = 0.0f;
+        for (int n = 0; n < 2 * (int)SAMPLE_RATE; n++) {
+            samples[0] = samples[1] = samples[2] = sinf(2.0f * (float)M_PI * f * (float)n / SAMPLE_RATE);
+            Biquad3Filter(&cascade, samples, 1);
+            if (n >= (int)SAMPLE_RATE) {
+                for (int i = 0; i < 3; i++) {
+                    out[i] = fmaxf(out[i], fabsf(samples[i]));
+                }
+            }
+        }
+    }
+
+    struct Biquad3Cascade cascade;
+    struct BiquadCoefficients gain[BIQUAD_MAX_STAGES];
+};
+
+TEST_F(BiquadTest, ButterworthQ) {
+    EXPECT_NEAR(BiquadButterworthQ(1, 0), 0.70711f, 1e-4f);
+    EXPECT_NEAR(BiquadButterworthQ(2, 0), 0.54120f, 1e-4f);
+    EXPECT_NEAR(BiquadButterworthQ(2, 1), 1.30656f, 1e-4f);
+}
+
+TEST_F(BiquadTest, LowPassResponse) {
+    const float frequencies[] = { 10.0f, 50.0f, CUTOFF, 200.0f, 400.0f, 1000.0f };
+    float out[3];
+
+    lowPass(CUTOFF, STAGES);
+    EXPECT_NEAR(expectedGain(0.0f), 1.0f, 1e-4f);
+    EXPECT_NEAR(expectedGain(CUTOFF), M_SQRT1_2, 0.005f);
+
+    for (uint32_t i = 0; i < sizeof(frequencies) / sizeof(frequencies[0]); i++) {
+        float f = frequencies[i];
+        memset(&cascade.stage, 0, sizeof(cascade.stage));
+        lowPass(CUTOFF, STAGES);
+        measureGain(f, out);
+
+        // analogue 4th order Butterworth, the bilinear transform warps a little towards fs / 2
+        float analogue = 1.0f / sqrtf(1.0f + powf(f / CUTOFF, 2 * 2 * STAGES));
+        EXPECT_NEAR(out[0], expectedGain(f), 0.01f * expectedGain(f) + 1e-4f) << f << " Hz";
+        EXPECT_NEAR(out[0], analogue, 0.02f) << f << " Hz";
+        EXPECT_EQ(out[0], out[1]);
+        EXPECT_EQ(out[0], out[2]);
+    }
+}
+
+TEST_F(BiquadTest, NotchOnOneAxis) {
+    struct BiquadCoefficients notch, pass = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    float out[3];
+
+    BiquadNotch(200.0f, SAMPLE_RATE, 2.0f, &notch);
+    Biquad3SetStage(&cascade, 0, 0, &notch);
+    Biquad3SetStage(&cascade, 0, 1, &pass);
+    Biquad3SetStage(&cascade, 0, 2, &pass);
+    cascade.stages = 1;
+
+    measureGain(200.0f, out);
+    EXPECT_LT(out[0], 0.01f);
+    EXPECT_NEAR(out[1], 1.0f, 1e-3f);
+    EXPECT_NEAR(out[2], 1.0f, 1e-3f);
+
+    // -3dB bandwidth is f0 / Q, the edges lie geometrically around f0
+    float lower = sqrtf(50.0f * 50.0f + 200.0f * 200.0f) - 50.0f;
+    EXPECT_NEAR(BiquadGain(&notch, lower, SAMPLE_RATE), M_SQRT1_2, 0.01f);
+    EXPECT_NEAR(BiquadGain(&notch, lower + 100.0f, SAMPLE_RATE), M_SQRT1_2, 0.01f);
+    measureGain(20.0f, out);
+    EXPECT_GT(out[0], 0.99f);
+    measureGain(2000.0f, out);
+    EXPECT_GT(out[0], 0.98f);
+}
+
+TEST_F(BiquadTest, ResetToSteadyState) {
+    const float x0[3] = { -4096.0f, 12.5f, 300.0f };
+    float samples[3];
+
+    lowPass(CUTOFF, 4);
+    Biquad3Reset(&cascade, x0);
+    for (int n = 0; n < 100; n++) {
+        memcpy(samples, x0, sizeof(samples));
+        Biquad3Filter(&cascade, samples, 1);
+        for (int i = 0; i < 3; i++) {
+            EXPECT_NEAR(samples[i], x0[i], 1e-3f * fabsf(x0[i])) << "sample " << n << " axis " << i;
+        }
+    }
+}
+
+TEST_F(BiquadTest, BlocksMatchSingleSamples) {
+    struct Biquad3Cascade single;
+    float block[64][3];
+    float samples[3];
+
+    lowPass(CUTOFF, STAGES);
+    single = cascade;
+    for (int n = 0; n < 64; n++) {
+        block[n][0] = sinf(0.3f * n);
+        block[n][1] = cosf(0.1f * n);
+        block[n][2] = (float)(n & 7);
+    }
+    Biquad3Filter(&cascade, &block[0][0], 64);
+    for (int n = 0; n < 64; n++) {
+        samples[0] = sinf(0.3f * n);
+        samples[1] = cosf(0.1f * n);
+        samples[2] = (float)(n & 7);
+        Biquad3Filter(&single, samples, 1);
+        for (int i = 0; i < 3; i++) {
+            EXPECT_FLOAT_EQ(samples[i], block[n][i]);
+        }
+    }
+}
+
+// Motor vibration above the output Nyquist frequency, decimated from 8kHz to 500Hz.
+// The average of 16 samples lets it through as a low frequency signal, the filter does not.
+TEST_F(BiquadTest, AliasRejection) {
+    const float vibration = 760.0f; // aliases to 240Hz
+    const float amplitude = 1000.0f;
+    float filtered = 0.0f, averaged = 0.0f;
+
+    lowPass(CUTOFF, STAGES);
+    int n = 0;
+    for (int k = 0; k < (int)OUTPUT_RATE; k++) {
+        int32_t accum = 0;
+        float samples[DECIMATION][3];
+        for (int i = 0; i < DECIMATION; i++, n++) {
+            int16_t raw = (int16_t)(amplitude * sinf(2.0f * (float)M_PI * vibration * (float)n / SAMPLE_RATE));
+            accum += raw;
+            samples[i][0] = samples[i][1] = samples[i][2] = (float)raw;
+        }
+        Biquad3Filter(&cascade, &samples[0][0], DECIMATION);
+        if (k >= (int)OUTPUT_RATE / 2) {
+            averaged = fmaxf(averaged, fabsf((float)accum / DECIMATION));
+            filtered = fmaxf(filtered, fabsf(samples[DECIMATION - 1][0]));
+        }
+    }
+    EXPECT_GT(averaged, 0.1f * amplitude);
+    EXPECT_LT(filtered, 0.002f * amplitude);
+}
+
+// Motor vibration on top of large, slow flight motion and some noise
+static float vibration(float f, int n, int axis)
+{
+    const float t = (float)n / SAMPLE_RATE;
+
+    return 50.0f * sinf(2.0f * (float)M_PI * f * t + axis) +
+           2000.0f * sinf(2.0f * (float)M_PI * 2.0f * t) +
+           10.0f * (float)((n * 7919 + axis * 104729) % 201 - 100) / 100.0f;
+}
+
+TEST_F(BiquadTest, PeakTrackerFindsVibration) {
+    struct Biquad3PeakTracker tracker;
+    const float f0[3]    = { 100.0f, 200.0f, 350.0f };
+    const float tones[3] = { 120.0f, 230.0f, 310.0f };
+    float samples[3];
+
+    Biquad3PeakTrackerInit(&tracker, 80.0f, 400.0f, SAMPLE_RATE, f0);
+    for (int n = 0; n < (int)SAMPLE_RATE; n++) {
+        for (int i = 0; i < 3; i++) {
+            samples[i] = vibration(tones[i], n, i);
+        }
+        Biquad3PeakTrackerUpdate(&tracker, samples, 1);
+    }
+    for (int i = 0; i < 3; i++) {
+        EXPECT_NEAR(tracker.frequency[i], tones[i], 0.03f * tones[i]) << "axis " << i;
+    }
+}
+
+TEST_F(BiquadTest, PeakTrackerStaysInBand) {
+    struct Biquad3PeakTracker tracker;
+    const float f0[3] = { 200.0f, 200.0f, 200.0f };
+    float samples[3];
+
+    Biquad3PeakTrackerInit(&tracker, 80.0f, 400.0f, SAMPLE_RATE, f0);
+    // one estimate per period, below the band that takes a while
+    for (int n = 0; n < 3 * (int)SAMPLE_RATE; n++) {
+        samples[0] = 50.0f * sinf(2.0f * (float)M_PI * 40.0f * (float)n / SAMPLE_RATE);
+        samples[1] = 50.0f * sinf(2.0f * (float)M_PI * 900.0f * (float)n / SAMPLE_RATE);
+        samples[2] = 0.0f;
+        Biquad3PeakTrackerUpdate(&tracker, samples, 1);
+    }
+    EXPECT_NEAR(tracker.frequency[0], 80.0f, 1.0f);
+    EXPECT_NEAR(tracker.frequency[1], 400.0f, 1.0f);
+    // no signal, no crossings, the estimate stays where it started
+    EXPECT_EQ(tracker.frequency[2], 200.0f);
+}
+
+// A notch that follows the tracker the way the Sensors module moves it, against a tone that
+// sweeps from 150Hz to 300Hz and then stays there
+TEST_F(BiquadTest, DynamicNotchFollowsTone) {
+    struct Biquad3PeakTracker tracker;
+    struct BiquadCoefficients notch;
+    const float f0[3] = { 150.0f, 150.0f, 150.0f };
+    float centre = f0[0], phase = 0.0f, out = 0.0f;
+    float block[DECIMATION][3];
+
+    Biquad3PeakTrackerInit(&tracker, 80.0f, 400.0f, SAMPLE_RATE, f0);
+    BiquadNotch(centre, SAMPLE_RATE, 2.0f, &notch);
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        Biquad3SetStage(&cascade, 0, axis, &notch);
+    }
+    cascade.stages = 1;
+
+    int n = 0;
+    for (int k = 0; k < 2 * (int)OUTPUT_RATE; k++) {
+        for (int i = 0; i < DECIMATION; i++, n++) {
+            const float f = 150.0f + 150.0f * fminf((float)n / SAMPLE_RATE, 1.0f);
+            phase += 2.0f * (float)M_PI * f / SAMPLE_RATE;
+            block[i][0] = block[i][1] = block[i][2] = 100.0f * sinf(phase);
+        }
+        float scratch[DECIMATION][3];
+        memcpy(scratch, block, sizeof(block));
+        Biquad3PeakTrackerUpdate(&tracker, &scratch[0][0], DECIMATION);
+        Biquad3Filter(&cascade, &block[0][0], DECIMATION);
+        if (fabsf(tracker.frequency[0] - centre) > 0.02f * centre) {
+            centre = tracker.frequency[0];
+            BiquadNotch(centre, SAMPLE_RATE, 2.0f, &notch);
+            for (uint8_t axis = 0; axis < 3; axis++) {
+                Biquad3SetStage(&cascade, 0, axis, &notch);
+            }
+        }
+        if (k >= 3 * (int)OUTPUT_RATE / 2) {
+            for (int i = 0; i < DECIMATION; i++) {
+                out = fmaxf(out, fabsf(block[i][0]));
+            }
+        }
+    }
+    EXPECT_NEAR(centre, 300.0f, 6.0f);
+    // a notch left at 150Hz would barely touch it, its gain at 300Hz is 0.95
+    EXPECT_LT(out, 5.0f);
+}
+
+TEST_F(BiquadTest, DISABLED_Benchmark) {
+    static int16_t raw[BENCH_SAMPLES][3];
+    volatile float sink;
+    struct BiquadCoefficients notch;
+
+    for (int n = 0; n < BENCH_SAMPLES; n++) {
+        raw[n][0] = (int16_t)(n * 7);
+        raw[n][1] = (int16_t)(n * 13);
+        raw[n][2] = (int16_t)(n * 29);
+    }
+
+    // the current averaging, the first pass warms up the caches
+    uint64_t start = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        start = bench_cycles();
+        for (int n = 0; n < BENCH_SAMPLES; n += DECIMATION) {
+            int32_t accum[3] = { 0, 0, 0 };
+            for (int i = 0; i < DECIMATION; i++) {
+                accum[0] += raw[n + i][0];
+                accum[1] += raw[n + i][1];
+                accum[2] += raw[n + i][2];
+            }
+            sink = (float)accum[0] / DECIMATION + (float)accum[1] / DECIMATION + (float)accum[2] / DECIMATION;
+        }
+    }
+    double average = (double)(bench_cycles() - start) / BENCH_SAMPLES;
+
+    // 4th order low pass and a notch, converted in chunks the way the Sensors module does
+    lowPass(CUTOFF, STAGES);
+    BiquadNotch(200.0f, SAMPLE_RATE, 2.0f, &notch);
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        Biquad3SetStage(&cascade, STAGES, axis, &notch);
+    }
+    cascade.stages = STAGES + 1;
+    start = bench_cycles();
+    for (int n = 0; n < BENCH_SAMPLES; n += 8) {
+        float samples[8][3];
+        for (int i = 0; i < 8; i++) {
+            samples[i][0] = (float)raw[n + i][0];
+            samples[i][1] = (float)raw[n + i][1];
+            samples[i][2] = (float)raw[n + i][2];
+        }
+        Biquad3Filter(&cascade, &samples[0][0], 8);
+        sink = samples[7][0];
+    }
+    double filter = (double)(bench_cycles() - start) / BENCH_SAMPLES;
+
+    // the same with the peak tracker of the dynamic notches running on a copy of each chunk
+    struct Biquad3PeakTracker tracker;
+    const float f0[3] = { 200.0f, 200.0f, 200.0f };
+    Biquad3PeakTrackerInit(&tracker, 80.0f, 400.0f, SAMPLE_RATE, f0);
+    start = bench_cycles();
+    for (int n = 0; n < BENCH_SAMPLES; n += 8) {
+        float samples[8][3], scratch[8][3];
+        for (int i = 0; i < 8; i++) {
+            samples[i][0] = (float)raw[n + i][0];
+            samples[i][1] = (float)raw[n + i][1];
+            samples[i][2] = (float)raw[n + i][2];
+        }
+        memcpy(scratch, samples, sizeof(samples));
+        Biquad3PeakTrackerUpdate(&tracker, &scratch[0][0], 8);
+        Biquad3Filter(&cascade, &samples[0][0], 8);
+        sink = samples[7][0];
+    }
+    double dynamic = (double)(bench_cycles() - start) / BENCH_SAMPLES;
+    (void)sink;
+
+    printf("[ BIQUAD   ] per 3 axis sample: average %.1f cycles  low pass + notch %.1f cycles  with peak tracker %.1f cycles\n", average, filter, dynamic);
+}
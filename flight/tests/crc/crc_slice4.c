@@ -0,0 +1,10 @@
+/* Slice-by-4 build of pios_crc.c, renamed so every engine links into one test */
+#define PIOS_CRC_SLICE_BY_4
+#define PIOS_CRC_updateByte    crc8_slice4_updateByte
+#define PIOS_CRC_updateCRC     crc8_slice4_updateCRC
+#define PIOS_CRC16_updateByte  crc16_slice4_updateByte
+#define PIOS_CRC16_updateCRC   crc16_slice4_updateCRC
+#define PIOS_CRC32_updateByte  crc32_slice4_updateByte
+#define PIOS_CRC32_updateCRC   crc32_slice4_updateCRC
+
+#include "pios_crc.c"
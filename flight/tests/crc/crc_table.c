@@ -0,0 +1,9 @@
+/* Byte table build of pios_crc.c, renamed so every engine links into one test */
+#define PIOS_CRC_updateByte    crc8_table_updateByte
+#define PIOS_CRC_updateCRC     crc8_table_updateCRC
+#define PIOS_CRC16_updateByte  crc16_table_updateByte
+#define PIOS_CRC16_updateCRC   crc16_table_updateCRC
+#define PIOS_CRC32_updateByte  crc32_table_updateByte
+#define PIOS_CRC32_updateCRC   crc32_table_updateCRC
+
+#include "pios_crc.c"
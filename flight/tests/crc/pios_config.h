@@ -0,0 +1,6 @@
+#ifndef PIOS_CONFIG_H
+#define PIOS_CONFIG_H
+
+/* The CRC engine is selected by each crc_*.c wrapper */
+
+#endif /* PIOS_CONFIG_H */
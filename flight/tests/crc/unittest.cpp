@@ -0,0 +1,195 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <stdlib.h> /* rand */
+#include <string.h> /* memcpy */
+
+extern "C" {
+#include <stdint.h>
+
+#define CRC_ENGINE_PROTOTYPES(name) \
+    uint8_t crc8_ ## name ## _updateCRC(uint8_t crc, const uint8_t *data, int32_t length); \
+    uint16_t crc16_ ## name ## _updateCRC(uint16_t crc, const uint8_t *data, int32_t length); \
+    uint32_t crc32_ ## name ## _updateCRC(uint32_t crc, const uint8_t *data, int32_t length);
+
+CRC_ENGINE_PROTOTYPES(table)
+CRC_ENGINE_PROTOTYPES(slice4)
+CRC_ENGINE_PROTOTYPES(slice8)
+}
+
+struct crc_engine {
+    const char *name;
+    uint8_t    (*crc8)(uint8_t crc, const uint8_t *data, int32_t length);
+    uint16_t   (*crc16)(uint16_t crc, const uint8_t *data, int32_t length);
+    uint32_t   (*crc32)(uint32_t crc, const uint8_t *data, int32_t length);
+};
+
+#define CRC_ENGINE(name) { #name, crc8_ ## name ## _updateCRC, crc16_ ## name ## _updateCRC, crc32_ ## name ## _updateCRC }
+
+static const struct crc_engine engines[] = {
+    CRC_ENGINE(table),
+    CRC_ENGINE(slice4),
+    CRC_ENGINE(slice8),
+};
+
+#define NUM_ENGINES    (sizeof(engines) / sizeof(engines[0]))
+#define BUFFER_SIZE    4096
+#define BENCH_SIZE     (64 * 1024)
+#define BENCH_TIME_SEC 0.2
+
+/* Bit at a time references, straight from the polynomial definitions */
+static uint8_t ref_crc8(uint8_t crc, const uint8_t *data, int32_t length)
+{
+    while (length-- > 0) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t ref_crc16(uint16_t crc, const uint8_t *data, int32_t length)
+{
+    while (length-- > 0) {
+        crc ^= *data++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0x8408) : (uint16_t)(crc >> 1);
+        }
+    }
+    return crc;
+}
+
+static uint32_t ref_crc32(uint32_t crc, const uint8_t *data, int32_t length)
+{
+    while (length-- > 0) {
+        crc ^= (uint32_t)*data++ << 24;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x80000000) ? ((crc << 1) ^ 0x04c11db7) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class CrcTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        srand(1234);
+        for (uint32_t i = 0; i < sizeof(buffer); i++) {
+            buffer[i] = rand();
+        }
+    }
+
+    virtual void TearDown()
+    {}
+
+    uint8_t buffer[BUFFER_SIZE];
+};
+
+TEST_F(CrcTest, CheckValues) {
+    const uint8_t check[] = "123456789";
+
+    for (uint32_t e = 0; e < NUM_ENGINES; e++) {
+        SCOPED_TRACE(engines[e].name);
+        /* CRC-8, CRC-16/MCRF4XX and CRC-32/MPEG-2 check values */
+        EXPECT_EQ(0xf4, engines[e].crc8(0, check, 9));
+        EXPECT_EQ(0x6f91, engines[e].crc16(0xffff, check, 9));
+        EXPECT_EQ(0x0376e6e7u, engines[e].crc32(0xffffffff, check, 9));
+    }
+}
+
+TEST_F(CrcTest, MatchReference) {
+    for (uint32_t e = 0; e < NUM_ENGINES; e++) {
+        SCOPED_TRACE(engines[e].name);
+        for (int32_t length = 0; length <= 67; length++) {
+            for (uint32_t offset = 0; offset < 8; offset++) {
+                const uint8_t *p = &buffer[offset];
+                uint32_t seed    = length * 8 + offset;
+
+                ASSERT_EQ(ref_crc8(seed, p, length), engines[e].crc8(seed, p, length));
+                ASSERT_EQ(ref_crc16(seed, p, length), engines[e].crc16(seed, p, length));
+                ASSERT_EQ(ref_crc32(0xffffffff ^ seed, p, length), engines[e].crc32(0xffffffff ^ seed, p, length));
+            }
+        }
+        ASSERT_EQ(ref_crc32(0xffffffff, buffer, BUFFER_SIZE), engines[e].crc32(0xffffffff, buffer, BUFFER_SIZE));
+    }
+}
+
+TEST_F(CrcTest, SplitUpdates) {
+    for (uint32_t e = 0; e < NUM_ENGINES; e++) {
+        SCOPED_TRACE(engines[e].name);
+        uint8_t crc8   = 0;
+        uint32_t crc32 = 0xffffffff;
+        uint32_t done  = 0;
+
+        for (uint32_t step = 1; done < BUFFER_SIZE; step = (step * 5 + 3) % 41) {
+            uint32_t n = (done + step > BUFFER_SIZE) ? BUFFER_SIZE - done : step;
+            crc8  = engines[e].crc8(crc8, &buffer[done], n);
+            crc32 = engines[e].crc32(crc32, &buffer[done], n);
+            done += n;
+        }
+        EXPECT_EQ(engines[e].crc8(0, buffer, BUFFER_SIZE), crc8);
+        EXPECT_EQ(engines[e].crc32(0xffffffff, buffer, BUFFER_SIZE), crc32);
+    }
+}
+
+/* The STM32 CRC unit always restarts from 0xffffffff. PIOS_CRC32_HARDWARE resumes
+ * from an arbitrary value by folding it into the first word of every chunk;
+ * check that identity against the software engine since the unit is not
+ * available here. */
+TEST_F(CrcTest, HardwareResume) {
+    for (uint32_t chunk = 0; chunk < BUFFER_SIZE / 64; chunk++) {
+        uint32_t crc = ref_crc32(0xffffffff, buffer, chunk * 64);
+        uint8_t folded[64];
+
+        memcpy(folded, &buffer[chunk * 64], sizeof(folded));
+        folded[0] ^= (crc ^ 0xffffffff) >> 24;
+        folded[1] ^= (crc ^ 0xffffffff) >> 16;
+        folded[2] ^= (crc ^ 0xffffffff) >> 8;
+        folded[3] ^= (crc ^ 0xffffffff);
+
+        ASSERT_EQ(crc32_table_updateCRC(crc, &buffer[chunk * 64], 64), crc32_table_updateCRC(0xffffffff, folded, 64));
+    }
+}
+
+TEST_F(CrcTest, DISABLED_BenchmarkThroughput) {
+    static uint8_t data[BENCH_SIZE];
+
+    memcpy(data, buffer, sizeof(buffer));
+    for (uint32_t i = sizeof(buffer); i < sizeof(data); i++) {
+        data[i] = data[i - sizeof(buffer)] * 31 + 7;
+    }
+
+    for (uint32_t e = 0; e < NUM_ENGINES; e++) {
+        volatile uint32_t sink = 0;
+        double mbs[3];
+
+        for (uint32_t width = 0; width < 3; width++) {
+            double start  = bench_seconds();
+            double end    = start;
+            uint32_t runs = 0;
+
+            while (end - start < BENCH_TIME_SEC) {
+                switch (width) {
+                case 0:
+                    sink ^= engines[e].crc8(0, data, sizeof(data));
+                    break;
+                case 1:
+                    sink ^= engines[e].crc16(0xffff, data, sizeof(data));
+                    break;
+                default:
+                    sink ^= engines[e].crc32(0xffffffff, data, sizeof(data));
+                    break;
+                }
+                runs++;
+                end = bench_seconds();
+            }
+            mbs[width] = runs * (double)sizeof(data) / (end - start) / (1024.0 * 1024.0);
+        }
+
+        printf("[ CRC      ] %-8s crc8 %8.1f MB/s  crc16 %8.1f MB/s  crc32 %8.1f MB/s\n",
+               engines[e].name, mbs[0], mbs[1], mbs[2]);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+/*
+ * Single threaded stand-ins for the FreeRTOS primitives used by the
+ * event dispatcher. Semaphores always succeed, queues are simple ring
+ * buffers and the tick count is driven by the test (see unittest_init.c)
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+#define pdTRUE            1
+#define pdFALSE           0
+#define portMAX_DELAY     0xffffffff
+#define portTICK_RATE_MS  1
+#define tskIDLE_PRIORITY  0
+#define configMINIMAL_STACK_SIZE 128
+
+typedef uint32_t portTickType;
+typedef long portBASE_TYPE;
+typedef void *xSemaphoreHandle;
+typedef struct ut_queue *xQueueHandle;
+
+#define pvPortMalloc(xSize)                  (malloc(xSize))
+#define vPortFree(pv)                        (free(pv))
+
+static inline portBASE_TYPE ut_semaphore_op(__attribute__((unused)) xSemaphoreHandle sema)
+{
+    return pdTRUE;
+}
+
+#define xSemaphoreCreateRecursiveMutex()     ((xSemaphoreHandle)1)
+#define xSemaphoreTakeRecursive(sema, ticks) ut_semaphore_op(sema)
+#define xSemaphoreGiveRecursive(sema)        ut_semaphore_op(sema)
+
+portTickType xTaskGetTickCount(void);
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t item_size);
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+
+#endif /* FREERTOS_H */
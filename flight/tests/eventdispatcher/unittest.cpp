@@ -0,0 +1,176 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+
+extern "C" {
+#include "openpilot.h"
+
+extern portTickType ut_ticks;
+extern DelayedCallback ut_event_task;
+extern portTickType ut_event_due;
+}
+
+#define NUM_EVENTS 300
+#define RUN_TIME_MS 20000
+
+static uint32_t fired[NUM_EVENTS];
+
+static void count_cb(UAVObjEvent *ev)
+{
+    fired[(uintptr_t)ev->obj - 1]++;
+}
+
+static UAVObjEvent make_event(uint32_t n)
+{
+    UAVObjEvent ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.obj   = (UAVObjHandle)(uintptr_t)(n + 1);
+    ev.event = EV_UPDATED_PERIODIC;
+    return ev;
+}
+
+static uint16_t period_of(uint32_t n)
+{
+    return 10 + (n * 37) % 990;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class EventDispatcherTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        memset(fired, 0, sizeof(fired));
+        ASSERT_EQ(0, EventDispatcherInitialize());
+        ASSERT_TRUE(ut_event_task != NULL);
+    }
+
+    virtual void TearDown()
+    {}
+
+    /* Run the event task whenever it asked to for a while, optionally waking it up late */
+    uint32_t runFor(uint32_t durationMs, uint32_t lateMs)
+    {
+        portTickType end = ut_ticks + durationMs;
+        uint32_t runs    = 0;
+
+        for (;;) {
+            if (ut_event_due > ut_ticks) {
+                if (ut_event_due >= end) {
+                    ut_ticks = end;
+                    return runs;
+                }
+                ut_ticks = ut_event_due + lateMs;
+            }
+            ut_event_due = UINT32_MAX;
+            ut_event_task();
+            runs++;
+        }
+    }
+};
+
+TEST_F(EventDispatcherTest, PeriodicEventsFireAtTheirRate) {
+    for (uint32_t n = 0; n < NUM_EVENTS; n++) {
+        UAVObjEvent ev = make_event(n);
+        ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, count_cb, period_of(n)));
+    }
+
+    uint32_t runs = runFor(RUN_TIME_MS, 0);
+
+    for (uint32_t n = 0; n < NUM_EVENTS; n++) {
+        uint32_t expected = RUN_TIME_MS / period_of(n);
+        EXPECT_NEAR(expected, fired[n], 1) << "event " << n << " period " << period_of(n);
+    }
+
+    EventStats stats;
+    EventGetStats(&stats);
+    EXPECT_EQ(0u, stats.eventErrors);
+    EXPECT_EQ(0u, stats.maxJitterMs);
+    EXPECT_GT(stats.periodicEvents, 0u);
+
+    /* The task only wakes up when something is due */
+    EXPECT_LE(runs, stats.periodicEvents);
+}
+
+TEST_F(EventDispatcherTest, DuplicateAndUnknownEvents) {
+    UAVObjEvent ev = make_event(0);
+    UAVObjEvent other = make_event(1);
+
+    EXPECT_EQ(0, EventPeriodicCallbackCreate(&ev, count_cb, 100));
+    EXPECT_EQ(-1, EventPeriodicCallbackCreate(&ev, count_cb, 200));
+    EXPECT_EQ(-1, EventPeriodicCallbackUpdate(&other, count_cb, 200));
+    EXPECT_EQ(0, EventPeriodicCallbackUpdate(&ev, count_cb, 200));
+}
+
+TEST_F(EventDispatcherTest, UpdateChangesAndStopsPeriod) {
+    UAVObjEvent fast = make_event(0);
+    UAVObjEvent slow = make_event(1);
+    UAVObjEvent off  = make_event(2);
+
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&fast, count_cb, 1000));
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&slow, count_cb, 10));
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&off, count_cb, 0));
+
+    ASSERT_EQ(0, EventPeriodicCallbackUpdate(&fast, count_cb, 10));
+    ASSERT_EQ(0, EventPeriodicCallbackUpdate(&slow, count_cb, 1000));
+    runFor(10000, 0);
+    EXPECT_NEAR(1000, fired[0], 1);
+    EXPECT_NEAR(10, fired[1], 1);
+    EXPECT_EQ(0u, fired[2]);
+
+    /* Stop one, start the other */
+    ASSERT_EQ(0, EventPeriodicCallbackUpdate(&fast, count_cb, 0));
+    ASSERT_EQ(0, EventPeriodicCallbackUpdate(&off, count_cb, 100));
+    memset(fired, 0, sizeof(fired));
+    runFor(10000, 0);
+    EXPECT_EQ(0u, fired[0]);
+    EXPECT_NEAR(10, fired[1], 1);
+    EXPECT_NEAR(100, fired[2], 1);
+}
+
+TEST_F(EventDispatcherTest, LateWakeupsAreReportedAsJitter) {
+    UAVObjEvent ev = make_event(0);
+
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, count_cb, 50));
+    runFor(1000, 0);
+    EventClearStats();
+    uint32_t before = fired[0];
+
+    runFor(5000, 7);
+
+    EventStats stats;
+    EventGetStats(&stats);
+    EXPECT_EQ(7u, stats.maxJitterMs);
+    EXPECT_EQ(7u * stats.periodicEvents, stats.totalJitterMs);
+    /* Late updates are not made up for, the period is kept on average */
+    EXPECT_NEAR(5000 / 50, fired[0] - before, 2);
+}
+
+TEST_F(EventDispatcherTest, ShortPeriodAmongManyIdleEvents) {
+    for (uint32_t n = 0; n < NUM_EVENTS; n++) {
+        UAVObjEvent ev = make_event(n);
+        ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, count_cb, 60000));
+    }
+    UAVObjEvent ev = make_event(NUM_EVENTS);
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, NULL, 1));
+
+    uint32_t runs = runFor(50000, 0);
+    EXPECT_GE(runs, 49000u);
+}
+
+TEST_F(EventDispatcherTest, DISABLED_BenchmarkWakeupsAmongManyIdleEvents) {
+    for (uint32_t n = 0; n < NUM_EVENTS; n++) {
+        UAVObjEvent ev = make_event(n);
+        ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, count_cb, 60000));
+    }
+    UAVObjEvent ev = make_event(NUM_EVENTS);
+    ASSERT_EQ(0, EventPeriodicCallbackCreate(&ev, NULL, 1));
+
+    double start  = bench_seconds();
+    uint32_t runs = runFor(50000, 0);
+    double ns     = (bench_seconds() - start) * 1e9 / runs;
+
+    printf("[ EVENTS   ] %u wakeups with %u periodic events registered: %.0f ns per wakeup\n", runs, NUM_EVENTS + 1, ns);
+}
@@ -0,0 +1,92 @@
+/*
+ * Host side stand-ins for the parts of the flight environment used by
+ * the event dispatcher. Time only advances when the test says so.
+ */
+
+#include "openpilot.h"
+
+portTickType ut_ticks;
+DelayedCallback ut_event_task;
+portTickType ut_event_due;
+
+portTickType xTaskGetTickCount(void)
+{
+    return ut_ticks;
+}
+
+struct ut_queue {
+    uint32_t length;
+    uint32_t item_size;
+    uint32_t head;
+    uint32_t count;
+    uint8_t  items[];
+};
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t item_size)
+{
+    struct ut_queue *queue = (struct ut_queue *)malloc(sizeof(struct ut_queue) + length * item_size);
+
+    if (queue) {
+        queue->length    = length;
+        queue->item_size = item_size;
+        queue->head  = 0;
+        queue->count = 0;
+    }
+    return queue;
+}
+
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    uint32_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->items[tail * queue->item_size], item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+DelayedCallbackInfo *PIOS_CALLBACKSCHEDULER_Create(DelayedCallback cb,
+                                                   __attribute__((unused)) DelayedCallbackPriority priority,
+                                                   __attribute__((unused)) DelayedCallbackPriorityTask priorityTask,
+                                                   __attribute__((unused)) int16_t callbackID,
+                                                   __attribute__((unused)) uint32_t stacksize)
+{
+    ut_event_task = cb;
+    return (DelayedCallbackInfo *)&ut_event_task;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Schedule(__attribute__((unused)) DelayedCallbackInfo *cbinfo,
+                                        int32_t milliseconds,
+                                        DelayedCallbackUpdateMode updatemode)
+{
+    portTickType due = ut_ticks + (milliseconds > 0 ? milliseconds : 0);
+
+    if (updatemode == CALLBACK_UPDATEMODE_SOONER && due >= ut_event_due) {
+        return 0;
+    }
+    ut_event_due = due;
+    return 1;
+}
+
+int32_t PIOS_CALLBACKSCHEDULER_Dispatch(__attribute__((unused)) DelayedCallbackInfo *cbinfo)
+{
+    ut_event_due = ut_ticks;
+    return 1;
+}
+
+uint32_t UAVObjGetID(UAVObjHandle obj)
+{
+    return (uint32_t)(uintptr_t)obj;
+}
@@ -0,0 +1,6 @@
+/* Build of insgps13state.c with the generic sparse loops, the reference for the generated kernels */
+#define INSGPS_GENERIC_KERNELS
+#define INSGPS_PREFIX(name) generic_ ## name
+#include "insgps_rename.h"
+
+#include "insgps13state.c"
@@ -0,0 +1,5 @@
+/* Build of insgps13state.c with the kernels generated by make/scripts/insgps_kernelgen.py */
+#define INSGPS_PREFIX(name) kernels_ ## name
+#include "insgps_rename.h"
+
+#include "insgps13state.c"
@@ -0,0 +1,27 @@
+/* Renames the exported symbols of insgps13state.c with INSGPS_PREFIX() so several builds link into one test */
+#define ins_get_num_states      INSGPS_PREFIX(ins_get_num_states)
+#define INSGPSInit              INSGPS_PREFIX(INSGPSInit)
+#define INSResetP               INSGPS_PREFIX(INSResetP)
+#define INSGetP                 INSGPS_PREFIX(INSGetP)
+#define INSSetState             INSGPS_PREFIX(INSSetState)
+#define INSPosVelReset          INSGPS_PREFIX(INSPosVelReset)
+#define INSSetPosVelVar         INSGPS_PREFIX(INSSetPosVelVar)
+#define INSSetGyroBias          INSGPS_PREFIX(INSSetGyroBias)
+#define INSSetAccelVar          INSGPS_PREFIX(INSSetAccelVar)
+#define INSSetGyroVar           INSGPS_PREFIX(INSSetGyroVar)
+#define INSSetGyroBiasVar       INSGPS_PREFIX(INSSetGyroBiasVar)
+#define INSSetMagVar            INSGPS_PREFIX(INSSetMagVar)
+#define INSSetBaroVar           INSGPS_PREFIX(INSSetBaroVar)
+#define INSSetMagNorth          INSGPS_PREFIX(INSSetMagNorth)
+#define INSStatePrediction      INSGPS_PREFIX(INSStatePrediction)
+#define INSCovariancePrediction INSGPS_PREFIX(INSCovariancePrediction)
+#define INSCorrection           INSGPS_PREFIX(INSCorrection)
+#define MagCorrection           INSGPS_PREFIX(MagCorrection)
+#define MagVelBaroCorrection    INSGPS_PREFIX(MagVelBaroCorrection)
+#define GpsBaroCorrection       INSGPS_PREFIX(GpsBaroCorrection)
+#define FullCorrection          INSGPS_PREFIX(FullCorrection)
+#define GpsMagCorrection        INSGPS_PREFIX(GpsMagCorrection)
+#define VelBaroCorrection       INSGPS_PREFIX(VelBaroCorrection)
+#define CovariancePrediction    INSGPS_PREFIX(CovariancePrediction)
+#define Nav                     INSGPS_PREFIX(Nav)
+#define zeros                   INSGPS_PREFIX(zeros)
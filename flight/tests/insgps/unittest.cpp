@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <math.h> /* fabsf */
+#include <stdlib.h> /* rand */
+
+extern "C" {
+#include <stdint.h>
+#include "insgps.h"
+
+#define INSGPS_PROTOTYPES(prefix) \
+    void prefix ## _INSGPSInit(); \
+    void prefix ## _INSStatePrediction(float gyro_data[3], float accel_data[3], float dT); \
+    void prefix ## _INSCovariancePrediction(float dT); \
+    void prefix ## _INSCorrection(float mag_data[3], float Pos[3], float Vel[3], float BaroAlt, uint16_t SensorsUsed); \
+    void prefix ## _INSResetP(float PDiag[13]); \
+    void prefix ## _INSGetP(float PDiag[13]); \
+    void prefix ## _INSSetState(float pos[3], float vel[3], float q[4], float gyro_bias[3], float accel_bias[3]); \
+    void prefix ## _INSSetPosVelVar(float PosVar[3], float VelVar[3]); \
+    void prefix ## _INSSetAccelVar(float accel_var[3]); \
+    void prefix ## _INSSetGyroVar(float gyro_var[3]); \
+    void prefix ## _INSSetGyroBiasVar(float gyro_bias_var[3]); \
+    void prefix ## _INSSetMagNorth(float B[3]); \
+    void prefix ## _INSSetMagVar(float scaled_mag_var[3]); \
+    void prefix ## _INSSetBaroVar(float baro_var); \
+    extern struct NavStruct prefix ## _Nav;
+
+INSGPS_PROTOTYPES(generic)
+INSGPS_PROTOTYPES(kernels)
+}
+
+struct insgps_build {
+    const char *name;
+    void       (*init)();
+    void       (*statePrediction)(float gyro_data[3], float accel_data[3], float dT);
+    void       (*covariancePrediction)(float dT);
+    void       (*correction)(float mag_data[3], float Pos[3], float Vel[3], float BaroAlt, uint16_t SensorsUsed);
+    void       (*resetP)(float PDiag[13]);
+    void       (*getP)(float PDiag[13]);
+    void       (*setState)(float pos[3], float vel[3], float q[4], float gyro_bias[3], float accel_bias[3]);
+    void       (*setPosVelVar)(float PosVar[3], float VelVar[3]);
+    void       (*setAccelVar)(float accel_var[3]);
+    void       (*setGyroVar)(float gyro_var[3]);
+    void       (*setGyroBiasVar)(float gyro_bias_var[3]);
+    void       (*setMagNorth)(float B[3]);
+    void       (*setMagVar)(float scaled_mag_var[3]);
+    void       (*setBaroVar)(float baro_var);
+    struct NavStruct *nav;
+};
+
+#define INSGPS_BUILD(prefix) \
+    { #prefix, prefix ## _INSGPSInit, prefix ## _INSStatePrediction, prefix ## _INSCovariancePrediction, \
+      prefix ## _INSCorrection, prefix ## _INSResetP, prefix ## _INSGetP, prefix ## _INSSetState, \
+      prefix ## _INSSetPosVelVar, prefix ## _INSSetAccelVar, prefix ## _INSSetGyroVar, prefix ## _INSSetGyroBiasVar, \
+      prefix ## _INSSetMagNorth, prefix ## _INSSetMagVar, prefix ## _INSSetBaroVar, &prefix ## _Nav }
+
+static const struct insgps_build generic = INSGPS_BUILD(generic);
+static const struct insgps_build kernels = INSGPS_BUILD(kernels);
+
+#define NUMX        13
+#define DT          0.002f
+#define BENCH_CALLS 20000
+
+static float randf(float range)
+{
+    return range * (2.0f * (float)rand() / (float)RAND_MAX - 1.0f);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class InsgpsTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        setup(&generic);
+        setup(&kernels);
+    }
+
+    virtual void TearDown()
+    {}
+
+    static void setup(const struct insgps_build *ins)
+    {
+        float pos[3]  = { 1.0f, -2.0f, -10.0f };
+        float vel[3]  = { 0.5f, 0.2f, -0.1f };
+        float q[4]    = { 0.9659258f, 0.0f, 0.0f, 0.258819f };
+        float gyro_bias[3]  = { 0.01f, -0.02f, 0.005f };
+        float accel_bias[3] = { 0.0f, 0.0f, 0.0f };
+        float pos_var[3]    = { 1.0f, 1.0f, 2.0f };
+        float vel_var[3]    = { 0.5f, 0.5f, 1.0f };
+        float accel_var[3]  = { 0.01f, 0.01f, 0.01f };
+        float gyro_var[3]   = { 1e-4f, 1e-4f, 1e-4f };
+        float gyro_bias_var[3] = { 1e-6f, 1e-6f, 1e-6f };
+        float mag_var[3]    = { 0.005f, 0.005f, 0.005f };
+        float be[3] = { 0.4f, 0.05f, 0.9f };
+
+        ins->init();
+        ins->setMagNorth(be);
+        ins->setMagVar(mag_var);
+        ins->setAccelVar(accel_var);
+        ins->setGyroVar(gyro_var);
+        ins->setGyroBiasVar(gyro_bias_var);
+        ins->setBaroVar(0.1f);
+        ins->setPosVelVar(pos_var, vel_var);
+        ins->setState(pos, vel, q, gyro_bias, accel_bias);
+    }
+
+    static void expectSame(const struct insgps_build *a, const struct insgps_build *b)
+    {
+        float pa[NUMX], pb[NUMX];
+
+        a->getP(pa);
+        b->getP(pb);
+        for (int i = 0; i < NUMX; i++) {
+            EXPECT_NEAR(pa[i], pb[i], 1e-5f * fmaxf(1.0f, fabsf(pa[i]))) << "P[" << i << "][" << i << "]";
+        }
+        for (int i = 0; i < 3; i++) {
+            EXPECT_NEAR(a->nav->Pos[i], b->nav->Pos[i], 1e-4f * fmaxf(1.0f, fabsf(a->nav->Pos[i])));
+            EXPECT_NEAR(a->nav->Vel[i], b->nav->Vel[i], 1e-4f * fmaxf(1.0f, fabsf(a->nav->Vel[i])));
+            EXPECT_NEAR(a->nav->gyro_bias[i], b->nav->gyro_bias[i], 1e-5f);
+        }
+        for (int i = 0; i < 4; i++) {
+            EXPECT_NEAR(a->nav->q[i], b->nav->q[i], 1e-5f);
+        }
+    }
+};
+
+TEST_F(InsgpsTest, CovariancePredictionMatchesGeneric) {
+    srand(1234);
+    for (int step = 0; step < 1000; step++) {
+        float gyro[3]  = { randf(1.0f), randf(1.0f), randf(1.0f) };
+        float accel[3] = { randf(2.0f), randf(2.0f), -9.81f + randf(2.0f) };
+
+        generic.statePrediction(gyro, accel, DT);
+        generic.covariancePrediction(DT);
+        kernels.statePrediction(gyro, accel, DT);
+        kernels.covariancePrediction(DT);
+    }
+    expectSame(&generic, &kernels);
+}
+
+TEST_F(InsgpsTest, SerialUpdateMatchesGeneric) {
+    const uint16_t sensors[] = {
+        FULL_SENSORS,
+        MAG_SENSORS,
+        HORIZ_SENSORS | VERT_SENSORS | BARO_SENSOR,
+        POS_SENSORS | BARO_SENSOR,
+        HORIZ_POS_SENSORS | MAG_SENSORS,
+    };
+
+    srand(4321);
+    for (int step = 0; step < 500; step++) {
+        float gyro[3]  = { randf(0.5f), randf(0.5f), randf(0.5f) };
+        float accel[3] = { randf(1.0f), randf(1.0f), -9.81f + randf(1.0f) };
+        float mag[3]   = { 0.4f + randf(0.05f), 0.05f + randf(0.05f), 0.9f + randf(0.05f) };
+        float pos[3]   = { 1.0f + randf(0.5f), -2.0f + randf(0.5f), -10.0f + randf(0.5f) };
+        float vel[3]   = { randf(0.2f), randf(0.2f), randf(0.2f) };
+        float baro     = 10.0f + randf(0.5f);
+        uint16_t used  = sensors[step % (sizeof(sensors) / sizeof(sensors[0]))];
+
+        generic.statePrediction(gyro, accel, DT);
+        generic.covariancePrediction(DT);
+        generic.correction(mag, pos, vel, baro, used);
+        kernels.statePrediction(gyro, accel, DT);
+        kernels.covariancePrediction(DT);
+        kernels.correction(mag, pos, vel, baro, used);
+    }
+    expectSame(&generic, &kernels);
+}
+
+TEST_F(InsgpsTest, DISABLED_Benchmark) {
+    const struct insgps_build *builds[] = { &generic, &kernels };
+    float mag[3]   = { 0.4f, 0.05f, 0.9f };
+    float pos[3]   = { 1.0f, -2.0f, -10.0f };
+    float vel[3]   = { 0.5f, 0.2f, -0.1f };
+    float gyro[3]  = { 0.1f, -0.2f, 0.05f };
+    float accel[3] = { 0.3f, -0.1f, -9.81f };
+    double predict[2], update[2];
+
+    for (int b = 0; b < 2; b++) {
+        const struct insgps_build *ins = builds[b];
+        uint64_t predict_cycles = 0;
+        uint64_t update_cycles  = 0;
+
+        setup(ins);
+        for (int i = 0; i < BENCH_CALLS; i++) {
+            ins->statePrediction(gyro, accel, DT);
+            uint64_t start = bench_cycles();
+            ins->covariancePrediction(DT);
+            uint64_t middle = bench_cycles();
+            ins->correction(mag, pos, vel, 10.0f, FULL_SENSORS);
+            update_cycles  += bench_cycles() - middle;
+            predict_cycles += middle - start;
+        }
+        predict[b] = (double)predict_cycles / BENCH_CALLS;
+        update[b]  = (double)update_cycles / BENCH_CALLS;
+        printf("[ INSGPS   ] %-8s covariance prediction %8.0f cycles  full correction %8.0f cycles\n",
+               ins->name, predict[b], update[b]);
+    }
+    printf("[ INSGPS   ] speedup prediction %.2fx  correction %.2fx\n", predict[0] / predict[1], update[0] / update[1]);
+}
@@ -1,3 +1,4 @@
 #include <stdlib.h>
 #define pvPortMalloc(xSize) (malloc(xSize))
 #define vPortFree(pv)       (free(pv))
+#define vTaskDelay(ticks)   ((void)(ticks))
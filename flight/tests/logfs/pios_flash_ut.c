@@ -15,6 +15,12 @@ struct flash_ut_dev {
     const struct pios_flash_ut_cfg *cfg;
     bool transaction_in_progress;
     FILE *flash_file;
+    uint32_t read_count;
+    uint32_t write_count;
+    uint32_t erase_count;
+    uint32_t unlocked_erase_count;
+    void     (*erase_hook)(void *context);
+    void     *erase_hook_context;
 };
 
 static struct flash_ut_dev *PIOS_Flash_UT_Alloc(void)
@@ -40,6 +46,11 @@ int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *
 
     flash_dev->cfg = cfg;
     flash_dev->transaction_in_progress = false;
+    flash_dev->read_count  = 0;
+    flash_dev->write_count = 0;
+    flash_dev->erase_count = 0;
+    flash_dev->unlocked_erase_count = 0;
+    flash_dev->erase_hook = NULL;
 
     flash_dev->flash_file = fopen(FLASH_IMAGE_FILE, "rb+");
     if (flash_dev->flash_file == NULL) {
@@ -74,6 +85,47 @@ int32_t PIOS_Flash_UT_Destroy(uintptr_t flash_id)
     return 0;
 }
 
+/* Number of read_data calls so far, what costs on an SPI flash */
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->read_count;
+}
+
+/* Number of write_data calls so far */
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->write_count;
+}
+
+/* Number of erase_sector calls so far, each takes tens to hundreds of ms on a real chip */
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->erase_count;
+}
+
+/* Number of erase_sector calls made outside of a transaction */
+uint32_t PIOS_Flash_UT_GetUnlockedEraseCount(uintptr_t flash_id)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    return flash_dev->unlocked_erase_count;
+}
+
+/* Called by erase_sector calls made outside of a transaction before the sector is erased, as if the chip was still busy */
+void PIOS_Flash_UT_SetEraseHook(uintptr_t flash_id, void (*hook)(void *context), void *context)
+{
+    struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
+
+    flash_dev->erase_hook = hook;
+    flash_dev->erase_hook_context = context;
+}
+
 
 /**********************************
  *
@@ -108,7 +160,15 @@ static int32_t PIOS_Flash_UT_EraseSector(uintptr_t flash_id, uint32_t addr)
 {
     struct flash_ut_dev *flash_dev = (struct flash_ut_dev *)flash_id;
 
-    assert(flash_dev->transaction_in_progress);
+    flash_dev->erase_count++;
+
+    /* Sectors nothing else uses may be erased while others go on with their transactions */
+    if (!flash_dev->transaction_in_progress) {
+        flash_dev->unlocked_erase_count++;
+        if (flash_dev->erase_hook) {
+            flash_dev->erase_hook(flash_dev->erase_hook_context);
+        }
+    }
 
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
@@ -135,6 +195,8 @@ static int32_t PIOS_Flash_UT_WriteData(uintptr_t flash_id, uint32_t addr, uint8_
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->write_count++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
@@ -156,6 +218,8 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
 
     assert(flash_dev->transaction_in_progress);
 
+    flash_dev->read_count++;
+
     if (fseek(flash_dev->flash_file, addr, SEEK_SET) != 0) {
         assert(0);
     }
@@ -175,4 +239,5 @@ const struct pios_flash_driver pios_ut_flash_driver = {
     .erase_sector = PIOS_Flash_UT_EraseSector,
     .write_data   = PIOS_Flash_UT_WriteData,
     .read_data    = PIOS_Flash_UT_ReadData,
+    .unlocked_erase = true,
 };
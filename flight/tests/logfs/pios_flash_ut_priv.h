@@ -8,6 +8,12 @@ struct pios_flash_ut_cfg {
 int32_t PIOS_Flash_UT_Init(uintptr_t *flash_id, const struct pios_flash_ut_cfg *cfg);
 
 int32_t PIOS_Flash_UT_Destroy(uintptr_t flash_id);
+
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id);
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id);
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id);
+uint32_t PIOS_Flash_UT_GetUnlockedEraseCount(uintptr_t flash_id);
+void PIOS_Flash_UT_SetEraseHook(uintptr_t flash_id, void (*hook)(void *context), void *context);
 extern const struct pios_flash_driver pios_ut_flash_driver;
 
 #if !defined(FLASH_IMAGE_FILE)
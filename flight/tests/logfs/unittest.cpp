@@ -1,6 +1,6 @@
 #include "gtest/gtest.h"
+#include "benchmark.h"
 
-#include <stdio.h> /* printf */
 #include <stdlib.h> /* abort */
 #include <string.h> /* memset */
 
@@ -13,6 +13,8 @@ extern struct pios_flash_ut_cfg flash_config;
 #include "pios_flashfs_logfs_priv.h"
 
 extern struct flashfs_logfs_cfg flashfs_config_partition_a;
+extern struct flashfs_logfs_cfg flashfs_config_partition_a_scan;
+extern struct flashfs_logfs_cfg flashfs_config_partition_a_blocking;
 extern struct flashfs_logfs_cfg flashfs_config_partition_b;
 
 #include "pios_flashfs.h" /* PIOS_FLASHFS_* */
@@ -32,6 +34,8 @@ extern struct flashfs_logfs_cfg flashfs_config_partition_b;
 #define OBJ4_ID   0x90901111
 #define OBJ4_SIZE (768) // only fits in partition b slots
 
+#define NUM_SETTINGS 120 // distinct objects for the index tests, saved twice they nearly fill an arena
+
 // To use a test fixture, derive a class from testing::Test.
 class LogfsTestRaw : public testing::Test {
 protected:
@@ -297,6 +301,334 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
     EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+TEST_F(LogfsTestCooked, IndexedLookups) {
+    unsigned char obj1_check[OBJ1_SIZE];
+
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+    }
+
+    /* Remount, the index is rebuilt from the log */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+
+    /* One read for the slot header, one for the data */
+    uint32_t reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+    }
+    EXPECT_EQ(2u * NUM_SETTINGS, PIOS_Flash_UT_GetReadCount(flash_id) - reads);
+
+    /* Missing objects don't touch the flash at all */
+    reads = PIOS_Flash_UT_GetReadCount(flash_id);
+    EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ2_ID, 0));
+    EXPECT_EQ(0u, PIOS_Flash_UT_GetReadCount(flash_id) - reads);
+
+    /* Deleting moves entries around in the index, everything else must still be found */
+    for (uint32_t i = 0; i < NUM_SETTINGS; i += 3) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, i));
+    }
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        memset(obj1_check, 0, sizeof(obj1_check));
+        if (i % 3 == 0) {
+            EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check))) << "instance " << i;
+        } else {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check))) << "instance " << i;
+            EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+        }
+    }
+}
+
+/* Count the flash reads and time a boot (mount and load every object) and a save of every object */
+static void saveAllLoadAll(const struct flashfs_logfs_cfg *cfg, unsigned char *obj, unsigned char *obj_alt,
+                           double *elapsed, uint32_t *reads)
+{
+    uintptr_t flash_id;
+    uintptr_t fs_id;
+    unsigned char obj_check[OBJ1_SIZE];
+
+    ASSERT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfg, &pios_ut_flash_driver, flash_id));
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj, OBJ1_SIZE));
+    }
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+
+    double start = bench_seconds();
+    uint32_t startReads = PIOS_Flash_UT_GetReadCount(flash_id);
+
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfg, &pios_ut_flash_driver, flash_id));
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj_check, sizeof(obj_check)));
+        ASSERT_EQ(0, memcmp(obj, obj_check, OBJ1_SIZE));
+    }
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj_alt, OBJ1_SIZE));
+    }
+
+    *elapsed = bench_seconds() - start;
+    *reads   = PIOS_Flash_UT_GetReadCount(flash_id) - startReads;
+
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj_check, sizeof(obj_check)));
+        ASSERT_EQ(0, memcmp(obj_alt, obj_check, OBJ1_SIZE));
+    }
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    PIOS_Flash_UT_Destroy(flash_id);
+}
+
+TEST_F(LogfsTestRaw, IndexedFasterThanScan) {
+    double indexed, scanned;
+    uint32_t indexedReads, scannedReads;
+
+    saveAllLoadAll(&flashfs_config_partition_a, obj1, obj1_alt, &indexed, &indexedReads);
+    SetUp(); // fresh flash image, same layout for the second run
+    saveAllLoadAll(&flashfs_config_partition_a_scan, obj1, obj1_alt, &scanned, &scannedReads);
+
+    /* The mount scan is the same, after that it's a read or two per object instead of half the log */
+    uint32_t slots = flashfs_config_partition_a.arena_size / flashfs_config_partition_a.slot_size;
+    EXPECT_LE(indexedReads, slots + 4 * NUM_SETTINGS);
+    EXPECT_GT(scannedReads, 10 * indexedReads);
+}
+
+/* Every object still holds the value it was last saved with, 0 for deleted ones */
+static void verifyAll(uintptr_t fs_id, const uint8_t *expected, uint16_t num_objs)
+{
+    unsigned char obj_check[OBJ1_SIZE];
+    unsigned char obj[OBJ1_SIZE];
+
+    for (uint16_t i = 0; i < num_objs; i++) {
+        if (expected[i] == 0) {
+            ASSERT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj_check, sizeof(obj_check))) << "instance " << i;
+        } else {
+            memset(obj, expected[i], sizeof(obj));
+            ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj_check, sizeof(obj_check))) << "instance " << i;
+            ASSERT_EQ(0, memcmp(obj, obj_check, sizeof(obj))) << "instance " << i;
+        }
+    }
+}
+
+/*
+ * Save and delete objects at random with a step of background garbage collection
+ * after each, so saves and deletes land on every part of a running collection
+ */
+static void churnWithBackgroundGC(const struct flashfs_logfs_cfg *cfg, uint32_t *collections)
+{
+    const uint16_t num_objs = 100;
+    uint8_t expected[num_objs];
+    unsigned char obj[OBJ1_SIZE];
+    uintptr_t flash_id;
+    uintptr_t fs_id;
+
+    ASSERT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfg, &pios_ut_flash_driver, flash_id));
+
+    memset(expected, 0, sizeof(expected));
+    srand(42);
+    uint32_t erases = PIOS_Flash_UT_GetEraseCount(flash_id);
+
+    for (uint32_t n = 0; n < 3000; n++) {
+        uint16_t i = rand() % num_objs;
+        if (rand() % 8 == 0) {
+            ASSERT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, i));
+            expected[i] = 0;
+        } else {
+            expected[i] = 1 + n % 255;
+            memset(obj, expected[i], sizeof(obj));
+            ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj, sizeof(obj)));
+        }
+        ASSERT_GE(PIOS_FLASHFS_Logfs_GCStep(fs_id), 0);
+        if (n % 50 == 0) {
+            verifyAll(fs_id, expected, num_objs);
+        }
+    }
+    /* An arena is one sector */
+    *collections = PIOS_Flash_UT_GetEraseCount(flash_id) - erases;
+
+    /* Nothing deleted comes back from the copies */
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfg, &pios_ut_flash_driver, flash_id));
+    verifyAll(fs_id, expected, num_objs);
+
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    PIOS_Flash_UT_Destroy(flash_id);
+}
+
+TEST_F(LogfsTestRaw, BackgroundGarbageCollect) {
+    uint32_t collections;
+
+    churnWithBackgroundGC(&flashfs_config_partition_a, &collections);
+    EXPECT_GT(collections, 10u);
+
+    /* Without the index the copies are found by scanning */
+    SetUp();
+    churnWithBackgroundGC(&flashfs_config_partition_a_scan, &collections);
+    EXPECT_GT(collections, 10u);
+}
+
+struct eraseHookState {
+    uintptr_t fs_id;
+    uint32_t  calls;
+    uint8_t   value;
+};
+
+/* Saves and loads another object while a background collection step erases */
+static void saveDuringErase(void *context)
+{
+    struct eraseHookState *state = (struct eraseHookState *)context;
+    unsigned char obj[OBJ2_SIZE];
+    unsigned char obj_check[OBJ2_SIZE];
+
+    state->value = 1 + state->calls++ % 255;
+    memset(obj, state->value, sizeof(obj));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(state->fs_id, OBJ2_ID, 0, obj, sizeof(obj)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(state->fs_id, OBJ2_ID, 0, obj_check, sizeof(obj_check)));
+    EXPECT_EQ(0, memcmp(obj, obj_check, sizeof(obj)));
+    /* the erasing step is still under way, another one backs off */
+    EXPECT_EQ(1, PIOS_FLASHFS_Logfs_GCStep(state->fs_id));
+}
+
+TEST_F(LogfsTestRaw, SaveDuringBackgroundErase) {
+    const uint16_t num_objs = 20;
+    unsigned char obj[OBJ1_SIZE];
+    unsigned char obj_check[OBJ2_SIZE];
+    struct eraseHookState state = { 0, 0, 0 };
+    uintptr_t flash_id;
+
+    ASSERT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&state.fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    PIOS_Flash_UT_SetEraseHook(flash_id, &saveDuringErase, &state);
+
+    for (uint32_t n = 0; n < 2000; n++) {
+        memset(obj, 1 + n % 255, sizeof(obj));
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(state.fs_id, OBJ1_ID, n % num_objs, obj, sizeof(obj)));
+        ASSERT_GE(PIOS_FLASHFS_Logfs_GCStep(state.fs_id), 0);
+    }
+    EXPECT_GT(PIOS_Flash_UT_GetUnlockedEraseCount(flash_id), 5u);
+    EXPECT_EQ(PIOS_Flash_UT_GetUnlockedEraseCount(flash_id), state.calls);
+
+    /* Nothing saved during an erase went to the arena being erased */
+    PIOS_Flash_UT_SetEraseHook(flash_id, NULL, NULL);
+    PIOS_FLASHFS_Logfs_Destroy(state.fs_id);
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&state.fs_id, &flashfs_config_partition_a, &pios_ut_flash_driver, flash_id));
+    ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(state.fs_id, OBJ2_ID, 0, obj_check, sizeof(obj_check)));
+    EXPECT_EQ(state.value, obj_check[0]);
+    for (uint16_t i = 0; i < num_objs; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(state.fs_id, OBJ1_ID, i, obj, sizeof(obj)));
+        EXPECT_EQ((uint8_t)(1 + (2000 - num_objs + i) % 255), obj[0]) << "instance " << i;
+    }
+
+    PIOS_FLASHFS_Logfs_Destroy(state.fs_id);
+    PIOS_Flash_UT_Destroy(flash_id);
+}
+
+struct saveCost {
+    double   time;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t erases;
+};
+
+/*
+ * Rewrite every object many times over and record the worst save. With
+ * background set a few collection steps run between saves, as the idle
+ * callback would.
+ */
+static void worstCaseSave(const struct flashfs_logfs_cfg *cfg, unsigned char *obj, bool background,
+                          struct saveCost *worst, uint32_t *collections)
+{
+    unsigned char obj_check[OBJ1_SIZE];
+    uintptr_t flash_id;
+    uintptr_t fs_id;
+
+    memset(worst, 0, sizeof(*worst));
+    ASSERT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    ASSERT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, cfg, &pios_ut_flash_driver, flash_id));
+    uint32_t startErases = PIOS_Flash_UT_GetEraseCount(flash_id);
+
+    for (uint32_t n = 0; n < 2000; n++) {
+        uint32_t reads  = PIOS_Flash_UT_GetReadCount(flash_id);
+        uint32_t writes = PIOS_Flash_UT_GetWriteCount(flash_id);
+        uint32_t erases = PIOS_Flash_UT_GetEraseCount(flash_id);
+        double start    = bench_seconds();
+
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, n % NUM_SETTINGS, obj, OBJ1_SIZE));
+
+        double elapsed = bench_seconds() - start;
+        reads  = PIOS_Flash_UT_GetReadCount(flash_id) - reads;
+        writes = PIOS_Flash_UT_GetWriteCount(flash_id) - writes;
+        erases = PIOS_Flash_UT_GetEraseCount(flash_id) - erases;
+        worst->time   = (elapsed > worst->time) ? elapsed : worst->time;
+        worst->reads  = (reads > worst->reads) ? reads : worst->reads;
+        worst->writes = (writes > worst->writes) ? writes : worst->writes;
+        worst->erases = (erases > worst->erases) ? erases : worst->erases;
+
+        for (int step = 0; background && step < 4 && PIOS_FLASHFS_Logfs_GCStep(fs_id) > 0; step++) {
+            ;
+        }
+    }
+    *collections = PIOS_Flash_UT_GetEraseCount(flash_id) - startErases;
+
+    for (uint32_t i = 0; i < NUM_SETTINGS; i++) {
+        ASSERT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj_check, sizeof(obj_check)));
+        ASSERT_EQ(0, memcmp(obj, obj_check, OBJ1_SIZE));
+    }
+    PIOS_FLASHFS_Logfs_Destroy(fs_id);
+    PIOS_Flash_UT_Destroy(flash_id);
+}
+
+TEST_F(LogfsTestRaw, WorstCaseSaveLatency) {
+    struct saveCost blocking, background;
+    uint32_t blockingCollections, backgroundCollections;
+
+    worstCaseSave(&flashfs_config_partition_a_blocking, obj1, false, &blocking, &blockingCollections);
+    SetUp(); // fresh flash image, same layout for the second run
+    worstCaseSave(&flashfs_config_partition_a, obj1, true, &background, &backgroundCollections);
+
+    EXPECT_GT(blockingCollections, 10u);
+    EXPECT_GT(backgroundCollections, 10u);
+
+    /* The save that finds the log full erases the next arena and copies every active slot */
+    EXPECT_EQ(1u, blocking.erases);
+    EXPECT_GT(blocking.reads, (uint32_t)NUM_SETTINGS);
+    EXPECT_GT(blocking.writes, (uint32_t)NUM_SETTINGS);
+
+    /*
+     * Otherwise it is a few slot header reads and writes, wherever the collection is at.
+     */
+    EXPECT_EQ(0u, background.erases);
+    EXPECT_LE(background.reads, 3u);
+    EXPECT_LE(background.writes, 5u);
+}
+
+/* The simulator times are mostly host noise, the flash operations are what a chip waits on */
+TEST_F(LogfsTestRaw, DISABLED_BenchmarkIndexedAndScan) {
+    double indexed, scanned;
+    uint32_t indexedReads, scannedReads;
+
+    saveAllLoadAll(&flashfs_config_partition_a, obj1, obj1_alt, &indexed, &indexedReads);
+    SetUp(); // fresh flash image, same layout for the second run
+    saveAllLoadAll(&flashfs_config_partition_a_scan, obj1, obj1_alt, &scanned, &scannedReads);
+
+    printf("[ LOGFS    ] %d objects, mount + load + save all: indexed %.2fms %u reads, scanning %.2fms %u reads\n",
+           NUM_SETTINGS, indexed * 1e3, indexedReads, scanned * 1e3, scannedReads);
+}
+
+TEST_F(LogfsTestRaw, DISABLED_BenchmarkWorstCaseSave) {
+    struct saveCost blocking, background;
+    uint32_t blockingCollections, backgroundCollections;
+
+    worstCaseSave(&flashfs_config_partition_a_blocking, obj1, false, &blocking, &blockingCollections);
+    SetUp(); // fresh flash image, same layout for the second run
+    worstCaseSave(&flashfs_config_partition_a, obj1, true, &background, &backgroundCollections);
+
+    printf("[ LOGFS    ] worst ObjSave, collecting when full: %.3fms %u reads %u writes %u erases (%u collections)\n",
+           blocking.time * 1e3, blocking.reads, blocking.writes, blocking.erases, blockingCollections);
+    printf("[ LOGFS    ] worst ObjSave, collecting in the background: %.3fms %u reads %u writes %u erases (%u collections)\n",
+           background.time * 1e3, background.reads, background.writes, background.erases, backgroundCollections);
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
     virtual void SetUp()
@@ -392,3 +724,22 @@ TEST_F(LogfsTestCookedMultiPart, WriteLarge) {
     memset(obj4_check, 0, sizeof(obj4_check));
     EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id_b, OBJ4_ID, 0, obj4_check, sizeof(obj4_check)));
 }
+
+TEST_F(LogfsTestCookedMultiPart, IndexOverflow) {
+    /* Partition b only indexes a few objects, it has to fall back to scanning */
+    for (uint16_t i = 0; i < 20; i++) {
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id_b, OBJ2_ID, i, obj2, sizeof(obj2)));
+    }
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id_b, OBJ2_ID, 5));
+
+    unsigned char obj2_check[OBJ2_SIZE];
+    for (uint16_t i = 0; i < 20; i++) {
+        memset(obj2_check, 0, sizeof(obj2_check));
+        if (i == 5) {
+            EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id_b, OBJ2_ID, i, obj2_check, sizeof(obj2_check)));
+        } else {
+            EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id_b, OBJ2_ID, i, obj2_check, sizeof(obj2_check)));
+            EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+        }
+    }
+}
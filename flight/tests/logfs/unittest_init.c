@@ -22,6 +22,37 @@ const struct flashfs_logfs_cfg flashfs_config_partition_a = {
     .start_offset  = 0,          /* start at the beginning of the chip */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .index_size    = 0x00000C00, /* 256 entries, the whole arena */
+    .gc_watermark  = 32,         /* collect ahead when PIOS_FLASHFS_Logfs_GCStep() is called */
+};
+
+/* partition a collecting only when the log is full, blocking the save that finds it full */
+const struct flashfs_logfs_cfg flashfs_config_partition_a_blocking = {
+    .fs_magic      = 0x89abceef,
+    .total_fs_size = 0x00200000, /* 2M bytes (32 sectors) */
+    .arena_size    = 0x00010000, /* 256 * slot size */
+    .slot_size     = 0x00000100, /* 256 bytes */
+
+    .start_offset  = 0,          /* start at the beginning of the chip */
+    .sector_size   = 0x00010000, /* 64K bytes */
+    .page_size     = 0x00000100, /* 256 bytes */
+
+    .index_size    = 0x00000C00, /* 256 entries, the whole arena */
+};
+
+/* partition a without the index, always scans the log */
+const struct flashfs_logfs_cfg flashfs_config_partition_a_scan = {
+    .fs_magic      = 0x89abceef,
+    .total_fs_size = 0x00200000, /* 2M bytes (32 sectors) */
+    .arena_size    = 0x00010000, /* 256 * slot size */
+    .slot_size     = 0x00000100, /* 256 bytes */
+
+    .start_offset  = 0,          /* start at the beginning of the chip */
+    .sector_size   = 0x00010000, /* 64K bytes */
+    .page_size     = 0x00000100, /* 256 bytes */
+
+    .gc_watermark  = 32,         /* collect ahead when PIOS_FLASHFS_Logfs_GCStep() is called */
 };
 
 const struct flashfs_logfs_cfg flashfs_config_partition_b = {
@@ -33,4 +64,6 @@ const struct flashfs_logfs_cfg flashfs_config_partition_b = {
     .start_offset  = 0x00200000, /* start after partition a */
     .sector_size   = 0x00010000, /* 64K bytes */
     .page_size     = 0x00000100, /* 256 bytes */
+
+    .index_size    = 0x00000060, /* 8 entries, overflows */
 };
@@ -0,0 +1,387 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <math.h> /* fabsf */
+#include <stdlib.h> /* rand */
+
+extern "C" {
+#include <stdint.h>
+#include "mixermatrix.h"
+}
+
+#define CHANNELS      MIXERMATRIX_MAX_CHANNELS
+#define ITERATIONS    20000
+#define TOLERANCE     1.0e-5f
+
+/* MixerSettings MixerNType values */
+#define TYPE_DISABLED 0
+#define TYPE_MOTOR    1
+#define TYPE_REVMOTOR 2
+#define TYPE_SERVO    3
+#define TYPE_CAMROLL  4
+#define TYPE_ACCESSORY0 7
+
+/* Same layout as Mixer_t in the Actuator module */
+typedef struct {
+    uint8_t type;
+    int8_t  matrix[5];
+} Mixer_t;
+
+struct vehicle {
+    const char *name;
+    bool    multirotor;
+    bool    fixedwing;
+    uint8_t firstRollServo;
+    int8_t  rollDifferential;
+    Mixer_t mixers[CHANNELS];
+};
+
+/*
+ * The per channel mixer the matrix replaced, taken from the Actuator module
+ * with the settings passed in instead of read from the module globals
+ */
+static float ProcessMixer(const struct vehicle *v, const int index, const float curve1, const float curve2,
+                          float roll, float pitch, float yaw, bool multirotor, bool fixedwing)
+{
+    const Mixer_t *mixer = &v->mixers[index];
+    float differential   = 1.0f;
+
+    // Apply differential only for fixedwing and Roll servos
+    if (fixedwing && (v->firstRollServo > 0) &&
+        (mixer->type == TYPE_SERVO) &&
+        (mixer->matrix[MIXERMATRIX_VECTOR_ROLL] != 0)) {
+        // Positive differential
+        if (v->rollDifferential > 0) {
+            // Check for first Roll servo (should be left aileron or elevon) and Roll desired (positive/negative)
+            if (((index == v->firstRollServo - 1) && (roll > 0.0f))
+                || ((index != v->firstRollServo - 1) && (roll < 0.0f))) {
+                differential -= (v->rollDifferential * 0.01f);
+            }
+        } else if (v->rollDifferential < 0) {
+            if (((index == v->firstRollServo - 1) && (roll < 0.0f))
+                || ((index != v->firstRollServo - 1) && (roll > 0.0f))) {
+                differential -= (-v->rollDifferential * 0.01f);
+            }
+        }
+    }
+
+    float result = ((((float)mixer->matrix[MIXERMATRIX_VECTOR_THROTTLECURVE1]) * curve1) +
+                    (((float)mixer->matrix[MIXERMATRIX_VECTOR_THROTTLECURVE2]) * curve2) +
+                    (((float)mixer->matrix[MIXERMATRIX_VECTOR_ROLL]) * roll * differential) +
+                    (((float)mixer->matrix[MIXERMATRIX_VECTOR_PITCH]) * pitch) +
+                    (((float)mixer->matrix[MIXERMATRIX_VECTOR_YAW]) * yaw)) / 128.0f;
+
+    if (mixer->type == TYPE_MOTOR) {
+        if (!multirotor) { // we allow negative throttle with a multirotor
+            if (result < 0.0f) { // zero throttle
+                result = 0.0f;
+            }
+        }
+    }
+
+    return result;
+}
+
+/* What the actuator loop used to do for every mixing channel */
+static bool referenceMix(const struct vehicle *v, int ct, float curve1, float curve2,
+                         float roll, float pitch, float yaw, float *out)
+{
+    switch (v->mixers[ct].type) {
+    case TYPE_MOTOR:
+    {
+        float nonreversible_curve1 = curve1;
+        float nonreversible_curve2 = curve2;
+        if (nonreversible_curve1 < 0.0f) {
+            nonreversible_curve1 = 0.0f;
+        }
+        if (nonreversible_curve2 < 0.0f) {
+            if (!v->multirotor) {
+                nonreversible_curve2 = 0.0f;
+            }
+        }
+        *out = ProcessMixer(v, ct, nonreversible_curve1, nonreversible_curve2, roll, pitch, yaw, v->multirotor, v->fixedwing);
+        return true;
+    }
+    case TYPE_REVMOTOR:
+    case TYPE_SERVO:
+        *out = ProcessMixer(v, ct, curve1, curve2, roll, pitch, yaw, v->multirotor, v->fixedwing);
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+/* Multirotor mixer the way the GCS builds it, from its factor table and 50% mixer values */
+static void multirotor(struct vehicle *v, const char *name, const float factors[][3], int motors)
+{
+    memset(v, 0, sizeof(*v));
+    v->name = name;
+    v->multirotor = true;
+    for (int i = 0; i < motors; i++) {
+        v->mixers[i].type = TYPE_MOTOR;
+        v->mixers[i].matrix[MIXERMATRIX_VECTOR_THROTTLECURVE1] = 127;
+        v->mixers[i].matrix[MIXERMATRIX_VECTOR_ROLL]  = (int8_t)(factors[i][0] * 50 * 1.27);
+        v->mixers[i].matrix[MIXERMATRIX_VECTOR_PITCH] = (int8_t)(factors[i][1] * 50 * 1.27);
+        v->mixers[i].matrix[MIXERMATRIX_VECTOR_YAW]   = (int8_t)(factors[i][2] * 50 * 1.27);
+    }
+}
+
+static void channel(struct vehicle *v, int ct, uint8_t type, int8_t c1, int8_t c2, int8_t roll, int8_t pitch, int8_t yaw)
+{
+    v->mixers[ct] = (Mixer_t) { type, { c1, c2, roll, pitch, yaw }
+    };
+}
+
+/* The vehicle templates the GCS offers, plus a custom mix that uses every channel type */
+static int vehicles(struct vehicle *v)
+{
+    static const float quadX[][3] = { { 1, 1, -1 }, { -1, 1, 1 }, { -1, -1, -1 }, { 1, -1, 1 } };
+    static const float quadP[][3] = { { 0, 1, -1 }, { -1, 0, 1 }, { 0, -1, -1 }, { 1, 0, 1 } };
+    static const float hexa[][3]  = { { 0, 1, -1 }, { -1, 0.5, 1 }, { -1, -0.5, -1 }, { 0, -1, 1 }, { 1, -0.5, -1 }, { 1, 0.5, 1 } };
+    static const float hexaX[][3] = { { 0.5, 1, -1 }, { -0.5, 1, 1 }, { -1, 0, -1 }, { -0.5, -1, 1 }, { 0.5, -1, -1 }, { 1, 0, 1 } };
+    static const float y6[][3]    = { { 0.5, 1, -1 }, { 0.5, 1, 1 }, { 0.5, -1, -1 }, { 0.5, -1, 1 }, { -1, 0, -1 }, { -1, 0, 1 } };
+    static const float octo[][3]  = { { 1, 0, -1 }, { 0.71, -0.71, 1 }, { 0, -1, -1 }, { -0.71, -0.71, 1 },
+                                      { -1, 0, -1 }, { -0.71, 0.71, 1 }, { 0, 1, -1 }, { 0.71, 0.71, 1 } };
+    static const float octoV[][3] = { { 0.33, -1, -1 }, { 1, -1, 1 }, { -1, -1, -1 }, { -0.33, -1, 1 },
+                                      { -0.33, 1, -1 }, { -1, 1, 1 }, { 1, 1, -1 }, { 0.33, 1, 1 } };
+    static const float octoCoax[][3] = { { 1, 1, -1 }, { 1, 1, 1 }, { 1, -1, -1 }, { 1, -1, 1 },
+                                         { -1, -1, -1 }, { -1, -1, 1 }, { -1, 1, -1 }, { -1, 1, 1 } };
+    static const float tri[][3]   = { { 0.5, 1, 0 }, { 0.5, -1, 0 }, { -1, 0, 0 } };
+    int n = 0;
+
+    multirotor(&v[n++], "QuadX", quadX, 4);
+    multirotor(&v[n++], "QuadP", quadP, 4);
+    multirotor(&v[n++], "Hexa", hexa, 6);
+    multirotor(&v[n++], "HexaX", hexaX, 6);
+    multirotor(&v[n++], "HexaCoax", y6, 6);
+    multirotor(&v[n++], "Octo", octo, 8);
+    multirotor(&v[n++], "OctoV", octoV, 8);
+    multirotor(&v[n++], "OctoCoaxX", octoCoax, 8);
+    multirotor(&v[n], "Tri", tri, 3);
+    channel(&v[n++], 3, TYPE_SERVO, 0, 0, 0, 0, 127);
+
+    // Aileron plane with two aileron servos and a roll differential
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "FixedWing";
+    v[n].fixedwing        = true;
+    v[n].firstRollServo   = 2;
+    v[n].rollDifferential = 20;
+    channel(&v[n], 0, TYPE_MOTOR, 127, 0, 0, 0, 0);
+    channel(&v[n], 1, TYPE_SERVO, 0, 0, 127, 0, 0);
+    channel(&v[n], 2, TYPE_SERVO, 0, 0, 127, 0, 0);
+    channel(&v[n], 3, TYPE_SERVO, 0, 0, 0, 127, 0);
+    channel(&v[n++], 4, TYPE_SERVO, 0, 0, 0, 0, 127);
+
+    // Elevon, negative differential
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "FixedWingElevon";
+    v[n].fixedwing        = true;
+    v[n].firstRollServo   = 2;
+    v[n].rollDifferential = -15;
+    channel(&v[n], 0, TYPE_MOTOR, 127, 0, 0, 0, 0);
+    channel(&v[n], 1, TYPE_SERVO, 0, 0, 64, -64, 0);
+    channel(&v[n++], 2, TYPE_SERVO, 0, 0, 64, 64, 0);
+
+    // Vtail
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "FixedWingVtail";
+    v[n].fixedwing        = true;
+    v[n].firstRollServo   = 2;
+    v[n].rollDifferential = 10;
+    channel(&v[n], 0, TYPE_MOTOR, 127, 0, 0, 0, 0);
+    channel(&v[n], 1, TYPE_SERVO, 0, 0, 127, 0, 0);
+    channel(&v[n], 2, TYPE_SERVO, 0, 0, -127, 0, 0);
+    channel(&v[n], 3, TYPE_SERVO, 0, 0, 0, -64, -64);
+    channel(&v[n++], 4, TYPE_SERVO, 0, 0, 0, 64, -64);
+
+    // Differential drive ground vehicle
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "GroundDifferential";
+    channel(&v[n], 0, TYPE_REVMOTOR, 127, 0, 0, 0, 127);
+    channel(&v[n++], 1, TYPE_REVMOTOR, 127, 0, 0, 0, -127);
+
+    // Car
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "GroundCar";
+    channel(&v[n], 0, TYPE_REVMOTOR, 127, 0, 0, 0, 0);
+    channel(&v[n++], 1, TYPE_SERVO, 0, 0, 0, 0, 127);
+
+    // Helicopter, swash servos on curve 2
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "Heli";
+    channel(&v[n], 0, TYPE_MOTOR, 127, 0, 0, 0, 0);
+    channel(&v[n], 1, TYPE_SERVO, 0, 127, 110, 64, 0);
+    channel(&v[n], 2, TYPE_SERVO, 0, 127, -110, 64, 0);
+    channel(&v[n], 3, TYPE_SERVO, 0, -127, 0, 127, 0);
+    channel(&v[n++], 4, TYPE_SERVO, 0, 0, 0, 0, 127);
+
+    // Custom, every channel type and some disabled channels in between
+    memset(&v[n], 0, sizeof(v[n]));
+    v[n].name = "Custom";
+    v[n].fixedwing        = true;
+    v[n].firstRollServo   = 3;
+    v[n].rollDifferential = 50;
+    channel(&v[n], 0, TYPE_MOTOR, 127, -64, 10, -20, 30);
+    channel(&v[n], 2, TYPE_SERVO, 32, 64, 127, -128, 1);
+    channel(&v[n], 3, TYPE_SERVO, -32, 0, -127, 0, 0);
+    channel(&v[n], 4, TYPE_REVMOTOR, 127, 127, 0, 64, -64);
+    channel(&v[n], 5, TYPE_CAMROLL, 127, 127, 127, 127, 127);
+    channel(&v[n], 6, TYPE_ACCESSORY0, 127, 127, 127, 127, 127);
+    channel(&v[n], 8, TYPE_DISABLED, 127, 127, 127, 127, 127);
+    channel(&v[n++], 11, TYPE_MOTOR, 0, 127, 0, 0, 0);
+
+    return n;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class MixerMatrixTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        count = vehicles(vehicle);
+        srand(1234);
+    }
+
+    virtual void TearDown()
+    {}
+
+    void compile(const struct vehicle *v)
+    {
+        struct MixerMatrixConfig config;
+
+        memset(&config, 0, sizeof(config));
+        config.channels   = CHANNELS;
+        config.multirotor = v->multirotor;
+        config.fixedwing  = v->fixedwing;
+        config.firstRollServo   = v->firstRollServo;
+        config.rollDifferential = v->rollDifferential;
+        for (int ct = 0; ct < CHANNELS; ct++) {
+            switch (v->mixers[ct].type) {
+            case TYPE_MOTOR:
+                config.channel[ct].type = MIXERMATRIX_CHANNEL_MOTOR;
+                break;
+            case TYPE_REVMOTOR:
+                config.channel[ct].type = MIXERMATRIX_CHANNEL_REVERSIBLEMOTOR;
+                break;
+            case TYPE_SERVO:
+                config.channel[ct].type = MIXERMATRIX_CHANNEL_SERVO;
+                break;
+            default:
+                config.channel[ct].type = MIXERMATRIX_CHANNEL_NONE;
+                break;
+            }
+            memcpy(config.channel[ct].vector, v->mixers[ct].matrix, sizeof(config.channel[ct].vector));
+        }
+        ASSERT_EQ(0, MixerMatrixCompile(&matrix, &config));
+    }
+
+    static float random(float min, float max)
+    {
+        return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+    }
+
+    struct vehicle vehicle[20];
+    int count;
+    struct MixerMatrix matrix;
+};
+
+TEST_F(MixerMatrixTest, TooManyChannels) {
+    struct MixerMatrixConfig config;
+
+    memset(&config, 0, sizeof(config));
+    config.channels = MIXERMATRIX_MAX_CHANNELS + 1;
+    EXPECT_EQ(-1, MixerMatrixCompile(&matrix, &config));
+}
+
+TEST_F(MixerMatrixTest, MatchesProcessMixer) {
+    for (int i = 0; i < count; i++) {
+        const struct vehicle *v = &vehicle[i];
+        compile(v);
+
+        for (int n = 0; n < ITERATIONS; n++) {
+            // curves beyond 1 happen for multirotors, below 0 for reversible throttle
+            float curve1 = random(-1.0f, 1.5f);
+            float curve2 = random(-1.0f, 1.5f);
+            float roll   = random(-1.2f, 1.2f);
+            float pitch  = random(-1.2f, 1.2f);
+            float yaw    = random(-1.2f, 1.2f);
+            // exact zeros and the sign changes of the differential
+            if ((n & 15) == 0) {
+                roll = 0.0f;
+            }
+            if ((n & 31) == 1) {
+                curve1 = 0.0f;
+                curve2 = 0.0f;
+            }
+
+            float out[CHANNELS];
+            MixerMatrixApply(&matrix, curve1, curve2, roll, pitch, yaw, out);
+
+            for (int ct = 0; ct < CHANNELS; ct++) {
+                float expected;
+                if (referenceMix(v, ct, curve1, curve2, roll, pitch, yaw, &expected)) {
+                    ASSERT_NEAR(expected, out[ct], TOLERANCE * (1.0f + fabsf(expected)))
+                        << v->name << " channel " << ct << " curve1 " << curve1 << " curve2 " << curve2
+                        << " roll " << roll << " pitch " << pitch << " yaw " << yaw;
+                } else {
+                    ASSERT_EQ(0.0f, out[ct]) << v->name << " channel " << ct;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(MixerMatrixTest, MotorsNeverNegativeUnlessMultirotor) {
+    for (int i = 0; i < count; i++) {
+        const struct vehicle *v = &vehicle[i];
+        compile(v);
+
+        float out[CHANNELS];
+        MixerMatrixApply(&matrix, -1.0f, -1.0f, 1.0f, -1.0f, 1.0f, out);
+        for (int ct = 0; ct < CHANNELS; ct++) {
+            if (v->mixers[ct].type == TYPE_MOTOR && !v->multirotor) {
+                EXPECT_GE(out[ct], 0.0f) << v->name << " channel " << ct;
+            }
+        }
+    }
+}
+
+TEST_F(MixerMatrixTest, DISABLED_Benchmark) {
+    static float inputs[ITERATIONS][5];
+    volatile float sink = 0.0f;
+    const struct vehicle *v = &vehicle[5]; // octo, the most motors
+
+    ASSERT_STREQ("Octo", v->name);
+    compile(v);
+    for (int n = 0; n < ITERATIONS; n++) {
+        for (int i = 0; i < 5; i++) {
+            inputs[n][i] = random(-1.0f, 1.0f);
+        }
+    }
+
+    // per channel, the first pass warms up the caches
+    uint64_t start = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        start = bench_cycles();
+        for (int n = 0; n < ITERATIONS; n++) {
+            for (int ct = 0; ct < CHANNELS; ct++) {
+                float out = 0.0f;
+                referenceMix(v, ct, inputs[n][0], inputs[n][1], inputs[n][2], inputs[n][3], inputs[n][4], &out);
+                sink = out;
+            }
+        }
+    }
+    double perChannel = (double)(bench_cycles() - start) / ITERATIONS;
+
+    start = bench_cycles();
+    for (int n = 0; n < ITERATIONS; n++) {
+        float out[CHANNELS];
+        MixerMatrixApply(&matrix, inputs[n][0], inputs[n][1], inputs[n][2], inputs[n][3], inputs[n][4], out);
+        sink = out[CHANNELS - 1];
+    }
+    double compiled = (double)(bench_cycles() - start) / ITERATIONS;
+    (void)sink;
+
+    printf("[ MIXER    ] per update: ProcessMixer %.1f cycles  compiled matrix %.1f cycles\n", perChannel, compiled);
+}
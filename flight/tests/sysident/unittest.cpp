@@ -0,0 +1,204 @@
+#include "gtest/gtest.h"
+
+#include <math.h> /* expf */
+#include <stdlib.h> /* rand */
+#include <string.h> /* memset */
+
+extern "C" {
+#include <stdint.h>
+#include "sysident.h"
+}
+
+#define RATE_HZ  500
+#define DURATION 60 // seconds of shaking, a little longer than AutoTune's default
+
+// SystemIdentSettings defaults
+static const float initialBeta[3] = { 10.0f, 10.0f, 7.0f };
+#define INITIAL_TAU (-4.0f)
+
+// To use a test fixture, derive a class from testing::Test.
+class SysIdentTest : public testing::Test {
+protected:
+    struct SysIdentTuning tuning;
+
+    virtual void SetUp()
+    {
+        srand(1234);
+        tuning.calculateYaw = SYSIDENT_YAW_LIMITTORATIO;
+        tuning.yawToRollPitchPIDRatioMin = 1.0f;
+        tuning.yawToRollPitchPIDRatioMax = 2.5f;
+        tuning.dampMin   = 90.0f;
+        tuning.dampRate  = 110.0f;
+        tuning.dampMax   = 150.0f;
+        tuning.noiseMin  = 6.0f;
+        tuning.noiseRate = 10.0f;
+        tuning.noiseMax  = 16.0f;
+    }
+
+    virtual void TearDown()
+    {}
+
+    // roughly gaussian, zero mean, unit variance
+    static float gaussian()
+    {
+        float sum = 0.0f;
+
+        for (int i = 0; i < 12; i++) {
+            sum += (float)rand() / (float)RAND_MAX;
+        }
+        return sum - 6.0f;
+    }
+
+    // shake a simulated multirotor with the plant the filter assumes:
+    // torque is the thrust scaled command through a first order lag,
+    // rate is the integral of gain * (torque - bias)
+    void shake(struct SysIdent *ident, const float beta[3], float tau, float throttle, float gyroNoise)
+    {
+        const float dT = 1.0f / RATE_HZ;
+        const float e_tau = expf(tau);
+        float torque[3] = { 0.0f, 0.0f, 0.0f };
+        float rate[3]   = { 0.0f, 0.0f, 0.0f };
+
+        for (int n = 0; n < DURATION * RATE_HZ; n++) {
+            float u[3];
+            float gyro[3];
+
+            // the SystemIdent stabilization mode shakes one axis at a time
+            for (int j = 0; j < 3; j++) {
+                const int phase = (n * 10 / RATE_HZ) % 6; // 100ms steps
+                u[j] = (phase / 2 == j) ? ((phase & 1) ? -0.1f : 0.1f) : 0.0f;
+                rate[j]   += dT * expf(beta[j]) * torque[j];
+                torque[j] += dT / (dT + e_tau) * (4.0f * throttle * u[j] - torque[j]);
+                gyro[j]    = rate[j] + gyroNoise * gaussian();
+            }
+            SysIdentSample(ident, u, gyro, dT, throttle);
+        }
+    }
+};
+
+TEST_F(SysIdentTest, Init) {
+    struct SysIdent ident;
+
+    memset(&ident, 0xff, sizeof(ident));
+    SysIdentInit(&ident, initialBeta, INITIAL_TAU);
+
+    EXPECT_EQ(0.0f, ident.X[SYSIDENT_X_RATE]);
+    EXPECT_EQ(10.0f, ident.X[SYSIDENT_X_BETA + 0]);
+    EXPECT_EQ(7.0f, ident.X[SYSIDENT_X_BETA + 2]);
+    EXPECT_EQ(INITIAL_TAU, ident.X[SYSIDENT_X_TAU]);
+    EXPECT_EQ(0.0f, ident.X[SYSIDENT_X_BIAS + 2]);
+    EXPECT_EQ(1.0f, ident.P[0]);
+    EXPECT_EQ(0.0f, ident.P[3]);
+    EXPECT_EQ(0u, ident.predicts);
+    EXPECT_EQ(0.0f, ident.noise[1]);
+    EXPECT_EQ(0.0f, SysIdentHoverThrottle(&ident));
+}
+
+TEST_F(SysIdentTest, Converges) {
+    static const float beta[3] = { 9.0f, 9.5f, 7.5f };
+    const float tau = logf(0.03f);
+    struct SysIdent ident;
+
+    SysIdentInit(&ident, initialBeta, INITIAL_TAU);
+    shake(&ident, beta, tau, 0.45f, 5.0f);
+
+    EXPECT_EQ((uint32_t)(DURATION * RATE_HZ), ident.predicts);
+    for (int j = 0; j < 3; j++) {
+        EXPECT_NEAR(beta[j], ident.X[SYSIDENT_X_BETA + j], 0.2f) << "axis " << j;
+        EXPECT_NEAR(0.0f, ident.X[SYSIDENT_X_BIAS + j], 0.05f) << "axis " << j;
+        // most of the residual is the gyro noise
+        EXPECT_GT(ident.noise[j], 5.0f);
+        EXPECT_LT(ident.noise[j], 100.0f);
+    }
+    EXPECT_NEAR(tau, ident.X[SYSIDENT_X_TAU], 0.2f);
+    EXPECT_NEAR(0.45f, SysIdentHoverThrottle(&ident), 0.001f);
+    EXPECT_EQ(0, SysIdentCheck(&ident.X[SYSIDENT_X_BETA], ident.X[SYSIDENT_X_TAU]));
+}
+
+TEST_F(SysIdentTest, Check) {
+    static const float good[3] = { 10.0f, 10.0f, 7.0f };
+    static const float weak[3] = { 5.0f, 5.5f, 2.0f };
+
+    EXPECT_EQ(0, SysIdentCheck(good, INITIAL_TAU));
+    // yaw is limited when computing the PIDs instead
+    EXPECT_EQ(SYSIDENT_ROLL_BETA_LOW | SYSIDENT_PITCH_BETA_LOW, SysIdentCheck(weak, INITIAL_TAU));
+    EXPECT_EQ(SYSIDENT_TAU_TOO_LONG, SysIdentCheck(good, logf(0.2f)));
+    EXPECT_EQ(SYSIDENT_TAU_TOO_SHORT, SysIdentCheck(good, logf(0.005f)));
+}
+
+TEST_F(SysIdentTest, Pids) {
+    static const float beta[3] = { 10.0f, 10.5f, 7.0f };
+    struct SysIdentPids pids;
+
+    SysIdentComputePids(&tuning, beta, INITIAL_TAU, tuning.dampRate, tuning.noiseRate, &pids);
+
+    EXPECT_TRUE(pids.yaw);
+    for (int j = 0; j < 2; j++) {
+        EXPECT_GT(pids.rate[j].Kp, 0.0f);
+        EXPECT_GT(pids.rate[j].Ki, 0.0f);
+        EXPECT_GT(pids.rate[j].Kd, 0.0f);
+    }
+    // gains are inversely proportional to the axis gain
+    EXPECT_NEAR(pids.rate[0].Kp / pids.rate[1].Kp, expf(beta[1] - beta[0]), 1e-4f);
+    EXPECT_NEAR(pids.rate[0].Ki / pids.rate[1].Ki, expf(beta[1] - beta[0]), 1e-4f);
+    EXPECT_NEAR(pids.rate[0].Kd / pids.rate[1].Kd, expf(beta[1] - beta[0]), 1e-4f);
+    EXPECT_GT(pids.outerKp, 0.0f);
+    EXPECT_GT(pids.outerKi, 0.0f);
+
+    // weak yaw wants a lot more than 2.5 times the roll gain, it is scaled down to that
+    EXPECT_NEAR(2.5f * pids.rate[0].Kp, pids.rate[2].Kp, 1e-5f);
+    EXPECT_NEAR(pids.rate[2].Ki / pids.rate[2].Kp, 0.8f * pids.rate[0].Ki / pids.rate[0].Kp, 1e-5f);
+
+    // and is left alone when asked to
+    struct SysIdentPids unlimited;
+    tuning.calculateYaw = SYSIDENT_YAW_IGNORELIMIT;
+    SysIdentComputePids(&tuning, beta, INITIAL_TAU, tuning.dampRate, tuning.noiseRate, &unlimited);
+    EXPECT_EQ(pids.rate[0].Kp, unlimited.rate[0].Kp);
+    // from the axis with the lowest gain
+    EXPECT_NEAR(pids.rate[0].Kp * expf(0.6f * (beta[0] - beta[2])), unlimited.rate[2].Kp, 1e-3f);
+
+    // strong yaw is raised to the roll gain
+    static const float strongYaw[3] = { 10.0f, 10.5f, 12.0f };
+    tuning.calculateYaw = SYSIDENT_YAW_LIMITTORATIO;
+    SysIdentComputePids(&tuning, strongYaw, INITIAL_TAU, tuning.dampRate, tuning.noiseRate, &pids);
+    EXPECT_NEAR(pids.rate[0].Kp, pids.rate[2].Kp, 1e-5f);
+}
+
+TEST_F(SysIdentTest, NoYaw) {
+    static const float beta[3] = { 10.0f, 10.0f, 7.0f };
+    struct SysIdentPids pids;
+
+    memset(&pids, 0, sizeof(pids));
+    pids.rate[2].Kp = 123.0f;
+    tuning.calculateYaw = SYSIDENT_YAW_NONE;
+    SysIdentComputePids(&tuning, beta, INITIAL_TAU, tuning.dampRate, tuning.noiseRate, &pids);
+
+    EXPECT_FALSE(pids.yaw);
+    EXPECT_GT(pids.rate[0].Kp, 0.0f);
+    EXPECT_EQ(pids.rate[0].Kp, pids.rate[1].Kp);
+    EXPECT_EQ(123.0f, pids.rate[2].Kp);
+}
+
+TEST_F(SysIdentTest, SmoothToQuick) {
+    static const float beta[3] = { 10.0f, 10.0f, 7.0f };
+    float damp, noise;
+
+    SysIdentSmoothToQuick(&tuning, -1.0f, -1.0f, 1.0f, &damp, &noise);
+    EXPECT_FLOAT_EQ(tuning.dampMax, damp);
+    EXPECT_FLOAT_EQ(tuning.noiseMin, noise);
+    SysIdentSmoothToQuick(&tuning, -1.0f, 0.0f, 1.0f, &damp, &noise);
+    EXPECT_FLOAT_EQ(tuning.dampRate, damp);
+    EXPECT_FLOAT_EQ(tuning.noiseRate, noise);
+    SysIdentSmoothToQuick(&tuning, -1.0f, 1.0f, 1.0f, &damp, &noise);
+    EXPECT_FLOAT_EQ(tuning.dampMin, damp);
+    EXPECT_FLOAT_EQ(tuning.noiseMax, noise);
+    SysIdentSmoothToQuick(&tuning, 0.0f, 3.0f, 4.0f, &damp, &noise);
+    EXPECT_FLOAT_EQ(0.5f * (tuning.dampRate + tuning.dampMin), damp);
+    EXPECT_FLOAT_EQ(0.5f * (tuning.noiseRate + tuning.noiseMax), noise);
+
+    // quicker means more gain
+    struct SysIdentPids smooth, quick;
+    SysIdentComputePids(&tuning, beta, INITIAL_TAU, tuning.dampMax, tuning.noiseMin, &smooth);
+    SysIdentComputePids(&tuning, beta, INITIAL_TAU, tuning.dampMin, tuning.noiseMax, &quick);
+    EXPECT_GT(quick.rate[0].Kp, smooth.rate[0].Kp);
+}
@@ -0,0 +1,53 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+/*
+ * Single threaded stand-ins for the FreeRTOS primitives used by the
+ * UAVObject manager and UAVTalk. Semaphores always succeed, queues are
+ * simple ring buffers implemented in unittest_init.c
+ */
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Number of UAVO handle slots available to the test */
+#define UT_NUM_HANDLES    128
+
+#define pdTRUE            1
+#define pdFALSE           0
+#define portMAX_DELAY     0xffffffff
+#define portTICK_RATE_MS  1
+
+typedef uint32_t portTickType;
+typedef long portBASE_TYPE;
+typedef void *xSemaphoreHandle;
+typedef struct ut_queue *xQueueHandle;
+
+#define pvPortMalloc(xSize)                  (malloc(xSize))
+#define vPortFree(pv)                        (free(pv))
+
+static inline portBASE_TYPE ut_semaphore_op(__attribute__((unused)) xSemaphoreHandle sema)
+{
+    return pdTRUE;
+}
+
+#define xSemaphoreCreateRecursiveMutex()     ((xSemaphoreHandle)1)
+#define xSemaphoreTakeRecursive(sema, ticks) ut_semaphore_op(sema)
+#define xSemaphoreGiveRecursive(sema)        ut_semaphore_op(sema)
+#define vSemaphoreCreateBinary(sema)         ((sema) = (xSemaphoreHandle)1)
+#define xSemaphoreTake(sema, ticks)          ut_semaphore_op(sema)
+#define xSemaphoreGive(sema)                 ut_semaphore_op(sema)
+
+#define vTaskDelay(ticks)                    ((void)(ticks))
+#define taskYIELD()                          ((void)0)
+
+/* Threads of the seqlock test really run in parallel, the lock is spun on */
+#define portENTER_CRITICAL()                 ((void)0)
+#define portEXIT_CRITICAL()                  ((void)0)
+
+portTickType xTaskGetTickCount(void);
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t item_size);
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, portTickType ticks);
+portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, portTickType ticks);
+
+#endif /* FREERTOS_H */
@@ -0,0 +1,7 @@
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+/* Size of the largest object used by the unit test */
+#define UAVOBJECTS_LARGEST 256
+
+#endif /* UAVOBJECTSINIT_H */
@@ -0,0 +1,579 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <stdlib.h> /* abort */
+#include <string.h> /* memset */
+#include <pthread.h> /* pthread_create */
+
+extern "C" {
+#include "openpilot.h"
+#include "uavtalk_priv.h"
+
+extern UAVObjHandle ut_handles[UT_NUM_HANDLES];
+}
+
+#define NUM_OBJS       110
+#define OBJ_MAX_SIZE   200
+#define STREAM_PACKETS 40000
+
+static uint8_t stream[4 * 1024 * 1024];
+static uint32_t stream_len;
+
+static int32_t stream_out(uint8_t *data, int32_t length)
+{
+    if (stream_len + length > sizeof(stream)) {
+        return -1;
+    }
+    memcpy(&stream[stream_len], data, length);
+    stream_len += length;
+    return length;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjectsTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(0, UAVObjInitialize());
+
+        /* Register a flight-like population of objects with hash-like IDs */
+        uint32_t seed = 0x1234567;
+        for (uint32_t i = 0; i < NUM_OBJS; i++) {
+            seed = seed * 1103515245 + 12345;
+            ids[i]     = (seed ^ (seed >> 13)) & 0xFFFFFFFE;
+            sizes[i]   = 4 + (seed >> 8) % (OBJ_MAX_SIZE - 4);
+            handles[i] = UAVObjRegister(ids[i], (i % 8) != 0, false, false, sizes[i], NULL);
+            ut_handles[i] = handles[i];
+            ASSERT_TRUE(handles[i] != NULL);
+        }
+    }
+
+    virtual void TearDown()
+    {}
+
+    /* Telemetry bursts are mostly small objects */
+    uint32_t smallObjects(uint32_t maxSize, uint32_t maxNum, UAVObjHandle *objs, uint32_t *objSizes)
+    {
+        uint32_t num = 0;
+
+        for (uint32_t i = 0; i < NUM_OBJS && num < maxNum; i++) {
+            if (sizes[i] <= maxSize) {
+                objs[num]     = handles[i];
+                objSizes[num] = sizes[i];
+                num++;
+            }
+        }
+        return num;
+    }
+
+    uint32_t ids[NUM_OBJS];
+    uint32_t sizes[NUM_OBJS];
+    UAVObjHandle handles[NUM_OBJS];
+};
+
+TEST_F(UAVObjectsTest, GetByIDFindsDataAndMetaObjects) {
+    for (uint32_t i = 0; i < NUM_OBJS; i++) {
+        EXPECT_EQ(handles[i], UAVObjGetByID(ids[i]));
+        EXPECT_EQ(UAVObjGetLinkedObj(handles[i]), UAVObjGetByID(MetaObjectId(ids[i])));
+        EXPECT_EQ(ids[i], UAVObjGetID(UAVObjGetByID(ids[i])));
+        EXPECT_EQ(MetaObjectId(ids[i]), UAVObjGetID(UAVObjGetByID(MetaObjectId(ids[i]))));
+    }
+}
+
+TEST_F(UAVObjectsTest, GetByIDUnknownObject) {
+    EXPECT_TRUE(UAVObjGetByID(0x0BADF00D) == NULL);
+    EXPECT_TRUE(UAVObjGetByID(0) == NULL);
+}
+
+TEST_F(UAVObjectsTest, DuplicateRegistrationFails) {
+    EXPECT_TRUE(UAVObjRegister(ids[0], true, false, false, sizes[0], NULL) == NULL);
+    EXPECT_EQ(handles[0], UAVObjGetByID(ids[0]));
+}
+
+TEST_F(UAVObjectsTest, MultiInstanceStorageGrowsContiguously) {
+    UAVObjHandle obj = handles[0];
+    uint32_t size    = sizes[0];
+    uint8_t data[OBJ_MAX_SIZE];
+    static uint8_t range[50 * OBJ_MAX_SIZE];
+
+    ASSERT_FALSE(UAVObjIsSingleInstance(obj));
+    memset(data, 0xA5, size);
+    ASSERT_EQ(0, UAVObjSetInstanceData(obj, 0, data));
+
+    /* Unpacking a higher instance creates all instances before it */
+    memset(data, 9, size);
+    ASSERT_EQ(0, UAVObjUnpack(obj, 9, data));
+    EXPECT_EQ(10, UAVObjGetNumInstances(obj));
+    for (uint16_t n = 10; n < 50; n++) {
+        EXPECT_EQ(n, UAVObjCreateInstance(obj, NULL));
+    }
+    ASSERT_EQ(50, UAVObjGetNumInstances(obj));
+
+    /* Existing data survives the storage growing */
+    ASSERT_EQ(0, UAVObjGetInstanceData(obj, 0, data));
+    for (uint32_t i = 0; i < size; i++) {
+        ASSERT_EQ(0xA5, data[i]);
+    }
+
+    for (uint16_t n = 0; n < 50; n++) {
+        memset(data, n, size);
+        ASSERT_EQ(0, UAVObjSetInstanceData(obj, n, data));
+    }
+
+    /* A range read returns the instances packed back to back */
+    ASSERT_EQ(0, UAVObjGetInstanceRange(obj, 5, 40, range));
+    for (uint32_t n = 0; n < 40; n++) {
+        for (uint32_t i = 0; i < size; i++) {
+            ASSERT_EQ(n + 5, range[n * size + i]);
+        }
+    }
+    EXPECT_EQ(0, UAVObjGetInstanceRange(obj, 0, 50, range));
+    EXPECT_EQ(-1, UAVObjGetInstanceRange(obj, 10, 41, range));
+    EXPECT_EQ(-1, UAVObjGetInstanceRange(UAVObjGetLinkedObj(obj), 0, 1, range));
+    EXPECT_EQ(-1, UAVObjGetInstanceData(obj, 50, data));
+}
+
+TEST_F(UAVObjectsTest, ProcessInputStreamInChunks) {
+    UAVTalkConnection tx = UAVTalkInitialize(&stream_out);
+    UAVTalkConnection rx = UAVTalkInitialize(NULL);
+    uint32_t seed = 42;
+
+    ASSERT_TRUE(tx != NULL);
+    ASSERT_TRUE(rx != NULL);
+
+    /* Build a stream of unacked object updates for randomly picked objects */
+    stream_len = 0;
+    uint32_t packets = 0;
+    while (packets < STREAM_PACKETS && stream_len + 2 * OBJ_MAX_SIZE < sizeof(stream)) {
+        seed = seed * 1103515245 + 12345;
+        ASSERT_EQ(0, UAVTalkSendObject(tx, handles[(seed >> 8) % NUM_OBJS], 0, 0, 0));
+        packets++;
+    }
+
+    /* Feed it through the receiver in radio sized chunks */
+    for (uint32_t pos = 0; pos < stream_len; pos += 255) {
+        uint32_t chunk = stream_len - pos < 255 ? stream_len - pos : 255;
+        UAVTalkProcessInputStream(rx, &stream[pos], (uint8_t)chunk);
+    }
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(rx, &stats, false);
+    EXPECT_EQ(packets, stats.rxObjects);
+    EXPECT_EQ(0u, stats.rxErrors);
+}
+
+static uint8_t reply[1024];
+static uint32_t reply_len;
+
+static int32_t reply_out(uint8_t *data, int32_t length)
+{
+    if (reply_len + length > sizeof(reply)) {
+        return -1;
+    }
+    memcpy(&reply[reply_len], data, length);
+    reply_len += length;
+    return length;
+}
+
+static void feed(UAVTalkConnection con, uint8_t *data, uint32_t length)
+{
+    for (uint32_t pos = 0; pos < length; pos += 255) {
+        uint32_t chunk = length - pos < 255 ? length - pos : 255;
+        UAVTalkProcessInputStream(con, &data[pos], (uint8_t)chunk);
+    }
+}
+
+#define PACKED_OBJS     20
+#define PACKED_OBJ_SIZE 64
+
+TEST_F(UAVObjectsTest, PackedObjectsAfterNegotiation) {
+    UAVTalkConnection flight = UAVTalkInitialize(&stream_out);
+    UAVTalkConnection gcs    = UAVTalkInitialize(&reply_out);
+    uint8_t data[OBJ_MAX_SIZE];
+    UAVTalkStats stats;
+    UAVObjHandle objs[PACKED_OBJS];
+    uint32_t objSizes[PACKED_OBJS];
+
+    ASSERT_TRUE(flight != NULL);
+    ASSERT_TRUE(gcs != NULL);
+
+    ASSERT_EQ((uint32_t)PACKED_OBJS, smallObjects(PACKED_OBJ_SIZE, PACKED_OBJS, objs, objSizes));
+
+    /* Without negotiation every object goes out in its own packet */
+    stream_len = 0;
+    uint32_t payload = 0;
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[i], 0));
+        payload += objSizes[i];
+    }
+    ASSERT_EQ(0, UAVTalkFlushPacked(flight));
+    uint32_t single_len = stream_len;
+    EXPECT_EQ(payload + PACKED_OBJS * 11, single_len);
+
+    /* Offer multi object packets, the peer answers */
+    stream_len = 0;
+    reply_len  = 0;
+    ASSERT_EQ(0, UAVTalkAnnounceMultiObject(flight));
+    feed(gcs, stream, stream_len);
+    ASSERT_LT(0u, reply_len);
+    feed(flight, reply, reply_len);
+
+    /* Now the same objects are packed, set them to a known pattern before sending */
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        memset(data, i + 1, objSizes[i]);
+        ASSERT_EQ(0, UAVObjSetInstanceData(objs[i], 0, data));
+    }
+    stream_len = 0;
+    UAVTalkResetStats(flight);
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[i], 0));
+    }
+    ASSERT_EQ(0, UAVTalkFlushPacked(flight));
+    UAVTalkGetStats(flight, &stats, false);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.txObjects);
+    EXPECT_LT(stream_len, single_len);
+
+    /* The receiver unpacks every object */
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        memset(data, 0, objSizes[i]);
+        ASSERT_EQ(0, UAVObjSetInstanceData(objs[i], 0, data));
+    }
+    UAVTalkResetStats(gcs);
+    feed(gcs, stream, stream_len);
+    UAVTalkGetStats(gcs, &stats, false);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.rxObjects);
+    EXPECT_EQ(0u, stats.rxErrors);
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        ASSERT_EQ(0, UAVObjGetInstanceData(objs[i], 0, data));
+        for (uint32_t n = 0; n < objSizes[i]; n++) {
+            ASSERT_EQ(i + 1, data[n]);
+        }
+    }
+
+    /* A new offer falls back to single packets until it is answered */
+    stream_len = 0;
+    ASSERT_EQ(0, UAVTalkAnnounceMultiObject(flight));
+    uint32_t offer_len = stream_len;
+    ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[1], 0));
+    EXPECT_EQ(offer_len + objSizes[1] + 11, stream_len);
+}
+
+TEST_F(UAVObjectsTest, DeltaEncodedUpdates) {
+    UAVTalkConnection flight = UAVTalkInitialize(&stream_out);
+    UAVTalkConnection gcs    = UAVTalkInitialize(&reply_out);
+    uint8_t before[PACKED_OBJS][OBJ_MAX_SIZE];
+    uint8_t data[OBJ_MAX_SIZE];
+    UAVTalkStats stats;
+    UAVObjHandle objs[PACKED_OBJS];
+    uint32_t objSizes[PACKED_OBJS];
+
+    ASSERT_TRUE(flight != NULL);
+    ASSERT_TRUE(gcs != NULL);
+    ASSERT_EQ((uint32_t)PACKED_OBJS, smallObjects(PACKED_OBJ_SIZE, PACKED_OBJS, objs, objSizes));
+    ASSERT_EQ(0, UAVTalkSetDeltaMode(flight, true));
+
+    stream_len = 0;
+    reply_len  = 0;
+    ASSERT_EQ(0, UAVTalkAnnounceMultiObject(flight));
+    feed(gcs, stream, stream_len);
+    feed(flight, reply, reply_len);
+
+    /* The first update of every object is a keyframe */
+    stream_len = 0;
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        for (uint32_t n = 0; n < objSizes[i]; n++) {
+            before[i][n] = i + n;
+        }
+        ASSERT_EQ(0, UAVObjSetInstanceData(objs[i], 0, before[i]));
+        ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[i], 0));
+    }
+    ASSERT_EQ(0, UAVTalkFlushPacked(flight));
+    uint32_t full_len = stream_len;
+
+    /* Then only the changed words are sent, like one float changing in a state object */
+    stream_len = 0;
+    UAVTalkResetStats(flight);
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        memcpy(data, before[i], objSizes[i]);
+        data[objSizes[i] / 2] ^= 0xFF;
+        ASSERT_EQ(0, UAVObjSetInstanceData(objs[i], 0, data));
+        ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[i], 0));
+    }
+    ASSERT_EQ(0, UAVTalkFlushPacked(flight));
+    UAVTalkGetStats(flight, &stats, false);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.txObjects);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.txDeltaObjects);
+    EXPECT_LT(stream_len * 3, full_len);
+
+    uint32_t raw, sent;
+    ASSERT_EQ(0, UAVTalkGetDeltaStats(flight, UAVObjGetID(objs[0]), 0, &raw, &sent));
+    EXPECT_EQ(2 * objSizes[0], raw);
+    EXPECT_LT(sent, raw);
+    EXPECT_EQ(-1, UAVTalkGetDeltaStats(flight, UAVObjGetID(objs[0]), 1, &raw, &sent));
+
+    /* The receiver patches the deltas into the data it had */
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        ASSERT_EQ(0, UAVObjSetInstanceData(objs[i], 0, before[i]));
+    }
+    UAVTalkResetStats(gcs);
+    feed(gcs, stream, stream_len);
+    UAVTalkGetStats(gcs, &stats, false);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.rxObjects);
+    EXPECT_EQ((uint32_t)PACKED_OBJS, stats.rxDeltaObjects);
+    EXPECT_EQ(0u, stats.rxErrors);
+    for (uint32_t i = 0; i < PACKED_OBJS; i++) {
+        ASSERT_EQ(0, UAVObjGetInstanceData(objs[i], 0, data));
+        before[i][objSizes[i] / 2] ^= 0xFF;
+        ASSERT_EQ(0, memcmp(before[i], data, objSizes[i]));
+    }
+
+    /* Keyframes are sent periodically */
+    UAVTalkResetStats(flight);
+    for (uint32_t n = 0; n < 2 * UAVTALK_DELTA_KEYFRAME_INTERVAL; n++) {
+        ASSERT_EQ(0, UAVTalkSendObjectPacked(flight, objs[0], 0));
+    }
+    UAVTalkGetStats(flight, &stats, false);
+    EXPECT_EQ(2u * UAVTALK_DELTA_KEYFRAME_INTERVAL - 2, stats.txDeltaObjects);
+}
+
+#define SEQ_OBJ_SIZE   1024
+#define SEQ_ITERATIONS 100000
+
+static volatile bool writer_done;
+
+static void *seq_writer(void *arg)
+{
+    UAVObjHandle obj = (UAVObjHandle)arg;
+    uint8_t data[SEQ_OBJ_SIZE];
+
+    for (uint32_t n = 0; n < SEQ_ITERATIONS; n++) {
+        memset(data, n & 0xFF, sizeof(data));
+        UAVObjSetData(obj, data);
+    }
+    writer_done = true;
+    return NULL;
+}
+
+TEST_F(UAVObjectsTest, ConcurrentReadsAreNeverTorn) {
+    UAVObjHandle obj = UAVObjRegister(0xC0FFEE00, true, false, false, SEQ_OBJ_SIZE, NULL);
+    pthread_t writer;
+    uint8_t data[SEQ_OBJ_SIZE];
+    uint32_t torn  = 0;
+    uint32_t reads = 0;
+
+    ASSERT_TRUE(obj != NULL);
+    ut_handles[NUM_OBJS] = obj;
+
+    writer_done = false;
+    ASSERT_EQ(0, pthread_create(&writer, NULL, seq_writer, obj));
+    while (!writer_done) {
+        UAVObjGetData(obj, data);
+        for (uint32_t i = 1; i < sizeof(data); i++) {
+            if (data[i] != data[0]) {
+                torn++;
+                break;
+            }
+        }
+        reads++;
+    }
+    pthread_join(writer, NULL);
+
+    EXPECT_GT(reads, 0u);
+    EXPECT_EQ(0u, torn);
+}
+
+TEST_F(UAVObjectsTest, BorrowAndCommit) {
+    UAVObjHandle obj = UAVObjRegister(0xB0AA0000, true, false, false, SEQ_OBJ_SIZE, NULL);
+    uint8_t data[SEQ_OBJ_SIZE];
+    uint32_t version;
+
+    ASSERT_TRUE(obj != NULL);
+    ut_handles[NUM_OBJS + 1] = obj;
+
+    /* A write borrow starts from the current data and only shows up once committed */
+    memset(data, 0x11, SEQ_OBJ_SIZE);
+    ASSERT_EQ(0, UAVObjSetData(obj, data));
+    uint8_t *out = (uint8_t *)UAVObjBorrowInstanceDataWrite(obj, 0);
+    ASSERT_TRUE(out != NULL);
+    EXPECT_EQ(0x11, out[SEQ_OBJ_SIZE - 1]);
+    memset(out, 0x5A, SEQ_OBJ_SIZE / 2);
+    ASSERT_EQ(0, UAVObjGetData(obj, data));
+    EXPECT_EQ(0x11, data[0]);
+    EXPECT_EQ(0, UAVObjCommitInstanceData(obj, 0));
+    ASSERT_EQ(0, UAVObjGetData(obj, data));
+    EXPECT_EQ(0x5A, data[0]);
+    EXPECT_EQ(0x11, data[SEQ_OBJ_SIZE - 1]);
+
+    /* The copy is reused once committed */
+    out = (uint8_t *)UAVObjBorrowInstanceDataWrite(obj, 0);
+    ASSERT_TRUE(out != NULL);
+    memset(out, 0x5A, SEQ_OBJ_SIZE);
+    EXPECT_EQ(0, UAVObjCommitInstanceData(obj, 0));
+    ASSERT_EQ(0, UAVObjGetData(obj, data));
+    EXPECT_EQ(0x5A, data[0]);
+    EXPECT_EQ(0x5A, data[SEQ_OBJ_SIZE - 1]);
+
+    /* A read borrow sees the live data and is invalidated by any write */
+    const uint8_t *in = (const uint8_t *)UAVObjBorrowInstanceData(obj, 0, &version);
+    ASSERT_TRUE(in != NULL);
+    EXPECT_EQ(0x5A, in[SEQ_OBJ_SIZE / 2]);
+    EXPECT_TRUE(UAVObjBorrowValid(obj, version));
+    ASSERT_EQ(0, UAVObjSetData(obj, data));
+    EXPECT_FALSE(UAVObjBorrowValid(obj, version));
+
+    EXPECT_TRUE(UAVObjBorrowInstanceData(obj, 1, &version) == NULL);
+    EXPECT_TRUE(UAVObjBorrowInstanceData(UAVObjGetLinkedObj(obj), 0, &version) == NULL);
+    EXPECT_TRUE(UAVObjBorrowInstanceDataWrite(obj, 1) == NULL);
+
+    /* Read only objects can't be borrowed for writing */
+    UAVObjMetadata mdata;
+    ASSERT_EQ(0, UAVObjGetMetadata(obj, &mdata));
+    UAVObjSetAccess(&mdata, ACCESS_READONLY);
+    ASSERT_EQ(0, UAVObjSetMetadata(obj, &mdata));
+    EXPECT_TRUE(UAVObjBorrowInstanceDataWrite(obj, 0) == NULL);
+    UAVObjSetAccess(&mdata, ACCESS_READWRITE);
+    ASSERT_EQ(0, UAVObjSetMetadata(obj, &mdata));
+}
+
+#define COALESCE_UPDATES 500
+
+TEST_F(UAVObjectsTest, CoalescedQueueKeepsOneUpdatePerInstance) {
+    UAVObjHandle fast = UAVObjRegister(0xC0A1E500, true, false, false, 16, NULL);
+    UAVObjHandle multi = UAVObjRegister(0xC0A1E600, false, false, false, 8, NULL);
+    uint8_t data[16] = { 0 };
+    UAVObjEvent ev;
+    UAVObjStats stats;
+
+    ASSERT_TRUE(fast != NULL);
+    ASSERT_TRUE(multi != NULL);
+    ut_handles[NUM_OBJS + 2] = fast;
+    ut_handles[NUM_OBJS + 3] = multi;
+    ASSERT_EQ(1, UAVObjCreateInstance(multi, NULL));
+
+    xQueueHandle plain     = xQueueCreate(8, sizeof(UAVObjEvent));
+    xQueueHandle coalesced = xQueueCreate(8, sizeof(UAVObjEvent));
+    ASSERT_EQ(0, UAVObjConnectQueue(fast, plain, EV_MASK_ALL_UPDATES));
+    ASSERT_EQ(0, UAVObjConnectQueueCoalesced(fast, coalesced, EV_MASK_ALL_UPDATES));
+    ASSERT_EQ(0, UAVObjConnectQueueCoalesced(multi, coalesced, EV_MASK_ALL_UPDATES));
+    UAVObjClearStats();
+
+    /* A fast object floods the plain queue but takes one slot in the coalescing one */
+    for (uint32_t n = 0; n < COALESCE_UPDATES; n++) {
+        data[0] = n;
+        ASSERT_EQ(0, UAVObjSetData(fast, data));
+    }
+    UAVObjGetStats(&stats);
+    EXPECT_EQ((uint32_t)COALESCE_UPDATES - 8, stats.eventQueueErrors);
+    EXPECT_EQ((uint32_t)COALESCE_UPDATES - 1, stats.eventsCoalesced);
+
+    /* Slower objects still get through, per instance, and other events are never merged */
+    ASSERT_EQ(0, UAVObjSetInstanceData(multi, 0, data));
+    ASSERT_EQ(0, UAVObjSetInstanceData(multi, 1, data));
+    ASSERT_EQ(0, UAVObjSetInstanceData(multi, 1, data));
+    UAVObjInstanceUpdated(multi, 1);
+    UAVObjInstanceUpdated(multi, 1);
+
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_TRUE(ev.obj == fast);
+    ASSERT_EQ(0, UAVObjGetData(fast, data));
+    EXPECT_EQ((uint8_t)(COALESCE_UPDATES - 1), data[0]);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_TRUE(ev.obj == multi && ev.instId == 0 && ev.event == EV_UPDATED);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_TRUE(ev.obj == multi && ev.instId == 1 && ev.event == EV_UPDATED);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_EQ(EV_UPDATED_MANUAL, ev.event);
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_EQ(EV_UPDATED_MANUAL, ev.event);
+    EXPECT_EQ(pdFALSE, UAVObjQueueReceive(coalesced, &ev, 0));
+
+    /* Once received, the next update is queued again */
+    ASSERT_EQ(0, UAVObjSetData(fast, data));
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(coalesced, &ev, 0));
+    EXPECT_TRUE(ev.obj == fast);
+}
+
+TEST_F(UAVObjectsTest, DisconnectedQueuesGetNoEvents) {
+    UAVObjHandle obj = UAVObjRegister(0xD15C0000, true, false, false, 16, NULL);
+    uint8_t data[16] = { 0 };
+    UAVObjEvent ev;
+
+    ASSERT_TRUE(obj != NULL);
+    ut_handles[NUM_OBJS + 4] = obj;
+
+    xQueueHandle first  = xQueueCreate(8, sizeof(UAVObjEvent));
+    xQueueHandle second = xQueueCreate(8, sizeof(UAVObjEvent));
+    ASSERT_EQ(0, UAVObjConnectQueue(obj, first, EV_MASK_ALL_UPDATES));
+    ASSERT_EQ(0, UAVObjDisconnectQueue(obj, first));
+    EXPECT_EQ(-1, UAVObjDisconnectQueue(obj, first));
+    ASSERT_EQ(0, UAVObjSetData(obj, data));
+    EXPECT_EQ(pdFALSE, UAVObjQueueReceive(first, &ev, 0));
+
+    /* The entry left behind by the disconnect is taken over by the next connection */
+    ASSERT_EQ(0, UAVObjConnectQueue(obj, second, EV_MASK_ALL_UPDATES));
+    ASSERT_EQ(0, UAVObjSetData(obj, data));
+    EXPECT_EQ(pdFALSE, UAVObjQueueReceive(first, &ev, 0));
+    ASSERT_EQ(pdTRUE, UAVObjQueueReceive(second, &ev, 0));
+    EXPECT_TRUE(ev.obj == obj && ev.event == EV_UPDATED);
+    EXPECT_EQ(pdFALSE, UAVObjQueueReceive(second, &ev, 0));
+}
+
+TEST_F(UAVObjectsTest, DISABLED_BenchmarkProcessInputStream) {
+    UAVTalkConnection tx = UAVTalkInitialize(&stream_out);
+    UAVTalkConnection rx = UAVTalkInitialize(NULL);
+    uint32_t seed = 42;
+
+    ASSERT_TRUE(tx != NULL);
+    ASSERT_TRUE(rx != NULL);
+
+    stream_len = 0;
+    uint32_t packets = 0;
+    while (packets < STREAM_PACKETS && stream_len + 2 * OBJ_MAX_SIZE < sizeof(stream)) {
+        seed = seed * 1103515245 + 12345;
+        ASSERT_EQ(0, UAVTalkSendObject(tx, handles[(seed >> 8) % NUM_OBJS], 0, 0, 0));
+        packets++;
+    }
+
+    double start = bench_seconds();
+    for (uint32_t pos = 0; pos < stream_len; pos += 255) {
+        uint32_t chunk = stream_len - pos < 255 ? stream_len - pos : 255;
+        UAVTalkProcessInputStream(rx, &stream[pos], (uint8_t)chunk);
+    }
+    double elapsed = bench_seconds() - start;
+
+    printf("[ UAVTALK  ] UAVTalkProcessInputStream: %u packets, %u bytes in %.3f s, %.0f packets/s\n",
+           packets, stream_len, elapsed, packets / elapsed);
+}
+
+#define BORROW_ITERATIONS 200000
+
+TEST_F(UAVObjectsTest, DISABLED_BenchmarkBorrowAgainstCopy) {
+    UAVObjHandle obj = UAVObjRegister(0xB0AA0000, true, false, false, SEQ_OBJ_SIZE, NULL);
+    uint8_t data[SEQ_OBJ_SIZE];
+    const uint8_t *in;
+    uint32_t version;
+
+    ASSERT_TRUE(obj != NULL);
+    ut_handles[NUM_OBJS + 1] = obj;
+
+    /* Read two fields of a large object via a copy and via a borrow */
+    volatile uint32_t sum = 0;
+    double start = bench_seconds();
+    for (uint32_t n = 0; n < BORROW_ITERATIONS; n++) {
+        UAVObjGetData(obj, data);
+        sum += data[0] + data[SEQ_OBJ_SIZE - 1];
+    }
+    double copy = bench_seconds() - start;
+
+    start = bench_seconds();
+    for (uint32_t n = 0; n < BORROW_ITERATIONS; n++) {
+        do {
+            in   = (const uint8_t *)UAVObjBorrowInstanceData(obj, 0, &version);
+            sum += in[0] + in[SEQ_OBJ_SIZE - 1];
+        } while (!UAVObjBorrowValid(obj, version));
+    }
+    double borrow = bench_seconds() - start;
+
+    printf("[ UAVOBJ   ] %u byte object, %u reads: copy %.1f ns/read, borrow %.1f ns/read\n",
+           SEQ_OBJ_SIZE, BORROW_ITERATIONS, copy * 1e9 / BORROW_ITERATIONS, borrow * 1e9 / BORROW_ITERATIONS);
+}
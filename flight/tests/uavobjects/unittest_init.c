@@ -0,0 +1,64 @@
+/*
+ * Host side stand-ins for the parts of the flight environment used by
+ * the UAVObject manager and UAVTalk.
+ */
+
+#include "openpilot.h"
+
+/* Handle slots for the objects registered by the test, as the generated object code does */
+UAVObjHandle ut_handles[UT_NUM_HANDLES] __attribute__((section("_uavo_handles"), used));
+
+static portTickType ut_ticks;
+
+portTickType xTaskGetTickCount(void)
+{
+    return ut_ticks++;
+}
+
+struct ut_queue {
+    uint32_t length;
+    uint32_t item_size;
+    uint32_t head;
+    uint32_t count;
+    uint8_t  items[];
+};
+
+xQueueHandle xQueueCreate(uint32_t length, uint32_t item_size)
+{
+    struct ut_queue *queue = (struct ut_queue *)malloc(sizeof(struct ut_queue) + length * item_size);
+
+    if (queue) {
+        queue->length    = length;
+        queue->item_size = item_size;
+        queue->head  = 0;
+        queue->count = 0;
+    }
+    return queue;
+}
+
+portBASE_TYPE xQueueSend(xQueueHandle queue, const void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (queue->count == queue->length) {
+        return pdFALSE;
+    }
+    uint32_t tail = (queue->head + queue->count) % queue->length;
+    memcpy(&queue->items[tail * queue->item_size], item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+portBASE_TYPE xQueueReceive(xQueueHandle queue, void *item, __attribute__((unused)) portTickType ticks)
+{
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+int32_t EventCallbackDispatch(__attribute__((unused)) UAVObjEvent *ev, __attribute__((unused)) UAVObjEventCallback cb)
+{
+    return pdTRUE;
+}
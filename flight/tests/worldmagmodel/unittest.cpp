@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+#include "benchmark.h"
+
+#include <math.h> /* sqrtf */
+#include <stdlib.h> /* rand */
+
+extern "C" {
+#include <stdint.h>
+#include "WorldMagModel.h"
+#include "WorldMagModelCache.h"
+}
+
+#define MONTH      6
+#define DAY        15
+#define YEAR       2017
+#define ITERATIONS 2000
+
+/* Grid refresh steps, every node plus every cell centre */
+#define REFRESH_STEPS \
+    (WMM_CACHE_NODES * WMM_CACHE_NODES * WMM_CACHE_NODES + \
+     (WMM_CACHE_NODES - 1) * (WMM_CACHE_NODES - 1) * (WMM_CACHE_NODES - 1))
+
+static float distance(const float a[3], const float b[3])
+{
+    return sqrtf((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class WorldMagModelCacheTest : public testing::Test {
+protected:
+    virtual void SetUp()
+    {
+        WMM_CacheInvalidate();
+        srand(1234);
+    }
+
+    virtual void TearDown()
+    {}
+
+    // run the background refresh to completion, returns the number of steps it took
+    int refresh(uint16_t month = MONTH, uint16_t day = DAY, uint16_t year = YEAR)
+    {
+        int steps = 0;
+
+        while (WMM_CacheUpdate(month, day, year) > 0) {
+            steps++;
+            if (steps > 1000) {
+                break;
+            }
+        }
+        return steps + 1;
+    }
+
+    static float random(float min, float max)
+    {
+        return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+    }
+};
+
+TEST_F(WorldMagModelCacheTest, EmptyUntilRefreshed) {
+    float B[3] = { 1.0f, 2.0f, 3.0f };
+
+    EXPECT_EQ(0, WMM_CacheUpdate(MONTH, DAY, YEAR)); // nothing asked for yet
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(47.0f, 8.0f, 500.0f, B));
+    EXPECT_EQ(1.0f, B[0]);
+    EXPECT_EQ(-1.0f, WMM_CacheGetErrorBound());
+
+    // the miss asked for a grid, one model evaluation per step
+    EXPECT_EQ(REFRESH_STEPS, refresh());
+    EXPECT_EQ(0, WMM_CacheGetMagVector(47.0f, 8.0f, 500.0f, B));
+    EXPECT_GE(WMM_CacheGetErrorBound(), 0.0f);
+
+    // and nothing more to do
+    EXPECT_EQ(0, WMM_CacheUpdate(MONTH, DAY, YEAR));
+}
+
+TEST_F(WorldMagModelCacheTest, MatchesFullModel) {
+    // mid latitudes, both poles (the grid is kept inside), the date line and the south atlantic anomaly
+    static const float sites[][3] = {
+        { 47.0f,  8.0f,   500.0f  },
+        { -33.9f, 151.2f, 50.0f   },
+        { 64.1f,  -21.9f, 0.0f    },
+        { 89.9f,  45.0f,  100.0f  },
+        { -89.9f, -120.0f, 2800.0f },
+        { 0.0f,   179.9f, 10000.0f },
+        { -26.0f, -50.0f, 300.0f  },
+    };
+
+    for (unsigned s = 0; s < sizeof(sites) / sizeof(sites[0]); s++) {
+        const float *site = sites[s];
+        float B[3];
+
+        WMM_CacheInvalidate();
+        WMM_CacheRequest(site[0], site[1], site[2]);
+        refresh();
+        ASSERT_EQ(0, WMM_CacheGetMagVector(site[0], site[1], site[2], B)) << "site " << s;
+
+        const float bound = WMM_CacheGetErrorBound();
+        for (int n = 0; n < ITERATIONS; n++) {
+            // anywhere inside the grid, the poles are clamped by the model range
+            float lat = site[0] + random(-1.0f, 1.0f) * WMM_CACHE_LAT_SPACING;
+            float lon = site[1] + random(-1.0f, 1.0f) * WMM_CACHE_LON_SPACING;
+            float alt = site[2] + random(-1.0f, 1.0f) * WMM_CACHE_ALT_SPACING;
+            lat = lat > 90.0f ? 90.0f : (lat < -90.0f ? -90.0f : lat);
+            lon = lon > 180.0f ? lon - 360.0f : lon;
+
+            float cached[3];
+            float model[3];
+            if (WMM_CacheGetMagVector(lat, lon, alt, cached) < 0) {
+                continue; // past the clamped grid at the poles
+            }
+            ASSERT_EQ(0, WMM_GetMagVector(lat, lon, alt, MONTH, DAY, YEAR, model));
+
+            const float error = distance(cached, model);
+            // the bound is measured where interpolation is worst, allow for the model's float noise
+            ASSERT_LE(error, 2.0f * bound + 0.05f) << "site " << s << " lat " << lat << " lon " << lon << " alt " << alt;
+        }
+        // well below what the magnetometers resolve (1 here is 100nT), except
+        // next to the poles where north swings around within the grid
+        if (fabsf(site[0]) < 80.0f) {
+            EXPECT_LT(bound, 0.5f) << "site " << s;
+        }
+    }
+}
+
+TEST_F(WorldMagModelCacheTest, FollowsTheVehicle) {
+    float B[3];
+    float model[3];
+
+    WMM_CacheRequest(47.0f, 8.0f, 500.0f);
+    refresh();
+
+    // near the edge is still served, but moves the grid along
+    const float lat = 47.0f + 0.8f * WMM_CACHE_LAT_SPACING;
+    EXPECT_EQ(0, WMM_CacheGetMagVector(lat, 8.0f, 500.0f, B));
+    EXPECT_EQ(REFRESH_STEPS, refresh());
+    EXPECT_EQ(0, WMM_CacheGetMagVector(lat + 0.9f * WMM_CACHE_LAT_SPACING, 8.0f, 500.0f, B));
+
+    // well outside is a miss until the refresh has run
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(-20.0f, 30.0f, 0.0f, B));
+    EXPECT_EQ(1, WMM_CacheUpdate(MONTH, DAY, YEAR));
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(-20.0f, 30.0f, 0.0f, B));
+    refresh();
+    ASSERT_EQ(0, WMM_CacheGetMagVector(-20.0f, 30.0f, 0.0f, B));
+    ASSERT_EQ(0, WMM_GetMagVector(-20.0f, 30.0f, 0.0f, MONTH, DAY, YEAR, model));
+    EXPECT_LT(distance(B, model), 0.05f); // on a node
+}
+
+TEST_F(WorldMagModelCacheTest, RebuildsWhenTheMonthChanges) {
+    float B[3];
+    float model[3];
+
+    WMM_CacheRequest(47.0f, 8.0f, 500.0f);
+    refresh();
+    EXPECT_EQ(0, WMM_CacheUpdate(MONTH, DAY + 1, YEAR));
+    EXPECT_EQ(1, WMM_CacheUpdate(MONTH, DAY, YEAR + 2));
+    refresh(MONTH, DAY, YEAR + 2);
+
+    ASSERT_EQ(0, WMM_CacheGetMagVector(47.0f, 8.0f, 500.0f, B));
+    ASSERT_EQ(0, WMM_GetMagVector(47.0f, 8.0f, 500.0f, MONTH, DAY, YEAR + 2, model));
+    EXPECT_LT(distance(B, model), 0.05f);
+}
+
+TEST_F(WorldMagModelCacheTest, IgnoresBadLocations) {
+    float B[3];
+
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(NAN, 8.0f, 500.0f, B));
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(95.0f, 8.0f, 500.0f, B));
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(47.0f, 200.0f, 500.0f, B));
+    EXPECT_EQ(0, WMM_CacheUpdate(MONTH, DAY, YEAR));
+
+    WMM_CacheRequest(47.0f, 8.0f, 500.0f);
+    refresh();
+    EXPECT_EQ(-1, WMM_CacheGetMagVector(47.0f, 8.0f, NAN, B));
+    EXPECT_EQ(0, WMM_CacheUpdate(MONTH, DAY, YEAR));
+}
+
+TEST_F(WorldMagModelCacheTest, DISABLED_Benchmark) {
+    static float points[ITERATIONS][3];
+    volatile float sink = 0.0f;
+    float B[3];
+
+    WMM_CacheRequest(47.0f, 8.0f, 500.0f);
+    refresh();
+    for (int n = 0; n < ITERATIONS; n++) {
+        points[n][0] = 47.0f + random(-0.5f, 0.5f) * WMM_CACHE_LAT_SPACING;
+        points[n][1] = 8.0f + random(-0.5f, 0.5f) * WMM_CACHE_LON_SPACING;
+        points[n][2] = 500.0f + random(-0.5f, 0.5f) * WMM_CACHE_ALT_SPACING;
+    }
+
+    uint64_t start = bench_cycles();
+    for (int n = 0; n < ITERATIONS; n++) {
+        WMM_GetMagVector(points[n][0], points[n][1], points[n][2], MONTH, DAY, YEAR, B);
+        sink = B[0];
+    }
+    double model = (double)(bench_cycles() - start) / ITERATIONS;
+
+    uint64_t worst = 0;
+    start = bench_cycles();
+    for (int n = 0; n < ITERATIONS; n++) {
+        uint64_t t = bench_cycles();
+        WMM_CacheGetMagVector(points[n][0], points[n][1], points[n][2], B);
+        t     = bench_cycles() - t;
+        worst = t > worst ? t : worst;
+        sink  = B[0];
+    }
+    double cached = (double)(bench_cycles() - start) / ITERATIONS;
+    (void)sink;
+
+    printf("[ WMM      ] per lookup: full model %.0f cycles  cached grid %.0f cycles (worst %llu)\n",
+           model, cached, (unsigned long long)worst);
+}
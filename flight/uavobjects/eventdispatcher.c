@@ -44,6 +44,9 @@
 #define CALLBACK_PRIORITY    CALLBACK_PRIORITY_CRITICAL
 #define TASK_PRIORITY        CALLBACK_TASK_FLIGHTCONTROL
 #define MAX_UPDATE_PERIOD_MS 1000
+#define HASH_BUCKETS         16 // must be a power of 2
+#define HEAP_MIN_SIZE        8
+#define NOT_SCHEDULED        0xFFFF
 
 // Private types
 
@@ -60,17 +63,25 @@ typedef struct {
 
 /**
  * List of object properties that are needed for the periodic updates.
+ * Entries are found through a small hash table (chained on next) and the
+ * ones with a period are kept in a binary min-heap ordered by the time of
+ * their next update, so only the due entries are touched on each wakeup.
  */
 struct PeriodicObjectListStruct {
     EventCallbackInfo evInfo; /** Event callback information */
     uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
-    int32_t  timeToNextUpdateMs; /** Time delay to the next update */
+    uint16_t heapIndex; /** Position in mHeap or NOT_SCHEDULED */
+    int32_t  timeToNextUpdateMs; /** System time of the next update */
     struct PeriodicObjectListStruct *next; /** Needed by linked list library (utlist.h) */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
 // Private variables
-static PeriodicObjectList *mObjList;
+static PeriodicObjectList *mObjHash[HASH_BUCKETS];
+static PeriodicObjectList * *mHeap;
+static uint16_t mHeapCount;
+static uint16_t mHeapSize;
+static uint32_t mTimeToNextUpdateMs;
 static xQueueHandle mQueue;
 static DelayedCallbackInfo *eventSchedulerCallback;
 static xSemaphoreHandle mMutex;
@@ -82,6 +93,14 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static PeriodicObjectList * *hashBucket(UAVObjEvent *ev);
+static PeriodicObjectList *findEntry(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue);
+static void schedule(PeriodicObjectList *objEntry, int32_t timeToNextUpdateMs);
+static void wakeUpBefore(PeriodicObjectList *objEntry);
+static int32_t heapInsert(PeriodicObjectList *objEntry);
+static void heapRemove(PeriodicObjectList *objEntry);
+static void heapSiftUp(uint16_t index);
+static void heapSiftDown(uint16_t index);
 
 
 /**
@@ -91,7 +110,11 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
     // Initialize variables
-    mObjList = NULL;
+    memset(mObjHash, 0, sizeof(mObjHash));
+    mHeap      = NULL;
+    mHeapCount = 0;
+    mHeapSize  = 0;
+    mTimeToNextUpdateMs = 0;
     memset(&mStats, 0, sizeof(EventStats));
 
     // Create mMutex
@@ -216,31 +239,35 @@ static int32_t eventPeriodicCreate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
     // Check that the object is not already connected
-    LL_FOREACH(mObjList, objEntry) {
-        if (objEntry->evInfo.cb == cb &&
-            objEntry->evInfo.queue == queue &&
-            objEntry->evInfo.ev.obj == ev->obj &&
-            objEntry->evInfo.ev.instId == ev->instId &&
-            objEntry->evInfo.ev.event == ev->event) {
-            // Already registered, do nothing
-            xSemaphoreGiveRecursive(mMutex);
-            return -1;
-        }
+    if (findEntry(ev, cb, queue) != NULL) {
+        // Already registered, do nothing
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
     }
     // Create handle
     objEntry = (PeriodicObjectList *)pios_malloc(sizeof(PeriodicObjectList));
     if (objEntry == NULL) {
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
+    }
+    objEntry->evInfo.ev.obj    = ev->obj;
+    objEntry->evInfo.ev.instId = ev->instId;
+    objEntry->evInfo.ev.event  = ev->event;
+    objEntry->evInfo.ev.lowPriority = ev->lowPriority;
+    objEntry->evInfo.cb    = cb;
+    objEntry->evInfo.queue = queue;
+    objEntry->updatePeriodMs = periodMs;
+    objEntry->heapIndex      = NOT_SCHEDULED;
+    // Make sure the heap has room for it before making it visible
+    if (periodMs > 0 && heapInsert(objEntry) != 0) {
+        pios_free(objEntry);
+        xSemaphoreGiveRecursive(mMutex);
         return -1;
     }
-    objEntry->evInfo.ev.obj      = ev->obj;
-    objEntry->evInfo.ev.instId   = ev->instId;
-    objEntry->evInfo.ev.event    = ev->event;
-    objEntry->evInfo.cb = cb;
-    objEntry->evInfo.queue       = queue;
-    objEntry->updatePeriodMs     = periodMs;
-    objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
-    // Add to list
-    LL_APPEND(mObjList, objEntry);
+    schedule(objEntry, xTaskGetTickCount() * portTICK_RATE_MS + randomizePeriod(periodMs)); // avoid bunching of updates
+    // Add to hash table
+    LL_PREPEND(*hashBucket(ev), objEntry);
+    wakeUpBefore(objEntry);
     // Release lock
     xSemaphoreGiveRecursive(mMutex);
     return 0;
@@ -261,23 +288,25 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
     // Find object
-    LL_FOREACH(mObjList, objEntry) {
-        if (objEntry->evInfo.cb == cb &&
-            objEntry->evInfo.queue == queue &&
-            objEntry->evInfo.ev.obj == ev->obj &&
-            objEntry->evInfo.ev.instId == ev->instId &&
-            objEntry->evInfo.ev.event == ev->event) {
-            // Object found, update period
-            objEntry->updatePeriodMs     = periodMs;
-            objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
-            // Release lock
-            xSemaphoreGiveRecursive(mMutex);
-            return 0;
-        }
+    objEntry = findEntry(ev, cb, queue);
+    if (objEntry == NULL) {
+        // If this point is reached the object was not found
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
     }
-    // If this point is reached the object was not found
+    // Object found, update period
+    if (periodMs == 0) {
+        heapRemove(objEntry);
+    } else if (objEntry->heapIndex == NOT_SCHEDULED && heapInsert(objEntry) != 0) {
+        xSemaphoreGiveRecursive(mMutex);
+        return -1;
+    }
+    objEntry->updatePeriodMs = periodMs;
+    schedule(objEntry, xTaskGetTickCount() * portTICK_RATE_MS + randomizePeriod(periodMs)); // avoid bunching of updates
+    wakeUpBefore(objEntry);
+    // Release lock
     xSemaphoreGiveRecursive(mMutex);
-    return -1;
+    return 0;
 }
 
 /**
@@ -285,7 +314,6 @@ static int32_t eventPeriodicUpdate(UAVObjEvent *ev, UAVObjEventCallback cb, xQue
  */
 static void eventTask()
 {
-    static uint32_t timeToNextUpdateMs = 0;
     EventCallbackInfo evInfo;
 
     // Wait for queue message
@@ -302,16 +330,18 @@ static void eventTask()
         }
     }
 
-    // Process periodic updates
-    if ((xTaskGetTickCount() * portTICK_RATE_MS) >= timeToNextUpdateMs) {
-        timeToNextUpdateMs = processPeriodicUpdates();
+    // Process periodic updates, wakeUpBefore() may move the next update forward meanwhile
+    xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
+    if ((xTaskGetTickCount() * portTICK_RATE_MS) >= mTimeToNextUpdateMs) {
+        mTimeToNextUpdateMs = processPeriodicUpdates();
     }
 
-    PIOS_CALLBACKSCHEDULER_Schedule(eventSchedulerCallback, timeToNextUpdateMs - (xTaskGetTickCount() * portTICK_RATE_MS), CALLBACK_UPDATEMODE_SOONER);
+    PIOS_CALLBACKSCHEDULER_Schedule(eventSchedulerCallback, mTimeToNextUpdateMs - (xTaskGetTickCount() * portTICK_RATE_MS), CALLBACK_UPDATEMODE_SOONER);
+    xSemaphoreGiveRecursive(mMutex);
 }
 
 /**
- * Handle periodic updates for all objects.
+ * Handle periodic updates for all due objects.
  * \return The system time until the next update (in ms) or -1 if failed
  */
 static int32_t processPeriodicUpdates()
@@ -319,49 +349,211 @@ static int32_t processPeriodicUpdates()
     PeriodicObjectList *objEntry;
     int32_t timeNow;
     int32_t timeToNextUpdate;
-    int32_t offset;
+    uint32_t jitter;
 
     // Get lock
     xSemaphoreTakeRecursive(mMutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(mObjList, objEntry) {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0) {
-            // Check if time for the next update
-            timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow) {
-                // Reset timer
-                offset = (timeNow - objEntry->timeToNextUpdateMs) % objEntry->updatePeriodMs;
-                objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-                // Invoke callback, if one
-                if (objEntry->evInfo.cb != 0) {
-                    objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-                }
-                // Push event to queue, if one
-                if (objEntry->evInfo.queue != 0) {
-                    if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
-                        if (objEntry->evInfo.ev.obj != NULL) {
-                            mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-                        }
-                        ++mStats.eventErrors;
-                    }
+    // Pop the due objects off the heap, reschedule and dispatch them.
+    // Limit the loop to the number of objects in case callbacks keep rescheduling themselves.
+    timeNow = xTaskGetTickCount() * portTICK_RATE_MS;
+    for (uint16_t limit = mHeapCount; limit > 0 && mHeapCount > 0 && mHeap[0]->timeToNextUpdateMs <= timeNow; --limit) {
+        objEntry = mHeap[0];
+
+        // Keep track of how late the update is
+        jitter = timeNow - objEntry->timeToNextUpdateMs;
+        ++mStats.periodicEvents;
+        mStats.totalJitterMs += jitter;
+        if (jitter > mStats.maxJitterMs) {
+            mStats.maxJitterMs = jitter;
+        }
+
+        // Reset timer, skip missed updates but stay in phase
+        schedule(objEntry, timeNow + objEntry->updatePeriodMs - jitter % objEntry->updatePeriodMs);
+
+        // Invoke callback, if one
+        if (objEntry->evInfo.cb != 0) {
+            objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+        }
+        // Push event to queue, if one
+        if (objEntry->evInfo.queue != 0) {
+            if (xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE && !objEntry->evInfo.ev.lowPriority) { // do not block if queue is full
+                if (objEntry->evInfo.ev.obj != NULL) {
+                    mStats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
                 }
-            }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate) {
-                timeToNextUpdate = objEntry->timeToNextUpdateMs;
+                ++mStats.eventErrors;
             }
         }
     }
 
+    // Calculate the delay to the next update
+    timeToNextUpdate = xTaskGetTickCount() * portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
+    if (mHeapCount > 0 && mHeap[0]->timeToNextUpdateMs < timeToNextUpdate) {
+        timeToNextUpdate = mHeap[0]->timeToNextUpdateMs;
+    }
+
     // Done
     xSemaphoreGiveRecursive(mMutex);
     return timeToNextUpdate;
 }
 
+/**
+ * Get the hash table bucket for an event
+ */
+static PeriodicObjectList * *hashBucket(UAVObjEvent *ev)
+{
+    uint32_t hash = (uint32_t)(uintptr_t)ev->obj;
+
+    hash ^= (hash >> 5) ^ (hash >> 11) ^ ev->instId ^ ((uint32_t)ev->event << 3);
+    return &mObjHash[hash & (HASH_BUCKETS - 1)];
+}
+
+/**
+ * Find a periodic object entry, must be called with the lock held
+ * \return The entry or NULL if not found
+ */
+static PeriodicObjectList *findEntry(UAVObjEvent *ev, UAVObjEventCallback cb, xQueueHandle queue)
+{
+    PeriodicObjectList *objEntry;
+
+    LL_FOREACH(*hashBucket(ev), objEntry) {
+        if (objEntry->evInfo.cb == cb &&
+            objEntry->evInfo.queue == queue &&
+            objEntry->evInfo.ev.obj == ev->obj &&
+            objEntry->evInfo.ev.instId == ev->instId &&
+            objEntry->evInfo.ev.event == ev->event) {
+            return objEntry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Set the time of the next update of an entry and restore the heap order
+ */
+static void schedule(PeriodicObjectList *objEntry, int32_t timeToNextUpdateMs)
+{
+    int32_t previous = objEntry->timeToNextUpdateMs;
+
+    objEntry->timeToNextUpdateMs = timeToNextUpdateMs;
+    if (objEntry->heapIndex == NOT_SCHEDULED) {
+        return;
+    }
+    if (timeToNextUpdateMs < previous) {
+        heapSiftUp(objEntry->heapIndex);
+    } else {
+        heapSiftDown(objEntry->heapIndex);
+    }
+}
+
+/**
+ * Make sure the event task wakes up in time for a (re)scheduled entry,
+ * must be called with the lock held
+ */
+static void wakeUpBefore(PeriodicObjectList *objEntry)
+{
+    if (objEntry->heapIndex != NOT_SCHEDULED && (uint32_t)objEntry->timeToNextUpdateMs < mTimeToNextUpdateMs) {
+        mTimeToNextUpdateMs = objEntry->timeToNextUpdateMs;
+        PIOS_CALLBACKSCHEDULER_Schedule(eventSchedulerCallback, mTimeToNextUpdateMs - (xTaskGetTickCount() * portTICK_RATE_MS), CALLBACK_UPDATEMODE_SOONER);
+    }
+}
+
+/**
+ * Add an entry to the heap (at the very end, the caller has to schedule() it)
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(PeriodicObjectList *objEntry)
+{
+    if (mHeapCount == mHeapSize) {
+        uint16_t size = mHeapSize ? 2 * mHeapSize : HEAP_MIN_SIZE;
+        if (size >= NOT_SCHEDULED) {
+            return -1;
+        }
+        PeriodicObjectList * *heap = (PeriodicObjectList * *)pios_malloc(size * sizeof(PeriodicObjectList *));
+        if (heap == NULL) {
+            return -1;
+        }
+        if (mHeap) {
+            memcpy(heap, mHeap, mHeapCount * sizeof(PeriodicObjectList *));
+            pios_free(mHeap);
+        }
+        mHeap     = heap;
+        mHeapSize = size;
+    }
+    // An entry at the end with the largest possible time keeps the heap valid until it is scheduled
+    objEntry->timeToNextUpdateMs = INT32_MAX;
+    objEntry->heapIndex = mHeapCount;
+    mHeap[mHeapCount++] = objEntry;
+    return 0;
+}
+
+/**
+ * Remove an entry from the heap
+ */
+static void heapRemove(PeriodicObjectList *objEntry)
+{
+    uint16_t index = objEntry->heapIndex;
+
+    if (index == NOT_SCHEDULED) {
+        return;
+    }
+    objEntry->heapIndex = NOT_SCHEDULED;
+    if (index == --mHeapCount) {
+        return;
+    }
+    // Move the last entry into the hole and restore the heap order
+    mHeap[index] = mHeap[mHeapCount];
+    mHeap[index]->heapIndex = index;
+    heapSiftUp(index);
+    heapSiftDown(mHeap[index]->heapIndex);
+}
+
+/**
+ * Move an entry towards the root of the heap until its parent is due earlier
+ */
+static void heapSiftUp(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    while (index > 0) {
+        uint16_t parent = (index - 1) / 2;
+        if (mHeap[parent]->timeToNextUpdateMs <= objEntry->timeToNextUpdateMs) {
+            break;
+        }
+        mHeap[index] = mHeap[parent];
+        mHeap[index]->heapIndex = index;
+        index = parent;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
+/**
+ * Move an entry towards the leaves of the heap until its children are due later
+ */
+static void heapSiftDown(uint16_t index)
+{
+    PeriodicObjectList *objEntry = mHeap[index];
+
+    for (;;) {
+        uint32_t child = 2 * (uint32_t)index + 1;
+        if (child >= mHeapCount) {
+            break;
+        }
+        if (child + 1 < mHeapCount && mHeap[child + 1]->timeToNextUpdateMs < mHeap[child]->timeToNextUpdateMs) {
+            child++;
+        }
+        if (objEntry->timeToNextUpdateMs <= mHeap[child]->timeToNextUpdateMs) {
+            break;
+        }
+        mHeap[index] = mHeap[child];
+        mHeap[index]->heapIndex = index;
+        index = child;
+    }
+    mHeap[index] = objEntry;
+    objEntry->heapIndex = index;
+}
+
 /**
  * Return a psedorandom integer from 0 to periodMs
  * Based on the Park-Miller-Carta Pseudo-Random Number Generator
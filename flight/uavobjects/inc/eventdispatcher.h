@@ -33,6 +33,9 @@
 typedef struct {
     uint32_t lastErrorID;
     uint32_t eventErrors;
+    uint32_t periodicEvents; /** Number of periodic events dispatched */
+    uint32_t totalJitterMs; /** Sum of the periodic event delays, to compute the average */
+    uint32_t maxJitterMs; /** Largest delay of a periodic event */
 } EventStats;
 
 // Public functions
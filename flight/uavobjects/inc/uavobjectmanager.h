@@ -180,6 +180,9 @@ typedef struct {
     uint32_t eventCallbackErrors;
     uint32_t lastCallbackErrorID;
     uint32_t lastQueueErrorID;
+    uint32_t readRetries; /** Reads that had to be repeated because of a concurrent write */
+    uint32_t writeContentions; /** Writes that had to wait for a concurrent write to the same object */
+    uint32_t eventsCoalesced; /** Updates not queued because the same update was still pending on a coalescing queue */
 } UAVObjStats;
 
 int32_t UAVObjInitialize();
@@ -215,7 +218,12 @@ int32_t UAVObjGetDataField(UAVObjHandle obj_handle, void *dataOut, uint32_t offs
 int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId, const void *dataIn);
 int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, const void *dataIn, uint32_t offset, uint32_t size);
 int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId, void *dataOut);
+int32_t UAVObjGetInstanceRange(UAVObjHandle obj_handle, uint16_t firstInstId, uint16_t numInstances, void *dataOut);
 int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, void *dataOut, uint32_t offset, uint32_t size);
+const void *UAVObjBorrowInstanceData(UAVObjHandle obj_handle, uint16_t instId, uint32_t *version);
+bool UAVObjBorrowValid(UAVObjHandle obj_handle, uint32_t version);
+void *UAVObjBorrowInstanceDataWrite(UAVObjHandle obj_handle, uint16_t instId);
+int32_t UAVObjCommitInstanceData(UAVObjHandle obj_handle, uint16_t instId);
 int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata *dataIn);
 int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut);
 uint8_t UAVObjGetMetadataAccess(const UAVObjMetadata *dataOut);
@@ -235,7 +243,9 @@ UAVObjUpdateMode UAVObjGetLoggingUpdateMode(const UAVObjMetadata *dataOut);
 void UAVObjSetLoggingUpdateMode(UAVObjMetadata *dataOut, UAVObjUpdateMode val);
 int8_t UAVObjReadOnly(UAVObjHandle obj);
 int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue, uint8_t eventMask);
+int32_t UAVObjConnectQueueCoalesced(UAVObjHandle obj_handle, xQueueHandle queue, uint8_t eventMask);
 int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue);
+portBASE_TYPE UAVObjQueueReceive(xQueueHandle queue, UAVObjEvent *ev, portTickType ticks);
 int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
 int32_t UAVObjDisconnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb);
 void UAVObjRequestUpdate(UAVObjHandle obj);
@@ -74,16 +74,16 @@ struct ObjectEventEntry {
     UAVObjEventCallback     cb;
     uint8_t eventMask;
     bool fast;
+    bool coalesce; /** Queue at most one EV_UPDATED per instance until it is received */
+    uint32_t pending; /** Instances (bit = instId, first 32 only) with an EV_UPDATED in the queue */
 };
 
 /*
    MetaInstance   == [UAVOBase [UAVObjMetadata]]
    SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-   MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-   \-->[InstanceData1 [next]]
-                                                  _________...________/
-   \-->[InstanceDataN [next]]
+   MultiInstance  == [UAVOBase [UAVOData [NumInstances [MaxInstances [instances]]]]]
+                                                                    |
+   \-->[InstanceData0 [pad] InstanceData1 [pad] ... InstanceDataN [pad]]
  */
 
 /*
@@ -110,6 +110,16 @@ struct UAVOMeta {
     UAVObjMetadata  instance0;
 } __attribute__((packed));
 
+/*
+ * Private copy of an instance handed out by UAVObjBorrowInstanceDataWrite()
+ * and published by UAVObjCommitInstanceData(), one per object.
+ */
+struct UAVOWriteCopy {
+    volatile uint32_t busy; /** Borrowed and not yet committed */
+    uint16_t instId;
+    uint8_t  data[] __attribute__((aligned(4)));
+};
+
 /* Shared data structure for all data-carrying UAVObjects (UAVOSingle and UAVOMulti) */
 struct UAVOData {
     struct UAVOBase base;
@@ -120,6 +130,13 @@ struct UAVOData {
      */
     struct UAVOMeta metaObj;
     uint16_t instance_size;
+    /*
+     * Sequence counter guarding the data of all instances and of the
+     * embedded meta object, odd while a write is in progress.
+     */
+    volatile uint32_t seq __attribute__((aligned(4)));
+    /* Allocated on the first write borrow */
+    struct UAVOWriteCopy *writeCopy;
 } __attribute__((packed, aligned(4)));
 
 /* Augmented type for Single Instance Data UAVO */
@@ -133,25 +150,19 @@ struct UAVOSingle {
      */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-    struct UAVOMultiInst *next;
-    uint8_t instance[];
-    /*
-     * Additional space will be malloc'd here to hold the
-     * the data for this instance.
-     */
-} __attribute__((packed));
-
-/* Augmented type for Multi Instance Data UAVO */
+/*
+ * Augmented type for Multi Instance Data UAVO
+ *   - All instances are kept in one contiguous array, each instance
+ *     padded to InstanceStride() bytes so that all of them stay word aligned.
+ *   - The array is grown (reallocated) with the mutex and the sequence
+ *     lock held, lock free readers have to fetch the instance pointer
+ *     inside their sequence read section. Retired arrays are not freed.
+ */
 struct UAVOMulti {
     struct UAVOData uavo;
     uint16_t num_instances;
-    struct UAVOMultiInst instance0 __attribute__((aligned(4)));
-    /*
-     * Additional space will be malloc'd here to hold the
-     * the data for instance 0.
-     */
+    uint16_t max_instances;
+    uint8_t  *instances __attribute__((aligned(4)));
 } __attribute__((packed));
 
 /** all information about a metaobject are hardcoded constants **/
@@ -163,11 +174,13 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void *)(&(((struct UAVOSingle *)obj)->instance0)))
-#define InstanceDataOffset(inst)         ((void *)&(((struct UAVOMultiInst *)inst)->instance))
+#define InstanceStride(obj)              (((uint32_t)(obj)->instance_size + 3) & ~3UL)
 #define InstanceData(instance)           ((void *)instance)
 
 // Private functions
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType event);
 InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId);
+void UAVObjSeqWriteBegin(UAVObjHandle obj_handle);
+void UAVObjSeqWriteEnd(UAVObjHandle obj_handle);
 
 #endif /* UAVOBJECTPRIVATE_H_ */
@@ -34,12 +34,17 @@
 #include "openpilot.h"
 #include "pios_struct_helper.h"
 #include "inc/uavobjectprivate.h"
+#ifdef PIOS_INCLUDE_DEBUGLOG
+#include "uavobjectsinit.h"
+#endif
 
 // Private functions
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId);
-static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool fast);
+static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb, uint8_t eventMask, bool fast, bool coalesce);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue, UAVObjEventCallback cb);
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId);
+static struct UAVOData *indexLookup(uint32_t id);
+static int32_t indexInsert(struct UAVOData *obj);
 
 
 int32_t UAVObjPers_stub(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused))  uint16_t instId)
@@ -67,6 +72,28 @@ static const UAVObjMetadata defMetadata = {
 
 static UAVObjStats stats;
 
+/*
+ * Object data is protected by a per object sequence lock rather than by the
+ * global mutex: writers of the same object exclude each other through the
+ * sequence counter, readers never block writers and retry their copy if a
+ * write happened meanwhile. The global mutex is only used for registration,
+ * instance creation, event connections and list iteration.
+ *
+ * Writers hold the lock in a critical section for no longer than the copy,
+ * so a reader or writer of any priority can never preempt an unfinished
+ * write and wait for it. Only where tasks really run in parallel (hosts)
+ * the lock is found taken, and then briefly spun on.
+ */
+
+/*
+ * Object ID index, an open addressing hash table of data objects.
+ * It is sized once at init time from the number of UAVO handle slots
+ * (load factor <= 50%) and entries are only ever added (at registration,
+ * with the mutex held), so lookups can run without taking the mutex.
+ */
+static struct UAVOData * *uavo_index;
+static uint32_t uavo_index_mask;
+
 
 static inline bool IsMetaobject(UAVObjHandle obj_handle)
 {
@@ -100,6 +127,85 @@ static inline bool IsPriority(UAVObjHandle obj_handle)
     return uavo_base->flags.isPriority;
 }
 
+/**
+ * Get the object holding the sequence counter of an object handle,
+ * meta objects share the counter of their parent object.
+ */
+static inline struct UAVOData *SeqObject(UAVObjHandle obj_handle)
+{
+    if (IsMetaobject(obj_handle)) {
+        return container_of((struct UAVOMeta *)obj_handle, struct UAVOData, metaObj);
+    }
+    return (struct UAVOData *)obj_handle;
+}
+
+/**
+ * Start reading the object data
+ * \return The sequence number to pass to seqReadRetry()
+ */
+static inline uint32_t seqReadBegin(struct UAVOData *obj)
+{
+    uint32_t seq = obj->seq;
+
+    if (seq & 1) {
+        ++stats.readRetries;
+        while ((seq = obj->seq) & 1) {
+            ;
+        }
+    }
+    __sync_synchronize();
+    return seq;
+}
+
+/**
+ * Finish reading the object data
+ * \return True if a write happened meanwhile and the read must be repeated
+ */
+static inline bool seqReadRetry(struct UAVOData *obj, uint32_t seq)
+{
+    __sync_synchronize();
+    if (obj->seq != seq) {
+        ++stats.readRetries;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Start writing the object data. Interrupts stay masked until UAVObjSeqWriteEnd(),
+ * so readers never wait for a preempted writer. Only copy data in between.
+ * Writers on other host threads (simulation, unit tests) are waited for.
+ * \param[in] obj The object handle, a meta object locks its parent object
+ */
+void UAVObjSeqWriteBegin(UAVObjHandle obj_handle)
+{
+    struct UAVOData *obj = SeqObject(obj_handle);
+
+    portENTER_CRITICAL();
+    for (uint32_t tries = 0;; ++tries) {
+        uint32_t seq = obj->seq;
+        if (!(seq & 1) && __sync_bool_compare_and_swap(&obj->seq, seq, seq + 1)) {
+            return;
+        }
+        if (tries == 0) {
+            ++stats.writeContentions;
+        }
+    }
+}
+
+/**
+ * Finish writing the object data
+ * \param[in] obj The object handle, a meta object unlocks its parent object
+ */
+void UAVObjSeqWriteEnd(UAVObjHandle obj_handle)
+{
+    struct UAVOData *obj = SeqObject(obj_handle);
+
+    __sync_synchronize();
+    obj->seq++;
+    portEXIT_CRITICAL();
+}
+
 /**
  * Is this a metaobject?
  * \param[in] obj The object handle
@@ -166,6 +272,19 @@ int32_t UAVObjInitialize()
     memset(__start__uavo_handles, 0,
            (uintptr_t)__stop__uavo_handles - (uintptr_t)__start__uavo_handles);
 
+    // Allocate the object ID index, twice the number of handle slots rounded up to a power of 2
+    uint32_t num_slots  = __start__uavo_handles ? (__stop__uavo_handles - __start__uavo_handles) : 0;
+    uint32_t index_size = 8;
+    while (index_size < 2 * num_slots) {
+        index_size <<= 1;
+    }
+    uavo_index = (struct UAVOData * *)pios_malloc(index_size * sizeof(struct UAVOData *));
+    if (uavo_index == NULL) {
+        return -1;
+    }
+    memset(uavo_index, 0, index_size * sizeof(struct UAVOData *));
+    uavo_index_mask = index_size - 1;
+
     // Create mutex
     mutex = xSemaphoreCreateRecursiveMutex();
     if (mutex == NULL) {
@@ -246,16 +365,21 @@ static struct UAVOData *UAVObjAllocSingle(uint32_t num_bytes)
 
 static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
 {
-    /* Compute the complete size of the object, including the data for a single embedded instance */
-    uint32_t object_size = sizeof(struct UAVOMulti) + num_bytes;
-
-    /* Allocate the object from the heap */
-    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)pios_malloc(object_size);
+    /* Allocate the object from the heap, the instances are kept in a separate array */
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)pios_malloc(sizeof(struct UAVOMulti));
 
     if (!uavo_multi) {
         return NULL;
     }
 
+    /* Allocate the storage for instance 0, more is added as instances get created */
+    uint32_t stride = (num_bytes + 3) & ~3UL;
+    uavo_multi->instances = (uint8_t *)pios_malloc(stride);
+    if (!uavo_multi->instances) {
+        pios_free(uavo_multi);
+        return NULL;
+    }
+
     /* Fill in the common part of the UAVO */
     struct UAVOBase *uavo_base = &(uavo_multi->uavo.base);
     memset(uavo_base, 0, sizeof(*uavo_base));
@@ -264,9 +388,10 @@ static struct UAVOData *UAVObjAllocMulti(uint32_t num_bytes)
 
     /* Set up the type-specific part of the UAVO */
     uavo_multi->num_instances = 1;
+    uavo_multi->max_instances = 1;
 
-    /* Clear the multi instance data carried in the UAVO */
-    memset(&(uavo_multi->instance0), 0, sizeof(struct UAVOMultiInst) + num_bytes);
+    /* Clear the multi instance data */
+    memset(uavo_multi->instances, 0, stride);
 
     /* Give back the generic UAVO part */
     return &(uavo_multi->uavo);
@@ -312,7 +437,9 @@ UAVObjHandle UAVObjRegister(uint32_t id,
     }
 
     /* Fill in the details about this UAVO */
-    uavo_data->id = id;
+    uavo_data->id  = id;
+    uavo_data->seq = 0;
+    uavo_data->writeCopy     = NULL;
     uavo_data->instance_size = num_bytes;
     if (isSettings) {
         uavo_data->base.flags.isSettings = true;
@@ -324,6 +451,16 @@ UAVObjHandle UAVObjRegister(uint32_t id,
     /* Initialize the embedded meta UAVO */
     UAVObjInitMetaData(&uavo_data->metaObj);
 
+    /* Make the object visible to UAVObjGetByID() */
+    if (indexInsert(uavo_data) != 0) {
+        if (!isSingleInstance) {
+            pios_free(((struct UAVOMulti *)uavo_data)->instances);
+        }
+        pios_free(uavo_data);
+        uavo_data = NULL;
+        goto unlock_exit;
+    }
+
     /* Initialize object fields and metadata to default values */
     if (initCb) {
         initCb((UAVObjHandle)uavo_data, 0);
@@ -353,26 +490,21 @@ unlock_exit:
  */
 UAVObjHandle UAVObjGetByID(uint32_t id)
 {
-    UAVObjHandle *found_obj = (UAVObjHandle *)NULL;
-
-    // Get lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    struct UAVOData *obj;
 
-    // Look for object
-    UAVO_LIST_ITERATE(tmp_obj)
-    if (tmp_obj->id == id) {
-        found_obj = (UAVObjHandle *)tmp_obj;
-        goto unlock_exit;
+    // Look for a data object first
+    obj = indexLookup(id);
+    if (obj) {
+        return (UAVObjHandle)obj;
     }
-    if (MetaObjectId(tmp_obj->id) == id) {
-        found_obj = (UAVObjHandle *)&(tmp_obj->metaObj);
-        goto unlock_exit;
+
+    // Then for a meta object, which is indexed through its parent
+    obj = indexLookup(id - 1);
+    if (obj) {
+        return (UAVObjHandle) & (obj->metaObj);
     }
-}
 
-unlock_exit:
-xSemaphoreGiveRecursive(mutex);
-return found_obj;
+    return (UAVObjHandle)NULL;
 }
 
 /**
@@ -522,16 +654,15 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
+    struct UAVOData *seqObj = SeqObject(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
+        UAVObjSeqWriteBegin(seqObj);
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        UAVObjSeqWriteEnd(seqObj);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -539,27 +670,29 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId, const uint8_t *da
         // Cast handle to object
         obj = (struct UAVOData *)obj_handle;
 
-        // Get the instance
-        instEntry = getInstance(obj, instId);
-
         // If the instance does not exist create it and any other instances before it
-        if (instEntry == NULL) {
-            instEntry = createInstance(obj, instId);
+        if (instId >= UAVObjGetNumInstances(obj_handle)) {
+            xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+            if (instId >= UAVObjGetNumInstances(obj_handle)) {
+                instEntry = createInstance(obj, instId);
+            } else {
+                instEntry = getInstance(obj, instId);
+            }
+            xSemaphoreGiveRecursive(mutex);
             if (instEntry == NULL) {
-                goto unlock_exit;
+                return -1;
             }
         }
-        // Set the data
+        // Set the data, the instance may have moved until the lock is held
+        UAVObjSeqWriteBegin(seqObj);
+        instEntry = getInstance(obj, instId);
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        UAVObjSeqWriteEnd(seqObj);
     }
 
     // Fire event
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -571,39 +704,7 @@ unlock_exit:
  */
 int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t *dataOut)
 {
-    PIOS_Assert(obj_handle);
-
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
-
-    if (IsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            goto unlock_exit;
-        }
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
-
-        // Cast handle to object
-        obj = (struct UAVOData *)obj_handle;
-
-        // Get the instance
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-        // Pack data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
-    }
-
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return UAVObjGetInstanceData(obj_handle, instId, dataOut);
 }
 
 /**
@@ -617,71 +718,59 @@ uint8_t UAVObjUpdateCRC(UAVObjHandle obj_handle, uint16_t instId, uint8_t crc)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
     if (IsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            goto unlock_exit;
-        }
         // TODO
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
+        return crc;
+    }
 
-        // Cast handle to object
-        obj = (struct UAVOData *)obj_handle;
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+    InstanceHandle instEntry;
+    uint8_t newcrc;
+    uint32_t seq;
 
-        // Get the instance
+    // Update crc
+    do {
+        seq = seqReadBegin(obj);
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
+            return crc;
         }
-        // Update crc
-        crc = PIOS_CRC_updateCRC(crc, (uint8_t *)InstanceData(instEntry), (int32_t)obj->instance_size);
-    }
+        newcrc = PIOS_CRC_updateCRC(crc, (uint8_t *)InstanceData(instEntry), (int32_t)obj->instance_size);
+    } while (seqReadRetry(obj, seq));
 
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return crc;
+    return newcrc;
+}
+
+#ifdef PIOS_INCLUDE_DEBUGLOG
+struct logInstance {
+    UAVObjHandle obj_handle;
+    uint16_t     instId;
+};
+
+static void copyToLog(void *context, uint8_t *data, size_t size)
+{
+    const struct logInstance *instance = (const struct logInstance *)context;
+
+    // instances are never deleted, the caller checked this one exists
+    UAVObjGetInstanceDataField(instance->obj_handle, instance->instId, data, 0, size);
 }
 
 /**
- * Actually write the object's data to the logfile
+ * Add the object's data to the log. The snapshot is taken straight into the log
+ * buffer, writing it to flash is left to the flush callback of the log.
  * \param[in] obj The object handle
  * \param[in] instId The object instance ID
  */
-#ifdef PIOS_INCLUDE_DEBUGLOG
 void UAVObjInstanceWriteToLog(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    if (IsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            goto unlock_exit;
-        }
-        PIOS_DEBUGLOG_UAVObject(UAVObjGetID(obj_handle), instId, MetaNumBytes, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle));
-    } else {
-        struct UAVOData *obj;
-        InstanceHandle instEntry;
-
-        // Cast handle to object
-        obj = (struct UAVOData *)obj_handle;
-
-        // Get the instance
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-        // Pack data
-        PIOS_DEBUGLOG_UAVObject(UAVObjGetID(obj_handle), instId, obj->instance_size, (uint8_t *)InstanceData(instEntry));
+    if (instId >= UAVObjGetNumInstances(obj_handle)) {
+        return;
     }
 
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
+    struct logInstance instance = { obj_handle, instId };
+    PIOS_DEBUGLOG_UAVObjectCopy(UAVObjGetID(obj_handle), instId, UAVObjGetNumBytes(obj_handle), &copyToLog, &instance);
 }
 #else /* ifdef PIOS_INCLUDE_DEBUGLOG */
 void UAVObjInstanceWriteToLog(__attribute__((unused)) UAVObjHandle obj_handle, __attribute__((unused)) uint16_t instId) {}
@@ -913,16 +1002,15 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
+    struct UAVOData *seqObj = SeqObject(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
+        UAVObjSeqWriteBegin(seqObj);
         memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+        UAVObjSeqWriteEnd(seqObj);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -932,24 +1020,23 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 
         // Check access level
         if (UAVObjReadOnly(obj_handle)) {
-            goto unlock_exit;
+            return -1;
         }
         // Get instance information
+        UAVObjSeqWriteBegin(seqObj);
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
+            UAVObjSeqWriteEnd(seqObj);
+            return -1;
         }
         // Set data
         memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+        UAVObjSeqWriteEnd(seqObj);
     }
 
     // Fire event
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -963,24 +1050,23 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
+    struct UAVOData *seqObj = SeqObject(obj_handle);
 
     if (IsMetaobject(obj_handle)) {
         // Get instance information
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Check for overrun
         if ((size + offset) > MetaNumBytes) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Set data
-        memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+        UAVObjSeqWriteBegin(seqObj);
+        memcpy((uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+        UAVObjSeqWriteEnd(seqObj);
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -990,32 +1076,31 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 
         // Check access level
         if (UAVObjReadOnly(obj_handle)) {
-            goto unlock_exit;
+            return -1;
+        }
+
+        // Check for overrun
+        if ((size + offset) > obj->instance_size) {
+            return -1;
         }
 
         // Get instance information
+        UAVObjSeqWriteBegin(seqObj);
         instEntry = getInstance(obj, instId);
         if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-
-        // Check for overrun
-        if ((size + offset) > obj->instance_size) {
-            goto unlock_exit;
+            UAVObjSeqWriteEnd(seqObj);
+            return -1;
         }
 
         // Set data
-        memcpy(InstanceData(instEntry) + offset, dataIn, size);
+        memcpy((uint8_t *)InstanceData(instEntry) + offset, dataIn, size);
+        UAVObjSeqWriteEnd(seqObj);
     }
 
 
     // Fire event
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -1030,18 +1115,19 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
+    struct UAVOData *seqObj = SeqObject(obj_handle);
+    uint32_t seq;
 
     if (IsMetaobject(obj_handle)) {
         // Get instance information
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
         // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+        do {
+            seq = seqReadBegin(seqObj);
+            memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+        } while (seqReadRetry(seqObj, seq));
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -1049,20 +1135,18 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
         // Cast to object info
         obj = (struct UAVOData *)obj_handle;
 
-        // Get instance information
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-        // Set data
-        memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+        // Get instance information and data
+        do {
+            seq = seqReadBegin(seqObj);
+            instEntry = getInstance(obj, instId);
+            if (instEntry == NULL) {
+                return -1;
+            }
+            memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+        } while (seqReadRetry(seqObj, seq));
     }
 
-    rc = 0;
-
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+    return 0;
 }
 
 /**
@@ -1076,24 +1160,25 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-    int32_t rc = -1;
+    struct UAVOData *seqObj = SeqObject(obj_handle);
+    uint32_t seq;
 
     if (IsMetaobject(obj_handle)) {
         // Get instance information
         if (instId != 0) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Check for overrun
         if ((size + offset) > MetaNumBytes) {
-            goto unlock_exit;
+            return -1;
         }
 
         // Set data
-        memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+        do {
+            seq = seqReadBegin(seqObj);
+            memcpy(dataOut, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+        } while (seqReadRetry(seqObj, seq));
     } else {
         struct UAVOData *obj;
         InstanceHandle instEntry;
@@ -1101,26 +1186,183 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
         // Cast to object info
         obj = (struct UAVOData *)obj_handle;
 
-        // Get instance information
-        instEntry = getInstance(obj, instId);
-        if (instEntry == NULL) {
-            goto unlock_exit;
-        }
-
         // Check for overrun
         if ((size + offset) > obj->instance_size) {
-            goto unlock_exit;
+            return -1;
         }
 
-        // Set data
-        memcpy(dataOut, InstanceData(instEntry) + offset, size);
+        // Get instance information and data
+        do {
+            seq = seqReadBegin(seqObj);
+            instEntry = getInstance(obj, instId);
+            if (instEntry == NULL) {
+                return -1;
+            }
+            memcpy(dataOut, (uint8_t *)InstanceData(instEntry) + offset, size);
+        } while (seqReadRetry(seqObj, seq));
     }
 
-    rc = 0;
+    return 0;
+}
 
-unlock_exit:
-    xSemaphoreGiveRecursive(mutex);
-    return rc;
+/**
+ * Get the data of a range of consecutive object instances in one go
+ * \param[in] obj The object handle
+ * \param[in] firstInstId The first object instance ID to copy
+ * \param[in] numInstances The number of instances to copy
+ * \param[out] dataOut Array of numInstances object data structures
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjGetInstanceRange(UAVObjHandle obj_handle, uint16_t firstInstId, uint16_t numInstances, void *dataOut)
+{
+    PIOS_Assert(obj_handle);
+
+    if (IsMetaobject(obj_handle)) {
+        return -1;
+    }
+
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+    uint32_t lastInstId  = (uint32_t)firstInstId + numInstances;
+    uint32_t seq;
+
+    if (numInstances == 0) {
+        return 0;
+    }
+
+    do {
+        seq = seqReadBegin(obj);
+
+        if (lastInstId > UAVObjGetNumInstances(obj_handle)) {
+            return -1;
+        }
+
+        if (IsSingleInstance(obj_handle)) {
+            memcpy(dataOut, ObjSingleInstanceDataOffset(obj), obj->instance_size);
+        } else {
+            // Instances are stored contiguously, copy them out without the padding
+            const uint8_t *instEntry = getInstance(obj, firstInstId);
+            uint8_t *out    = (uint8_t *)dataOut;
+            uint32_t stride = InstanceStride(obj);
+            for (uint32_t n = firstInstId; n < lastInstId; ++n) {
+                memcpy(out, instEntry, obj->instance_size);
+                out       += obj->instance_size;
+                instEntry += stride;
+            }
+        }
+    } while (seqReadRetry(obj, seq));
+
+    return 0;
+}
+
+/**
+ * Borrow the data of a specific object instance for reading, without copying it.
+ * The data can change at any time, whatever was read through the pointer is only
+ * consistent if UAVObjBorrowValid() returns true afterwards, otherwise borrow again.
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ * \param[out] version The data version to pass to UAVObjBorrowValid()
+ * \return Pointer to the instance data or NULL if failure
+ */
+const void *UAVObjBorrowInstanceData(UAVObjHandle obj_handle, uint16_t instId, uint32_t *version)
+{
+    PIOS_Assert(obj_handle);
+
+    if (IsMetaobject(obj_handle)) {
+        return NULL;
+    }
+
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+
+    *version = seqReadBegin(obj);
+    return getInstance(obj, instId);
+}
+
+/**
+ * Check that a read borrow is still valid
+ * \param[in] obj The object handle
+ * \param[in] version The data version returned by UAVObjBorrowInstanceData()
+ * \return True if the data was not written since it was borrowed
+ */
+bool UAVObjBorrowValid(UAVObjHandle obj_handle, uint32_t version)
+{
+    PIOS_Assert(obj_handle);
+
+    return !seqReadRetry((struct UAVOData *)obj_handle, version);
+}
+
+/**
+ * Borrow the data of a specific object instance for modification.
+ * The caller modifies a private copy of the instance, UAVObjCommitInstanceData()
+ * publishes it, so readers and writers are not held up meanwhile. An object can
+ * only be borrowed for writing once at a time, commit before borrowing it again.
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID
+ * \return Pointer to the copy of the instance data or NULL if failure (nothing to commit then)
+ */
+void *UAVObjBorrowInstanceDataWrite(UAVObjHandle obj_handle, uint16_t instId)
+{
+    PIOS_Assert(obj_handle);
+
+    if (IsMetaobject(obj_handle) || UAVObjReadOnly(obj_handle)) {
+        return NULL;
+    }
+
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+
+    // The copy is kept for the next borrows of the object
+    if (obj->writeCopy == NULL) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        if (obj->writeCopy == NULL) {
+            struct UAVOWriteCopy *copy = (struct UAVOWriteCopy *)pios_malloc(sizeof(struct UAVOWriteCopy) + obj->instance_size);
+            if (copy != NULL) {
+                copy->busy = 0;
+                __sync_synchronize();
+                obj->writeCopy = copy;
+            }
+        }
+        xSemaphoreGiveRecursive(mutex);
+        if (obj->writeCopy == NULL) {
+            return NULL;
+        }
+    }
+
+    struct UAVOWriteCopy *copy = obj->writeCopy;
+    bool claimed = __sync_bool_compare_and_swap(&copy->busy, 0, 1);
+    PIOS_Assert(claimed);
+
+    if (UAVObjGetInstanceData(obj_handle, instId, copy->data) < 0) {
+        __sync_lock_release(&copy->busy);
+        return NULL;
+    }
+    copy->instId = instId;
+
+    return copy->data;
+}
+
+/**
+ * Publish the copy of a write borrow and fire a single update event
+ * \param[in] obj The object handle
+ * \param[in] instId The object instance ID passed to UAVObjBorrowInstanceDataWrite()
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjCommitInstanceData(UAVObjHandle obj_handle, uint16_t instId)
+{
+    PIOS_Assert(obj_handle);
+
+    struct UAVOData *obj = (struct UAVOData *)obj_handle;
+    struct UAVOWriteCopy *copy = obj->writeCopy;
+
+    PIOS_Assert(copy && copy->busy && copy->instId == instId);
+
+    // Instances are never removed, the borrowed one still exists
+    UAVObjSeqWriteBegin(obj);
+    memcpy(InstanceData(getInstance(obj, instId)), copy->data, obj->instance_size);
+    UAVObjSeqWriteEnd(obj);
+    __sync_lock_release(&copy->busy);
+
+    // Fire event
+    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
+    return 0;
 }
 
 /**
@@ -1138,11 +1380,8 @@ int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata *dataIn)
         return -1;
     }
 
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
     UAVObjSetData((UAVObjHandle)MetaObjectPtr((struct UAVOData *)obj_handle), dataIn);
 
-    xSemaphoreGiveRecursive(mutex);
     return 0;
 }
 
@@ -1156,9 +1395,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
 {
     PIOS_Assert(obj_handle);
 
-    // Lock
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
     // Get metadata
     if (IsMetaobject(obj_handle)) {
         memcpy(dataOut, &defMetadata, sizeof(UAVObjMetadata));
@@ -1167,8 +1403,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata *dataOut)
                       dataOut);
     }
 
-    // Unlock
-    xSemaphoreGiveRecursive(mutex);
     return 0;
 }
 
@@ -1363,7 +1597,31 @@ int32_t UAVObjConnectQueue(UAVObjHandle obj_handle, xQueueHandle queue,
     PIOS_Assert(queue);
     int32_t res;
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, queue, 0, eventMask, false);
+    res = connectObj(obj_handle, queue, 0, eventMask, false, false);
+    xSemaphoreGiveRecursive(mutex);
+    return res;
+}
+
+/**
+ * Connect an event queue to the object in coalescing mode, if the queue is already connected then
+ * the event mask and mode are only updated.
+ * An EV_UPDATED event is not queued again for an instance while a previous one for the same instance
+ * is still waiting in the queue, the consumer reads the latest data when it gets to the event.
+ * Only the first 32 instances are coalesced, all other events are queued as usual.
+ * Events must be read with UAVObjQueueReceive() for this to work.
+ * \param[in] obj The object handle
+ * \param[in] queue The event queue
+ * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \return 0 if success or -1 if failure
+ */
+int32_t UAVObjConnectQueueCoalesced(UAVObjHandle obj_handle, xQueueHandle queue,
+                                    uint8_t eventMask)
+{
+    PIOS_Assert(obj_handle);
+    PIOS_Assert(queue);
+    int32_t res;
+    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    res = connectObj(obj_handle, queue, 0, eventMask, false, true);
     xSemaphoreGiveRecursive(mutex);
     return res;
 }
@@ -1385,6 +1643,36 @@ int32_t UAVObjDisconnectQueue(UAVObjHandle obj_handle, xQueueHandle queue)
     return res;
 }
 
+/**
+ * Receive an event from a queue connected to objects, drop in replacement for xQueueReceive().
+ * For queues connected with UAVObjConnectQueueCoalesced() this marks the update as no longer
+ * pending, so the next update of the same instance is queued again.
+ * \param[in] queue The event queue
+ * \param[out] ev The received event
+ * \param[in] ticks Time to wait for an event
+ * \return pdTRUE if an event was received
+ */
+portBASE_TYPE UAVObjQueueReceive(xQueueHandle queue, UAVObjEvent *ev, portTickType ticks)
+{
+    if (xQueueReceive(queue, ev, ticks) != pdTRUE) {
+        return pdFALSE;
+    }
+
+    if (ev->event == EV_UPDATED && ev->instId < 32) {
+        struct ObjectEventEntry *event;
+
+        // Lock free like sendEvent(), the bit is cleared before the consumer reads the data
+        LL_FOREACH(((struct UAVOBase *)ev->obj)->next_event, event) {
+            if (event->queue == queue && event->coalesce) {
+                __sync_fetch_and_and(&event->pending, ~(1u << ev->instId));
+                break;
+            }
+        }
+    }
+
+    return pdTRUE;
+}
+
 /**
  * Connect an event callback to the object, if the callback is already connected then the event mask is only updated.
  * The supplied callback will be invoked on all events matching the event mask.
@@ -1399,7 +1687,7 @@ int32_t UAVObjConnectCallback(UAVObjHandle obj_handle, UAVObjEventCallback cb,
     PIOS_Assert(obj_handle);
     int32_t res;
     xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-    res = connectObj(obj_handle, 0, cb, eventMask, fast);
+    res = connectObj(obj_handle, 0, cb, eventMask, fast, false);
     xSemaphoreGiveRecursive(mutex);
     return res;
 }
@@ -1439,9 +1727,7 @@ void UAVObjRequestUpdate(UAVObjHandle obj_handle)
 void UAVObjRequestInstanceUpdate(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATE_REQ);
-    xSemaphoreGiveRecursive(mutex);
 }
 
 /**
@@ -1461,9 +1747,7 @@ void UAVObjUpdated(UAVObjHandle obj_handle)
 void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED_MANUAL);
-    xSemaphoreGiveRecursive(mutex);
 }
 
 /**
@@ -1474,9 +1758,7 @@ void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 static void instanceAutoUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-    xSemaphoreGiveRecursive(mutex);
 }
 
 /*
@@ -1496,9 +1778,7 @@ void UAVObjLogging(UAVObjHandle obj_handle)
 void UAVObjInstanceLogging(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
-    xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
     sendEvent((struct UAVOBase *)obj_handle, instId, EV_LOGGING_MANUAL);
-    xSemaphoreGiveRecursive(mutex);
 }
 
 /**
@@ -1525,6 +1805,8 @@ xSemaphoreGiveRecursive(mutex);
 
 /**
  * Send a triggered event to all event queues registered on the object.
+ * Runs without the mutex, event entries are never freed and a queue or
+ * callback is only set once the rest of its entry is, see connectObj().
  */
 int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType triggered_event)
 {
@@ -1540,21 +1822,35 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     struct ObjectEventEntry *event;
 
     LL_FOREACH(obj->next_event, event) {
+        // Read once, disconnectObj() may clear them meanwhile
+        xQueueHandle queue     = event->queue;
+        UAVObjEventCallback cb = event->cb;
+
         if (event->eventMask == 0 || (event->eventMask & triggered_event) != 0) {
             // Send to queue if a valid queue is registered
-            if (event->queue) {
-                // will not block
-                if (xQueueSend(event->queue, &msg, 0) != pdTRUE) {
+            if (queue) {
+                // Skip updates the consumer has not picked up yet, it will read the latest data anyway
+                if (event->coalesce && triggered_event == EV_UPDATED && instId < 32) {
+                    uint32_t pendingBit = 1u << instId;
+                    if (__sync_fetch_and_or(&event->pending, pendingBit) & pendingBit) {
+                        ++stats.eventsCoalesced;
+                    } else if (xQueueSend(queue, &msg, 0) != pdTRUE) {
+                        __sync_fetch_and_and(&event->pending, ~pendingBit);
+                        ++stats.eventQueueErrors;
+                        stats.lastQueueErrorID = UAVObjGetID(obj);
+                    }
+                } else if (xQueueSend(queue, &msg, 0) != pdTRUE) {
+                    // will not block
                     ++stats.eventQueueErrors;
                     stats.lastQueueErrorID = UAVObjGetID(obj);
                 }
             }
 
             // Invoke callback (from event task) if a valid one is registered
-            if (event->cb) {
+            if (cb) {
                 if (event->fast) {
-                    event->cb(&msg);
-                } else if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
+                    cb(&msg);
+                } else if (EventCallbackDispatch(&msg, cb) != pdTRUE) {
                     // invoke callback from the event task, will not block
                     ++stats.eventCallbackErrors;
                     stats.lastCallbackErrorID = UAVObjGetID(obj);
@@ -1566,13 +1862,67 @@ int32_t sendEvent(struct UAVOBase *obj, uint16_t instId, UAVObjEventType trigger
     return 0;
 }
 
+/**
+ * Hash an object ID into the object index
+ */
+static inline uint32_t indexHash(uint32_t id)
+{
+    // Object IDs are already hashes, just fold the high bits in
+    return (id ^ (id >> 16)) & uavo_index_mask;
+}
+
+/**
+ * Find a data object in the object index, lock free.
+ * \param[in] id The data object ID
+ * \return The object or NULL if not found
+ */
+static struct UAVOData *indexLookup(uint32_t id)
+{
+    if (!uavo_index) {
+        return NULL;
+    }
+
+    for (uint32_t slot = indexHash(id);; slot = (slot + 1) & uavo_index_mask) {
+        struct UAVOData *obj = uavo_index[slot];
+        if (obj == NULL) {
+            return NULL;
+        }
+        if (obj->id == id) {
+            return obj;
+        }
+    }
+}
+
+/**
+ * Add a data object to the object index, must be called with the mutex held.
+ * \param[in] obj The fully initialized data object
+ * \return 0 if success or -1 if the index is full
+ */
+static int32_t indexInsert(struct UAVOData *obj)
+{
+    uint32_t slot = indexHash(obj->id);
+
+    for (uint32_t n = 0; n < uavo_index_mask; ++n) {
+        if (uavo_index[slot] == NULL) {
+            // Make sure the object is complete before lock free readers can see it
+            __sync_synchronize();
+            uavo_index[slot] = obj;
+            return 0;
+        }
+        slot = (slot + 1) & uavo_index_mask;
+    }
+
+    // Always keep at least one free slot so lookups terminate
+    return -1;
+}
+
 /**
  * Create a new object instance, return the instance info or NULL if failure.
+ * Must be called with the mutex held, the instance pointer is only valid
+ * until the next instance is created.
  */
 static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
 {
-    struct UAVOMultiInst *instEntry;
-
     /* Don't allow more than one instance for single instance objects */
     if (IsSingleInstance(&(obj->base))) {
         PIOS_Assert(0);
@@ -1585,33 +1935,58 @@ static InstanceHandle createInstance(struct UAVOData *obj, uint16_t instId)
     }
 
     /* Don't allow duplicate instances */
-    if (instId < UAVObjGetNumInstances(&(obj->base))) {
+    uint16_t firstId = UAVObjGetNumInstances(&(obj->base));
+    if (instId < firstId) {
         return NULL;
     }
 
-    // Create any missing instances (all instance IDs must be sequential)
-    for (uint16_t n = UAVObjGetNumInstances(&(obj->base)); n < instId; ++n) {
-        if (createInstance(obj, n) == NULL) {
+    struct UAVOMulti *uavo_multi = (struct UAVOMulti *)obj;
+    uint32_t stride = InstanceStride(obj);
+
+    // Create any missing instances as well (all instance IDs must be sequential)
+    if (instId >= uavo_multi->max_instances) {
+        /* Grow the instance array geometrically to keep creation of many instances cheap */
+        uint32_t max_instances = 2 * (uint32_t)uavo_multi->max_instances;
+        if (max_instances <= instId) {
+            max_instances = instId + 1;
+        }
+        if (max_instances > UAVOBJ_MAX_INSTANCES) {
+            max_instances = UAVOBJ_MAX_INSTANCES;
+        }
+
+        uint8_t *instances = (uint8_t *)pios_malloc(max_instances * stride);
+        if (!instances) {
             return NULL;
         }
-    }
+        memset(instances + firstId * stride, 0, (max_instances - firstId) * stride);
+
+        /*
+         * Move the existing instances, readers retry and pick up the new array.
+         * The old array is never freed, a preempted reader may still be copying from it.
+         * With the geometric growth all retired arrays together stay smaller than the current one.
+         */
+        UAVObjSeqWriteBegin(obj);
+        memcpy(instances, uavo_multi->instances, firstId * stride);
+        uavo_multi->instances     = instances;
+        uavo_multi->max_instances = max_instances;
+        __sync_synchronize();
+        uavo_multi->num_instances = instId + 1;
+        UAVObjSeqWriteEnd(obj);
+    } else {
+        memset(uavo_multi->instances + firstId * stride, 0, (instId + 1 - firstId) * stride);
 
-    /* Create the actual instance */
-    uint32_t size = sizeof(struct UAVOMultiInst) + obj->instance_size;
-    instEntry = (struct UAVOMultiInst *)pios_malloc(size);
-    if (!instEntry) {
-        return NULL;
+        // Publish the new instances to lock free readers only once they are cleared
+        __sync_synchronize();
+        uavo_multi->num_instances = instId + 1;
     }
-    memset(instEntry, 0, size);
-    LL_APPEND(((struct UAVOMulti *)obj)->instance0.next, instEntry);
-
-    ((struct UAVOMulti *)obj)->num_instances++;
 
-    // Fire event
-    instanceAutoUpdated((UAVObjHandle)obj, instId);
+    // Fire events
+    for (uint16_t n = firstId; n <= instId; ++n) {
+        instanceAutoUpdated((UAVObjHandle)obj, n);
+    }
 
     // Done
-    return InstanceDataOffset(instEntry);
+    return uavo_multi->instances + instId * stride;
 }
 
 /**
@@ -1647,17 +2022,11 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
             return NULL;
         }
 
-        // Look for specified instance ID
-        uint16_t instance = 0;
-        struct UAVOMultiInst *instEntry;
-        LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-            if (instance++ == instId) {
-                /* Found it */
-                return &(instEntry->instance);
-            }
-        }
-        /* Instance was not found */
-        return NULL;
+        /* The array is replaced before the instance count grows */
+        __sync_synchronize();
+
+        /* All instances live in one array */
+        return uavo_multi->instances + instId * InstanceStride(obj);
     }
 }
 
@@ -1667,12 +2036,15 @@ InstanceHandle getInstance(struct UAVOData *obj, uint16_t instId)
  * \param[in] queue The event queue
  * \param[in] cb The event callback
  * \param[in] eventMask The event mask, if EV_MASK_ALL then all events are enabled (e.g. EV_UPDATED | EV_UPDATED_MANUAL)
+ * \param[in] fast Invoke the callback directly instead of from the event task
+ * \param[in] coalesce Do not queue an EV_UPDATED while the previous one for the instance is pending
  * \return 0 if success or -1 if failure
  */
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
-                          UAVObjEventCallback cb, uint8_t eventMask, bool fast)
+                          UAVObjEventCallback cb, uint8_t eventMask, bool fast, bool coalesce)
 {
     struct ObjectEventEntry *event;
+    struct ObjectEventEntry *unused = NULL;
     struct UAVOBase *obj;
 
     // Check that the queue is not already connected, if it is simply update event mask
@@ -1681,21 +2053,36 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
         if (event->queue == queue && event->cb == cb) {
             // Already connected, update event mask and return
             event->eventMask = eventMask;
-            event->fast = fast;
+            event->fast     = fast;
+            event->coalesce = coalesce;
             return 0;
         }
+        if (event->queue == NULL && event->cb == NULL) {
+            unused = event;
+        }
     }
 
-    // Add queue to list
-    event = (struct ObjectEventEntry *)pios_malloc(sizeof(struct ObjectEventEntry));
+    // Reuse a disconnected entry or add an unused one to the list, sendEvent() skips it
+    event = unused;
     if (event == NULL) {
-        return -1;
+        event = (struct ObjectEventEntry *)pios_malloc(sizeof(struct ObjectEventEntry));
+        if (event == NULL) {
+            return -1;
+        }
+        event->next  = NULL;
+        event->queue = NULL;
+        event->cb    = NULL;
+        __sync_synchronize();
+        LL_APPEND(obj->next_event, event);
     }
-    event->queue     = queue;
-    event->cb        = cb;
     event->eventMask = eventMask;
     event->fast      = fast;
-    LL_APPEND(obj->next_event, event);
+    event->coalesce  = coalesce;
+    event->pending   = 0;
+    // Make sure the entry is complete before sendEvent() acts on it
+    __sync_synchronize();
+    event->queue     = queue;
+    event->cb        = cb;
 
     // Done
     return 0;
@@ -1719,8 +2106,9 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
     LL_FOREACH(obj->next_event, event) {
         if ((event->queue == queue
              && event->cb == cb)) {
-            LL_DELETE(obj->next_event, event);
-            vPortFree(event);
+            // Leave the entry in the list for connectObj() to reuse, sendEvent() may be walking it
+            event->queue = NULL;
+            event->cb    = NULL;
             return 0;
         }
     }
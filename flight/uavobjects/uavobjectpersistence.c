@@ -43,28 +43,25 @@ int32_t UAVObjSave(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
 
-    if (UAVObjIsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            return -1;
-        }
-
-        if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), UAVObjGetNumBytes(obj_handle)) != 0) {
-            return -1;
-        }
-    } else {
-        InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+    if (UAVObjIsMetaobject(obj_handle) && instId != 0) {
+        return -1;
+    }
 
-        if (instEntry == NULL) {
-            return -1;
-        }
+    // Write a consistent copy, so neither readers nor writers wait for the flash
+    uint32_t numBytes = UAVObjGetNumBytes(obj_handle);
+    uint8_t *data     = (uint8_t *)pios_malloc(numBytes);
+    if (data == NULL) {
+        return -1;
+    }
 
-        if (InstanceData(instEntry) == NULL) {
-            return -1;
-        }
+    int32_t rc = UAVObjGetInstanceData(obj_handle, instId, data);
+    if (rc == 0) {
+        rc = PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, data, numBytes);
+    }
+    pios_free(data);
 
-        if (PIOS_FLASHFS_ObjSave(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) != 0) {
-            return -1;
-        }
+    if (rc != 0) {
+        return -1;
     }
     return 0;
 }
@@ -82,32 +79,39 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 {
     PIOS_Assert(obj_handle);
 
-    if (UAVObjIsMetaobject(obj_handle)) {
-        if (instId != 0) {
-            return -1;
-        }
-
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle), UAVObjGetNumBytes(obj_handle)) == 0) {
-            sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
-        } else {
-            return -1;
-        }
-    } else {
-        InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+    if (UAVObjIsMetaobject(obj_handle) && instId != 0) {
+        return -1;
+    }
 
-        if (instEntry == NULL) {
-            return -1;
-        }
+    // Read from flash into a buffer first, the object is only locked for the copy
+    uint32_t numBytes = UAVObjGetNumBytes(obj_handle);
+    uint8_t *data     = (uint8_t *)pios_malloc(numBytes);
+    if (data == NULL) {
+        return -1;
+    }
 
-        // Fire event on success
-        if (PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, InstanceData(instEntry), UAVObjGetNumBytes(obj_handle)) == 0) {
-            sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
+    int32_t rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id, UAVObjGetID(obj_handle), instId, data, numBytes);
+    if (rc == 0) {
+        UAVObjSeqWriteBegin(obj_handle);
+        if (UAVObjIsMetaobject(obj_handle)) {
+            memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), data, numBytes);
         } else {
-            return -1;
+            InstanceHandle instEntry = getInstance((struct UAVOData *)obj_handle, instId);
+            if (instEntry != NULL) {
+                memcpy(InstanceData(instEntry), data, numBytes);
+            } else {
+                rc = -1;
+            }
         }
+        UAVObjSeqWriteEnd(obj_handle);
     }
+    pios_free(data);
 
+    // Fire event on success
+    if (rc != 0) {
+        return -1;
+    }
+    sendEvent((struct UAVOBase *)obj_handle, instId, EV_UNPACKED);
 
     return 0;
 }
@@ -44,6 +44,10 @@ typedef struct {
     uint32_t rxErrors;
     uint32_t rxSyncErrors;
     uint32_t rxCrcErrors;
+
+    uint32_t txDeltaObjects; // objects sent delta encoded
+    uint32_t txDeltaSavedBytes; // payload bytes saved by delta encoding
+    uint32_t rxDeltaObjects;
 } UAVTalkStats;
 
 typedef void *UAVTalkConnection;
@@ -56,6 +60,11 @@ int32_t UAVTalkSetOutputStream(UAVTalkConnection connection, UAVTalkOutputStream
 UAVTalkOutputStream UAVTalkGetOutputStream(UAVTalkConnection connection);
 int32_t UAVTalkSendObject(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
 int32_t UAVTalkSendObjectTimestamped(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, uint8_t acked, int32_t timeoutMs);
+int32_t UAVTalkSendObjectPacked(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId);
+int32_t UAVTalkFlushPacked(UAVTalkConnection connectionHandle);
+int32_t UAVTalkAnnounceMultiObject(UAVTalkConnection connectionHandle);
+int32_t UAVTalkSetDeltaMode(UAVTalkConnection connectionHandle, bool enable);
+int32_t UAVTalkGetDeltaStats(UAVTalkConnection connectionHandle, uint32_t objId, uint16_t instId, uint32_t *rawBytes, uint32_t *sentBytes);
 int32_t UAVTalkSendObjectRequest(UAVTalkConnection connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs);
 UAVTalkRxState UAVTalkProcessInputStream(UAVTalkConnection connectionHandle, uint8_t *rxbuffer, uint8_t length);
 UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
@@ -46,6 +46,44 @@
 #define UAVTALK_MIN_PACKET_LENGTH  UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH  UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
 
+// multi object entry header : object ID(4), instance ID(2)
+#define UAVTALK_MULTI_ENTRY_HEADER_LENGTH 6
+
+// payload limit of a multi object packet, the GCS accepts at most 255 payload bytes per packet
+#define UAVTALK_MULTI_MAX_PAYLOAD  (UAVOBJECTS_LARGEST < 255 ? UAVOBJECTS_LARGEST : 255)
+
+// the object ID field of a multi object packet, the instance ID field holds the number of entries
+#define UAVTALK_MULTI_OBJID        0
+// instance ID field of the empty multi object packets used to negotiate support, a bitmask
+#define UAVTALK_MULTI_OFFER        0x0000
+#define UAVTALK_MULTI_ANSWER       0x0001
+#define UAVTALK_MULTI_DELTA        0x0002 // the sender decodes delta entries
+
+// instance ID flag of delta encoded multi object entries, the entry data is a bitmap of changed
+// 32bit words followed by the changed words (the last word may be short)
+#define UAVTALK_DELTA_FLAG         0x8000
+#define UAVTALK_DELTA_WORD         4
+#define UAVTALK_DELTA_BITMAP_LENGTH(size) ((((size) + UAVTALK_DELTA_WORD - 1) / UAVTALK_DELTA_WORD + 7) / 8)
+// every n-th update of an object instance is sent in full so receivers recover from lost packets
+#define UAVTALK_DELTA_KEYFRAME_INTERVAL 16
+// memory limit for the last transmitted object images kept per connection
+#define UAVTALK_DELTA_MAX_BYTES    2048
+#define UAVTALK_DELTA_BUCKETS      16
+
+/**
+ * Last transmitted image of an object instance, reference for delta encoding
+ */
+typedef struct UAVTalkDeltaImageStruct {
+    struct UAVTalkDeltaImageStruct *next;
+    uint32_t objId;
+    uint16_t instId;
+    uint16_t length;
+    uint8_t  updates; // updates sent since the last keyframe
+    uint32_t rawBytes; // payload bytes of all updates
+    uint32_t sentBytes; // bytes actually sent for them
+    uint8_t  data[];
+} UAVTalkDeltaImage;
+
 typedef struct {
     uint8_t  type;
     uint16_t packet_size;
@@ -73,6 +111,14 @@ typedef struct {
     UAVTalkInputProcessor iproc;
     uint8_t      *rxBuffer;
     uint8_t      *txBuffer;
+    uint8_t      *multiBuffer; // packet being packed, allocated once the peer announced support
+    uint16_t     multiLength; // payload bytes in multiBuffer
+    uint16_t     multiCount; // entries in multiBuffer
+    bool multiPeer; // the peer accepts multi object packets
+    bool deltaEnabled; // delta encoding requested by UAVTalkSetDeltaMode()
+    bool deltaPeer; // the peer decodes delta entries
+    uint16_t     deltaBytes; // memory used by deltaImages
+    UAVTalkDeltaImage *deltaImages[UAVTALK_DELTA_BUCKETS];
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI          0xCA
@@ -86,6 +132,7 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK    (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK        (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK       (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_MULTI  (UAVTALK_TYPE_VER | 0x05)
 #define UAVTALK_TYPE_OBJ_TS     (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
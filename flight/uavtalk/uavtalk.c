@@ -52,6 +52,12 @@ static int32_t objectTransaction(UAVTalkConnectionData *connection, uint8_t type
 static int32_t sendObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, UAVObjHandle obj);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t *data);
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length);
+static int32_t packObject(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj);
+static int32_t flushMultiObject(UAVTalkConnectionData *connection);
+static UAVTalkDeltaImage *getDeltaImage(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint16_t length);
+static uint16_t encodeDelta(const UAVTalkDeltaImage *image, const uint8_t *data, uint8_t *out);
+static int32_t sendMultiObjectAnnounce(UAVTalkConnectionData *connection, uint16_t kind);
 static void updateAck(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId);
 // UavTalk Process FSM functions
 static bool UAVTalkProcess_SYNC(UAVTalkConnectionData *connection, UAVTalkInputProcessor *iproc, uint8_t *rxbuffer, uint8_t length, uint8_t *position);
@@ -92,6 +98,14 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
     if (!connection->txBuffer) {
         return 0;
     }
+    connection->multiBuffer = NULL;
+    connection->multiLength = 0;
+    connection->multiCount  = 0;
+    connection->multiPeer   = false;
+    connection->deltaEnabled = false;
+    connection->deltaPeer   = false;
+    connection->deltaBytes  = 0;
+    memset(connection->deltaImages, 0, sizeof(connection->deltaImages));
     vSemaphoreCreateBinary(connection->respSema);
     xSemaphoreTake(connection->respSema, 0); // reset to zero
     UAVTalkResetStats((UAVTalkConnection)connection);
@@ -187,6 +201,9 @@ void UAVTalkAddStats(UAVTalkConnection connectionHandle, UAVTalkStats *statsOut,
     statsOut->rxErrors      += connection->stats.rxErrors;
     statsOut->rxSyncErrors  += connection->stats.rxSyncErrors;
     statsOut->rxCrcErrors   += connection->stats.rxCrcErrors;
+    statsOut->txDeltaObjects    += connection->stats.txDeltaObjects;
+    statsOut->txDeltaSavedBytes += connection->stats.txDeltaSavedBytes;
+    statsOut->rxDeltaObjects    += connection->stats.rxDeltaObjects;
 
     if (reset) {
         // Clear stats
@@ -273,6 +290,147 @@ int32_t UAVTalkSendObject(UAVTalkConnection connectionHandle, UAVObjHandle obj,
     }
 }
 
+/**
+ * Send the specified object through the telemetry link without an ack, packed together with other
+ * objects into one multi object packet if the peer supports it. Packed objects are sent once the
+ * packet is full, on UAVTalkFlushPacked() or before any other packet goes out on the connection.
+ * Falls back to a regular UAVTALK_TYPE_OBJ packet otherwise.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectPacked(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    int32_t ret = 0;
+    uint32_t objId = UAVObjGetID(obj);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj)) {
+        instId = 0;
+    }
+    if (!connection->multiPeer) {
+        ret = sendObject(connection, UAVTALK_TYPE_OBJ, objId, instId, obj);
+    } else if (instId == UAVOBJ_ALL_INSTANCES) {
+        // Pack all instances in reverse order, see sendObject()
+        uint32_t numInst = UAVObjGetNumInstances(obj);
+        for (uint32_t n = 0; n < numInst && ret == 0; ++n) {
+            ret = packObject(connection, objId, numInst - n - 1, obj);
+        }
+    } else {
+        ret = packObject(connection, objId, instId, obj);
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Send the multi object packet collected by UAVTalkSendObjectPacked(), if any.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushPacked(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    int32_t ret = flushMultiObject(connection);
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Offer multi object packets to the peer. Until the peer answers, UAVTalkSendObjectPacked()
+ * sends regular packets. Peers that do not know multi object packets drop the offer.
+ * Call this whenever a new peer may be connected (i.e. on the connection handshake).
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkAnnounceMultiObject(UAVTalkConnection connectionHandle)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    flushMultiObject(connection);
+    connection->multiPeer = false;
+    connection->deltaPeer = false;
+    // the new peer knows nothing yet, start over with keyframes
+    for (uint8_t n = 0; n < UAVTALK_DELTA_BUCKETS; n++) {
+        for (UAVTalkDeltaImage *image = connection->deltaImages[n]; image; image = image->next) {
+            image->updates = 0;
+        }
+    }
+    int32_t ret = sendMultiObjectAnnounce(connection, UAVTALK_MULTI_OFFER);
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
+/**
+ * Enable delta encoding of packed objects. Once the peer announced it decodes them, objects sent
+ * with UAVTalkSendObjectPacked() only carry the 32bit words changed since their last transmission.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] enable Enable or disable delta encoding
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSetDeltaMode(UAVTalkConnection connectionHandle, bool enable)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    connection->deltaEnabled = enable;
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return 0;
+}
+
+/**
+ * Get the delta encoding statistics of an object instance.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[out] rawBytes Payload bytes of all updates sent packed
+ * \param[out] sentBytes Bytes actually sent for them, sentBytes / rawBytes is the compression ratio
+ * \return 0 Success
+ * \return -1 Failure, the instance was never sent delta encoded
+ */
+int32_t UAVTalkGetDeltaStats(UAVTalkConnection connectionHandle, uint32_t objId, uint16_t instId, uint32_t *rawBytes, uint32_t *sentBytes)
+{
+    UAVTalkConnectionData *connection;
+
+    CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+    int32_t ret = -1;
+    xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+    for (UAVTalkDeltaImage *image = connection->deltaImages[(objId ^ instId) % UAVTALK_DELTA_BUCKETS]; image; image = image->next) {
+        if (image->objId == objId && image->instId == instId) {
+            *rawBytes  = image->rawBytes;
+            *sentBytes = image->sentBytes;
+            ret = 0;
+            break;
+        }
+    }
+    xSemaphoreGiveRecursive(connection->lock);
+
+    return ret;
+}
+
 /**
  * Send the specified object through the telemetry link with a timestamp.
  * \param[in] connection UAVTalkConnection to be used
@@ -486,6 +644,9 @@ int32_t UAVTalkRelayPacket(UAVTalkConnection inConnectionHandle, UAVTalkConnecti
     // Lock
     xSemaphoreTakeRecursive(outConnection->lock, portMAX_DELAY);
 
+    // Keep the order of packets
+    flushMultiObject(outConnection);
+
     outConnection->txBuffer[0] = UAVTALK_SYNC_VAL;
     // Setup type
     outConnection->txBuffer[1] = inIproc->type;
@@ -688,6 +849,14 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
         }
         break;
 
+    case UAVTALK_TYPE_OBJ_MULTI:
+        if (objId == UAVTALK_MULTI_OBJID) {
+            ret = receiveMultiObject(connection, instId, data, connection->iproc.length);
+        } else {
+            ret = -1;
+        }
+        break;
+
     default:
         ret = -1;
     }
@@ -699,6 +868,307 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
     return ret;
 }
 
+/**
+ * Receive a multi object packet, an empty one negotiates multi object support.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] count Number of packed objects, or the announce kind for empty packets
+ * \param[in] data Data buffer
+ * \param[in] length Buffer length
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t receiveMultiObject(UAVTalkConnectionData *connection, uint16_t count, uint8_t *data, uint32_t length)
+{
+    if (length == 0) {
+        // the peer understands multi object packets, make room to send them
+        if (!connection->multiBuffer) {
+            connection->multiBuffer = pios_malloc(UAVTALK_MAX_HEADER_LENGTH + UAVTALK_MULTI_MAX_PAYLOAD + UAVTALK_CHECKSUM_LENGTH);
+        }
+        connection->multiPeer = (connection->multiBuffer != NULL);
+        connection->deltaPeer = (count & UAVTALK_MULTI_DELTA) != 0;
+        if (!(count & UAVTALK_MULTI_ANSWER)) {
+            return sendMultiObjectAnnounce(connection, UAVTALK_MULTI_ANSWER);
+        }
+        return 0;
+    }
+
+    int32_t ret     = 0;
+    uint32_t offset = 0;
+    for (uint16_t n = 0; n < count; n++) {
+        if (offset + UAVTALK_MULTI_ENTRY_HEADER_LENGTH > length) {
+            return -1;
+        }
+        uint32_t objId  = data[offset] | (data[offset + 1] << 8) | (data[offset + 2] << 16) | ((uint32_t)data[offset + 3] << 24);
+        uint16_t instId = data[offset + 4] | (data[offset + 5] << 8);
+        offset += UAVTALK_MULTI_ENTRY_HEADER_LENGTH;
+
+        // the entry length is only known for known objects, the rest of the packet is lost otherwise
+        UAVObjHandle obj = UAVObjGetByID(objId);
+        if (!obj || instId == UAVOBJ_ALL_INSTANCES) {
+            return -1;
+        }
+        uint16_t size = UAVObjGetNumBytes(obj);
+
+        if (instId & UAVTALK_DELTA_FLAG) {
+            // patch the changed words into the current object data
+            instId &= ~UAVTALK_DELTA_FLAG;
+            uint8_t *bitmap = &data[offset];
+            uint16_t bitmapLength = UAVTALK_DELTA_BITMAP_LENGTH(size);
+            uint8_t *image = connection->txBuffer;
+            offset += bitmapLength;
+            if (offset > length) {
+                return -1;
+            }
+            int32_t packed = UAVObjPack(obj, instId, image);
+            for (uint16_t word = 0; word * UAVTALK_DELTA_WORD < size; word++) {
+                if (bitmap[word / 8] & (1 << (word % 8))) {
+                    uint16_t start = word * UAVTALK_DELTA_WORD;
+                    uint16_t bytes = (size - start < UAVTALK_DELTA_WORD) ? size - start : UAVTALK_DELTA_WORD;
+                    if (offset + bytes > length) {
+                        return -1;
+                    }
+                    memcpy(&image[start], &data[offset], bytes);
+                    offset += bytes;
+                }
+            }
+            // a delta can not create the instance, it is skipped until the next keyframe
+            if (packed == 0 && UAVObjUnpack(obj, instId, image) == 0) {
+                updateAck(connection, UAVTALK_TYPE_OBJ, objId, instId);
+                connection->stats.rxDeltaObjects++;
+            } else {
+                ret = -1;
+            }
+        } else {
+            if (offset + size > length) {
+                return -1;
+            }
+            if (UAVObjUnpack(obj, instId, &data[offset]) == 0) {
+                updateAck(connection, UAVTALK_TYPE_OBJ, objId, instId);
+            } else {
+                ret = -1;
+            }
+            offset += size;
+        }
+    }
+    // one object was already accounted for the whole packet, an empty one keeps that
+    if (count > 0) {
+        connection->stats.rxObjects += count - 1;
+    }
+
+    return (offset == length) ? ret : -1;
+}
+
+/**
+ * Find the last transmitted image of an object instance, allocate it if there is none yet.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID
+ * \param[in] length The object size
+ * \return The image or NULL if the delta memory is exhausted
+ */
+static UAVTalkDeltaImage *getDeltaImage(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, uint16_t length)
+{
+    UAVTalkDeltaImage **bucket = &connection->deltaImages[(objId ^ instId) % UAVTALK_DELTA_BUCKETS];
+    UAVTalkDeltaImage *image;
+
+    for (image = *bucket; image; image = image->next) {
+        if (image->objId == objId && image->instId == instId) {
+            return image;
+        }
+    }
+
+    if (connection->deltaBytes + sizeof(UAVTalkDeltaImage) + length > UAVTALK_DELTA_MAX_BYTES) {
+        return NULL;
+    }
+    image = pios_malloc(sizeof(UAVTalkDeltaImage) + length);
+    if (!image) {
+        return NULL;
+    }
+    image->objId     = objId;
+    image->instId    = instId;
+    image->length    = length;
+    image->updates   = 0;
+    image->rawBytes  = 0;
+    image->sentBytes = 0;
+    image->next      = *bucket;
+    *bucket = image;
+    connection->deltaBytes += sizeof(UAVTalkDeltaImage) + length;
+    return image;
+}
+
+/**
+ * Delta encode an object instance against its last transmitted image.
+ * \param[in] image The last transmitted image
+ * \param[in] data The current object data
+ * \param[out] out Bitmap of changed words followed by the changed words, NULL to only get the length
+ * \return Encoded length
+ */
+static uint16_t encodeDelta(const UAVTalkDeltaImage *image, const uint8_t *data, uint8_t *out)
+{
+    uint16_t bitmapLength = UAVTALK_DELTA_BITMAP_LENGTH(image->length);
+    uint16_t length = bitmapLength;
+
+    if (out) {
+        memset(out, 0, bitmapLength);
+    }
+    for (uint16_t start = 0; start < image->length; start += UAVTALK_DELTA_WORD) {
+        uint16_t bytes = (image->length - start < UAVTALK_DELTA_WORD) ? image->length - start : UAVTALK_DELTA_WORD;
+        if (memcmp(&image->data[start], &data[start], bytes)) {
+            if (out) {
+                uint16_t word = start / UAVTALK_DELTA_WORD;
+                out[word / 8] |= 1 << (word % 8);
+                memcpy(&out[length], &data[start], bytes);
+            }
+            length += bytes;
+        }
+    }
+    return length;
+}
+
+/**
+ * Append an object instance to the multi object packet, sending the packet first if it is full.
+ * Objects that do not fit into an empty multi object packet are sent as regular packet.
+ * If the peer decodes deltas, only the words changed since the last transmission are sent
+ * with a full keyframe every UAVTALK_DELTA_KEYFRAME_INTERVAL updates.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] objId The object ID
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] obj Object handle to send
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t packObject(UAVTalkConnectionData *connection, uint32_t objId, uint16_t instId, UAVObjHandle obj)
+{
+    uint16_t length = UAVObjGetNumBytes(obj);
+
+    if (length + UAVTALK_MULTI_ENTRY_HEADER_LENGTH > UAVTALK_MULTI_MAX_PAYLOAD) {
+        return sendSingleObject(connection, UAVTALK_TYPE_OBJ, objId, instId, obj);
+    }
+
+    // the current data is packed into the tx buffer, the entry is built from there
+    uint8_t *current = connection->txBuffer;
+    if (UAVObjPack(obj, instId, current) == -1) {
+        connection->stats.txErrors++;
+        return -1;
+    }
+
+    uint16_t payloadLength   = length;
+    uint16_t entryInstId     = instId;
+    UAVTalkDeltaImage *image = NULL;
+    if (connection->deltaEnabled && connection->deltaPeer) {
+        image = getDeltaImage(connection, objId, instId, length);
+    }
+    if (image && image->updates > 0) {
+        uint16_t deltaLength = encodeDelta(image, current, NULL);
+        if (deltaLength < length) {
+            payloadLength = deltaLength;
+            entryInstId  |= UAVTALK_DELTA_FLAG;
+        }
+    }
+
+    if (connection->multiLength + UAVTALK_MULTI_ENTRY_HEADER_LENGTH + payloadLength > UAVTALK_MULTI_MAX_PAYLOAD) {
+        if (flushMultiObject(connection) == -1) {
+            return -1;
+        }
+    }
+
+    uint8_t *entry = &connection->multiBuffer[UAVTALK_MIN_HEADER_LENGTH + connection->multiLength];
+    entry[0] = (uint8_t)(objId & 0xFF);
+    entry[1] = (uint8_t)((objId >> 8) & 0xFF);
+    entry[2] = (uint8_t)((objId >> 16) & 0xFF);
+    entry[3] = (uint8_t)((objId >> 24) & 0xFF);
+    entry[4] = (uint8_t)(entryInstId & 0xFF);
+    entry[5] = (uint8_t)((entryInstId >> 8) & 0xFF);
+    if (entryInstId & UAVTALK_DELTA_FLAG) {
+        encodeDelta(image, current, &entry[UAVTALK_MULTI_ENTRY_HEADER_LENGTH]);
+    } else {
+        memcpy(&entry[UAVTALK_MULTI_ENTRY_HEADER_LENGTH], current, length);
+    }
+    connection->multiLength += UAVTALK_MULTI_ENTRY_HEADER_LENGTH + payloadLength;
+    connection->multiCount++;
+    connection->stats.txObjectBytes += payloadLength;
+
+    if (image) {
+        memcpy(image->data, current, length);
+        image->updates    = (image->updates + 1) % UAVTALK_DELTA_KEYFRAME_INTERVAL;
+        image->rawBytes  += length;
+        image->sentBytes += payloadLength;
+        if (entryInstId & UAVTALK_DELTA_FLAG) {
+            connection->stats.txDeltaObjects++;
+            connection->stats.txDeltaSavedBytes += length - payloadLength;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Send the pending multi object packet, if any.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushMultiObject(UAVTalkConnectionData *connection)
+{
+    if (!connection->multiCount) {
+        return 0;
+    }
+
+    uint8_t *buffer = connection->multiBuffer;
+    uint16_t packetLength;
+    if (connection->multiCount == 1 && !(buffer[UAVTALK_MIN_HEADER_LENGTH + 5] & (UAVTALK_DELTA_FLAG >> 8))) {
+        // a single entry is cheaper as regular packet, its object and instance ID are already in place
+        buffer      += UAVTALK_MULTI_ENTRY_HEADER_LENGTH;
+        packetLength = connection->multiLength - UAVTALK_MULTI_ENTRY_HEADER_LENGTH + UAVTALK_MIN_HEADER_LENGTH;
+        buffer[0]    = UAVTALK_SYNC_VAL;
+        buffer[1]    = UAVTALK_TYPE_OBJ;
+        buffer[2]    = (uint8_t)(packetLength & 0xFF);
+        buffer[3]    = (uint8_t)((packetLength >> 8) & 0xFF);
+    } else {
+        packetLength = UAVTALK_MIN_HEADER_LENGTH + connection->multiLength;
+        buffer[0]    = UAVTALK_SYNC_VAL;
+        buffer[1]    = UAVTALK_TYPE_OBJ_MULTI;
+        buffer[2]    = (uint8_t)(packetLength & 0xFF);
+        buffer[3]    = (uint8_t)((packetLength >> 8) & 0xFF);
+        buffer[4]    = (uint8_t)(UAVTALK_MULTI_OBJID & 0xFF);
+        buffer[5]    = (uint8_t)((UAVTALK_MULTI_OBJID >> 8) & 0xFF);
+        buffer[6]    = (uint8_t)((UAVTALK_MULTI_OBJID >> 16) & 0xFF);
+        buffer[7]    = (uint8_t)((UAVTALK_MULTI_OBJID >> 24) & 0xFF);
+        buffer[8]    = (uint8_t)(connection->multiCount & 0xFF);
+        buffer[9]    = (uint8_t)((connection->multiCount >> 8) & 0xFF);
+    }
+    buffer[packetLength] = PIOS_CRC_updateCRC(0, buffer, packetLength);
+
+    uint16_t count = connection->multiCount;
+    connection->multiLength = 0;
+    connection->multiCount  = 0;
+
+    int32_t rc = connection->outStream ? (*connection->outStream)(buffer, packetLength + UAVTALK_CHECKSUM_LENGTH) : -1;
+    if (rc == packetLength + UAVTALK_CHECKSUM_LENGTH) {
+        connection->stats.txObjects += count;
+        connection->stats.txBytes   += rc;
+    } else {
+        connection->stats.txErrors++;
+        connection->stats.txBytes += (rc > 0) ? rc : 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Send an empty multi object packet to offer or confirm multi object support.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] kind UAVTALK_MULTI_OFFER or UAVTALK_MULTI_ANSWER
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendMultiObjectAnnounce(UAVTalkConnectionData *connection, uint16_t kind)
+{
+    // delta entries are always decoded
+    return sendSingleObject(connection, UAVTALK_TYPE_OBJ_MULTI, UAVTALK_MULTI_OBJID, kind | UAVTALK_MULTI_DELTA, NULL);
+}
+
 /**
  * Check if an ack is pending on an object and give response semaphore
  * \param[in] connection UAVTalkConnection to be used
@@ -789,6 +1259,9 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
         return -1;
     }
 
+    // Keep the order of packets
+    flushMultiObject(connection);
+
     // Setup sync byte
     connection->txBuffer[0] = UAVTALK_SYNC_VAL;
     // Setup type
@@ -814,7 +1287,7 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, uint8_t type,
 
     // Determine data length
     int32_t length;
-    if (type == UAVTALK_TYPE_OBJ_REQ || type == UAVTALK_TYPE_ACK || type == UAVTALK_TYPE_NACK) {
+    if (type == UAVTALK_TYPE_OBJ_REQ || type == UAVTALK_TYPE_ACK || type == UAVTALK_TYPE_NACK || type == UAVTALK_TYPE_OBJ_MULTI) {
         length = 0;
     } else {
         length = UAVObjGetNumBytes(obj);
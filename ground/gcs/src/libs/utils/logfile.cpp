@@ -1,15 +1,74 @@
 #include "logfile.h"
 #include <QDebug>
 #include <QtGlobal>
+#include <QtEndian>
+
+/*
+ * Log layout, fields in host byte order like the records always were:
+ *
+ * header:   char magic[8], quint32 version, quint32 header size,
+ *           quint32 keyframe interval in ms, quint32 object count, then per
+ *           object quint32 id, quint32 size, quint16 name length, UTF-8 name
+ * records:  quint32 timestamp in ms, qint64 size, the UAVTalk packets sent.
+ *           A negative size marks a keyframe, the last packet of every
+ *           object instance so far, written before the first record of
+ *           every keyframe interval.
+ * index:    quint32 timestamp and qint64 offset of every keyframe, then
+ *           quint32 count, quint32 last timestamp, qint64 index offset and
+ *           char magic[8]. Only written on close, logs without it are
+ *           scanned on opening.
+ *
+ * Logs written before the header existed are just the records.
+ */
+static const char LOG_MAGIC[8]   = { 'L', 'P', 'L', 'O', 'G', 0, 0, 0 };
+static const char INDEX_MAGIC[8] = { 'L', 'P', 'L', 'O', 'G', 'I', 'D', 'X' };
+static const quint32 LOG_VERSION = 1;
+static const qint64 LOG_HEADER_SIZE    = sizeof(LOG_MAGIC) + 4 * sizeof(quint32);
+static const qint64 RECORD_HEADER_SIZE = sizeof(quint32) + sizeof(qint64);
+static const qint64 INDEX_ENTRY_SIZE   = sizeof(quint32) + sizeof(qint64);
+static const qint64 INDEX_TRAILER_SIZE = 2 * sizeof(quint32) + sizeof(qint64) + sizeof(INDEX_MAGIC);
+static const qint64 MAX_RECORD_SIZE    = 1024 * 1024;
+static const quint32 KEYFRAME_INTERVAL = 10000;
+static const quint32 MAX_TIMESTAMP_GAP = 60 * 60 * 1000;
+static const quint32 POSITION_INTERVAL = 100;
+
+// UAVTalk framing, enough to tell object updates apart for the keyframes
+static const quint8 UAVTALK_SYNC_VAL      = 0x3C;
+static const quint8 UAVTALK_TYPE_OBJ      = 0x20;
+static const quint8 UAVTALK_TYPE_OBJ_ACK  = 0x22;
+static const qint64 UAVTALK_HEADER_LENGTH = 10;
+
+template<typename T> static void appendValue(QByteArray & array, T value)
+{
+    array.append((const char *)&value, sizeof(value));
+}
+
+template<typename T> static T readValue(const uchar *data)
+{
+    T value;
+
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
 
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
+    m_dataBufferPos(0),
     m_lastTimeStamp(0),
-    m_lastPlayed(0),
+    m_replayTime(0.0),
+    m_lastPositionSignal(0),
     m_timeOffset(0),
     m_playbackSpeed(1.0),
     m_nextTimeStamp(0),
-    m_useProvidedTimeStamp(false)
+    m_useProvidedTimeStamp(false),
+    m_map(NULL),
+    m_mapSize(0),
+    m_dataStart(0),
+    m_dataEnd(0),
+    m_readOffset(0),
+    m_duration(0),
+    m_lastKeyframe(0),
+    m_lastWritten(0)
 {
     connect(&m_timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -36,8 +95,13 @@ bool LogFile::open(OpenMode mode)
         return false;
     }
 
-    // TODO: Write a header at the beginng describing objects so that in future
-    // they can be read back if ID's change
+    if (m_file.isWritable()) {
+        // Describe the objects so that the log can be read back if ID's change
+        writeHeader();
+    } else if (!mapFile()) {
+        m_file.close();
+        return false;
+    }
 
     // Must call parent function for QIODevice to pass calls to writeData
     // We always open ReadWrite, because otherwise we will get tons of warnings
@@ -54,8 +118,22 @@ void LogFile::close()
     if (m_timer.isActive()) {
         m_timer.stop();
     }
+    if (m_file.isOpen() && m_file.isWritable()) {
+        writeIndex();
+    }
+    if (m_map) {
+        m_file.unmap(const_cast<uchar *>(m_map));
+        m_map = NULL;
+    }
     m_file.close();
     QIODevice::close();
+
+    m_state.clear();
+    m_index.clear();
+    m_mutex.lock();
+    m_dataBuffer.clear();
+    m_dataBufferPos = 0;
+    m_mutex.unlock();
 }
 
 qint64 LogFile::writeData(const char *data, qint64 dataSize)
@@ -68,97 +146,106 @@ qint64 LogFile::writeData(const char *data, qint64 dataSize)
     // This is used when saving logs from on-board logging
     quint32 timeStamp = m_useProvidedTimeStamp ? m_nextTimeStamp : m_myTime.elapsed();
 
-    m_file.write((char *)&timeStamp, sizeof(timeStamp));
-    m_file.write((char *)&dataSize, sizeof(dataSize));
-
-    qint64 written = m_file.write(data, dataSize);
-    if (written != -1) {
-        emit bytesWritten(written);
+    // Start the interval with everything known so far, seeking starts from there
+    if (timeStamp >= m_lastKeyframe + KEYFRAME_INTERVAL && !m_state.isEmpty()) {
+        QByteArray keyframe;
+        foreach(const QByteArray &packet, m_state) {
+            keyframe.append(packet);
+        }
+        IndexEntry entry = { timeStamp, m_file.pos() };
+        m_index.append(entry);
+        writeRecord(timeStamp, -(qint64)keyframe.size(), keyframe.constData());
+        m_lastKeyframe = timeStamp;
     }
 
+    writeRecord(timeStamp, dataSize, data);
+    updateState(m_state, data, dataSize);
+
+    emit bytesWritten(dataSize);
+
     return dataSize;
 }
 
 qint64 LogFile::readData(char *data, qint64 maxSize)
 {
     QMutexLocker locker(&m_mutex);
-    qint64 toRead = qMin(maxSize, (qint64)m_dataBuffer.size());
+    qint64 toRead = qMin(maxSize, (qint64)(m_dataBuffer.size() - m_dataBufferPos));
 
-    memcpy(data, m_dataBuffer.data(), toRead);
-    m_dataBuffer.remove(0, toRead);
+    memcpy(data, m_dataBuffer.constData() + m_dataBufferPos, toRead);
+    m_dataBufferPos += toRead;
     return toRead;
 }
 
 qint64 LogFile::bytesAvailable() const
 {
-    return m_dataBuffer.size();
+    return m_dataBuffer.size() - m_dataBufferPos;
 }
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
-
-    if (m_file.bytesAvailable() > 4) {
-        int time;
-        time = m_myTime.elapsed();
-
-        // TODO: going back in time will be a problem
-        while ((m_lastPlayed + ((time - m_timeOffset) * m_playbackSpeed) > m_lastTimeStamp)) {
-            m_lastPlayed += ((time - m_timeOffset) * m_playbackSpeed);
-            if (m_file.bytesAvailable() < (qint64)sizeof(dataSize)) {
-                stopReplay();
-                return;
-            }
-
-            m_file.read((char *)&dataSize, sizeof(dataSize));
-
-            if (dataSize < 1 || dataSize > (1024 * 1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-
-            if (m_file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
-
-            m_mutex.lock();
-            m_dataBuffer.append(m_file.read(dataSize));
-            m_mutex.unlock();
-
-            emit readyRead();
-
-            if (m_file.bytesAvailable() < (qint64)sizeof(m_lastTimeStamp)) {
-                stopReplay();
-                return;
-            }
-
-            int save = m_lastTimeStamp;
-            m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
-            // some validity checks
-            if (m_lastTimeStamp < save // logfile goes back in time
-                || (m_lastTimeStamp - save) > (60 * 60 * 1000)) { // gap of more than 60 minutes)
-                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << m_lastTimeStamp << " after " << save << "\n";
-                stopReplay();
-                return;
-            }
-
-            m_timeOffset = time;
-            time = m_myTime.elapsed();
+    int time = m_myTime.elapsed();
+
+    m_replayTime += (time - m_timeOffset) * m_playbackSpeed;
+    m_timeOffset  = time;
+
+    // Play every record that is due
+    bool played = false;
+    Record record;
+    while (m_readOffset < m_dataEnd) {
+        if (!readRecord(m_readOffset, record)) {
+            qDebug() << "Error: Logfile corrupted! Unreadable record at offset " << m_readOffset << "\n";
+            stopReplay();
+            return;
+        }
+        if (record.timeStamp > m_replayTime) {
+            break;
+        }
+        // some validity checks
+        if (record.timeStamp < m_lastTimeStamp // logfile goes back in time
+            || (record.timeStamp - m_lastTimeStamp) > MAX_TIMESTAMP_GAP) { // gap of more than 60 minutes
+            qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << record.timeStamp << " after " << m_lastTimeStamp << "\n";
+            stopReplay();
+            return;
+        }
+        m_lastTimeStamp = record.timeStamp;
+        m_readOffset    = record.next;
+
+        // Keyframes repeat what was already played, they are only needed to seek
+        if (!record.keyframe) {
+            queueData(record.data, record.size);
+            played = true;
         }
-    } else {
+    }
+
+    if (played) {
+        emit readyRead();
+    }
+    if (replayPosition() - m_lastPositionSignal >= POSITION_INTERVAL) {
+        m_lastPositionSignal = replayPosition();
+        emit replayPositionChanged(m_lastPositionSignal);
+    }
+    if (m_readOffset >= m_dataEnd) {
         stopReplay();
     }
 }
 
 bool LogFile::startReplay()
 {
+    m_mutex.lock();
     m_dataBuffer.clear();
+    m_dataBufferPos = 0;
+    m_mutex.unlock();
     m_myTime.restart();
-    m_timeOffset = 0;
-    m_lastPlayed = 0;
-    m_file.read((char *)&m_lastTimeStamp, sizeof(m_lastTimeStamp));
+    m_timeOffset    = 0;
+    m_replayTime    = 0.0;
+    m_lastPositionSignal = 0;
+    m_readOffset    = m_dataStart;
+    m_lastTimeStamp = 0;
+
+    Record record;
+    if (readRecord(m_readOffset, record)) {
+        m_lastTimeStamp = record.timeStamp;
+    }
     m_timer.setInterval(10);
     m_timer.start();
     emit replayStarted();
@@ -182,3 +269,296 @@ void LogFile::resumeReplay()
     m_timeOffset = m_myTime.elapsed();
     m_timer.start();
 }
+
+/**
+ * Moves the replay to a position, backwards as well as forwards. The state of
+ * every object at that time is sent right away, playing goes on from there.
+ * Only the records since the keyframe before the position are read.
+ */
+bool LogFile::seekReplay(quint32 timeStamp)
+{
+    if (!m_map) {
+        return false;
+    }
+
+    // Last keyframe at or before the position
+    int first = 0;
+    int last  = m_index.size();
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (m_index[middle].timeStamp <= timeStamp) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    qint64 offset = (first > 0) ? m_index[first - 1].offset : m_dataStart;
+
+    QMap<quint64, QByteArray> state;
+    Record record;
+    m_lastTimeStamp = 0;
+    while (offset < m_dataEnd && readRecord(offset, record)) {
+        m_lastTimeStamp = record.timeStamp;
+        if (record.timeStamp > timeStamp) {
+            break;
+        }
+        if (record.keyframe) {
+            // holds everything played so far
+            state.clear();
+        }
+        updateState(state, record.data, record.size);
+        offset = record.next;
+    }
+    m_readOffset = offset;
+    m_replayTime = timeStamp;
+    m_timeOffset = m_myTime.elapsed();
+    m_lastPositionSignal = timeStamp;
+
+    m_mutex.lock();
+    m_dataBuffer.clear();
+    m_dataBufferPos = 0;
+    foreach(const QByteArray &packet, state) {
+        m_dataBuffer.append(packet);
+    }
+    m_mutex.unlock();
+
+    emit readyRead();
+    emit replayPositionChanged(timeStamp);
+    return true;
+}
+
+/**
+ * Pauses the replay and moves it by a number of milliseconds, negative to step back
+ */
+void LogFile::stepReplay(qint32 milliseconds)
+{
+    pauseReplay();
+    qint64 position = (qint64)replayPosition() + milliseconds;
+    seekReplay((quint32)qBound((qint64)0, position, (qint64)m_duration));
+}
+
+/**
+ * Maps the log being replayed and finds its records and keyframes
+ */
+bool LogFile::mapFile()
+{
+    m_mapSize = m_file.size();
+    m_map     = (m_mapSize > 0) ? m_file.map(0, m_mapSize) : NULL;
+    if (!m_map) {
+        qDebug() << "Unable to map " << m_file.fileName() << " for replay";
+        return false;
+    }
+
+    m_objectDefinitions.clear();
+    m_index.clear();
+    m_dataStart = 0;
+    m_dataEnd   = m_mapSize;
+    m_duration  = 0;
+    if (!readHeader()) {
+        qDebug() << "Error: Logfile corrupted! Invalid header\n";
+        m_file.unmap(const_cast<uchar *>(m_map));
+        m_map = NULL;
+        return false;
+    }
+    if (!readIndex()) {
+        // not closed properly or from before the index
+        scanRecords();
+    }
+    return true;
+}
+
+bool LogFile::readHeader()
+{
+    if (m_mapSize < LOG_HEADER_SIZE || memcmp(m_map, LOG_MAGIC, sizeof(LOG_MAGIC))) {
+        // just records
+        return true;
+    }
+
+    const uchar *header = m_map + sizeof(LOG_MAGIC);
+    quint32 version     = readValue<quint32>(header);
+    quint32 headerSize  = readValue<quint32>(header + sizeof(quint32));
+    quint32 count = readValue<quint32>(header + 3 * sizeof(quint32));
+    if (version < 1 || headerSize < LOG_HEADER_SIZE || headerSize > m_mapSize) {
+        return false;
+    }
+
+    // Later versions may add to the header, the records still start after it
+    qint64 offset = LOG_HEADER_SIZE;
+    for (quint32 i = 0; i < count; i++) {
+        if (offset + 2 * sizeof(quint32) + sizeof(quint16) > headerSize) {
+            return false;
+        }
+        ObjectDefinition definition;
+        definition.objId    = readValue<quint32>(m_map + offset);
+        definition.numBytes = readValue<quint32>(m_map + offset + sizeof(quint32));
+        quint16 nameLength = readValue<quint16>(m_map + offset + 2 * sizeof(quint32));
+        offset += 2 * sizeof(quint32) + sizeof(quint16);
+        if (offset + nameLength > headerSize) {
+            return false;
+        }
+        definition.name = QString::fromUtf8((const char *)m_map + offset, nameLength);
+        offset += nameLength;
+        m_objectDefinitions << definition;
+    }
+    m_dataStart = headerSize;
+    return true;
+}
+
+bool LogFile::readIndex()
+{
+    if (m_dataStart == 0 || m_mapSize < m_dataStart + INDEX_TRAILER_SIZE ||
+        memcmp(m_map + m_mapSize - sizeof(INDEX_MAGIC), INDEX_MAGIC, sizeof(INDEX_MAGIC))) {
+        return false;
+    }
+
+    const uchar *trailer = m_map + m_mapSize - INDEX_TRAILER_SIZE;
+    quint32 count    = readValue<quint32>(trailer);
+    quint32 duration = readValue<quint32>(trailer + sizeof(quint32));
+    qint64 indexOffset = readValue<qint64>(trailer + 2 * sizeof(quint32));
+    if (indexOffset < m_dataStart || indexOffset + count * INDEX_ENTRY_SIZE + INDEX_TRAILER_SIZE != m_mapSize) {
+        return false;
+    }
+
+    m_index.resize(count);
+    for (quint32 i = 0; i < count; i++) {
+        const uchar *entry = m_map + indexOffset + i * INDEX_ENTRY_SIZE;
+        m_index[i].timeStamp = readValue<quint32>(entry);
+        m_index[i].offset    = readValue<qint64>(entry + sizeof(quint32));
+        if (m_index[i].offset < m_dataStart || m_index[i].offset >= indexOffset) {
+            m_index.clear();
+            return false;
+        }
+    }
+    m_dataEnd  = indexOffset;
+    m_duration = duration;
+    return true;
+}
+
+/**
+ * Walks the record headers to find the keyframes and where the log ends
+ */
+void LogFile::scanRecords()
+{
+    Record record;
+    qint64 offset = m_dataStart;
+
+    m_index.clear();
+    m_dataEnd = m_mapSize;
+    while (offset < m_dataEnd && readRecord(offset, record)) {
+        if (record.keyframe) {
+            IndexEntry entry = { record.timeStamp, offset };
+            m_index.append(entry);
+        }
+        m_duration = record.timeStamp;
+        offset     = record.next;
+    }
+    // a record cut short by a crash is not played
+    m_dataEnd = offset;
+}
+
+bool LogFile::readRecord(qint64 offset, Record & record) const
+{
+    if (offset + RECORD_HEADER_SIZE > m_dataEnd) {
+        return false;
+    }
+
+    qint64 size = readValue<qint64>(m_map + offset + sizeof(quint32));
+    record.timeStamp = readValue<quint32>(m_map + offset);
+    record.keyframe  = size < 0;
+    record.size = record.keyframe ? -size : size;
+    if (record.size < 1 || record.size > MAX_RECORD_SIZE || record.size > m_dataEnd - offset - RECORD_HEADER_SIZE) {
+        return false;
+    }
+    record.data = (const char *)m_map + offset + RECORD_HEADER_SIZE;
+    record.next = offset + RECORD_HEADER_SIZE + record.size;
+    return true;
+}
+
+void LogFile::writeHeader()
+{
+    QByteArray header;
+
+    header.append(LOG_MAGIC, sizeof(LOG_MAGIC));
+    appendValue<quint32>(header, LOG_VERSION);
+    appendValue<quint32>(header, 0); // header size, filled in below
+    appendValue<quint32>(header, KEYFRAME_INTERVAL);
+    appendValue<quint32>(header, m_objectDefinitions.size());
+    foreach(const ObjectDefinition &definition, m_objectDefinitions) {
+        QByteArray name = definition.name.toUtf8();
+        appendValue<quint32>(header, definition.objId);
+        appendValue<quint32>(header, definition.numBytes);
+        appendValue<quint16>(header, name.size());
+        header.append(name);
+    }
+    quint32 headerSize = header.size();
+    memcpy(header.data() + sizeof(LOG_MAGIC) + sizeof(quint32), &headerSize, sizeof(headerSize));
+
+    m_file.write(header);
+    m_state.clear();
+    m_index.clear();
+    m_lastKeyframe = 0;
+    m_lastWritten  = 0;
+}
+
+void LogFile::writeRecord(quint32 timeStamp, qint64 size, const char *data)
+{
+    m_file.write((char *)&timeStamp, sizeof(timeStamp));
+    m_file.write((char *)&size, sizeof(size));
+    m_file.write(data, qAbs(size));
+    m_lastWritten = timeStamp;
+}
+
+void LogFile::writeIndex()
+{
+    qint64 indexOffset = m_file.pos();
+    QByteArray index;
+
+    foreach(const IndexEntry &entry, m_index) {
+        appendValue<quint32>(index, entry.timeStamp);
+        appendValue<qint64>(index, entry.offset);
+    }
+    appendValue<quint32>(index, m_index.size());
+    appendValue<quint32>(index, m_lastWritten);
+    appendValue<qint64>(index, indexOffset);
+    index.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    m_file.write(index);
+}
+
+/**
+ * Adds data for the reader, what was read before is only dropped once in a
+ * while instead of moving the buffer on every read
+ */
+void LogFile::queueData(const char *data, qint64 size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_dataBufferPos == m_dataBuffer.size()) {
+        m_dataBuffer.clear();
+        m_dataBufferPos = 0;
+    } else if (m_dataBufferPos > MAX_RECORD_SIZE) {
+        m_dataBuffer.remove(0, m_dataBufferPos);
+        m_dataBufferPos = 0;
+    }
+    m_dataBuffer.append(data, size);
+}
+
+/**
+ * Keeps the last update packet of every object instance in data
+ */
+void LogFile::updateState(QMap<quint64, QByteArray> & state, const char *data, qint64 size)
+{
+    qint64 offset = 0;
+
+    while (offset + UAVTALK_HEADER_LENGTH < size) {
+        const uchar *packet = (const uchar *)data + offset;
+        qint64 length = qFromLittleEndian<quint16>(packet + 2) + 1; // and the checksum
+        if (packet[0] != UAVTALK_SYNC_VAL || length <= UAVTALK_HEADER_LENGTH || offset + length > size) {
+            break;
+        }
+        if (packet[1] == UAVTALK_TYPE_OBJ || packet[1] == UAVTALK_TYPE_OBJ_ACK) {
+            quint64 key = ((quint64)qFromLittleEndian<quint32>(packet + 4) << 16) | qFromLittleEndian<quint16>(packet + 8);
+            state.insert(key, QByteArray((const char *)packet, length));
+        }
+        offset += length;
+    }
+}
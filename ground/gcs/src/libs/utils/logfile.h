@@ -8,11 +8,21 @@
 #include <QDebug>
 #include <QBuffer>
 #include <QFile>
+#include <QList>
+#include <QMap>
+#include <QVector>
 #include "utils_global.h"
 
 class QTCREATOR_UTILS_EXPORT LogFile : public QIODevice {
     Q_OBJECT
 public:
+    // Written to the header so that logs can be read back if object IDs change
+    struct ObjectDefinition {
+        quint32 objId;
+        quint32 numBytes;
+        QString name;
+    };
+
     explicit LogFile(QObject *parent = 0);
     qint64 bytesAvailable() const;
     qint64 bytesToWrite() const
@@ -40,6 +50,28 @@ public:
         m_nextTimeStamp = nextTimestamp;
     }
 
+    // Set before opening for writing, read from the header when replaying
+    void setObjectDefinitions(const QList<ObjectDefinition> & definitions)
+    {
+        m_objectDefinitions = definitions;
+    }
+
+    QList<ObjectDefinition> objectDefinitions() const
+    {
+        return m_objectDefinitions;
+    }
+
+    // Timestamp of the last record, in ms
+    quint32 replayDuration() const
+    {
+        return m_duration;
+    }
+
+    quint32 replayPosition() const
+    {
+        return (quint32)m_replayTime;
+    }
+
 public slots:
     void setReplaySpeed(double val)
     {
@@ -48,6 +80,8 @@ public slots:
     };
     void pauseReplay();
     void resumeReplay();
+    bool seekReplay(quint32 timeStamp);
+    void stepReplay(qint32 milliseconds);
 
 protected slots:
     void timerFired();
@@ -56,14 +90,17 @@ signals:
     void readReady();
     void replayStarted();
     void replayFinished();
+    void replayPositionChanged(quint32 timeStamp);
 
 protected:
     QByteArray m_dataBuffer;
+    int m_dataBufferPos; // bytes of m_dataBuffer already read
     QTimer m_timer;
     QTime m_myTime;
     QFile m_file;
-    qint32 m_lastTimeStamp;
-    qint32 m_lastPlayed;
+    quint32 m_lastTimeStamp;
+    double m_replayTime;
+    quint32 m_lastPositionSignal;
     QMutex m_mutex;
 
 
@@ -71,8 +108,47 @@ protected:
     double m_playbackSpeed;
 
 private:
+    struct Record {
+        quint32 timeStamp;
+        bool keyframe;
+        const char *data;
+        qint64 size;
+        qint64 next;
+    };
+
+    struct IndexEntry {
+        quint32 timeStamp;
+        qint64  offset;
+    };
+
     quint32 m_nextTimeStamp;
     bool m_useProvidedTimeStamp;
+    QList<ObjectDefinition> m_objectDefinitions;
+
+    // replay, the file is mapped and records are read in place
+    const uchar *m_map;
+    qint64 m_mapSize;
+    qint64 m_dataStart;
+    qint64 m_dataEnd;
+    qint64 m_readOffset;
+    quint32 m_duration;
+    QVector<IndexEntry> m_index;
+
+    // recording, last packet of every object instance for the next keyframe
+    QMap<quint64, QByteArray> m_state;
+    quint32 m_lastKeyframe;
+    quint32 m_lastWritten;
+
+    bool mapFile();
+    bool readHeader();
+    bool readIndex();
+    void scanRecords();
+    bool readRecord(qint64 offset, Record & record) const;
+    void writeHeader();
+    void writeRecord(quint32 timeStamp, qint64 size, const char *data);
+    void writeIndex();
+    void queueData(const char *data, qint64 size);
+    static void updateState(QMap<quint64, QByteArray> & state, const char *data, qint64 size);
 };
 
 #endif // LOGFILE_H
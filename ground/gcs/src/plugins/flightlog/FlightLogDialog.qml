@@ -105,6 +105,19 @@ Rectangle {
                             id: totalEntries
                             text: "<b>" + qsTr("Entries downloaded:") + "</b> " + logManager.logEntriesCount
                         }
+                        ProgressBar {
+                            id: downloadProgress
+                            visible: logManager.disableControls
+                            minimumValue: 0
+                            maximumValue: 100
+                            indeterminate: logManager.downloadProgress < 0
+                            value: logManager.downloadProgress
+                        }
+                        Text {
+                            id: downloadRate
+                            visible: logManager.disableControls
+                            text: "<b>" + qsTr("Download rate:") + "</b> " + logManager.downloadRate.toFixed(1) + " kB/s"
+                        }
                         Rectangle {
                             Layout.fillHeight: true
                         }
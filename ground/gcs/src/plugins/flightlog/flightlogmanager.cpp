@@ -44,7 +44,8 @@
 FlightLogManager::FlightLogManager(QObject *parent) :
     QObject(parent), m_disableControls(false),
     m_disableExport(true), m_cancelDownload(false),
-    m_adjustExportedTimestamps(true)
+    m_adjustExportedTimestamps(true), m_streaming(false),
+    m_downloadedEntries(0), m_downloadTotal(0)
 {
     ExtensionSystem::PluginManager *pluginManager = ExtensionSystem::PluginManager::instance();
 
@@ -68,6 +69,14 @@ FlightLogManager::FlightLogManager(QObject *parent) :
 
     m_flightLogEntry    = DebugLogEntry::GetInstance(m_objectManager);
     Q_ASSERT(m_flightLogEntry);
+    // streamed entries arrive in every instance, more are created as they are first received
+    foreach(UAVObject * obj, m_objectManager->getObjectInstances(DebugLogEntry::OBJID)) {
+        logEntryInstanceAdded(obj);
+    }
+    connect(m_flightLogEntry, SIGNAL(newInstance(UAVObject *)), this, SLOT(logEntryInstanceAdded(UAVObject *)));
+
+    m_streamTimer.setSingleShot(true);
+    connect(&m_streamTimer, SIGNAL(timeout()), &m_streamLoop, SLOT(quit()));
 
     m_flightLogSettings = DebugLogSettings::GetInstance(m_objectManager);
     Q_ASSERT(m_flightLogSettings);
@@ -191,8 +200,6 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     setDisableControls(true);
     QApplication::setOverrideCursor(Qt::WaitCursor);
     m_cancelDownload = false;
-    UAVObjectUpdaterHelper updateHelper;
-    UAVObjectRequestHelper requestHelper;
 
     clearLogList();
 
@@ -200,68 +207,34 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     int startFlight = (flightToRetrieve == -1) ? 0 : flightToRetrieve;
     int endFlight   = (flightToRetrieve == -1) ? m_flightLogStatus->getFlight() : flightToRetrieve;
 
-    // Prepare to send request for event retrieval
-    m_flightLogControl->setOperation(DebugLogControl::OPERATION_RETRIEVE);
+    // All flights fill the used slots, only the number of entries of the current one is known otherwise
+    if (flightToRetrieve == -1) {
+        m_downloadTotal = m_flightLogStatus->getUsedSlots();
+    } else if (flightToRetrieve == m_flightLogStatus->getFlight()) {
+        m_downloadTotal = m_flightLogStatus->getEntry();
+    } else {
+        m_downloadTotal = 0;
+    }
+    m_downloadedEntries = 0;
+    m_downloadTime.start();
+    emit downloadProgressChanged();
+
+    m_streaming = true;
     for (int flight = startFlight; flight <= endFlight; flight++) {
-        m_flightLogControl->setFlight(flight);
-        bool gotLast = false;
-        int slot     = 0;
-        while (!gotLast) {
-            // Send request for loading flight entry on flight side and wait for ack/nack
-            m_flightLogControl->setEntry(slot);
-
-            if (updateHelper.doObjectAndWait(m_flightLogControl, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS &&
-                requestHelper.doObjectAndWait(m_flightLogEntry, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS) {
-                if (m_flightLogEntry->getType() != DebugLogEntry::TYPE_EMPTY) {
-                    // Ok, we retrieved the entry, and it was the correct one. clone it and add it to the list
-                    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
-
-                    logEntry->setData(m_flightLogEntry->getData(), m_objectManager);
-                    m_logEntries << logEntry;
-                    if (logEntry->getData().Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
-                        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
-                        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
-                        const quint32 header_len = total_len - data_len;
-
-                        DebugLogEntry::DataFields fields;
-                        quint32 start = logEntry->getData().Size;
-
-                        // cycle until there is space for another object
-                        while (start + header_len + 1 < data_len) {
-                            memset(&fields, 0xFF, total_len);
-                            memcpy(&fields, &logEntry->getData().Data[start], header_len);
-                            // check wether a packed object is found
-                            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
-                            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
-                            quint32 toread = header_len + fields.Size;
-                            if (!(toread + start > data_len)) {
-                                memcpy(&fields, &logEntry->getData().Data[start], toread);
-                                ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
-                                subEntry->setData(fields, m_objectManager);
-                                m_logEntries << subEntry;
-                            }
-                            start += toread;
-                        }
-                    }
+        bool success = retrieveFlight(flight);
 
-                    // Increment to get next entry from flight side
-                    slot++;
-                } else {
-                    // We are done, not more entries on this flight
-                    gotLast = true;
-                }
-            } else {
-                // We failed for some reason
-                break;
-            }
-            if (m_cancelDownload) {
-                break;
-            }
+        // Entries may have arrived out of order, the map lists them in order
+        foreach(const DebugLogEntry::DataFields &data, m_streamEntries) {
+            addLogEntry(data);
         }
-        if (m_cancelDownload) {
+        m_streamEntries.clear();
+
+        if (!success) {
+            // Cancelled or we failed for some reason
             break;
         }
     }
+    m_streaming = false;
 
     if (m_cancelDownload) {
         clearLogList();
@@ -275,11 +248,166 @@ void FlightLogManager::retrieveLogs(int flightToRetrieve)
     setDisableControls(false);
 }
 
+bool FlightLogManager::retrieveFlight(int flight)
+{
+    UAVObjectUpdaterHelper updateHelper;
+    int firstMissing = 0;
+    int retries = 0;
+
+    m_streamEntries.clear();
+    m_streamFlight   = flight;
+    m_streamEnd      = -1;
+    m_streamProgress = 0;
+
+    m_flightLogControl->setOperation(DebugLogControl::OPERATION_STREAM);
+    m_flightLogControl->setFlight(flight);
+    while (!m_cancelDownload) {
+        // Ask for the next run of missing entries, up to where the flight ends once it is known
+        while (m_streamEntries.contains(firstMissing)) {
+            firstMissing++;
+        }
+        if (m_streamEnd >= 0 && firstMissing >= m_streamEnd) {
+            return true;
+        }
+        int count = 1;
+        while (count < STREAM_WINDOW && !m_streamEntries.contains(firstMissing + count) &&
+               (m_streamEnd < 0 || firstMissing + count < m_streamEnd)) {
+            count++;
+        }
+        m_streamWindowStart = firstMissing;
+        m_streamWindowEnd   = firstMissing + count;
+
+        int progress = m_streamProgress;
+        m_flightLogControl->setEntry(firstMissing);
+        m_flightLogControl->setCount(count);
+        if (updateHelper.doObjectAndWait(m_flightLogControl, UAVTALK_TIMEOUT) == UAVObjectUpdaterHelper::SUCCESS &&
+            !streamWindowDone()) {
+            // Entries keep coming back to back, give up on the rest of the window after a silence
+            m_streamTimer.start(STREAM_TIMEOUT);
+            m_streamLoop.exec();
+            m_streamTimer.stop();
+        }
+
+        if (m_streamProgress != progress) {
+            retries = 0;
+        } else if (++retries > STREAM_RETRIES) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool FlightLogManager::streamWindowDone()
+{
+    int end = (m_streamEnd >= 0) ? qMin(m_streamEnd, m_streamWindowEnd) : m_streamWindowEnd;
+
+    for (int entry = m_streamWindowStart; entry < end; entry++) {
+        if (!m_streamEntries.contains(entry)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FlightLogManager::logEntryInstanceAdded(UAVObject *obj)
+{
+    connect(obj, SIGNAL(objectUnpacked(UAVObject *)), this, SLOT(logEntryUnpacked(UAVObject *)));
+}
+
+void FlightLogManager::logEntryUnpacked(UAVObject *obj)
+{
+    DebugLogEntry *logEntry = qobject_cast<DebugLogEntry *>(obj);
+
+    if (!m_streaming || !logEntry) {
+        return;
+    }
+
+    DebugLogEntry::DataFields data = logEntry->getData();
+    if (data.Flight != m_streamFlight) {
+        // Left over from an earlier request
+        return;
+    }
+    if (data.Type == DebugLogEntry::TYPE_EMPTY) {
+        // There are no more entries on this flight
+        if (m_streamEnd < 0 || data.Entry < m_streamEnd) {
+            m_streamEnd = data.Entry;
+            m_streamProgress++;
+        }
+    } else if (!m_streamEntries.contains(data.Entry)) {
+        m_streamEntries.insert(data.Entry, data);
+        m_streamProgress++;
+        m_downloadedEntries++;
+        emit downloadProgressChanged();
+    }
+
+    if (streamWindowDone()) {
+        m_streamLoop.quit();
+    } else if (m_streamTimer.isActive()) {
+        m_streamTimer.start(STREAM_TIMEOUT);
+    }
+}
+
+void FlightLogManager::addLogEntry(const DebugLogEntry::DataFields & data)
+{
+    // Clone the entry and add it to the list
+    ExtendedDebugLogEntry *logEntry = new ExtendedDebugLogEntry();
+
+    logEntry->setData(data, m_objectManager);
+    m_logEntries << logEntry;
+    if (logEntry->getData().Type == DebugLogEntry::TYPE_MULTIPLEUAVOBJECTS) {
+        const quint32 total_len  = sizeof(DebugLogEntry::DataFields);
+        const quint32 data_len   = sizeof(((DebugLogEntry::DataFields *)0)->Data);
+        const quint32 header_len = total_len - data_len;
+
+        DebugLogEntry::DataFields fields;
+        quint32 start = logEntry->getData().Size;
+
+        // cycle until there is space for another object
+        while (start + header_len + 1 < data_len) {
+            memset(&fields, 0xFF, total_len);
+            memcpy(&fields, &logEntry->getData().Data[start], header_len);
+            // check wether a packed object is found
+            // note that empty data blocks are set as 0xFF in flight side to minimize flash wearing
+            // thus as soon as this read outside of used area, the test will fail as lenght would be 0xFFFF
+            quint32 toread = header_len + fields.Size;
+            if (!(toread + start > data_len)) {
+                memcpy(&fields, &logEntry->getData().Data[start], toread);
+                ExtendedDebugLogEntry *subEntry = new ExtendedDebugLogEntry();
+                subEntry->setData(fields, m_objectManager);
+                m_logEntries << subEntry;
+            }
+            start += toread;
+        }
+    }
+}
+
+int FlightLogManager::downloadProgress() const
+{
+    if (m_downloadTotal <= 0) {
+        return -1;
+    }
+    return qMin(100, 100 * m_downloadedEntries / m_downloadTotal);
+}
+
+double FlightLogManager::downloadRate() const
+{
+    qint64 elapsed = m_downloadTime.isValid() ? m_downloadTime.elapsed() : 0;
+
+    if (elapsed <= 0) {
+        return 0.0;
+    }
+    // bytes per millisecond are kilobytes per second
+    return (double)m_downloadedEntries * DebugLogEntry::NUMBYTES / elapsed;
+}
+
 void FlightLogManager::exportToOPL(QString fileName)
 {
     // Fix the file name
     fileName.replace(QString(".opl"), QString("%1.opl"));
 
+    // The objects of this GCS describe the exported logs
+    QList<LogFile::ObjectDefinition> definitions = m_objectManager->getObjectDefinitions();
+
     // Loop and create a new file for each flight.
     int currentEntry  = 0;
     int currentFlight = 0;
@@ -295,6 +423,7 @@ void FlightLogManager::exportToOPL(QString fileName)
 
         LogFile logFile;
         logFile.useProvidedTimeStamp(true);
+        logFile.setObjectDefinitions(definitions);
 
         // Set the file name to contain flight number
         logFile.setFileName(fileName.arg(tr("_flight-%1").arg(currentFlight + 1)));
@@ -415,6 +544,7 @@ void FlightLogManager::exportLogs()
 void FlightLogManager::cancelExportLogs()
 {
     m_cancelDownload = true;
+    m_streamLoop.quit();
 }
 
 void FlightLogManager::loadSettings()
@@ -31,6 +31,10 @@
 #include <QObject>
 #include <QList>
 #include <QHash>
+#include <QMap>
+#include <QEventLoop>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QQmlListProperty>
 #include <QSemaphore>
 #include <QXmlStreamWriter>
@@ -183,6 +187,8 @@ class FlightLogManager : public QObject {
     Q_PROPERTY(QStringList logStatuses READ logStatuses NOTIFY logStatusesChanged)
     Q_PROPERTY(int loggingEnabled READ loggingEnabled WRITE setLoggingEnabled NOTIFY loggingEnabledChanged)
     Q_PROPERTY(int logEntriesCount READ logEntriesCount NOTIFY logEntriesChanged)
+    Q_PROPERTY(int downloadProgress READ downloadProgress NOTIFY downloadProgressChanged)
+    Q_PROPERTY(double downloadRate READ downloadRate NOTIFY downloadProgressChanged)
 
 public:
     explicit FlightLogManager(QObject *parent = 0);
@@ -248,6 +254,13 @@ public:
     {
         return m_logEntries.count();
     }
+
+    // percentage of the entries to download, -1 if their number is not known
+    int downloadProgress() const;
+
+    // kilobytes per second
+    double downloadRate() const;
+
 signals:
     void logEntriesChanged();
     void flightEntriesChanged();
@@ -260,6 +273,7 @@ signals:
 
     void logStatusesChanged(QStringList arg);
     void loggingEnabledChanged(int arg);
+    void downloadProgressChanged();
 
 public slots:
     void clearAllLogs();
@@ -319,6 +333,8 @@ private slots:
     void setupLogStatuses();
     void connectionStatusChanged();
     bool updateLogWrapper(QString name, int level, int period);
+    void logEntryInstanceAdded(UAVObject *obj);
+    void logEntryUnpacked(UAVObject *obj);
 
 private:
     UAVObjectManager *m_objectManager;
@@ -338,11 +354,35 @@ private:
     QList<UAVOLogSettingsWrapper *> m_uavoEntries;
     QHash<QString, UAVOLogSettingsWrapper *> m_uavoEntriesHash;
 
+    // entries of the flight being streamed, by entry number
+    QMap<quint16, DebugLogEntry::DataFields> m_streamEntries;
+    bool m_streaming;
+    int m_streamFlight;
+    int m_streamEnd;
+    int m_streamWindowStart;
+    int m_streamWindowEnd;
+    int m_streamProgress;
+    QEventLoop m_streamLoop;
+    QTimer m_streamTimer;
+
+    int m_downloadedEntries;
+    int m_downloadTotal;
+    QElapsedTimer m_downloadTime;
+
+    bool retrieveFlight(int flight);
+    bool streamWindowDone();
+    void addLogEntry(const DebugLogEntry::DataFields & data);
+
     void exportToOPL(QString fileName);
     void exportToCSV(QString fileName);
     void exportToXML(QString fileName);
 
     static const int UAVTALK_TIMEOUT = 4000;
+    // entries asked for at once, the flight side streams them through as many DebugLogEntry instances
+    static const int STREAM_WINDOW  = 8;
+    // silence after which the missing entries of a window are asked for again
+    static const int STREAM_TIMEOUT = 1000;
+    static const int STREAM_RETRIES = 5;
     static const int LOG_SETTINGS_FILE_VERSION = 1;
     bool m_disableControls;
     bool m_disableExport;
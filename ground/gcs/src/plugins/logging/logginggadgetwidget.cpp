@@ -58,6 +58,12 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin *p)
     connect(m_logging->pauseButton, SIGNAL(clicked()), p->getLogfile(), SLOT(pauseReplay()));
     connect(m_logging->pauseButton, SIGNAL(clicked()), scpPlugin, SLOT(stopPlotting()));
     connect(m_logging->playbackSpeed, SIGNAL(valueChanged(double)), p->getLogfile(), SLOT(setReplaySpeed(double)));
+    connect(p->getLogfile(), SIGNAL(replayStarted()), this, SLOT(replayStarted()));
+    connect(p->getLogfile(), SIGNAL(replayFinished()), this, SLOT(replayStopped()));
+    connect(p->getLogfile(), SIGNAL(replayPositionChanged(quint32)), this, SLOT(replayPositionChanged(quint32)));
+    connect(m_logging->positionSlider, SIGNAL(sliderMoved(int)), this, SLOT(seekReplay(int)));
+    connect(m_logging->stepBackButton, SIGNAL(clicked()), this, SLOT(stepBackward()));
+    connect(m_logging->stepForwardButton, SIGNAL(clicked()), this, SLOT(stepForward()));
     void pauseReplay();
     void resumeReplay();
 }
@@ -68,6 +74,56 @@ void LoggingGadgetWidget::stateChanged(QString status)
     m_logging->statusLabel->setText(status);
 }
 
+static QString formatTime(quint32 timeStamp)
+{
+    quint32 seconds = timeStamp / 1000;
+
+    return QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+void LoggingGadgetWidget::replayStarted()
+{
+    m_logging->positionSlider->setRange(0, loggingPlugin->getLogfile()->replayDuration());
+    setReplayControlsEnabled(true);
+    replayPositionChanged(0);
+}
+
+void LoggingGadgetWidget::replayStopped()
+{
+    setReplayControlsEnabled(false);
+}
+
+void LoggingGadgetWidget::replayPositionChanged(quint32 timeStamp)
+{
+    // don't fight the user dragging it
+    if (!m_logging->positionSlider->isSliderDown()) {
+        m_logging->positionSlider->setValue(timeStamp);
+    }
+    m_logging->positionLabel->setText(formatTime(timeStamp) + " / " + formatTime(loggingPlugin->getLogfile()->replayDuration()));
+}
+
+void LoggingGadgetWidget::seekReplay(int timeStamp)
+{
+    loggingPlugin->getLogfile()->seekReplay(timeStamp);
+}
+
+void LoggingGadgetWidget::stepBackward()
+{
+    loggingPlugin->getLogfile()->stepReplay(-STEP_MS);
+}
+
+void LoggingGadgetWidget::stepForward()
+{
+    loggingPlugin->getLogfile()->stepReplay(STEP_MS);
+}
+
+void LoggingGadgetWidget::setReplayControlsEnabled(bool enabled)
+{
+    m_logging->positionSlider->setEnabled(enabled);
+    m_logging->stepBackButton->setEnabled(enabled);
+    m_logging->stepForwardButton->setEnabled(enabled);
+}
+
 /**
  * @}
  * @}
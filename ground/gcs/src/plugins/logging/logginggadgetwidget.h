@@ -47,12 +47,22 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void replayStarted();
+    void replayStopped();
+    void replayPositionChanged(quint32 timeStamp);
+    void seekReplay(int timeStamp);
+    void stepBackward();
+    void stepForward();
 
 signals:
     void pause();
     void play();
 
 private:
+    static const int STEP_MS = 1000;
+
+    void setReplayControlsEnabled(bool enabled);
+
     Ui_Logging *m_logging;
     LoggingPlugin *loggingPlugin;
     ScopeGadgetFactory *scpPlugin;
@@ -127,12 +127,15 @@ LoggingThread::~LoggingThread()
  */
 bool LoggingThread::openFile(QString file, LoggingPlugin *parent)
 {
-    logFile.setFileName(file);
-    logFile.open(QIODevice::WriteOnly);
-
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     UAVObjectManager *objManager = pm->getObject<UAVObjectManager>();
 
+    // Describe all objects in the log header
+    logFile.setObjectDefinitions(objManager->getObjectDefinitions());
+
+    logFile.setFileName(file);
+    logFile.open(QIODevice::WriteOnly);
+
     uavTalk = new UAVTalk(&logFile, objManager);
     connect(parent, SIGNAL(stopLoggingSignal()), this, SLOT(stopLogging()));
 
@@ -32,7 +32,9 @@
 #include "uavobject.h"
 #include "uavdataobject.h"
 #include "uavmetaobject.h"
+#include <utils/logfile.h>
 #include <QList>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QJsonObject>
@@ -49,6 +51,7 @@ public:
     QList< QList<UAVObject *> > getObjects();
     QList< QList<UAVDataObject *> > getDataObjects();
     QList< QList<UAVMetaObject *> > getMetaObjects();
+    QList<LogFile::ObjectDefinition> getObjectDefinitions();
     UAVObject *getObject(const QString & name, quint32 instId = 0);
     UAVObject *getObject(quint32 objId, quint32 instId = 0);
     QList<UAVObject *> getObjectInstances(const QString & name);
@@ -69,9 +72,13 @@ private:
     static const quint32 MAX_INSTANCES = 1000;
 
     QList< QList<UAVObject *> > objects;
+    // Index of each object type in the objects list, by object ID and by name
+    QHash<quint32, int> objectIdIndex;
+    QHash<QString, int> objectNameIndex;
     QMutex *mutex;
 
     void addObject(UAVObject *obj);
+    int getObjectIndex(const QString *name, quint32 objId) const;
     UAVObject *getObject(const QString *name, quint32 objId, quint32 instId);
     QList<UAVObject *> getObjectInstances(const QString *name, quint32 objId);
     qint32 getNumInstances(const QString *name, quint32 objId);
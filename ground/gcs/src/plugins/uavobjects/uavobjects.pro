@@ -61,6 +61,7 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/callbackinfo.xml \
     $${UAVOBJ_XML_DIR}/cameradesired.xml \
     $${UAVOBJ_XML_DIR}/camerastabsettings.xml \
+    $${UAVOBJ_XML_DIR}/controllatencystatus.xml \
     $${UAVOBJ_XML_DIR}/debuglogcontrol.xml \
     $${UAVOBJ_XML_DIR}/debuglogentry.xml \
     $${UAVOBJ_XML_DIR}/debuglogsettings.xml \
@@ -125,6 +126,7 @@ UAVOBJS = \
     $${UAVOBJ_XML_DIR}/receiverstatus.xml \
     $${UAVOBJ_XML_DIR}/revocalibration.xml \
     $${UAVOBJ_XML_DIR}/revosettings.xml \
+    $${UAVOBJ_XML_DIR}/sensorfiltersettings.xml \
     $${UAVOBJ_XML_DIR}/sonaraltitude.xml \
     $${UAVOBJ_XML_DIR}/stabilizationbank.xml \
     $${UAVOBJ_XML_DIR}/stabilizationdesired.xml \
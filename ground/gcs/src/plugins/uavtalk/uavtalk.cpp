@@ -361,8 +361,9 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
         // Search for object, if not found reset state machine
         {
-            UAVObject *rxObj = objMngr->getObject(rxObjId);
-            if (rxObj == NULL && rxType != TYPE_OBJ_REQ) {
+            // multi object packets carry several objects, their length is given by the packet size
+            UAVObject *rxObj = (rxType == TYPE_OBJ_MULTI) ? NULL : objMngr->getObject(rxObjId);
+            if (rxObj == NULL && rxType != TYPE_OBJ_REQ && rxType != TYPE_OBJ_MULTI) {
                 qWarning() << "UAVTalk - error : unknown object" << rxObjId;
                 stats.rxErrors++;
                 rxState = STATE_ERROR;
@@ -584,6 +585,10 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
         }
         break;
 
+    case TYPE_OBJ_MULTI:
+        error = (objId != MULTI_OBJID) || !receiveMultiObject(instId, data, length);
+        break;
+
     default:
         error = true;
     }
@@ -594,6 +599,98 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *
     return !error;
 }
 
+/**
+ * Receive a multi object packet, each entry is handled like a TYPE_OBJ message.
+ * Delta entries only carry the 32bit words changed since the previous update of the object.
+ * An empty packet offers multi object support, it is answered so the sender starts packing objects.
+ * \param[in] count Number of entries, or the announce bitmask for empty packets
+ * \param[in] data Data buffer
+ * \param[in] length Buffer length
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveMultiObject(quint16 count, quint8 *data, qint32 length)
+{
+    if (length == 0) {
+        if (!(count & MULTI_ANSWER)) {
+            return transmitSingleObject(TYPE_OBJ_MULTI, MULTI_OBJID, MULTI_ANSWER | MULTI_DELTA, NULL);
+        }
+        return true;
+    }
+
+    bool ok = true;
+    qint32 offset = 0;
+    for (quint16 n = 0; n < count; n++) {
+        if (offset + MULTI_ENTRY_HEADER_LENGTH > length) {
+            qWarning() << "UAVTalk - error : truncated multi object packet";
+            return false;
+        }
+        quint32 objId  = qFromLittleEndian<quint32>(&data[offset]);
+        quint16 instId = qFromLittleEndian<quint16>(&data[offset + 4]);
+        offset += MULTI_ENTRY_HEADER_LENGTH;
+
+        // the entry length is only known for known objects, the rest of the packet is lost otherwise
+        UAVObject *typeObj = objMngr->getObject(objId);
+        if (typeObj == NULL || instId == ALL_INSTANCES) {
+            qWarning() << "UAVTalk - error : unknown object in multi object packet" << objId;
+            return false;
+        }
+        qint32 size    = typeObj->getNumBytes();
+        UAVObject *obj = NULL;
+
+        if (instId & DELTA_FLAG) {
+            // patch the changed words into the current object data
+            instId &= ~DELTA_FLAG;
+            const quint8 *bitmap = &data[offset];
+            offset += ((size + DELTA_WORD - 1) / DELTA_WORD + 7) / 8;
+            if (offset > length) {
+                return false;
+            }
+            // a delta can not create the instance, it is skipped until the next keyframe
+            UAVObject *instObj = objMngr->getObject(objId, instId);
+            QByteArray image(size, 0);
+            if (instObj) {
+                instObj->pack((quint8 *)image.data());
+            }
+            for (qint32 word = 0; word * DELTA_WORD < size; word++) {
+                if (bitmap[word / 8] & (1 << (word % 8))) {
+                    qint32 start = word * DELTA_WORD;
+                    qint32 bytes = qMin(DELTA_WORD, size - start);
+                    if (offset + bytes > length) {
+                        return false;
+                    }
+                    memcpy(image.data() + start, &data[offset], bytes);
+                    offset += bytes;
+                }
+            }
+            if (instObj) {
+                instObj->unpack((const quint8 *)image.constData());
+                obj = instObj;
+                stats.rxDeltaObjects++;
+            }
+        } else {
+            if (offset + size > length) {
+                return false;
+            }
+            obj     = updateObject(objId, instId, &data[offset]);
+            offset += size;
+        }
+#ifdef VERBOSE_UAVTALK
+        VERBOSE_FILTER(objId) qDebug() << "UAVTalk - received packed object" << objId << instId << (obj != NULL ? obj->toStringBrief() : "<null object>");
+#endif
+        if (obj != NULL) {
+            updateAck(TYPE_OBJ, objId, instId, obj);
+        } else {
+            ok = false;
+        }
+    }
+    // the packet itself is accounted as one object, an empty one keeps that
+    if (count > 0) {
+        stats.rxObjects += count - 1;
+    }
+
+    return ok && offset == length;
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
@@ -757,7 +854,7 @@ bool UAVTalk::transmitSingleObject(quint8 type, quint32 objId, quint16 instId, U
     qToLittleEndian<quint16>(instId, &txBuffer[8]);
 
     // Determine data length
-    if (type == TYPE_OBJ_REQ || type == TYPE_ACK || type == TYPE_NACK) {
+    if (type == TYPE_OBJ_REQ || type == TYPE_ACK || type == TYPE_NACK || type == TYPE_OBJ_MULTI) {
         length = 0;
     } else {
         length = obj->getNumBytes();
@@ -896,6 +993,11 @@ const char *UAVTalk::typeToString(quint8 type)
     case TYPE_NACK:
         return "nack";
 
+        break;
+
+    case TYPE_OBJ_MULTI:
+        return "multi object";
+
         break;
     }
     return "<error>";
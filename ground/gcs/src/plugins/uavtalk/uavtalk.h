@@ -58,6 +58,8 @@ public:
         quint32 rxErrors;
         quint32 rxSyncErrors;
         quint32 rxCrcErrors;
+
+        quint32 rxDeltaObjects;
     } ComStats;
 
     UAVTalk(QIODevice *iodev, UAVObjectManager *objMngr);
@@ -93,6 +95,18 @@ private:
     static const int TYPE_OBJ_ACK  = (TYPE_VER | 0x02);
     static const int TYPE_ACK      = (TYPE_VER | 0x03);
     static const int TYPE_NACK     = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_MULTI = (TYPE_VER | 0x05);
+
+    // multi object packets : object ID field is MULTI_OBJID, instance ID field is the number of entries
+    // empty multi object packets negotiate support, the instance ID field is a bitmask of MULTI_ANSWER and MULTI_DELTA
+    static const quint32 MULTI_OBJID  = 0;
+    static const quint16 MULTI_ANSWER = 0x0001;
+    static const quint16 MULTI_DELTA  = 0x0002;
+    // multi object entry header : object ID(4), instance ID(2)
+    static const int MULTI_ENTRY_HEADER_LENGTH = 6;
+    // instance ID flag of delta encoded entries : bitmap of changed 32bit words followed by the changed words
+    static const quint16 DELTA_FLAG   = 0x8000;
+    static const int DELTA_WORD = 4;
 
     // header : sync(1), type (1), size(2), object ID(4), instance ID(2)
     static const int HEADER_LENGTH = 10;
@@ -149,6 +163,7 @@ private:
     bool objectTransaction(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     bool processInputByte(quint8 rxbyte);
     bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length);
+    bool receiveMultiObject(quint16 count, quint8 *data, qint32 length);
     UAVObject *updateObject(quint32 objId, quint16 instId, quint8 *data);
     void updateAck(quint8 type, quint32 objId, quint16 instId, UAVObject *obj);
     void updateNack(quint32 objId, quint16 instId, UAVObject *obj);
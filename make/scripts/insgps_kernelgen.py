@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+#
+# Generates the sparsity specialized covariance kernels used by the INSGPS EKF
+# (flight/libraries/insgps13state.c and insgps16state.c).
+#
+# The F, G and H patterns below must match LinearizeFG() and LinearizeH() of
+# the respective filter. X marks an element computed at run time, 1 and - mark
+# elements that are constant +1 and -1, everything else is a structural zero.
+#
+# Only the upper triangle of the new covariance is computed and mirrored, the
+# intermediate (P/T + F*P) is only computed where the upper triangle needs it,
+# and all loops are unrolled with zero terms dropped and unit terms reduced to
+# additions. Terms are summed in the same order as the generic loops so the
+# results match them to rounding.
+#
+# Usage: insgps_kernelgen.py 13|16 > flight/libraries/inc/insgps<N>kernels.h
+#
+# (c) 2016, The LibrePilot Project, http://www.librepilot.org
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+
+import sys
+
+PATTERNS = {
+    13: {
+        'F': """
+            ...1.........
+            ....1........
+            .....1.......
+            ......XXXX...
+            ......XXXX...
+            ......XXXX...
+            .......XXXXXX
+            ......X.XXXXX
+            ......XX.XXXX
+            ......XXX.XXX
+            .............
+            .............
+            .............
+        """,
+        'G': """
+            .........
+            .........
+            .........
+            ...XXX...
+            ...XXX...
+            ...XXX...
+            XXX......
+            XXX......
+            XXX......
+            XXX......
+            ......1..
+            .......1.
+            ........1
+        """,
+        'H': """
+            1............
+            .1...........
+            ..1..........
+            ...1.........
+            ....1........
+            .....1.......
+            ......XXXX...
+            ......XXXX...
+            ......XXXX...
+            ..-..........
+        """,
+    },
+    16: {
+        'F': """
+            ...1............
+            ....1...........
+            .....1..........
+            ......XXXX...XXX
+            ......XXXX...XXX
+            ......XXXX...XXX
+            .......XXXXXX...
+            ......X.XXXXX...
+            ......XX.XXXX...
+            ......XXX.XXX...
+            ................
+            ................
+            ................
+            ................
+            ................
+            ................
+        """,
+        'G': """
+            ............
+            ............
+            ............
+            ...XXX......
+            ...XXX......
+            ...XXX......
+            XXX.........
+            XXX.........
+            XXX.........
+            XXX.........
+            ......1.....
+            .......1....
+            ........1...
+            .........1..
+            ..........1.
+            ...........1
+        """,
+        'H': """
+            1...............
+            .1..............
+            ..1.............
+            ...1............
+            ....1...........
+            .....1..........
+            ......XXXX......
+            ......XXXX......
+            ......XXXX......
+            ..-.............
+        """,
+    },
+}
+
+
+def parse(pattern):
+    rows = [line.strip() for line in pattern.strip().splitlines()]
+    return [[c if c in 'X1-' else None for c in row] for row in rows]
+
+
+def nonzeros(row):
+    return [k for k, c in enumerate(row) if c]
+
+
+def product(a, b, kind):
+    # a * b where b is an element of the given kind, returns (sign, expression)
+    if kind == '1':
+        return '+', a
+    if kind == '-':
+        return '-', a
+    return '+', '%s * %s' % (a, b)
+
+
+def join(first, terms):
+    out = first
+    for sign, expr in terms:
+        out += ' %s %s' % (sign, expr)
+    return out
+
+
+def covariance(n, F, G, nw):
+    lines = []
+    lines.append('static inline void insgps%d_covariance_prediction(float F[%d][%d], float G[%d][%d], float Q[%d], float dT, float P[%d][%d])' % (n, n, n, n, nw, nw, n, n))
+    lines.append('{')
+    lines.append('    const float dT1  = 1.0f / dT;')
+    lines.append('    const float dTsq = dT * dT;')
+    lines.append('    float D[%d][%d];' % (n, n))
+    lines.append('')
+    lines.append('    // D = P/T + F*P, only where the upper triangle of Pnew needs it')
+    for i in range(n):
+        cols = set(range(i, n))
+        for j in range(i, n):
+            cols.update(nonzeros(F[j]))
+        for c in sorted(cols):
+            terms = [product('F[%d][%d]' % (i, k), 'P[%d][%d]' % (k, c), F[i][k]) if F[i][k] == 'X'
+                     else product('P[%d][%d]' % (k, c), None, F[i][k]) for k in nonzeros(F[i])]
+            lines.append('    D[%d][%d] = %s;' % (i, c, join('P[%d][%d] * dT1' % (i, c), terms)))
+    lines.append('')
+    lines.append('    // Pnew = T^2 * (D/T + D*F\' + G*Q*G\'), upper triangle mirrored to the lower one')
+    for i in range(n):
+        for j in range(i, n):
+            terms = [product('D[%d][%d]' % (i, k), 'F[%d][%d]' % (j, k), F[j][k]) for k in nonzeros(F[j])]
+            for k in range(nw):
+                if G[i][k] and G[j][k]:
+                    if G[i][k] in '1-' and G[j][k] in '1-':
+                        sign = '+' if G[i][k] == G[j][k] else '-'
+                        terms.append((sign, 'Q[%d]' % k))
+                    elif G[i][k] in '1-':
+                        terms.append(('+' if G[i][k] == '1' else '-', 'Q[%d] * G[%d][%d]' % (k, j, k)))
+                    elif G[j][k] in '1-':
+                        terms.append(('+' if G[j][k] == '1' else '-', 'Q[%d] * G[%d][%d]' % (k, i, k)))
+                    else:
+                        terms.append(('+', 'Q[%d] * G[%d][%d] * G[%d][%d]' % (k, i, k, j, k)))
+            target = 'P[%d][%d]' % (i, j) if i == j else 'P[%d][%d] = P[%d][%d]' % (i, j, j, i)
+            lines.append('    %s = (%s) * dTsq;' % (target, join('D[%d][%d] * dT1' % (i, j), terms)))
+    lines.append('}')
+    return lines
+
+
+def measurement(n, H, nv):
+    lines = []
+    lines.append('static inline float insgps%d_measurement_hp(uint8_t m, float H[%d][%d], float R[%d], float P[%d][%d], float HP[%d])' % (n, nv, n, nv, n, n, n))
+    lines.append('{')
+    lines.append('    switch (m) {')
+    for m in range(nv):
+        lines.append('    case %d:' % m)
+        ks = nonzeros(H[m])
+        for j in range(n):
+            terms = []
+            for k in ks:
+                if H[m][k] == '1':
+                    terms.append(('+', 'P[%d][%d]' % (k, j)))
+                elif H[m][k] == '-':
+                    terms.append(('-', 'P[%d][%d]' % (k, j)))
+                else:
+                    terms.append(('+', 'H[%d][%d] * P[%d][%d]' % (m, k, k, j)))
+            sign, first = terms[0]
+            expr = join(first if sign == '+' else '-' + first, terms[1:])
+            lines.append('        HP[%d] = %s;' % (j, expr))
+        terms = [product('HP[%d]' % k, 'H[%d][%d]' % (m, k), H[m][k]) for k in ks]
+        lines.append('        return %s;' % join('R[%d]' % m, terms))
+        lines.append('')
+    lines.append('    default:')
+    lines.append('        return 0.0f;')
+    lines.append('    }')
+    lines.append('}')
+    return lines
+
+
+def main():
+    if len(sys.argv) != 2 or int(sys.argv[1]) not in PATTERNS:
+        sys.exit('usage: %s 13|16' % sys.argv[0])
+    n = int(sys.argv[1])
+    F = parse(PATTERNS[n]['F'])
+    G = parse(PATTERNS[n]['G'])
+    H = parse(PATTERNS[n]['H'])
+    guard = 'INSGPS%dKERNELS_H' % n
+
+    out = []
+    out.append('/*')
+    out.append(' * Generated by make/scripts/insgps_kernelgen.py %d, do not edit.' % n)
+    out.append(' *')
+    out.append(' * Covariance prediction and measurement kernels of the %d state INSGPS EKF,' % n)
+    out.append(' * specialized for the sparsity of F, G and H in LinearizeFG() and LinearizeH().')
+    out.append(' */')
+    out.append('#ifndef %s' % guard)
+    out.append('#define %s' % guard)
+    out.append('')
+    out.append('#include <stdint.h>')
+    out.append('')
+    out.append('/**')
+    out.append(' * Pnew = (I+F*T)*P*(I+F*T)\' + T^2*G*Q*G\', written over P')
+    out.append(' */')
+    out += covariance(n, F, G, len(G[0]))
+    out.append('')
+    out.append('/**')
+    out.append(' * HP = H[m]*P for one measurement')
+    out.append(' * \\return H[m]*P*H[m]\' + R[m]')
+    out.append(' */')
+    out += measurement(n, H, len(H))
+    out.append('')
+    out.append('#endif /* %s */' % guard)
+    print('\n'.join(out))
+
+
+if __name__ == '__main__':
+    main()